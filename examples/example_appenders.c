@@ -87,6 +87,8 @@ const log4c_appender_type_t log4c_appender_type_s13_file = {
     etf_open,
     s13_file_append,
     etf_close,
+    NULL,
+    LOG4C_NEEDS_TIME,
 };
 
 /*******************************************************************************/
@@ -113,6 +115,8 @@ const log4c_appender_type_t log4c_appender_type_s13_stderr = {
    s13_stderr_open,
    s13_stderr_append,
    NULL,
+   NULL,
+   LOG4C_NEEDS_NONE,
 };
 
 
@@ -151,6 +155,8 @@ const log4c_appender_type_t log4c_appender_type_syslog_user = {
     syslog_user_open,
     syslog_user_append,
     syslog_user_close,
+    NULL,
+    LOG4C_NEEDS_NONE,
 };
 
 /**************************/
@@ -187,6 +193,8 @@ const log4c_appender_type_t log4c_appender_type_syslog_local0 = {
   syslog_local0_open,
   syslog_local0_append,
   syslog_local0_close,
+  NULL,
+  LOG4C_NEEDS_NONE,
 };
 
 
@@ -40,6 +40,7 @@ static const char* cat_format(
 const log4c_layout_type_t log4c_layout_type_cat  = {
    "s13_cat",
    cat_format,
+   LOG4C_NEEDS_NONE,
 };
 
 
@@ -54,6 +55,7 @@ static const char* none_format(
 const log4c_layout_type_t log4c_layout_type_none  = {
   "s13_none",
   none_format,
+  LOG4C_NEEDS_NONE,
 };
 
 
@@ -79,6 +81,7 @@ static const char* xml_format(
 const log4c_layout_type_t log4c_layout_type_xml = {
     "s13_xml",
      xml_format,
+    LOG4C_NEEDS_NONE,
 };
 
 
@@ -51,6 +51,7 @@ static const char* userloc_format(
 const log4c_layout_type_t log4c_layout_type_userloc  = {
    "s13_userloc",
    userloc_format,
+   LOG4C_NEEDS_NONE,
 };
 
 /*****************************/
@@ -18,6 +18,8 @@
 #include <log4c/layout.h>
 #include <log4c/logging_event.h>
 #include <log4c/priority.h>
+#include <log4c/stats.h>
+#include <log4c/binlog.h>
 
 #endif
 
@@ -14,12 +14,15 @@ static const char version[] = "$Id$";
 
 #include <log4c/appender.h>
 #include <log4c/appender_type_stream.h>
+#include <log4c/category.h>
+#include <log4c/stats.h>
 #include <string.h>
 #include <sd/error.h>
 #include <sd/malloc.h>
 #include <sd/factory.h>
 #include <sd/hash.h>
 #include <sd/sd_xplatform.h>
+#include "trace.h"
 
 struct __log4c_appender
 {
@@ -28,10 +31,14 @@ struct __log4c_appender
   const log4c_appender_type_t*	app_type;
   int					app_isopen;
   void*				app_udata;
+  int					app_id;
 };
 
 sd_factory_t* log4c_appender_factory = NULL;
 
+/* ids are never reused, so that counters do not outlive their appender */
+static int log4c_appender_nids = 0;
+
 extern int reread_flag;
 
 /**
@@ -131,6 +138,7 @@ extern log4c_appender_t* log4c_appender_new(const char* a_name)
   this->app_layout = log4c_layout_get("basic");
   this->app_isopen = 0;
   this->app_udata  = NULL;
+  this->app_id     = log4c_appender_nids++;
   return this;
 }
 
@@ -166,12 +174,36 @@ extern const log4c_appender_type_t* log4c_appender_get_type(
   return (this ? this->app_type : NULL);
 }
 
+/*******************************************************************************/
+extern int log4c_appender_get_id(const log4c_appender_t* this)
+{
+  return (this ? this->app_id : -1);
+}
+
 /*******************************************************************************/
 extern const log4c_layout_t* log4c_appender_get_layout(const log4c_appender_t* this)
 {
   return (this ? this->app_layout : NULL);
 }
 
+/*******************************************************************************/
+extern int log4c_appender_get_needs(const log4c_appender_t* this)
+{
+  const log4c_layout_type_t* layout_type;
+  int needs;
+
+  if (!this || !this->app_type || !this->app_type->append)
+    return LOG4C_NEEDS_NONE;
+
+  needs = this->app_type->needs ? this->app_type->needs : LOG4C_NEEDS_ALL;
+
+  if ((layout_type = log4c_layout_get_type(this->app_layout)) != NULL &&
+      layout_type->format)
+    needs |= layout_type->needs ? layout_type->needs : LOG4C_NEEDS_ALL;
+
+  return needs;
+}
+
 /*******************************************************************************/
 extern void* log4c_appender_get_udata(const log4c_appender_t* this)
 {
@@ -190,6 +222,7 @@ extern const log4c_appender_type_t* log4c_appender_set_type(
   
   previous = this->app_type;
   this->app_type = a_type;
+  __log4c_category_refresh_needs();
   return previous;
 }
 
@@ -205,6 +238,7 @@ extern const log4c_layout_t* log4c_appender_set_layout(
   
   previous = this->app_layout;
   this->app_layout = a_layout;
+  __log4c_category_refresh_needs();
   return previous;
 }
 
@@ -278,6 +312,9 @@ extern int log4c_appender_append(
   log4c_appender_t*		this, 
   log4c_logging_event_t*	a_event)
 {
+  unsigned long long start;
+  int rc;
+
   if (!this)
     return -1;
   
@@ -287,6 +324,8 @@ extern int log4c_appender_append(
   if (!this->app_type->append)
     return 0;
   
+  start = __log4c_stats_start();
+
   if (!this->app_isopen || reread_flag==1)
   {
     if (log4c_appender_open(this) == -1)
@@ -295,6 +334,7 @@ extern int log4c_appender_append(
 		{
 			reread_flag = 0;
 		} 
+		__log4c_stats_append(this->app_id, NULL, -1, start);
 		return -1;
 	}
 
@@ -308,7 +348,12 @@ extern int log4c_appender_append(
       log4c_layout_format(this->app_layout, a_event)) == NULL)
         a_event->evt_rendered_msg = a_event->evt_msg;
 
-    return this->app_type->append(this, a_event);
+    LOG4C_TRACE3(appender_append_start, this->app_name, a_event->evt_category,
+		 a_event->evt_rendered_msg);
+    rc = this->app_type->append(this, a_event);
+    LOG4C_TRACE3(appender_append_end, this->app_name, a_event->evt_category, rc);
+    __log4c_stats_append(this->app_id, a_event->evt_rendered_msg, rc, start);
+    return rc;
 }
 
 /*******************************************************************************/
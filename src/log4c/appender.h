@@ -47,8 +47,13 @@ typedef struct log4c_appender_init_data {
  * 
  * @li @c name appender type name 
  * @li @c open
- * @li @c append
+ * @li @c append returns the number of bytes written, which the appender
+ * statistics count, 0 if it does not tell, or -1 on error
  * @li @c close
+ * @li @c init
+ * @li @c needs what the appender reads from the event itself, besides
+ * what its layout reads: LOG4C_NEEDS_TIME, LOG4C_NEEDS_THREAD and
+ * LOG4C_NEEDS_CONTEXT, or LOG4C_NEEDS_NONE. 0 for everything.
  **/
 typedef struct log4c_appender_type {
     const char*	  name;
@@ -56,6 +61,7 @@ typedef struct log4c_appender_type {
     int (*append) (log4c_appender_t*, const log4c_logging_event_t*);
     int (*close)  (log4c_appender_t*);
     int (*init)   (log4c_appender_t*, const log4c_appender_init_data_t*);
+    int		  needs;
 } log4c_appender_type_t;
 
 /**
@@ -124,6 +130,15 @@ LOG4C_API const char* log4c_appender_get_name(const log4c_appender_t* a_appender
 LOG4C_API const log4c_appender_type_t* log4c_appender_get_type(
     const log4c_appender_t* a_appender);
 
+/**
+ * Returns the id of the appender. Ids are small integers given in order
+ * of creation and never reused, which can be used to index per appender
+ * tables.
+ * @param a_appender the log4c_appender_t object
+ * @return the id or -1 if @a a_appender is NULL
+ **/
+LOG4C_API int log4c_appender_get_id(const log4c_appender_t* a_appender);
+
 /**
  * @param a_appender the log4c_appender_t object
  * @return the appender layout
@@ -131,6 +146,13 @@ LOG4C_API const log4c_appender_type_t* log4c_appender_get_type(
 LOG4C_API const log4c_layout_t* log4c_appender_get_layout(
     const log4c_appender_t* a_appender);
 
+/**
+ * @param a_appender the log4c_appender_t object
+ * @return what the appender and its layout read from the events, the
+ * LOG4C_NEEDS_* flags
+ **/
+LOG4C_API int log4c_appender_get_needs(const log4c_appender_t* a_appender);
+
 /**
  * @param a_appender the log4c_appender_t object
  * @return the appender user data
@@ -16,6 +16,10 @@
  *   <appender name="stderrc" type="ansicolor" stream="stderr" layout="dated" />
 */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <algorithm>
 #include <iterator>
 #include <unordered_map>
@@ -31,6 +35,8 @@
 #include <linux/limits.h>
 
 #include <log4c.h>
+#include "trace.h"
+#include "lock.h"
 
 extern "C"
 {
@@ -189,9 +195,11 @@ namespace
 
 
 	int
-	acquire_lock()
+	acquire_lock(const log4c_appender_t *ctx, unsigned long long *acquired)
 	{
-		int res = pthread_mutex_lock(&mutex);
+		LOG4C_TRACE2(lock_wait, "ansicolor", log4c_appender_get_name(ctx));
+		int res = __log4c_lock(&__log4c_lock_site_ansicolor, &mutex, acquired);
+		LOG4C_TRACE2(lock_acquired, "ansicolor", log4c_appender_get_name(ctx));
 		assert(res == 0);
 		if(res != 0)
 		{
@@ -203,9 +211,10 @@ namespace
 
 
 	int
-	release_lock()
+	release_lock(const log4c_appender_t *ctx, unsigned long long acquired)
 	{
-		int res = pthread_mutex_unlock(&mutex);
+		LOG4C_TRACE2(lock_release, "ansicolor", log4c_appender_get_name(ctx));
+		int res = __log4c_unlock(&__log4c_lock_site_ansicolor, &mutex, acquired);
 		assert(res == 0);
 		if(res != 0)
 		{
@@ -273,8 +282,9 @@ namespace
 	ansicolor_open(log4c_appender_t *ctx)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		// Retrieve the context
 		const auto udata = static_cast<ansicolor_udata_t *>(log4c_appender_get_udata(ctx));
@@ -291,7 +301,7 @@ namespace
 		udata->colorState_ = new ColorState();
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -301,8 +311,9 @@ namespace
 	ansicolor_close(log4c_appender_t *ctx)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		const auto udata = static_cast<ansicolor_udata_t *>(log4c_appender_get_udata(ctx));
 		sd_debug("[ansicolor_close] udata=%p", udata);
@@ -317,7 +328,7 @@ namespace
 		}
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -327,13 +338,14 @@ namespace
 	ansicolor_append(log4c_appender_t *ctx, const log4c_logging_event_t *a_event)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
 		// Note: This lock isn't strictly necessary because liblog currently synchronizes calls to
 		//       log4c_category_log() internally. However, this may change in the future, so just to
 		//       be on the safe side we acquire the lock anyway. This also makes sure that append
 		//       operations are synchronized against open/close operations, which is not guaranteed
 		//       by log4c at this point.
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		const auto udata = static_cast<ansicolor_udata_t *>(log4c_appender_get_udata(ctx));
 		sd_debug("[ansicolor_append] udata=%p, category='%s'", udata, a_event->evt_category);
@@ -365,7 +377,7 @@ namespace
 		}
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -379,4 +391,5 @@ const log4c_appender_type_t log4c_appender_type_ansicolor = {
 	ansicolor_append,
 	ansicolor_close,
 	ansicolor_init,
+	LOG4C_NEEDS_NONE,
 };
@@ -1,3 +1,7 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <string>
 #include <cassert>
 #include <errno.h>
@@ -8,6 +12,8 @@
 #include <linux/limits.h>
 
 #include <log4c.h>
+#include "trace.h"
+#include "lock.h"
 
 extern "C"
 {
@@ -60,9 +66,11 @@ namespace
 
 
 	int
-	acquire_lock(void)
+	acquire_lock(const log4c_appender_t *ctx, unsigned long long *acquired)
 	{
-		int res = pthread_mutex_lock(&mutex);
+		LOG4C_TRACE2(lock_wait, "file", log4c_appender_get_name(ctx));
+		int res = __log4c_lock(&__log4c_lock_site_file, &mutex, acquired);
+		LOG4C_TRACE2(lock_acquired, "file", log4c_appender_get_name(ctx));
 		assert(res == 0);
 		if(res != 0)
 		{
@@ -74,9 +82,10 @@ namespace
 
 
 	int
-	release_lock(void)
+	release_lock(const log4c_appender_t *ctx, unsigned long long acquired)
 	{
-		int res = pthread_mutex_unlock(&mutex);
+		LOG4C_TRACE2(lock_release, "file", log4c_appender_get_name(ctx));
+		int res = __log4c_unlock(&__log4c_lock_site_file, &mutex, acquired);
 		assert(res == 0);
 		if(res != 0)
 		{
@@ -125,8 +134,9 @@ namespace
 	file_open(log4c_appender_t *ctx)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		// Retrieve the context
 		file_udata_t *udata = (file_udata_t *)log4c_appender_get_udata(ctx);
@@ -158,7 +168,7 @@ namespace
 		}
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -168,8 +178,9 @@ namespace
 	file_close(log4c_appender_t *ctx)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		file_udata_t * const udata = (file_udata_t *)log4c_appender_get_udata(ctx);
 		sd_debug("[file_close] udata=%p", udata);
@@ -189,7 +200,7 @@ namespace
 		}
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -199,13 +210,14 @@ namespace
 	file_append(log4c_appender_t *ctx, const log4c_logging_event_t *a_event)
 	{
 		int ret = 0;
+		unsigned long long acquired;
 
 		// Note: This lock isn't strictly necessary because liblog currently synchronizes calls to
 		//       log4c_category_log() internally. However, this may change in the future, so just to
 		//       be on the safe side we acquire the lock anyway. This also makes sure that append
 		//       operations are synchronized against open/close operations, which is not guaranteed
 		//       by log4c at this point.
-		acquire_lock();
+		acquire_lock(ctx, &acquired);
 
 		file_udata_t * const udata = (file_udata_t *)log4c_appender_get_udata(ctx);
 		sd_debug("[file_append] udata=%p", udata);
@@ -220,7 +232,7 @@ namespace
 		ret = fputs(a_event->evt_rendered_msg, udata->fh);
 
 	done:
-		release_lock();
+		release_lock(ctx, acquired);
 		return ret;
 	}
 
@@ -235,4 +247,5 @@ const log4c_appender_type_t log4c_appender_type_file = {
 	file_append,
 	file_close,
 	file_init,
+	LOG4C_NEEDS_NONE,
 };
@@ -0,0 +1,643 @@
+static const char version[] = "$Id$";
+
+/*
+ * appender_type_flightrecorder.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/appender.h>
+#include <log4c/appender_type_flightrecorder.h>
+#include <log4c/thread.h>
+#include <log4c/sigsafe.h>
+#include <sd/malloc.h>
+#include <sd/domnode.h>
+#include <sd/sd_xplatform.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define FLIGHT_PTHREADS
+#endif
+
+#define FLIGHT_SIZE_DEFAULT	(64 * 1024)
+#define FLIGHT_SIZE_MIN		4096
+#define FLIGHT_ALIGN(n)		(((n) + 7) & ~(size_t) 7)
+
+/* the events of log4c_sigsafe_log() are dumped as records of this size */
+#define FLIGHT_SIGNAL_LINE	512
+#define FLIGHT_SIGNAL_RECORD \
+    FLIGHT_ALIGN(sizeof(log4c_flightrecorder_record_t) + FLIGHT_SIGNAL_LINE)
+
+/*
+ * The ring of a thread. fl_head and fl_tail count the bytes written and
+ * dropped since it was created, the size is a power of two. A record
+ * never wraps: when it does not fit before the end of the ring, the end
+ * is filled with a padding record. Only the thread writes to its ring; a
+ * dump reads fl_tail and fl_head, which are published once the records
+ * they cover are written. fl_tail moves past the records before they are
+ * overwritten, so a dump which reads it again after copying the ring
+ * knows which bytes of the copy may be torn.
+ */
+typedef struct {
+    size_t		fl_size;
+    XP_UINT64		fl_head;
+    XP_UINT64		fl_tail;
+    unsigned long long	fl_cuts;
+    unsigned long	fl_thread;
+    char		fl_name[LOG4C_THREAD_NAME_MAX];
+    char*		fl_data;
+} flight_ring_t;
+
+/* the buffer a dump copies a ring to, as large as the largest ring */
+typedef struct flight_copy {
+    struct flight_copy*	fc_next;
+    size_t		fc_size;
+    char		fc_data[1];
+} flight_copy_t;
+
+/*
+ * fr_rings is indexed by the slot of the threads. fr_dumping is set while
+ * a dump uses fr_copy. The rings stay allocated once the appender is
+ * closed, as threads may still be writing to them, and are used again if
+ * it is opened again: every flight recorder is kept in flight_all until
+ * log4c_fini().
+ */
+typedef struct flightrecorder {
+    const char*			fr_path;
+    size_t			fr_size;
+    flight_copy_t*		fr_copy;
+    int				fr_dumping;
+    struct flightrecorder*	fr_next;
+    flight_ring_t*		fr_rings[LOG4C_FLIGHTRECORDER_THREADS];
+} flightrecorder_t;
+
+/* the open flight recorders, for the signal handler */
+static flightrecorder_t* flight_recorders[LOG4C_FLIGHTRECORDER_MAX];
+
+static flightrecorder_t* flight_all = NULL;
+
+/*
+ * The slot of the thread, plus one, 0 until it logs. Without thread local
+ * storage the key of the thread holds it.
+ */
+#ifdef SD_TLS
+static SD_TLS int flight_slot = 0;
+#elif !defined(FLIGHT_PTHREADS)
+static int flight_slot = 0;
+#endif
+
+/* the slots of the threads which exited keep their lines until needed */
+#define SLOT_FREE	0
+#define SLOT_USED	1
+#define SLOT_EXITED	2
+
+static unsigned char flight_slots[LOG4C_FLIGHTRECORDER_THREADS];
+
+#ifdef FLIGHT_PTHREADS
+static pthread_mutex_t flight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t flight_once = PTHREAD_ONCE_INIT;
+static pthread_key_t flight_key;
+
+/*******************************************************************************/
+/* the slot of a thread which exits goes to a new thread once all are used */
+static void flight_thread_exit(void* a_slot)
+{
+    pthread_mutex_lock(&flight_mutex);
+    flight_slots[(size_t) a_slot - 1] = SLOT_EXITED;
+    pthread_mutex_unlock(&flight_mutex);
+}
+
+/*******************************************************************************/
+static void flight_key_create(void)
+{
+    pthread_key_create(&flight_key, flight_thread_exit);
+}
+#endif
+
+/*******************************************************************************/
+static int flight_slot_get(void)
+{
+    int slot = 0;
+    int i;
+
+#if defined(SD_TLS) || !defined(FLIGHT_PTHREADS)
+    if (flight_slot)
+	return flight_slot - 1;
+#else
+    pthread_once(&flight_once, flight_key_create);
+    if ((slot = (int) (size_t) pthread_getspecific(flight_key)) != 0)
+	return slot - 1;
+#endif
+
+#ifdef FLIGHT_PTHREADS
+    pthread_once(&flight_once, flight_key_create);
+    pthread_mutex_lock(&flight_mutex);
+#endif
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_THREADS &&
+	     flight_slots[i] != SLOT_FREE; i++)
+	;
+    if (i == LOG4C_FLIGHTRECORDER_THREADS)
+	for (i = 0; i < LOG4C_FLIGHTRECORDER_THREADS &&
+		 flight_slots[i] != SLOT_EXITED; i++)
+	    ;
+    if (i < LOG4C_FLIGHTRECORDER_THREADS) {
+	flight_slots[i] = SLOT_USED;
+	slot = i + 1;
+    }
+#ifdef FLIGHT_PTHREADS
+    pthread_mutex_unlock(&flight_mutex);
+    if (slot)
+	pthread_setspecific(flight_key, (void*) (size_t) slot);
+#endif
+#if defined(SD_TLS) || !defined(FLIGHT_PTHREADS)
+    flight_slot = slot;
+#endif
+
+    return slot - 1;
+}
+
+/*******************************************************************************/
+/* the ring of the calling thread, taken over from an exited thread */
+static flight_ring_t* flight_ring_get(flightrecorder_t* this)
+{
+    const log4c_thread_t* self = log4c_thread_get();
+    flight_ring_t* ring;
+    int slot;
+
+    if ((slot = flight_slot_get()) == -1)
+	return NULL;
+
+    if ((ring = this->fr_rings[slot]) == NULL) {
+	ring = sd_calloc(1, sizeof(*ring));
+	ring->fl_size = this->fr_size;
+	/* touch the pages now rather than while logging */
+	ring->fl_data = sd_calloc(1, ring->fl_size);
+	memset(ring->fl_data, 0, ring->fl_size);
+	ring->fl_thread = ~self->th_id;
+	SD_ATOMIC_STORE_RELEASE(&this->fr_rings[slot], ring);
+    }
+
+    if (ring->fl_thread != self->th_id) {
+	SD_ATOMIC_STORE_RELEASE(&ring->fl_tail, ring->fl_head);
+	ring->fl_cuts	= 0;
+	ring->fl_thread = self->th_id;
+	strncpy(ring->fl_name, self->th_name, sizeof(ring->fl_name) - 1);
+    }
+    return ring;
+}
+
+/*******************************************************************************/
+/* makes room for a record, dropping the oldest ones */
+static log4c_flightrecorder_record_t* flight_reserve(flight_ring_t* this,
+						     size_t a_size)
+{
+    size_t mask = this->fl_size - 1;
+    XP_UINT64 head = this->fl_head;
+    XP_UINT64 tail = this->fl_tail;
+    size_t offset = (size_t) head & mask;
+    size_t skip = offset + a_size > this->fl_size ? this->fl_size - offset : 0;
+    log4c_flightrecorder_record_t* rec;
+
+    while (head + skip + a_size - tail > this->fl_size)
+	tail += ((log4c_flightrecorder_record_t*)
+		 (this->fl_data + ((size_t) tail & mask)))->fr_size;
+    if (tail != this->fl_tail) {
+	/* a dump must see the records dropped before they are overwritten */
+	SD_ATOMIC_STORE_RELEASE(&this->fl_tail, tail);
+	SD_ATOMIC_FENCE_RELEASE();
+    }
+
+    if (skip) {
+	rec = (log4c_flightrecorder_record_t*) (this->fl_data + offset);
+	rec->fr_size = (unsigned int) skip;
+	rec->fr_len  = LOG4C_FLIGHTRECORDER_PADDING;
+	SD_ATOMIC_STORE_RELEASE(&this->fl_head, head + skip);
+	offset = 0;
+    }
+    return (log4c_flightrecorder_record_t*) (this->fl_data + offset);
+}
+
+/*******************************************************************************/
+/* write() until done, as a signal may interrupt it */
+static int flight_write(int a_fd, const void* a_data, size_t a_size)
+{
+    const char* data = a_data;
+    ssize_t n;
+
+    while (a_size) {
+	if ((n = write(a_fd, data, a_size)) == -1) {
+	    if (errno == EINTR)
+		continue;
+	    return -1;
+	}
+	data   += n;
+	a_size -= n;
+    }
+    return 0;
+}
+
+/*******************************************************************************/
+/* the events of log4c_sigsafe_log() not drained yet, as a ring "signal" */
+static int flight_dump_signal(unsigned long long a_tail,
+			      unsigned long long a_head, int a_fd)
+{
+    log4c_flightrecorder_ring_t rh;
+    log4c_flightrecorder_record_t* rec;
+    XP_UINT64 record[FLIGHT_SIGNAL_RECORD / sizeof(XP_UINT64)];
+    unsigned long long position;
+    int len;
+
+    memset(&rh, 0, sizeof(rh));
+    rh.ring_size = (a_head - a_tail) * FLIGHT_SIGNAL_RECORD;
+    strcpy(rh.ring_name, "signal");
+    if (flight_write(a_fd, &rh, sizeof(rh)) == -1)
+	return -1;
+
+    /* the events drained meanwhile are written as padding */
+    rec = (log4c_flightrecorder_record_t*) record;
+    for (position = a_tail; position < a_head; position++) {
+	memset(record, 0, sizeof(record));
+	rec->fr_size = FLIGHT_SIGNAL_RECORD;
+	len = __log4c_sigsafe_render(position, (char*) (rec + 1),
+				     FLIGHT_SIGNAL_LINE, &rec->fr_realtime,
+				     &rec->fr_monotonic);
+	rec->fr_len	 = len == -1 ? LOG4C_FLIGHTRECORDER_PADDING : len;
+	rec->fr_sequence = position + 1;
+	if (flight_write(a_fd, record, sizeof(record)) == -1)
+	    return -1;
+    }
+    return 0;
+}
+
+/*******************************************************************************/
+/*
+ * The records of a ring, copied to the buffer of the flight recorder. The
+ * records a thread overwrote while they were copied are written as a
+ * padding record. The ring is written as it is when another dump uses the
+ * buffer, and may then show torn records.
+ */
+static int flight_dump_ring(flightrecorder_t* this, const flight_ring_t* a_ring,
+			    int a_fd)
+{
+    log4c_flightrecorder_ring_t rh;
+    log4c_flightrecorder_record_t* pad;
+    flight_copy_t* copy = SD_ATOMIC_LOAD_ACQUIRE(&this->fr_copy);
+    XP_UINT64 head, tail, now;
+    size_t size, offset, first;
+    int rc;
+
+    tail = SD_ATOMIC_LOAD_ACQUIRE(&a_ring->fl_tail);
+    head = SD_ATOMIC_LOAD_ACQUIRE(&a_ring->fl_head);
+    if (tail > head)
+	tail = head;
+    size = (size_t) (head - tail);
+
+    memset(&rh, 0, sizeof(rh));
+    rh.ring_size   = size;
+    rh.ring_cuts   = a_ring->fl_cuts;
+    rh.ring_thread = a_ring->fl_thread;
+    memcpy(rh.ring_name, a_ring->fl_name, sizeof(rh.ring_name));
+
+    offset = (size_t) tail & (a_ring->fl_size - 1);
+    first  = a_ring->fl_size - offset;
+    if (first > size)
+	first = size;
+
+    if (flight_write(a_fd, &rh, sizeof(rh)) == -1)
+	return -1;
+
+    if (!copy || copy->fc_size < size || !SD_ATOMIC_CAS(&this->fr_dumping, 0, 1))
+	return flight_write(a_fd, a_ring->fl_data + offset, first) == -1 ||
+	    flight_write(a_fd, a_ring->fl_data, size - first) == -1 ? -1 : 0;
+
+    memcpy(copy->fc_data, a_ring->fl_data + offset, first);
+    memcpy(copy->fc_data + first, a_ring->fl_data, size - first);
+    SD_ATOMIC_FENCE_ACQUIRE();
+
+    /* fl_tail only moves by whole records */
+    now = SD_ATOMIC_LOAD(&a_ring->fl_tail);
+    if (now > tail && size) {
+	pad = (log4c_flightrecorder_record_t*) copy->fc_data;
+	pad->fr_size = (unsigned int) (now - tail < size ? now - tail : size);
+	pad->fr_len  = LOG4C_FLIGHTRECORDER_PADDING;
+    }
+
+    rc = flight_write(a_fd, copy->fc_data, size);
+    SD_ATOMIC_STORE_RELEASE(&this->fr_dumping, 0);
+    return rc;
+}
+
+/*******************************************************************************/
+static int flight_dump(flightrecorder_t* this, int a_fd)
+{
+    log4c_flightrecorder_header_t hdr;
+    log4c_flightrecorder_ring_t rh;
+    const flight_ring_t* ring;
+    unsigned long long signal_tail, signal_head;
+    unsigned int nrings = 0;
+    int i;
+
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_THREADS; i++)
+	if (SD_ATOMIC_LOAD_ACQUIRE(&this->fr_rings[i]))
+	    nrings++;
+    __log4c_sigsafe_bounds(&signal_tail, &signal_head);
+    if (signal_head - signal_tail > LOG4C_SIGSAFE_SLOTS)
+	signal_tail = signal_head - LOG4C_SIGSAFE_SLOTS;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.hdr_magic, LOG4C_FLIGHTRECORDER_MAGIC, sizeof(hdr.hdr_magic));
+    hdr.hdr_version   = LOG4C_FLIGHTRECORDER_VERSION;
+    hdr.hdr_byteorder = LOG4C_FLIGHTRECORDER_BYTEORDER;
+    hdr.hdr_nrings    = nrings + (signal_head > signal_tail);
+    if (flight_write(a_fd, &hdr, sizeof(hdr)) == -1)
+	return -1;
+
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_THREADS && nrings; i++) {
+	if ((ring = SD_ATOMIC_LOAD_ACQUIRE(&this->fr_rings[i])) == NULL)
+	    continue;
+	nrings--;
+	if (flight_dump_ring(this, ring, a_fd) == -1)
+	    return -1;
+    }
+
+    /* rings created meanwhile are left out */
+    for (; nrings; nrings--) {
+	memset(&rh, 0, sizeof(rh));
+	if (flight_write(a_fd, &rh, sizeof(rh)) == -1)
+	    return -1;
+    }
+
+    if (signal_head > signal_tail)
+	return flight_dump_signal(signal_tail, signal_head, a_fd);
+    return 0;
+}
+
+/*******************************************************************************/
+/* the buffers only grow, the older ones are freed with the recorder */
+static void flight_copy_grow(flightrecorder_t* this, size_t a_size)
+{
+    flight_copy_t* copy;
+
+    if (this->fr_copy && this->fr_copy->fc_size >= a_size)
+	return;
+
+    copy = sd_malloc(sizeof(*copy) + a_size);
+    copy->fc_next = this->fr_copy;
+    copy->fc_size = a_size;
+    SD_ATOMIC_STORE_RELEASE(&this->fr_copy, copy);
+}
+
+/*******************************************************************************/
+static flightrecorder_t* flightrecorder_get_or_make_udata(log4c_appender_t* this)
+{
+    flightrecorder_t* fr = log4c_appender_get_udata(this);
+
+    if (!fr) {
+	fr = sd_calloc(1, sizeof(*fr));
+	fr->fr_size = FLIGHT_SIZE_DEFAULT;
+	flight_copy_grow(fr, fr->fr_size);
+#ifdef FLIGHT_PTHREADS
+	pthread_mutex_lock(&flight_mutex);
+#endif
+	fr->fr_next = flight_all;
+	flight_all  = fr;
+#ifdef FLIGHT_PTHREADS
+	pthread_mutex_unlock(&flight_mutex);
+#endif
+	log4c_appender_set_udata(this, fr);
+    }
+    return fr;
+}
+
+/*******************************************************************************/
+static int flightrecorder_init(log4c_appender_t* this,
+			       const log4c_appender_init_data_t* a_data)
+{
+    sd_domnode_t* size = NULL;
+
+    if (a_data && a_data->dom_node)
+	size = sd_domnode_attrs_get_expanded(a_data->dom_node, "size");
+
+    log4c_flightrecorder_set_size(this, size && size->value ?
+				  strtoul(size->value, NULL, 10) : 0);
+    return 0;
+}
+
+/*******************************************************************************/
+static int flightrecorder_open(log4c_appender_t* this)
+{
+    flightrecorder_t* fr = flightrecorder_get_or_make_udata(this);
+    int i;
+
+    fr->fr_path = log4c_appender_get_name(this);
+
+#ifdef FLIGHT_PTHREADS
+    pthread_mutex_lock(&flight_mutex);
+#endif
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_MAX && flight_recorders[i] &&
+	     flight_recorders[i] != fr; i++)
+	;
+    if (i < LOG4C_FLIGHTRECORDER_MAX)
+	SD_ATOMIC_STORE_RELEASE(&flight_recorders[i], fr);
+#ifdef FLIGHT_PTHREADS
+    pthread_mutex_unlock(&flight_mutex);
+#endif
+
+    return i < LOG4C_FLIGHTRECORDER_MAX ? 0 : -1;
+}
+
+/*******************************************************************************/
+static int flightrecorder_append(log4c_appender_t* this,
+				 const log4c_logging_event_t* a_event)
+{
+    flightrecorder_t* fr = log4c_appender_get_udata(this);
+    log4c_flightrecorder_record_t* rec;
+    flight_ring_t* ring;
+    size_t len, max;
+
+    if (!fr || (ring = flight_ring_get(fr)) == NULL)
+	return -1;
+
+    len = strlen(a_event->evt_rendered_msg);
+    max = ring->fl_size / 2 - sizeof(*rec);
+    if (len > max) {
+	len = max;
+	ring->fl_cuts++;
+    }
+
+    rec = flight_reserve(ring, FLIGHT_ALIGN(sizeof(*rec) + len));
+    rec->fr_size	= (unsigned int) FLIGHT_ALIGN(sizeof(*rec) + len);
+    rec->fr_len		= (unsigned int) len;
+    rec->fr_realtime	= a_event->evt_realtime_ns;
+    rec->fr_monotonic	= a_event->evt_monotonic_ns;
+    rec->fr_sequence	= a_event->evt_sequence;
+    memcpy(rec + 1, a_event->evt_rendered_msg, len);
+
+    SD_ATOMIC_STORE_RELEASE(&ring->fl_head, ring->fl_head + rec->fr_size);
+    return (int) len;
+}
+
+/*******************************************************************************/
+static int flightrecorder_close(log4c_appender_t* this)
+{
+    flightrecorder_t* fr = log4c_appender_get_udata(this);
+    int i;
+
+    if (!fr)
+	return 0;
+
+#ifdef FLIGHT_PTHREADS
+    pthread_mutex_lock(&flight_mutex);
+#endif
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_MAX; i++)
+	if (flight_recorders[i] == fr)
+	    SD_ATOMIC_STORE_RELEASE(&flight_recorders[i], NULL);
+#ifdef FLIGHT_PTHREADS
+    pthread_mutex_unlock(&flight_mutex);
+#endif
+
+    /* the rings are freed by log4c_fini() */
+    fr->fr_path = NULL;
+    return 0;
+}
+
+/*******************************************************************************/
+extern void log4c_flightrecorder_set_size(log4c_appender_t* this, size_t a_size)
+{
+    flightrecorder_t* fr;
+    size_t size = FLIGHT_SIZE_MIN;
+
+    if (!this)
+	return;
+
+    if (!a_size)
+	a_size = FLIGHT_SIZE_DEFAULT;
+    while (size < a_size)
+	size <<= 1;
+
+    /* the buffer of the dumps grows before the rings do */
+    fr = flightrecorder_get_or_make_udata(this);
+    flight_copy_grow(fr, size);
+    fr->fr_size = size;
+}
+
+/*******************************************************************************/
+extern int log4c_flightrecorder_dump(const log4c_appender_t* this, int a_fd)
+{
+    flightrecorder_t* fr = this ? log4c_appender_get_udata(this) : NULL;
+
+    if (!fr || !fr->fr_path)
+	return -1;
+    return flight_dump(fr, a_fd);
+}
+
+/*******************************************************************************/
+extern int log4c_flightrecorder_dump_all(void)
+{
+    flightrecorder_t* fr;
+    int i, fd, n = 0;
+
+    for (i = 0; i < LOG4C_FLIGHTRECORDER_MAX; i++) {
+	if ((fr = SD_ATOMIC_LOAD_ACQUIRE(&flight_recorders[i])) == NULL)
+	    continue;
+	if ((fd = open(fr->fr_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+	    return -1;
+	if (flight_dump(fr, fd) == -1) {
+	    close(fd);
+	    return -1;
+	}
+	close(fd);
+	n++;
+    }
+    return n;
+}
+
+#ifdef HAVE_SIGACTION
+/*******************************************************************************/
+/* the handler is reset on entry: raising the signal again ends the process
+   once it returns */
+static void flight_signal(int a_signal)
+{
+    int saved = errno;
+
+    log4c_flightrecorder_dump_all();
+    errno = saved;
+    raise(a_signal);
+}
+#endif
+
+/*******************************************************************************/
+extern int log4c_flightrecorder_install(void)
+{
+#ifdef HAVE_SIGACTION
+    static const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    struct sigaction sa;
+    size_t i;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = flight_signal;
+    sa.sa_flags   = SA_RESETHAND;
+#ifdef SA_ONSTACK
+    {
+	stack_t ss;
+
+	if (sigaltstack(NULL, &ss) == 0 && !(ss.ss_flags & SS_DISABLE))
+	    sa.sa_flags |= SA_ONSTACK;
+    }
+#endif
+    sigemptyset(&sa.sa_mask);
+
+    for (i = 0; i < sizeof(signals) / sizeof(signals[0]); i++)
+	if (sigaction(signals[i], &sa, NULL) == -1)
+	    return -1;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*******************************************************************************/
+extern void __log4c_flightrecorder_cleanup(void)
+{
+    flightrecorder_t* fr;
+    flight_copy_t* copy;
+    int i;
+
+    while ((fr = flight_all) != NULL) {
+	flight_all = fr->fr_next;
+	for (i = 0; i < LOG4C_FLIGHTRECORDER_THREADS; i++) {
+	    if (!fr->fr_rings[i])
+		continue;
+	    free(fr->fr_rings[i]->fl_data);
+	    free(fr->fr_rings[i]);
+	}
+	while ((copy = fr->fr_copy) != NULL) {
+	    fr->fr_copy = copy->fc_next;
+	    free(copy);
+	}
+	free(fr);
+    }
+}
+
+/*******************************************************************************/
+const log4c_appender_type_t log4c_appender_type_flightrecorder = {
+    "flightrecorder",
+    flightrecorder_open,
+    flightrecorder_append,
+    flightrecorder_close,
+    flightrecorder_init,
+    LOG4C_NEEDS_TIME,
+};
@@ -0,0 +1,177 @@
+/* $Id$
+ *
+ * appender_type_flightrecorder.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_appender_type_flightrecorder_h
+#define log4c_appender_type_flightrecorder_h
+
+/**
+ * @file appender_type_flightrecorder.h
+ *
+ * @brief Log4c flight recorder appender interface.
+ *
+ * The flight recorder appender keeps the last events each thread logged
+ * in memory, as formatted by its layout, so that they survive a crash
+ * which leaves the stdio buffers and the binlog buffers unwritten. Each
+ * thread writes to a ring of its own, allocated the first time it logs
+ * and of a fixed size: appending copies the line and never locks nor
+ * allocates. The oldest lines make room for the new ones.
+ *
+ * log4c_flightrecorder_dump() writes the rings with write() only and can
+ * be called from a signal handler. log4c_flightrecorder_install()
+ * installs one for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT which
+ * dumps every flight recorder to the file named after its appender,
+ * then lets the signal kill the process. The events logged with
+ * log4c_sigsafe_log() and not drained yet are dumped too, as the ring of
+ * a thread named "signal". log4c-flight merges the rings of a dump by
+ * time.
+ *
+ * @code
+ *
+ * log4c_appender_t* recorder;
+ *
+ * recorder = log4c_appender_get("/var/crash/myapp.flight");
+ * log4c_appender_set_type(recorder, &log4c_appender_type_flightrecorder);
+ * log4c_flightrecorder_set_size(recorder, 256 * 1024);
+ * log4c_flightrecorder_install();
+ *
+ * @endcode
+ *
+ * In a log4crc file, the "size" attribute of the @c <appender> element
+ * sets the size of the rings.
+ *
+ * A dump copies each ring then checks which lines the thread overwrote
+ * meanwhile, and writes them as padding. When two dumps run at once, the
+ * second one writes the rings as they are and may show torn lines, which
+ * log4c-flight skips. Closing the appender keeps the rings, as threads may
+ * still be writing to them: they are used again if it is opened again and
+ * freed by log4c_fini().
+ **/
+
+#include <stddef.h>
+#include <log4c/defs.h>
+#include <log4c/appender.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * Flight recorder appender type definition.
+ *
+ * This should be used as a parameter to the log4c_appender_set_type()
+ * routine to set the type of the appender.
+ **/
+LOG4C_API const log4c_appender_type_t log4c_appender_type_flightrecorder;
+
+/**
+ * The number of threads a flight recorder keeps a ring for. The rings of
+ * the threads which exited are kept, and given to new threads once every
+ * ring is used.
+ **/
+#define LOG4C_FLIGHTRECORDER_THREADS	256
+
+/**
+ * The number of flight recorder appenders which can be open at once.
+ **/
+#define LOG4C_FLIGHTRECORDER_MAX	8
+
+/**
+ * Sets the size of the rings of the threads which log to this appender
+ * from now on.
+ *
+ * @param a_appender the flight recorder appender
+ * @param a_size the size in bytes, 0 for 64KB
+ **/
+LOG4C_API void log4c_flightrecorder_set_size(log4c_appender_t* a_appender,
+					     size_t a_size);
+
+/**
+ * Writes the rings of a flight recorder to a file. Only calls functions
+ * which are async-signal-safe.
+ *
+ * @param a_appender the flight recorder appender
+ * @param a_fd the file descriptor to write to
+ * @returns 0 or -1 if the appender is not open or on a write error
+ **/
+LOG4C_API int log4c_flightrecorder_dump(const log4c_appender_t* a_appender,
+					int a_fd);
+
+/**
+ * Writes the rings of every open flight recorder to the file named after
+ * its appender, replacing it. Only calls functions which are
+ * async-signal-safe.
+ *
+ * @returns the number of flight recorders dumped, or -1 on error
+ **/
+LOG4C_API int log4c_flightrecorder_dump_all(void);
+
+/**
+ * Installs a handler for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT
+ * which calls log4c_flightrecorder_dump_all() then raises the signal
+ * again with its default action. The handler runs on the alternate
+ * signal stack of the thread when the thread which installs it has one.
+ *
+ * @returns 0 or -1 on error
+ **/
+LOG4C_API int log4c_flightrecorder_install(void);
+
+/**
+ * @internal
+ * Frees the rings of every flight recorder. Called by log4c_fini().
+ **/
+LOG4C_API void __log4c_flightrecorder_cleanup(void);
+
+/**
+ * A dump starts with a log4c_flightrecorder_header_t, followed by the
+ * rings. Each ring is a log4c_flightrecorder_ring_t followed by @c
+ * ring_size bytes of records, from the oldest to the newest. Each record
+ * is a log4c_flightrecorder_record_t followed by its text, the whole
+ * aligned on 8 bytes. Records with a @c fr_len of
+ * LOG4C_FLIGHTRECORDER_PADDING have no text and are skipped. Everything
+ * is in the byte order of the writer.
+ **/
+#define LOG4C_FLIGHTRECORDER_MAGIC	"L4CF"
+#define LOG4C_FLIGHTRECORDER_VERSION	1
+#define LOG4C_FLIGHTRECORDER_BYTEORDER	0x01020304
+#define LOG4C_FLIGHTRECORDER_PADDING	0xffffffffU
+
+typedef struct {
+    char		hdr_magic[4];
+    unsigned int	hdr_version;
+    unsigned int	hdr_byteorder;
+    unsigned int	hdr_nrings;
+} log4c_flightrecorder_header_t;
+
+/**
+ * @li @c ring_size the size of the records which follow
+ * @li @c ring_cuts the number of lines cut to fit in the ring
+ * @li @c ring_thread the id of the thread
+ * @li @c ring_name the name of the thread
+ **/
+typedef struct {
+    unsigned long long	ring_size;
+    unsigned long long	ring_cuts;
+    unsigned long long	ring_thread;
+    char		ring_name[32];
+} log4c_flightrecorder_ring_t;
+
+/**
+ * @li @c fr_size the size of the record, header and padding included
+ * @li @c fr_len the length of the text
+ * @li @c fr_realtime the time in nanoseconds since the epoch
+ * @li @c fr_monotonic the time in nanoseconds on the monotonic clock
+ * @li @c fr_sequence the number of the event among those of its thread
+ **/
+typedef struct {
+    unsigned int	fr_size;
+    unsigned int	fr_len;
+    unsigned long long	fr_realtime;
+    unsigned long long	fr_monotonic;
+    unsigned long long	fr_sequence;
+} log4c_flightrecorder_record_t;
+
+__LOG4C_END_DECLS
+
+#endif
@@ -106,13 +106,13 @@ static int mmap_open(log4c_appender_t* this)
 static int mmap_append(log4c_appender_t*	this, 
 		       const log4c_logging_event_t* a_event)
 {
-    size_t size, available;
+    size_t len, size, available;
     struct mmap_info* minfo = log4c_appender_get_udata(this);
 
     if (!minfo && !minfo->ptr)
 	return 0;
 
-    size = strlen(a_event->evt_rendered_msg);
+    size = len = strlen(a_event->evt_rendered_msg);
     available = ((char *)minfo->addr + minfo->length) - (char *)minfo->ptr;
 
     if (size > available) {
@@ -123,7 +123,7 @@ static int mmap_append(log4c_appender_t*	this,
 
     memcpy(minfo->ptr, a_event->evt_rendered_msg, size);
     minfo->ptr = (char *)minfo->ptr + size;
-    return 0;
+    return (int) len;
 }
 
 /*******************************************************************************/
@@ -149,5 +149,7 @@ const log4c_appender_type_t log4c_appender_type_mmap = {
     mmap_open,
     mmap_append,
     mmap_close,
+    NULL,
+    LOG4C_NEEDS_NONE,
 };
 
@@ -23,9 +23,13 @@
 #include <log4c/appender.h>
 #include <log4c/appender_type_rollingfile.h>
 #include <log4c/rollingpolicy.h>
+#include <log4c/stats.h>
 #include <sd/malloc.h>
 #include <sd/error.h>
 #include <sd/sd_xplatform.h>
+#include <sd/clock.h>
+#include "trace.h"
+#include "lock.h"
 
 /* Internal structs that defines the conf and the state info
 * for an instance of the appender_type_rollingfile type.
@@ -41,11 +45,22 @@ struct __rollingfile_udata {
 	long rfu_current_file_size; 
 	FILE *rfu_current_fp;
 	char *rfu_base_filename;
+	char *rfu_current_filename;
 	pthread_mutex_t rfu_mutex;
+	/* sidecar index of the current file */
+	long rfu_index_size;
+	long rfu_index_interval;
+	FILE *rfu_index_fp;
+	long rfu_index_offset;
+	long long rfu_index_sec;
 };
 
 static int rollingfile_open_zero_file(char *filename, long *fsp, FILE **fpp);
 static char *rollingfile_make_base_name(const char *log_dir, const char* prefix);
+static void rollingfile_index_open(rollingfile_udata_t *rfup);
+static void rollingfile_index_close(rollingfile_udata_t *rfup);
+static void rollingfile_index_add(rollingfile_udata_t *rfup,
+				  const log4c_logging_event_t* a_event);
 
 /***************************************************************************
 Appender Interface functions: open, append, close
@@ -118,8 +133,13 @@ static int rollingfile_open(log4c_appender_t* this)
 		rollingfile_open_zero_file( rfup->rfu_base_filename,
 			&rfup->rfu_current_file_size,
 			&rfup->rfu_current_fp);
+		rollingfile_udata_set_current_filename(rfup,
+			rfup->rfu_base_filename);
 	}
 
+	if (!rc)
+		rollingfile_index_open(rfup);
+
 	sd_debug("]");
 
 	return rc;
@@ -134,11 +154,15 @@ static int rollingfile_append(log4c_appender_t* this,
 	rollingfile_udata_t* rfup = log4c_appender_get_udata(this); 
 	log4c_logging_event_t* my_event = 
 		(log4c_logging_event_t*)a_event;
+	unsigned long long acquired;
 	int rc = 0;
 
 	sd_debug("rollingfile_append[");
 
-	pthread_mutex_lock(&rfup->rfu_mutex);  /***** LOCK ****/
+	LOG4C_TRACE2(lock_wait, "rollingfile", log4c_appender_get_name(this));
+	__log4c_lock(&__log4c_lock_site_rollingfile, &rfup->rfu_mutex,
+		     &acquired);  /***** LOCK ****/
+	LOG4C_TRACE2(lock_acquired, "rollingfile", log4c_appender_get_name(this));
 
 	if ( rfup->rfu_conf.rfc_policy != NULL) {
 
@@ -153,9 +177,15 @@ static int rollingfile_append(log4c_appender_t* this,
 					strlen(a_event->evt_rendered_msg), rfup->rfu_current_file_size);
 #endif
 
-				if ( (rc = log4c_rollingpolicy_rollover(rfup->rfu_conf.rfc_policy,
-					&rfup->rfu_current_fp, 1)) <= ROLLINGPOLICY_ROLLOVER_ERR_CAN_LOG){
+				LOG4C_TRACE2(rollover_start, log4c_appender_get_name(this),
+					     rfup->rfu_current_file_size);
+				rc = log4c_rollingpolicy_rollover(rfup->rfu_conf.rfc_policy,
+					&rfup->rfu_current_fp, 1);
+				LOG4C_TRACE2(rollover_end, log4c_appender_get_name(this), rc);
+				if ( rc <= ROLLINGPOLICY_ROLLOVER_ERR_CAN_LOG){
 						rfup->rfu_current_file_size = 0;
+						__log4c_stats_rollover(log4c_appender_get_id(this));
+						rollingfile_index_open(rfup);
 				}
 		} else {
 			/* no need to rotate up--stick with the current fp */
@@ -167,8 +197,11 @@ static int rollingfile_append(log4c_appender_t* this,
 
 	/* only attempt the write if the policy implem says I can */
 	if ( rc <= ROLLINGPOLICY_ROLLOVER_ERR_CAN_LOG ) {	           
+		if (rfup->rfu_index_fp)
+			rollingfile_index_add(rfup, a_event);
 		rc = fprintf(rfup->rfu_current_fp, "%s", a_event->evt_rendered_msg);
-		rfup->rfu_current_file_size += strlen(a_event->evt_rendered_msg);
+		if (rc > 0)
+			rfup->rfu_current_file_size += rc;
 
 		/*
 		* the fprintf needs to be inside the lock 
@@ -179,9 +212,12 @@ static int rollingfile_append(log4c_appender_t* this,
 	} else {
 		sd_error("not logging--something went wrong (trigger check or"
 			" rollover failed)");
+		__log4c_stats_drop();
 	}
 	sd_debug("]");
-	pthread_mutex_unlock(&rfup->rfu_mutex);  /****** UNLOCK *****/
+	LOG4C_TRACE2(lock_release, "rollingfile", log4c_appender_get_name(this));
+	__log4c_unlock(&__log4c_lock_site_rollingfile, &rfup->rfu_mutex,
+		       acquired);  /****** UNLOCK *****/
 	return (rc);
 
 }
@@ -190,6 +226,7 @@ static int rollingfile_close(log4c_appender_t* this)
 {  
 	int rc = 0;
 	rollingfile_udata_t* rfup = NULL; 
+	unsigned long long acquired;
 
 	sd_debug("rollingfile_close[");
 	if(!this){
@@ -198,9 +235,17 @@ static int rollingfile_close(log4c_appender_t* this)
 
 		rfup = log4c_appender_get_udata(this);
 
-		pthread_mutex_lock(&rfup->rfu_mutex);  /***** LOCK ****/  
+		LOG4C_TRACE2(lock_wait, "rollingfile", log4c_appender_get_name(this));
+		__log4c_lock(&__log4c_lock_site_rollingfile, &rfup->rfu_mutex,
+			     &acquired);  /***** LOCK ****/  
+		LOG4C_TRACE2(lock_acquired, "rollingfile", log4c_appender_get_name(this));
 		rc = (rfup->rfu_current_fp ? fclose(rfup->rfu_current_fp) : 0);
 		rfup->rfu_current_fp = NULL;
+		rollingfile_index_close(rfup);
+		if( rfup->rfu_current_filename) {
+			free(rfup->rfu_current_filename);
+			rfup->rfu_current_filename = NULL;
+		}
 
 		rfup->rfu_current_file_size = 0;
 		if( rfup->rfu_base_filename) {
@@ -224,7 +269,9 @@ static int rollingfile_close(log4c_appender_t* this)
 			}
 		}
 
-		pthread_mutex_unlock(&rfup->rfu_mutex);  /****** UNLOCK *****/
+		LOG4C_TRACE2(lock_release, "rollingfile", log4c_appender_get_name(this));
+		__log4c_unlock(&__log4c_lock_site_rollingfile, &rfup->rfu_mutex,
+			       acquired);  /****** UNLOCK *****/
 	}
 	sd_debug("]");
 	return(rc);
@@ -288,6 +335,117 @@ LOG4C_API long  rollingfile_get_current_file_size( rollingfile_udata_t* rfup){
 
 }
 
+/*******************************************************************************/
+
+LOG4C_API int rollingfile_udata_set_index(rollingfile_udata_t* rfup,
+					  long a_size, long a_interval){
+
+	rfup->rfu_index_size = (a_size > 0 ? a_size : 0);
+	rfup->rfu_index_interval = (a_interval > 0 ? a_interval : 0);
+
+	return(0);
+}
+/*******************************************************************************/
+
+LOG4C_API int rollingfile_udata_set_current_filename(rollingfile_udata_t* rfup,
+						      const char* a_filename){
+
+	char *s = strdup(a_filename);
+
+	if (!s)
+		return(-1);
+	free(rfup->rfu_current_filename);
+	rfup->rfu_current_filename = s;
+
+	return(0);
+}
+/*******************************************************************************/
+
+LOG4C_API int rollingfile_index_read(const char* a_logfile,
+				     rollingfile_index_entry_t** a_entries,
+				     size_t* a_nentries){
+
+	rollingfile_index_header_t hdr;
+	rollingfile_index_entry_t* entries = NULL;
+	size_t n = 0, max = 0;
+	char* name;
+	FILE* fp;
+
+	if (!a_logfile || !a_entries || !a_nentries)
+		return(-1);
+
+	name = malloc(strlen(a_logfile) + sizeof(ROLLINGFILE_INDEX_SUFFIX));
+	if (!name)
+		return(-1);
+	sprintf(name, "%s" ROLLINGFILE_INDEX_SUFFIX, a_logfile);
+	fp = fopen(name, "rb");
+	free(name);
+	if (!fp)
+		return(-1);
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.rih_magic, ROLLINGFILE_INDEX_MAGIC, sizeof(hdr.rih_magic)) ||
+	    hdr.rih_byteorder != ROLLINGFILE_INDEX_BYTEORDER) {
+		fclose(fp);
+		return(-1);
+	}
+
+	for (;;) {
+		if (n == max) {
+			rollingfile_index_entry_t* p;
+
+			max = (max ? 2 * max : 256);
+			p = realloc(entries, max * sizeof(*entries));
+			if (!p) {
+				free(entries);
+				fclose(fp);
+				return(-1);
+			}
+			entries = p;
+		}
+		/* a partial last entry is ignored */
+		if (fread(&entries[n], sizeof(*entries), 1, fp) != 1)
+			break;
+		n++;
+	}
+	fclose(fp);
+
+	*a_entries = entries;
+	*a_nentries = n;
+	return(0);
+}
+/*******************************************************************************/
+
+LOG4C_API long rollingfile_index_find(const char* a_logfile,
+				      const struct timeval* a_time){
+
+	rollingfile_index_entry_t* entries;
+	size_t n, lo, hi;
+	long offset;
+
+	if (!a_time ||
+	    rollingfile_index_read(a_logfile, &entries, &n) == -1)
+		return(-1);
+
+	/* the first entry not before a_time */
+	lo = 0;
+	hi = n;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (entries[mid].rie_sec < a_time->tv_sec ||
+		    (entries[mid].rie_sec == a_time->tv_sec &&
+		     entries[mid].rie_usec < (unsigned int) a_time->tv_usec))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	offset = (long) (lo ? entries[lo - 1].rie_offset : 0);
+	free(entries);
+	return(offset);
+}
+
 /*****************************************************************************
 Private functions
 *****************************************************************************/
@@ -343,11 +501,117 @@ static char *rollingfile_make_base_name(const char *logdir, const char* prefix){
 	return(s);
 }
 
+/*******************************************************************************/
+
+static void rollingfile_index_close(rollingfile_udata_t *rfup){
+
+	if (rfup->rfu_index_fp)
+		fclose(rfup->rfu_index_fp);
+	rfup->rfu_index_fp = NULL;
+}
+/*******************************************************************************/
+
+/*
+* Opens the index of the file just opened: a new one when the file is
+* empty, which is the case after a rollover, otherwise appends to it.
+*/
+static void rollingfile_index_open(rollingfile_udata_t *rfup){
+
+	char *name;
+
+	rollingfile_index_close(rfup);
+	rfup->rfu_index_offset = -1;
+
+	if ((!rfup->rfu_index_size && !rfup->rfu_index_interval) ||
+	    !rfup->rfu_current_filename)
+		return;
+
+	name = malloc(strlen(rfup->rfu_current_filename) +
+		      sizeof(ROLLINGFILE_INDEX_SUFFIX));
+	if (!name)
+		return;
+	sprintf(name, "%s" ROLLINGFILE_INDEX_SUFFIX, rfup->rfu_current_filename);
+
+	rfup->rfu_index_fp = fopen(name, rfup->rfu_current_file_size ? "ab" : "wb");
+	if (!rfup->rfu_index_fp) {
+		sd_error("failed to open index file '%s'", name);
+	} else if (ftell(rfup->rfu_index_fp) <= 0) {
+		rollingfile_index_header_t hdr;
+
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.rih_magic, ROLLINGFILE_INDEX_MAGIC, sizeof(hdr.rih_magic));
+		hdr.rih_version = ROLLINGFILE_INDEX_VERSION;
+		hdr.rih_byteorder = ROLLINGFILE_INDEX_BYTEORDER;
+		fwrite(&hdr, sizeof(hdr), 1, rfup->rfu_index_fp);
+		fflush(rfup->rfu_index_fp);
+	}
+	free(name);
+}
+/*******************************************************************************/
+
+/*
+* The time of an event in nanoseconds. The type does not need the time
+* of the events, which are only stamped when their layout or another
+* appender does: the index reads the clock itself then.
+*/
+static unsigned long long rollingfile_event_time(
+	const log4c_logging_event_t* a_event){
+
+	sd_clock_time_t now;
+
+	if (a_event->evt_realtime_ns)
+		return(a_event->evt_realtime_ns);
+
+	sd_clock_read(&now);
+	return(now.ct_realtime);
+}
+/*******************************************************************************/
+
+/*
+* Adds an entry for the event about to be written when enough bytes or
+* time have passed since the last one. Called with the lock held.
+*/
+static void rollingfile_index_add(rollingfile_udata_t *rfup,
+				  const log4c_logging_event_t* a_event){
+
+	rollingfile_index_entry_t entry;
+	unsigned long long t = 0;
+
+	if (rfup->rfu_index_offset >= 0 &&
+	    (!rfup->rfu_index_size ||
+	     rfup->rfu_current_file_size - rfup->rfu_index_offset < rfup->rfu_index_size)) {
+		if (!rfup->rfu_index_interval)
+			return;
+		t = rollingfile_event_time(a_event);
+		if ((long long) (t / 1000000000) - rfup->rfu_index_sec <
+		    rfup->rfu_index_interval)
+			return;
+	}
+	if (!t)
+		t = rollingfile_event_time(a_event);
+
+	memset(&entry, 0, sizeof(entry));
+	entry.rie_sec = (long long) (t / 1000000000);
+	entry.rie_usec = (unsigned int) (t % 1000000000 / 1000);
+	entry.rie_offset = rfup->rfu_current_file_size;
+
+	if (fwrite(&entry, sizeof(entry), 1, rfup->rfu_index_fp) != 1 ||
+	    fflush(rfup->rfu_index_fp)) {
+		sd_error("failed to write index entry");
+		return;
+	}
+
+	rfup->rfu_index_offset = rfup->rfu_current_file_size;
+	rfup->rfu_index_sec = entry.rie_sec;
+}
+
 /****************************************************************************/
 const log4c_appender_type_t log4c_appender_type_rollingfile = {
 	"rollingfile",
 	rollingfile_open,
 	rollingfile_append,
-	rollingfile_close
+	rollingfile_close,
+	NULL,
+	LOG4C_NEEDS_NONE,
 };
 
@@ -47,12 +47,39 @@
  *
 */
 
+#include <stddef.h>
 #include <log4c/defs.h>
 #include <log4c/appender.h>
 #include <log4c/rollingpolicy.h>
 
 __LOG4C_BEGIN_DECLS
 
+#define ROLLINGFILE_INDEX_SUFFIX	".idx"
+#define ROLLINGFILE_INDEX_MAGIC		"L4CX"
+#define ROLLINGFILE_INDEX_VERSION	1
+#define ROLLINGFILE_INDEX_BYTEORDER	0x01020304
+
+/**
+ * An index file starts with this header, followed by entries, in the byte
+ * order of the writer.
+ **/
+typedef struct {
+    char		rih_magic[4];
+    unsigned int	rih_version;
+    unsigned int	rih_byteorder;
+    unsigned int	rih_reserved;
+} rollingfile_index_header_t;
+
+/**
+ * An index entry: the timestamp of an event and its offset in the file.
+ **/
+typedef struct {
+    long long		rie_sec;
+    unsigned int	rie_usec;
+    unsigned int	rie_reserved;
+    long long		rie_offset;
+} rollingfile_index_entry_t;
+
 /**
  * rollingfile appender type definition.
  *
@@ -115,6 +142,50 @@ LOG4C_API const char* rollingfile_udata_get_files_prefix(
  */ 
 LOG4C_API long  rollingfile_get_current_file_size( rollingfile_udata_t* rfudatap);
 
+/**
+ * Enable the sidecar index in this rolling file appender configuration.
+ * @param rfudatap the rolling file appender configuration object.
+ * @param size the number of bytes between index entries, 0 for no limit.
+ * @param interval the number of seconds between index entries, 0 for no
+ * limit.
+ * The index is disabled when both are 0.
+ * @return zero if successful, non-zero otherwise.
+ */
+LOG4C_API int rollingfile_udata_set_index(rollingfile_udata_t* rfudatap,
+					  long size, long interval);
+
+/**
+ * Set the name of the file being logged to. Rolling policies call this
+ * when they open a file, so that its index is named after it.
+ * @param rfudatap the rolling file appender configuration object.
+ * @param filename the name of the file.
+ * @return zero if successful, non-zero otherwise.
+ */
+LOG4C_API int rollingfile_udata_set_current_filename(
+                            rollingfile_udata_t* rfudatap,
+                            const char* filename);
+
+/**
+ * Read the index of a log file.
+ * @param logfile the name of the log file, without the index suffix.
+ * @param entries where to store the entries, to be freed with free().
+ * @param nentries where to store the number of entries.
+ * @return zero if successful, non-zero if there is no valid index.
+ */
+LOG4C_API int rollingfile_index_read(const char* logfile,
+				     rollingfile_index_entry_t** entries,
+				     size_t* nentries);
+
+/**
+ * Find where to start reading a log file for the events from a time on.
+ * @param logfile the name of the log file, without the index suffix.
+ * @param time the time.
+ * @return the offset of the last index entry before @a time, 0 if there
+ * is none, or -1 if there is no valid index.
+ */
+LOG4C_API long rollingfile_index_find(const char* logfile,
+				      const struct timeval* time);
+
 __LOG4C_END_DECLS
 
 #endif
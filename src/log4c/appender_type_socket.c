@@ -82,9 +82,7 @@ static int socket_append(log4c_appender_t* this, const log4c_logging_event_t* a_
 {
 	socket_udata_t* sock = log4c_appender_get_udata(this); 
 
-	sendto(sock->sockfd, a_event->evt_rendered_msg, strlen(a_event->evt_rendered_msg), 0, (struct sockaddr *)&sock->sockaddr, sizeof(sock->sockaddr));
-
-	return 0;
+	return (int) sendto(sock->sockfd, a_event->evt_rendered_msg, strlen(a_event->evt_rendered_msg), 0, (struct sockaddr *)&sock->sockaddr, sizeof(sock->sockaddr));
 }
 
 /*******************************************************************************/
@@ -137,4 +135,6 @@ const log4c_appender_type_t log4c_appender_type_socket = {
     socket_open,
     socket_append,
     socket_close,
+    NULL,
+    LOG4C_NEEDS_NONE,
 };
\ No newline at end of file
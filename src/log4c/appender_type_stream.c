@@ -58,5 +58,7 @@ const log4c_appender_type_t log4c_appender_type_stream = {
     stream_open,
     stream_append,
     stream_close,
+    NULL,
+    LOG4C_NEEDS_NONE,
 };
 
@@ -100,5 +100,7 @@ const log4c_appender_type_t log4c_appender_type_syslog = {
     syslog_open,
     syslog_append,
     syslog_close,
+    NULL,
+    LOG4C_NEEDS_NONE,
 };
 
@@ -0,0 +1,406 @@
+static const char version[] = "$Id$";
+
+/*
+ * backtrace.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/backtrace.h>
+#include <log4c/context.h>
+#include <log4c/field.h>
+#include <log4c/thread.h>
+#include <log4c/rc.h>
+#include <sd/sprintf.h>
+#include <sd/malloc.h>
+#include <sd/error.h>
+#include <sd/sd_xplatform.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define BACKTRACE_PTHREADS
+#endif
+
+#define BACKTRACE_SIZE_DEFAULT	(64 * 1024)
+#define BACKTRACE_SIZE_MIN	(16 * 1024)
+
+#define BACKTRACE_ALIGN(n)	(((n) + 7) & ~(size_t) 7)
+#define BACKTRACE_HEADER	BACKTRACE_ALIGN(sizeof(backtrace_entry_t))
+
+/*
+ * An event of a ring. It is followed by the message, the NDC, the MDC and
+ * the fields of the event, each aligned on 8 bytes. The MDC and the
+ * fields are encoded by log4c_field_encode().
+ */
+typedef struct {
+    size_t			be_size;
+    int				be_category;
+    int				be_priority;
+    log4c_location_info_t	be_loc;
+    unsigned long long		be_realtime;
+    unsigned long long		be_monotonic;
+    unsigned long long		be_sequence;
+    size_t			be_msgsize;
+    size_t			be_ndcsize;
+    size_t			be_mdcsize;
+    size_t			be_fieldsize;
+} backtrace_entry_t;
+
+/*
+ * The ring of a thread. bt_head and bt_tail count the bytes written and
+ * dropped since it was created, the size is a power of two. An entry
+ * never wraps: when it does not fit before the end of the ring, the end
+ * is skipped, marked by an entry of size 0 when there is room for one.
+ */
+typedef struct {
+    char*	bt_data;
+    size_t	bt_size;
+    size_t	bt_head;
+    size_t	bt_tail;
+    size_t	bt_count;
+    int		bt_flushing;
+} backtrace_t;
+
+static size_t backtrace_size = BACKTRACE_SIZE_DEFAULT;
+static int backtrace_trigger = LOG4C_PRIORITY_ERROR;
+
+#ifdef SD_TLS
+static SD_TLS backtrace_t* backtrace_self = NULL;
+#elif !defined(BACKTRACE_PTHREADS)
+static backtrace_t* backtrace_self = NULL;
+#endif
+
+#ifdef BACKTRACE_PTHREADS
+static pthread_once_t backtrace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t backtrace_key;
+
+/*******************************************************************************/
+static void backtrace_thread_exit(void* a_ring)
+{
+    backtrace_t* this = a_ring;
+
+    /* a destructor which logs after this one gets a new ring */
+#ifdef SD_TLS
+    if (backtrace_self == this)
+	backtrace_self = NULL;
+#endif
+    free(this->bt_data);
+    free(this);
+}
+
+/*******************************************************************************/
+static void backtrace_key_create(void)
+{
+    pthread_key_create(&backtrace_key, backtrace_thread_exit);
+}
+#endif
+
+/*******************************************************************************/
+/* the ring of the thread, NULL until it first logs */
+static backtrace_t* backtrace_peek(void)
+{
+#if defined(SD_TLS) || !defined(BACKTRACE_PTHREADS)
+    return backtrace_self;
+#else
+    pthread_once(&backtrace_once, backtrace_key_create);
+    return pthread_getspecific(backtrace_key);
+#endif
+}
+
+/*******************************************************************************/
+static backtrace_t* backtrace_get(void)
+{
+    backtrace_t* this = backtrace_peek();
+
+    if (this)
+	return this;
+
+    this = sd_calloc(1, sizeof(*this));
+    this->bt_size = backtrace_size;
+    this->bt_data = sd_malloc(this->bt_size);
+
+#ifdef BACKTRACE_PTHREADS
+    pthread_once(&backtrace_once, backtrace_key_create);
+    pthread_setspecific(backtrace_key, this);
+#endif
+#if defined(SD_TLS) || !defined(BACKTRACE_PTHREADS)
+    backtrace_self = this;
+#endif
+    return this;
+}
+
+/*******************************************************************************/
+/* the oldest entry, past the end of the ring when it was skipped */
+static backtrace_entry_t* backtrace_tail(backtrace_t* this)
+{
+    size_t offset = this->bt_tail & (this->bt_size - 1);
+    backtrace_entry_t* entry = (backtrace_entry_t*) (this->bt_data + offset);
+
+    if (this->bt_size - offset < BACKTRACE_HEADER || !entry->be_size) {
+	this->bt_tail += this->bt_size - offset;
+	entry = (backtrace_entry_t*) this->bt_data;
+    }
+    return entry;
+}
+
+/*******************************************************************************/
+/* makes room for an entry, dropping the oldest ones */
+static backtrace_entry_t* backtrace_reserve(backtrace_t* this, size_t a_size)
+{
+    size_t offset = this->bt_head & (this->bt_size - 1);
+    size_t skip = offset + a_size > this->bt_size ? this->bt_size - offset : 0;
+
+    while (this->bt_head + skip + a_size - this->bt_tail > this->bt_size) {
+	this->bt_tail += backtrace_tail(this)->be_size;
+	this->bt_count--;
+    }
+
+    if (skip) {
+	if (skip >= BACKTRACE_HEADER)
+	    ((backtrace_entry_t*) (this->bt_data + offset))->be_size = 0;
+	this->bt_head += skip;
+	offset = 0;
+    }
+    return (backtrace_entry_t*) (this->bt_data + offset);
+}
+
+/*******************************************************************************/
+static void backtrace_put(const log4c_category_t* a_category,
+			  const log4c_location_info_t* a_locinfo,
+			  int a_priority,
+			  const char* a_message,
+			  size_t a_len,
+			  const log4c_field_t* a_fields,
+			  size_t a_nfields)
+{
+    backtrace_t* this = backtrace_get();
+    backtrace_entry_t* entry;
+    log4c_logging_event_t evt;
+    size_t ndcsize, mdcsize, fieldsize, size;
+    char* out;
+
+    /* the appenders log while the ring is flushed */
+    if (this->bt_flushing)
+	return;
+
+    __log4c_logging_event_stamp(&evt, LOG4C_NEEDS_TIME | LOG4C_NEEDS_CONTEXT);
+
+    if (a_len >= LOG4C_BACKTRACE_MESSAGE_MAX)
+	a_len = LOG4C_BACKTRACE_MESSAGE_MAX - 1;
+    ndcsize   = evt.evt_ndc ? strlen(evt.evt_ndc) + 1 : 0;
+    mdcsize   = log4c_field_encoded_size(evt.evt_mdc, evt.evt_nmdc);
+    fieldsize = log4c_field_encoded_size(a_fields, a_nfields);
+    size = BACKTRACE_HEADER + BACKTRACE_ALIGN(a_len + 1) +
+	BACKTRACE_ALIGN(ndcsize) + mdcsize + fieldsize;
+
+    if (size > this->bt_size / 2) {
+	sd_error("dropping backtrace event of %d bytes", (int) size);
+	return;
+    }
+
+    entry = backtrace_reserve(this, size);
+    entry->be_size	= size;
+    entry->be_category	= log4c_category_get_id(a_category);
+    entry->be_priority	= a_priority;
+    entry->be_realtime	= evt.evt_realtime_ns;
+    entry->be_monotonic	= evt.evt_monotonic_ns;
+    entry->be_sequence	= evt.evt_sequence;
+    entry->be_msgsize	= a_len + 1;
+    entry->be_ndcsize	= ndcsize;
+    entry->be_mdcsize	= mdcsize;
+    entry->be_fieldsize	= fieldsize;
+    if (a_locinfo)
+	entry->be_loc = *a_locinfo;
+    else
+	memset(&entry->be_loc, 0, sizeof(entry->be_loc));
+
+    out = (char*) entry + BACKTRACE_HEADER;
+    memcpy(out, a_message, a_len);
+    out[a_len] = '\0';
+    out += BACKTRACE_ALIGN(a_len + 1);
+    if (ndcsize)
+	memcpy(out, evt.evt_ndc, ndcsize);
+    out += BACKTRACE_ALIGN(ndcsize);
+    out += log4c_field_encode(evt.evt_mdc, evt.evt_nmdc, out);
+    log4c_field_encode(a_fields, a_nfields, out);
+
+    this->bt_head += size;
+    this->bt_count++;
+}
+
+/*******************************************************************************/
+static void backtrace_dispatch(backtrace_entry_t* a_entry)
+{
+    const log4c_category_t* cat = log4c_category_get_by_id(a_entry->be_category);
+    char* in = (char*) a_entry + BACKTRACE_HEADER;
+    log4c_field_t mdc[LOG4C_MDC_MAX];
+    log4c_field_t* fields = NULL;
+    log4c_logging_event_t evt;
+    int nmdc = 0, nfields = 0;
+
+    if (!cat)
+	return;
+
+    evt.evt_msg = in;
+    in += BACKTRACE_ALIGN(a_entry->be_msgsize);
+    evt.evt_ndc = a_entry->be_ndcsize ? in : NULL;
+    in += BACKTRACE_ALIGN(a_entry->be_ndcsize);
+    if (a_entry->be_mdcsize &&
+	(nmdc = log4c_field_decode(in, a_entry->be_mdcsize, mdc,
+				   LOG4C_MDC_MAX)) < 0)
+	nmdc = 0;
+    in += a_entry->be_mdcsize;
+    if (a_entry->be_fieldsize &&
+	(nfields = log4c_field_decode(in, a_entry->be_fieldsize, NULL, 0)) > 0) {
+	fields = sd_malloc(nfields * sizeof(*fields));
+	log4c_field_decode(in, a_entry->be_fieldsize, fields, nfields);
+    }
+    else
+	nfields = 0;
+
+    evt.evt_buffer.buf_maxsize = log4c_rc->config.bufsize;
+    evt.evt_buffer.buf_size = evt.evt_buffer.buf_maxsize ?
+	evt.evt_buffer.buf_maxsize : LOG4C_BUFFER_SIZE_DEFAULT;
+    evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
+
+    if (evt.evt_buffer.buf_maxsize &&
+	a_entry->be_msgsize > evt.evt_buffer.buf_maxsize)
+	((char*) evt.evt_msg)[evt.evt_buffer.buf_maxsize - 1] = '\0';
+
+    evt.evt_category	= log4c_category_get_name(cat);
+    evt.evt_priority	= a_entry->be_priority;
+    evt.evt_loc		= a_entry->be_loc.loc_file ? &a_entry->be_loc : NULL;
+    evt.evt_fields	= fields;
+    evt.evt_nfields	= nfields;
+    evt.evt_sequence	= a_entry->be_sequence;
+    evt.evt_thread	= log4c_thread_get();
+    evt.evt_mdc		= nmdc ? mdc : NULL;
+    evt.evt_nmdc	= nmdc;
+    log4c_logging_event_set_time(&evt, a_entry->be_realtime,
+				 a_entry->be_monotonic);
+
+    __log4c_category_dispatch(cat, &evt);
+
+    free(evt.evt_buffer.buf_data);
+    free(fields);
+}
+
+/*******************************************************************************/
+extern size_t log4c_backtrace_set_size(size_t a_size)
+{
+    size_t previous = backtrace_size;
+    size_t size = BACKTRACE_SIZE_MIN;
+
+    if (!a_size)
+	a_size = BACKTRACE_SIZE_DEFAULT;
+    while (size < a_size)
+	size <<= 1;
+
+    backtrace_size = size;
+    return previous;
+}
+
+/*******************************************************************************/
+extern int log4c_backtrace_set_trigger(int a_priority)
+{
+    int previous = backtrace_trigger;
+
+    backtrace_trigger = a_priority;
+    return previous;
+}
+
+/*******************************************************************************/
+extern void log4c_backtrace_flush(void)
+{
+    backtrace_t* this = backtrace_peek();
+    backtrace_entry_t* entry;
+
+    if (!this || !this->bt_count || this->bt_flushing)
+	return;
+
+    this->bt_flushing = 1;
+    while (this->bt_count) {
+	entry = backtrace_tail(this);
+	backtrace_dispatch(entry);
+	this->bt_tail += entry->be_size;
+	this->bt_count--;
+    }
+    this->bt_flushing = 0;
+}
+
+/*******************************************************************************/
+extern void log4c_backtrace_clear(void)
+{
+    backtrace_t* this = backtrace_peek();
+
+    if (!this || this->bt_flushing)
+	return;
+
+    this->bt_tail  = this->bt_head;
+    this->bt_count = 0;
+}
+
+/*******************************************************************************/
+extern size_t log4c_backtrace_get_count(void)
+{
+    backtrace_t* this = backtrace_peek();
+
+    return this ? this->bt_count : 0;
+}
+
+/*******************************************************************************/
+extern void __log4c_backtrace_put(const log4c_category_t* a_category,
+				  const log4c_location_info_t* a_locinfo,
+				  int a_priority,
+				  const char* a_message,
+				  size_t a_len,
+				  const log4c_field_t* a_fields,
+				  size_t a_nfields)
+{
+    backtrace_put(a_category, a_locinfo, a_priority, a_message, a_len,
+		  a_fields, a_nfields);
+}
+
+/*******************************************************************************/
+extern void __log4c_backtrace_vput(const log4c_category_t* a_category,
+				   const log4c_location_info_t* a_locinfo,
+				   int a_priority,
+				   const sd_format_t* a_parsed,
+				   const char* a_format,
+				   va_list a_args)
+{
+    char message[LOG4C_BACKTRACE_MESSAGE_MAX];
+    int n;
+
+    if (sd_format_is_literal(a_parsed)) {
+	backtrace_put(a_category, a_locinfo, a_priority, a_format,
+		      sd_format_get_length(a_parsed), NULL, 0);
+	return;
+    }
+
+    n = a_parsed ?
+	sd_format_vsnprintf(a_parsed, message, sizeof(message), a_args) :
+	sd_vsnprintf(message, sizeof(message), a_format, a_args);
+    if (n < 0)
+	return;
+
+    backtrace_put(a_category, a_locinfo, a_priority, message,
+		  (size_t) n < sizeof(message) ? (size_t) n : sizeof(message) - 1,
+		  NULL, 0);
+}
+
+/*******************************************************************************/
+extern void __log4c_backtrace_trigger(int a_priority)
+{
+    backtrace_t* this;
+
+    if (a_priority <= backtrace_trigger && (this = backtrace_peek()) != NULL &&
+	this->bt_count)
+	log4c_backtrace_flush();
+}
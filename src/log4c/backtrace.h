@@ -0,0 +1,133 @@
+/* $Id$
+ *
+ * backtrace.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_backtrace_h
+#define log4c_backtrace_h
+
+/**
+ * @file backtrace.h
+ *
+ * @brief the events which lead to an error.
+ *
+ * A category given a backtrace priority with
+ * log4c_category_set_backtrace() keeps the events it would not log, down
+ * to that priority, in a ring of the calling thread instead of dropping
+ * them. Nothing is formatted by a layout nor sent to an appender: the
+ * message is written to the ring with the time, the location and the
+ * diagnostic contexts of the event, and the oldest events make room for
+ * the new ones.
+ *
+ * When the thread logs an event of the trigger priority or higher, the
+ * ring is flushed ahead of it: each event goes to the appenders of its
+ * category as it would have been logged. A category can so run at the
+ * info priority and still show the debug events which came before an
+ * error.
+ *
+ * @code
+ * log4c_category_set_backtrace(cat, LOG4C_PRIORITY_DEBUG);
+ * ...
+ * log4c_category_debug(cat, "cache miss for %s", key);   (kept)
+ * log4c_category_error(cat, "lookup failed");            (flushes)
+ * @endcode
+ *
+ * The log4crc file sets the backtrace priority of a category with the
+ * "backtrace" attribute of its @c <category> element.
+ **/
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <log4c/defs.h>
+#include <log4c/category.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The longest message kept in a ring, '\0' included. Longer messages are
+ * truncated.
+ **/
+#define LOG4C_BACKTRACE_MESSAGE_MAX	1024
+
+/**
+ * Sets the size of the rings of the threads which keep their first event
+ * from now on.
+ *
+ * @param a_size the size in bytes, 0 for 64KB
+ * @returns the previous size
+ **/
+LOG4C_API size_t log4c_backtrace_set_size(size_t a_size);
+
+/**
+ * Sets the priority of the events which flush the ring of their thread.
+ *
+ * @param a_priority the trigger priority, LOG4C_PRIORITY_ERROR by default
+ * @returns the previous trigger priority
+ **/
+LOG4C_API int log4c_backtrace_set_trigger(int a_priority);
+
+/**
+ * Sends the events of the ring of the calling thread to the appenders of
+ * their categories and empties it.
+ **/
+LOG4C_API void log4c_backtrace_flush(void);
+
+/**
+ * Empties the ring of the calling thread, for instance once a request
+ * completed without error.
+ **/
+LOG4C_API void log4c_backtrace_clear(void);
+
+/**
+ * @returns the number of events in the ring of the calling thread
+ **/
+LOG4C_API size_t log4c_backtrace_get_count(void);
+
+/**
+ * @internal
+ * Keeps an event in the ring of the calling thread.
+ *
+ * @param a_category the category of the event
+ * @param a_locinfo the location of the event, copied
+ * @param a_priority the priority of the event
+ * @param a_message the message
+ * @param a_len the length of the message
+ * @param a_fields the key/value fields of the event
+ * @param a_nfields the number of fields
+ **/
+LOG4C_API void __log4c_backtrace_put(const log4c_category_t* a_category,
+				     const log4c_location_info_t* a_locinfo,
+				     int a_priority,
+				     const char* a_message,
+				     size_t a_len,
+				     const log4c_field_t* a_fields,
+				     size_t a_nfields);
+
+/**
+ * @internal
+ * Keeps an event in the ring of the calling thread, formatting its
+ * message.
+ *
+ * @param a_parsed the parsed format of a call site, or NULL
+ * @param a_format the format
+ * @param a_args the arguments of the format
+ **/
+LOG4C_API void __log4c_backtrace_vput(const log4c_category_t* a_category,
+				      const log4c_location_info_t* a_locinfo,
+				      int a_priority,
+				      const struct __sd_format* a_parsed,
+				      const char* a_format,
+				      va_list a_args);
+
+/**
+ * @internal
+ * Flushes the ring of the calling thread if @a a_priority is the trigger
+ * priority or higher.
+ **/
+LOG4C_API void __log4c_backtrace_trigger(int a_priority);
+
+__LOG4C_END_DECLS
+
+#endif
@@ -0,0 +1,1519 @@
+static const char version[] = "$Id$";
+
+/*
+ * binlog.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/binlog.h>
+#include <log4c/appender.h>
+#include <log4c/rc.h>
+#include <log4c/thread.h>
+#include <log4c/context.h>
+#include <log4c/backtrace.h>
+#include <log4c/sigsafe.h>
+#include <sd/hash.h>
+#include <sd/clock.h>
+#include <sd/sprintf.h>
+#include <sd/malloc.h>
+#include <sd/error.h>
+#include <sd/sd_xplatform.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define BINLOG_THREADS
+#endif
+
+#ifndef va_copy
+#define va_copy(d, s)  d = s
+#endif
+
+/*
+ * A format is split at each conversion: each spec holds the literal text
+ * before the conversion, the conversion itself and the type of its
+ * argument. The last spec holds the trailing text and no conversion.
+ */
+typedef enum {
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_STRING,
+    ARG_POINTER
+} binlog_arg_t;
+
+#define BINLOG_MAXSPEC	32
+
+typedef struct {
+    const char*		sp_literal;
+    size_t		sp_litlen;
+    char		sp_spec[BINLOG_MAXSPEC];
+    int			sp_nstars;
+    int			sp_precision;
+    binlog_arg_t	sp_arg;
+} binlog_spec_t;
+
+/* sp_precision of a conversion without a precision, or with '*' */
+#define BINLOG_PRECISION_NONE	-1
+#define BINLOG_PRECISION_STAR	-2
+
+struct __log4c_binlog_format {
+    char*		fmt_string;
+    int			fmt_nspecs;
+    binlog_spec_t*	fmt_specs;
+};
+
+#define BINLOG_ALIGN(n)		(((n) + 7) & ~(size_t) 7)
+#define BINLOG_NULL_STRING	0xffffffffU
+
+/*
+ * The dictionary: formats by id, in pages so that an id can be looked up
+ * without locking, and an index by string to share ids.
+ */
+#define DICT_PAGE_SHIFT		8
+#define DICT_PAGE_SIZE		(1 << DICT_PAGE_SHIFT)
+#define DICT_NPAGES		256
+#define DICT_MAXID		(DICT_PAGE_SIZE * DICT_NPAGES)
+
+static log4c_binlog_format_t** dict_pages[DICT_NPAGES];
+static int dict_nformats = 0;
+static sd_hash_t* dict_index = NULL;
+
+#ifdef BINLOG_THREADS
+/*
+ * The buffer of a thread: a ring of records with a single producer, the
+ * thread, and a single consumer, the background thread. The producer
+ * publishes records by moving bb_tail with a release store and the
+ * consumer frees them by moving bb_head. Both only grow; the offset in
+ * bb_data is taken modulo bb_size, a power of two.
+ *
+ * The producer writes a context record when the contexts of the thread
+ * changed since the last one, bb_context. The consumer keeps the last
+ * one it read in bb_ctxdata, decoded in bb_mdc and bb_ndc, and the
+ * number of the last segment it was written to in bb_ctxsegment.
+ */
+#define BINLOG_BUFSIZE_DEFAULT	(1024 * 1024)
+#define BINLOG_BUFSIZE_MIN	4096
+
+typedef struct __log4c_binlog_buffer {
+    struct __log4c_binlog_buffer* bb_next;
+    char*		bb_data;
+    size_t		bb_size;
+    unsigned int	bb_thread;
+    log4c_thread_t	bb_self;
+    char		bb_name[LOG4C_THREAD_NAME_MAX];
+    int			bb_orphan;
+    XP_UINT64		bb_sequence;
+    XP_UINT64		bb_drops;
+    unsigned int	bb_context;
+    char*		bb_ctxdata;
+    size_t		bb_ctxsize;
+    log4c_field_t*	bb_mdc;
+    size_t		bb_nmdc;
+    const char*		bb_ndc;
+    unsigned int	bb_ctxsegment;
+    char		bb_pad0[64];
+    XP_UINT64		bb_tail;
+    char		bb_pad1[64];
+    XP_UINT64		bb_head;
+} log4c_binlog_buffer_t;
+
+static pthread_mutex_t binlog_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t binlog_key;
+static pthread_once_t binlog_once = PTHREAD_ONCE_INIT;
+#ifdef SD_TLS
+static SD_TLS log4c_binlog_buffer_t* binlog_self = NULL;
+#endif
+static log4c_binlog_buffer_t* binlog_buffers = NULL;
+static unsigned int binlog_nthreads = 0;
+static XP_UINT64 binlog_retired_drops = 0;
+static size_t binlog_bufsize = BINLOG_BUFSIZE_DEFAULT;
+
+static pthread_t binlog_thread;
+static int binlog_running = 0;
+static int binlog_stopping = 0;
+
+/*
+ * The background thread waits on binlog_wakeup when the buffers are
+ * empty, after setting binlog_sleeping; the producers which see it set
+ * wake it. A wakeup lost to a producer checking just before the flag is
+ * set only delays the records by BINLOG_WAIT_MS.
+ */
+#define BINLOG_WAIT_MS		100
+
+static pthread_mutex_t binlog_wait_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t binlog_wakeup = PTHREAD_COND_INITIALIZER;
+static int binlog_sleeping = 0;
+
+/* the flushes requested, and the last one the background thread did */
+static XP_UINT64 binlog_flush_requests = 0;
+static XP_UINT64 binlog_flushed = 0;
+
+/* state of the background thread */
+static log4c_binlog_buffer_t** binlog_snapshot = NULL;
+static XP_UINT64* binlog_tails = NULL;
+static size_t binlog_nsnapshot = 0;
+static char* binlog_text = NULL;
+static size_t binlog_textsize = 0;
+static log4c_field_t* binlog_fields = NULL;
+static size_t binlog_nfields = 0;
+static log4c_buffer_t binlog_evtbuf;
+
+/* the segment files, when not sending to the appenders */
+static struct {
+    char*		sw_prefix;
+    size_t		sw_maxsize;
+    FILE*		sw_fp;
+    unsigned int	sw_number;
+    size_t		sw_size;
+    char*		sw_formats;
+    size_t		sw_nformats;
+    char*		sw_categories;
+    size_t		sw_ncategories;
+    char*		sw_threads;
+    size_t		sw_nthreads;
+} binlog_writer;
+
+/* the number of segments opened, never reset */
+static unsigned int binlog_nsegments = 0;
+
+#define BINLOG_LOCK()	pthread_mutex_lock(&binlog_mutex)
+#define BINLOG_UNLOCK()	pthread_mutex_unlock(&binlog_mutex)
+#else
+#define BINLOG_LOCK()
+#define BINLOG_UNLOCK()
+#endif
+
+/*******************************************************************************/
+/* parses the conversion at a_spec, returns what follows or NULL */
+static const char* spec_parse(const char* a_spec, binlog_spec_t* a_sp)
+{
+    enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_J, LEN_Z, LEN_T,
+	   LEN_LD } len = LEN_NONE;
+    const char* p = a_spec + 1;
+
+    a_sp->sp_precision = BINLOG_PRECISION_NONE;
+    if (*p == '%') {
+	a_sp->sp_arg = ARG_NONE;
+	return p + 1;
+    }
+
+    while (*p && strchr("-+ #0'", *p))
+	p++;
+
+    if (*p == '*') {
+	a_sp->sp_nstars++;
+	p++;
+    }
+    while (*p >= '0' && *p <= '9')
+	p++;
+
+    if (*p == '.') {
+	p++;
+	if (*p == '*') {
+	    a_sp->sp_nstars++;
+	    a_sp->sp_precision = BINLOG_PRECISION_STAR;
+	    p++;
+	}
+	else
+	    for (a_sp->sp_precision = 0; *p >= '0' && *p <= '9'; p++)
+		a_sp->sp_precision = a_sp->sp_precision * 10 + *p - '0';
+    }
+
+    /* positional arguments */
+    if (*p == '$')
+	return NULL;
+
+    switch (*p) {
+    case 'h': len = (p[1] == 'h') ? LEN_HH : LEN_H; break;
+    case 'l': len = (p[1] == 'l') ? LEN_LL : LEN_L; break;
+    case 'q': len = LEN_LL; break;
+    case 'L': len = LEN_LD; break;
+    case 'j': len = LEN_J; break;
+    case 'z': len = LEN_Z; break;
+    case 't': len = LEN_T; break;
+    }
+    if (len == LEN_HH || len == LEN_LL)
+	p += (*p == 'q') ? 1 : 2;
+    else if (len != LEN_NONE)
+	p++;
+
+    switch (*p) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+	switch (len) {
+	case LEN_L:	a_sp->sp_arg = ARG_LONG; break;
+	case LEN_LL:
+	case LEN_LD:	a_sp->sp_arg = ARG_LLONG; break;
+	case LEN_Z:	a_sp->sp_arg = ARG_SIZE; break;
+	case LEN_T:	a_sp->sp_arg = ARG_PTRDIFF; break;
+#ifdef HAVE_STDINT_H
+	case LEN_J:	a_sp->sp_arg = ARG_INTMAX; break;
+#else
+	case LEN_J:	return NULL;
+#endif
+	default:	a_sp->sp_arg = ARG_INT; break;
+	}
+	break;
+
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+    case 'a': case 'A':
+	if (len == LEN_LD)
+	    a_sp->sp_arg = ARG_LDOUBLE;
+	else if (len == LEN_NONE || len == LEN_L)
+	    a_sp->sp_arg = ARG_DOUBLE;
+	else
+	    return NULL;
+	break;
+
+    case 'c':
+	if (len != LEN_NONE)
+	    return NULL;
+	a_sp->sp_arg = ARG_INT;
+	break;
+
+    case 's':
+	if (len != LEN_NONE)
+	    return NULL;
+	a_sp->sp_arg = ARG_STRING;
+	break;
+
+    case 'p':
+	if (len != LEN_NONE)
+	    return NULL;
+	a_sp->sp_arg = ARG_POINTER;
+	break;
+
+    default:
+	return NULL;
+    }
+
+    return p + 1;
+}
+
+/*******************************************************************************/
+extern log4c_binlog_format_t* log4c_binlog_format_new(const char* a_format)
+{
+    log4c_binlog_format_t* this;
+    const char* p;
+    int n = 1;
+
+    if (!a_format)
+	return NULL;
+
+    for (p = a_format; *p; p++)
+	if (*p == '%')
+	    n++;
+
+    this = sd_calloc(1, sizeof(*this));
+    this->fmt_string = sd_strdup(a_format);
+    this->fmt_specs  = sd_calloc(n, sizeof(binlog_spec_t));
+
+    for (p = this->fmt_string; ; ) {
+	binlog_spec_t* sp = &this->fmt_specs[this->fmt_nspecs++];
+	const char* spec;
+
+	sp->sp_literal = p;
+	while (*p && *p != '%')
+	    p++;
+	sp->sp_litlen = p - sp->sp_literal;
+
+	if (!*p)
+	    break;
+
+	spec = p;
+	if ((p = spec_parse(spec, sp)) == NULL ||
+	    (size_t) (p - spec) >= sizeof(sp->sp_spec))
+	{
+	    log4c_binlog_format_delete(this);
+	    return NULL;
+	}
+	memcpy(sp->sp_spec, spec, p - spec);
+    }
+
+    return this;
+}
+
+/*******************************************************************************/
+extern void log4c_binlog_format_delete(log4c_binlog_format_t* this)
+{
+    if (!this)
+	return;
+
+    free(this->fmt_string);
+    free(this->fmt_specs);
+    free(this);
+}
+
+/*******************************************************************************/
+#define RENDER(value) \
+    (sp->sp_nstars == 0 ? sd_snprintf(out, room, sp->sp_spec, value) : \
+     sp->sp_nstars == 1 ? sd_snprintf(out, room, sp->sp_spec, stars[0], value) : \
+     sd_snprintf(out, room, sp->sp_spec, stars[0], stars[1], value))
+
+#define GET8(type, var) \
+    do { \
+	if (end - in < 8) \
+	    return -1; \
+	var = (type) *(const XP_INT64*) in; \
+	in += 8; \
+    } while (0)
+
+extern int log4c_binlog_format_render(const log4c_binlog_format_t* this,
+				      const void* a_args, size_t a_argsize,
+				      char* a_buf, size_t a_bufsize)
+{
+    const char* in = a_args;
+    const char* end = in + a_argsize;
+    size_t n = 0;
+    int i;
+
+    if (!this || (!a_buf && a_bufsize))
+	return -1;
+
+    for (i = 0; i < this->fmt_nspecs; i++) {
+	const binlog_spec_t* sp = &this->fmt_specs[i];
+	int stars[2];
+	char* out;
+	size_t room;
+	XP_INT64 v;
+	int j, r = 0;
+
+	if (n < a_bufsize)
+	    memcpy(a_buf + n, sp->sp_literal,
+		   sp->sp_litlen < a_bufsize - n ? sp->sp_litlen : a_bufsize - n);
+	n += sp->sp_litlen;
+
+	if (!sp->sp_spec[0])
+	    continue;
+
+	for (j = 0; j < sp->sp_nstars; j++)
+	    GET8(int, stars[j]);
+
+	out  = (n < a_bufsize) ? a_buf + n : NULL;
+	room = (n < a_bufsize) ? a_bufsize - n : 0;
+
+	switch (sp->sp_arg) {
+	case ARG_NONE:
+	    if (room)
+		*out = '%';
+	    r = 1;
+	    break;
+	case ARG_INT:	  GET8(XP_INT64, v); r = RENDER((int) v); break;
+	case ARG_LONG:	  GET8(XP_INT64, v); r = RENDER((long) v); break;
+	case ARG_LLONG:	  GET8(XP_INT64, v); r = RENDER((long long) v); break;
+	case ARG_SIZE:	  GET8(XP_INT64, v); r = RENDER((size_t) v); break;
+	case ARG_PTRDIFF: GET8(XP_INT64, v); r = RENDER((ptrdiff_t) v); break;
+#ifdef HAVE_STDINT_H
+	case ARG_INTMAX:  GET8(XP_INT64, v); r = RENDER((intmax_t) v); break;
+#endif
+	case ARG_POINTER: GET8(XP_INT64, v); r = RENDER((void*) (size_t) v); break;
+
+	case ARG_DOUBLE: {
+	    double d;
+
+	    if (end - in < 8)
+		return -1;
+	    memcpy(&d, in, sizeof(d));
+	    in += 8;
+	    r = RENDER(d);
+	    break;
+	}
+
+	case ARG_LDOUBLE: {
+	    long double d;
+
+	    if (end - in < 16)
+		return -1;
+	    memcpy(&d, in, sizeof(d) < 16 ? sizeof(d) : 16);
+	    in += 16;
+	    r = RENDER(d);
+	    break;
+	}
+
+	case ARG_STRING: {
+	    XP_UINT32 len;
+
+	    if (end - in < 4)
+		return -1;
+	    len = *(const XP_UINT32*) in;
+	    if (len == BINLOG_NULL_STRING) {
+		if (end - in < 8)
+		    return -1;
+		in += 8;
+		r = RENDER("(null)");
+		break;
+	    }
+	    if ((size_t) (end - in) < BINLOG_ALIGN(4 + len + 1) || in[4 + len])
+		return -1;
+	    r = RENDER(in + 4);
+	    in += BINLOG_ALIGN(4 + len + 1);
+	    break;
+	}
+
+	default:
+	    return -1;
+	}
+
+	if (r < 0)
+	    return -1;
+	n += r;
+    }
+
+    if (a_bufsize)
+	a_buf[n < a_bufsize ? n : a_bufsize - 1] = '\0';
+
+    return (int) n;
+}
+
+#undef RENDER
+#undef GET8
+
+/*******************************************************************************/
+extern int log4c_binlog_register(const char* a_format)
+{
+    log4c_binlog_format_t* fmt;
+    log4c_binlog_format_t*** page;
+    sd_hash_iter_t* i;
+    int id = -1;
+
+    if (!a_format)
+	return -1;
+
+    BINLOG_LOCK();
+    if (!dict_index)
+	dict_index = sd_hash_new(64, NULL);
+
+    if ((i = sd_hash_lookup(dict_index, a_format)) != NULL) {
+	id = (int) (size_t) i->data - 1;
+	goto out;
+    }
+
+    if (dict_nformats >= DICT_MAXID ||
+	(fmt = log4c_binlog_format_new(a_format)) == NULL)
+	goto out;
+
+    id = dict_nformats++;
+    page = &dict_pages[id >> DICT_PAGE_SHIFT];
+    if (!*page) {
+	log4c_binlog_format_t** p = sd_calloc(DICT_PAGE_SIZE, sizeof(*p));
+
+	SD_ATOMIC_STORE_RELEASE(page, p);
+    }
+    SD_ATOMIC_STORE_RELEASE(&(*page)[id & (DICT_PAGE_SIZE - 1)], fmt);
+    sd_hash_add(dict_index, fmt->fmt_string, (void*) (size_t) (id + 1));
+
+ out:
+    BINLOG_UNLOCK();
+    return id;
+}
+
+#ifdef BINLOG_THREADS
+/*******************************************************************************/
+static const log4c_binlog_format_t* dict_get(int a_id)
+{
+    log4c_binlog_format_t** page;
+
+    if (a_id < 0 || a_id >= DICT_MAXID)
+	return NULL;
+
+    if ((page = SD_ATOMIC_LOAD_ACQUIRE(&dict_pages[a_id >> DICT_PAGE_SHIFT])) == NULL)
+	return NULL;
+
+    return SD_ATOMIC_LOAD_ACQUIRE(&page[a_id & (DICT_PAGE_SIZE - 1)]);
+}
+
+/*******************************************************************************/
+/* returns the format id of a call site, registering it on first use */
+static int site_id(log4c_binlog_site_t* a_site, const char* a_format)
+{
+    int id = SD_ATOMIC_LOAD_ACQUIRE(&a_site->site_id);
+
+    if (id == 0) {
+	id = log4c_binlog_register(a_format);
+	id = (id < 0) ? -1 : id + 1;
+	SD_ATOMIC_STORE_RELEASE(&a_site->site_id, id);
+    }
+
+    return (id < 0) ? -1 : id - 1;
+}
+
+/*******************************************************************************/
+/*
+ * the length of the string argument of a conversion, which stops at its
+ * precision as vsnprintf() does: the string need not be terminated then
+ */
+static size_t arg_strlen(const binlog_spec_t* a_sp, const char* a_string,
+			 int a_star)
+{
+    int precision = a_sp->sp_precision;
+    const char* end;
+
+    if (precision == BINLOG_PRECISION_STAR)
+	precision = a_star;
+    if (precision < 0)
+	return strlen(a_string);
+
+    end = memchr(a_string, '\0', (size_t) precision);
+    return end ? (size_t) (end - a_string) : (size_t) precision;
+}
+
+/*******************************************************************************/
+static size_t args_size(const log4c_binlog_format_t* a_fmt, va_list a_args)
+{
+    va_list ap;
+    size_t size = 0;
+    int i, j;
+
+    va_copy(ap, a_args);
+    for (i = 0; i < a_fmt->fmt_nspecs; i++) {
+	const binlog_spec_t* sp = &a_fmt->fmt_specs[i];
+	int star = 0;
+
+	for (j = 0; j < sp->sp_nstars; j++) {
+	    star = va_arg(ap, int);
+	    size += 8;
+	}
+
+	switch (sp->sp_arg) {
+	case ARG_NONE:	  break;
+	case ARG_INT:	  (void) va_arg(ap, int); size += 8; break;
+	case ARG_LONG:	  (void) va_arg(ap, long); size += 8; break;
+	case ARG_LLONG:	  (void) va_arg(ap, long long); size += 8; break;
+	case ARG_SIZE:	  (void) va_arg(ap, size_t); size += 8; break;
+	case ARG_PTRDIFF: (void) va_arg(ap, ptrdiff_t); size += 8; break;
+#ifdef HAVE_STDINT_H
+	case ARG_INTMAX:  (void) va_arg(ap, intmax_t); size += 8; break;
+#endif
+	case ARG_POINTER: (void) va_arg(ap, void*); size += 8; break;
+	case ARG_DOUBLE:  (void) va_arg(ap, double); size += 8; break;
+	case ARG_LDOUBLE: (void) va_arg(ap, long double); size += 16; break;
+	case ARG_STRING: {
+	    const char* s = va_arg(ap, const char*);
+
+	    size += s ? BINLOG_ALIGN(4 + arg_strlen(sp, s, star) + 1) : 8;
+	    break;
+	}
+	default:
+	    break;
+	}
+    }
+    va_end(ap);
+
+    return size;
+}
+
+/*******************************************************************************/
+static void args_put(const log4c_binlog_format_t* a_fmt, char* a_out,
+		     va_list a_args)
+{
+    va_list ap;
+    int i, j;
+
+#define PUT8(value) \
+    do { \
+	*(XP_INT64*) a_out = (XP_INT64) (value); \
+	a_out += 8; \
+    } while (0)
+
+    va_copy(ap, a_args);
+    for (i = 0; i < a_fmt->fmt_nspecs; i++) {
+	const binlog_spec_t* sp = &a_fmt->fmt_specs[i];
+	int star = 0;
+
+	for (j = 0; j < sp->sp_nstars; j++) {
+	    star = va_arg(ap, int);
+	    PUT8(star);
+	}
+
+	switch (sp->sp_arg) {
+	case ARG_NONE:	  break;
+	case ARG_INT:	  PUT8(va_arg(ap, int)); break;
+	case ARG_LONG:	  PUT8(va_arg(ap, long)); break;
+	case ARG_LLONG:	  PUT8(va_arg(ap, long long)); break;
+	case ARG_SIZE:	  PUT8(va_arg(ap, size_t)); break;
+	case ARG_PTRDIFF: PUT8(va_arg(ap, ptrdiff_t)); break;
+#ifdef HAVE_STDINT_H
+	case ARG_INTMAX:  PUT8(va_arg(ap, intmax_t)); break;
+#endif
+	case ARG_POINTER: PUT8((size_t) va_arg(ap, void*)); break;
+
+	case ARG_DOUBLE: {
+	    double d = va_arg(ap, double);
+
+	    memcpy(a_out, &d, sizeof(d));
+	    a_out += 8;
+	    break;
+	}
+
+	case ARG_LDOUBLE: {
+	    long double d = va_arg(ap, long double);
+
+	    memset(a_out, 0, 16);
+	    memcpy(a_out, &d, sizeof(d) < 16 ? sizeof(d) : 16);
+	    a_out += 16;
+	    break;
+	}
+
+	case ARG_STRING: {
+	    const char* s = va_arg(ap, const char*);
+	    size_t len;
+
+	    if (!s) {
+		*(XP_UINT32*) a_out = BINLOG_NULL_STRING;
+		memset(a_out + 4, 0, 4);
+		a_out += 8;
+		break;
+	    }
+	    len = arg_strlen(sp, s, star);
+	    *(XP_UINT32*) a_out = (XP_UINT32) len;
+	    memcpy(a_out + 4, s, len);
+	    memset(a_out + 4 + len, 0, BINLOG_ALIGN(4 + len + 1) - 4 - len);
+	    a_out += BINLOG_ALIGN(4 + len + 1);
+	    break;
+	}
+
+	default:
+	    break;
+	}
+    }
+    va_end(ap);
+
+#undef PUT8
+}
+
+/*******************************************************************************/
+static void buffer_thread_exit(void* a_buffer)
+{
+    log4c_binlog_buffer_t* this = a_buffer;
+
+    /* the background thread frees the buffer once it is empty */
+    SD_ATOMIC_STORE_RELEASE(&this->bb_orphan, 1);
+#ifdef SD_TLS
+    binlog_self = NULL;
+#endif
+}
+
+/*******************************************************************************/
+static void buffer_key_create(void)
+{
+    pthread_key_create(&binlog_key, buffer_thread_exit);
+}
+
+/*******************************************************************************/
+static log4c_binlog_buffer_t* buffer_get(void)
+{
+    log4c_binlog_buffer_t* this;
+    const log4c_thread_t* self;
+
+#ifdef SD_TLS
+    if ((this = binlog_self) != NULL)
+	return this;
+#endif
+
+    pthread_once(&binlog_once, buffer_key_create);
+
+#ifndef SD_TLS
+    if ((this = pthread_getspecific(binlog_key)) != NULL)
+	return this;
+#endif
+
+    if ((this = calloc(1, sizeof(*this))) == NULL)
+	return NULL;
+
+    /* the thread as it is named when it first logs */
+    self = log4c_thread_get();
+    strncpy(this->bb_name, self->th_name, sizeof(this->bb_name) - 1);
+    this->bb_self.th_id   = self->th_id;
+    this->bb_self.th_name = this->bb_name;
+
+    BINLOG_LOCK();
+    this->bb_size = binlog_bufsize;
+    if ((this->bb_data = malloc(this->bb_size)) == NULL) {
+	BINLOG_UNLOCK();
+	free(this);
+	return NULL;
+    }
+    this->bb_thread = binlog_nthreads++;
+    this->bb_next   = binlog_buffers;
+    binlog_buffers  = this;
+    BINLOG_UNLOCK();
+
+    pthread_setspecific(binlog_key, this);
+#ifdef SD_TLS
+    binlog_self = this;
+#endif
+    return this;
+}
+
+/*******************************************************************************/
+/*
+ * Reserves a record of a_need bytes with its header filled, which
+ * buffer_commit() publishes. Returns NULL and counts a drop when the
+ * buffer is full.
+ */
+static log4c_binlog_record_t* buffer_reserve(log4c_binlog_buffer_t* this,
+					     size_t a_need, int a_type,
+					     const log4c_category_t* a_category,
+					     int a_priority, int a_id)
+{
+    XP_UINT64 tail = this->bb_tail;
+    XP_UINT64 head = SD_ATOMIC_LOAD_ACQUIRE(&this->bb_head);
+    size_t offset = (size_t) (tail & (this->bb_size - 1));
+    size_t contiguous = this->bb_size - offset;
+    log4c_binlog_record_t* rec;
+    sd_clock_time_t now;
+
+    if (a_need > contiguous) {
+	/* pad up to the end of the ring and start over */
+	if (a_need > this->bb_size / 2 ||
+	    tail + contiguous + a_need - head > this->bb_size)
+	    goto drop;
+
+	rec = (log4c_binlog_record_t*) (this->bb_data + offset);
+	rec->rec_size = (unsigned int) contiguous;
+	rec->rec_type = LOG4C_BINLOG_PAD;
+	tail  += contiguous;
+	offset = 0;
+	SD_ATOMIC_STORE_RELEASE(&this->bb_tail, tail);
+    }
+    else if (tail + a_need - head > this->bb_size)
+	goto drop;
+
+    sd_clock_read(&now);
+
+    rec = (log4c_binlog_record_t*) (this->bb_data + offset);
+    rec->rec_size     = (unsigned int) a_need;
+    rec->rec_type     = a_type;
+    rec->rec_format   = a_id;
+    rec->rec_category = log4c_category_get_id(a_category);
+    rec->rec_priority = a_priority;
+    rec->rec_thread   = this->bb_thread;
+    rec->rec_realtime  = now.ct_realtime;
+    rec->rec_monotonic = now.ct_monotonic;
+    rec->rec_sequence  = ++this->bb_sequence;
+    return rec;
+
+ drop:
+    SD_ATOMIC_STORE(&this->bb_drops, this->bb_drops + 1);
+    return NULL;
+}
+
+/*******************************************************************************/
+static void binlog_wake(void)
+{
+    pthread_mutex_lock(&binlog_wait_mutex);
+    SD_ATOMIC_STORE(&binlog_sleeping, 0);
+    pthread_cond_signal(&binlog_wakeup);
+    pthread_mutex_unlock(&binlog_wait_mutex);
+}
+
+/*******************************************************************************/
+static void buffer_commit(log4c_binlog_buffer_t* this,
+			  const log4c_binlog_record_t* a_rec)
+{
+    SD_ATOMIC_STORE_RELEASE(&this->bb_tail, this->bb_tail + a_rec->rec_size);
+    if (SD_ATOMIC_LOAD(&binlog_sleeping))
+	binlog_wake();
+}
+
+/*******************************************************************************/
+/* reserves and fills a record holding a string then fields */
+static int buffer_put_strfields(log4c_binlog_buffer_t* this, int a_type,
+				const log4c_category_t* a_category,
+				int a_priority, const char* a_string,
+				const log4c_field_t* a_fields, size_t a_nfields)
+{
+    size_t len = strlen(a_string);
+    size_t need = sizeof(log4c_binlog_record_t) + BINLOG_ALIGN(4 + len + 1) +
+	log4c_field_encoded_size(a_fields, a_nfields);
+    log4c_binlog_record_t* rec;
+    char* out;
+
+    if ((rec = buffer_reserve(this, need, a_type, a_category,
+			      a_priority, 0)) == NULL)
+	return -1;
+
+    out = (char*) (rec + 1);
+    *(XP_UINT32*) out = (XP_UINT32) len;
+    memcpy(out + 4, a_string, len);
+    memset(out + 4 + len, 0, BINLOG_ALIGN(4 + len + 1) - 4 - len);
+    log4c_field_encode(a_fields, a_nfields, out + BINLOG_ALIGN(4 + len + 1));
+
+    buffer_commit(this, rec);
+    return 0;
+}
+
+/*******************************************************************************/
+/*
+ * Writes the contexts of the thread when they changed since the last
+ * record. Returns -1 when the buffer is full.
+ */
+static int buffer_put_context(log4c_binlog_buffer_t* this,
+			      const log4c_category_t* a_category)
+{
+    const log4c_field_t* mdc;
+    const char* ndc;
+    size_t nmdc;
+    unsigned int context = __log4c_context_get(&mdc, &nmdc, &ndc);
+
+    if (context == this->bb_context)
+	return 0;
+
+    if (buffer_put_strfields(this, LOG4C_BINLOG_CONTEXT, a_category, 0,
+			     ndc ? ndc : "", mdc, nmdc) == -1)
+	return -1;
+
+    this->bb_context = context;
+    return 0;
+}
+
+/*******************************************************************************/
+static int buffer_put(log4c_binlog_buffer_t* this,
+		      const log4c_category_t* a_category, int a_priority,
+		      int a_id, const log4c_binlog_format_t* a_fmt,
+		      va_list a_args)
+{
+    size_t need = sizeof(log4c_binlog_record_t) + args_size(a_fmt, a_args);
+    log4c_binlog_record_t* rec;
+
+    if (buffer_put_context(this, a_category) == -1)
+	return -1;
+
+    if ((rec = buffer_reserve(this, need, LOG4C_BINLOG_EVENT, a_category,
+			      a_priority, a_id)) == NULL)
+	return -1;
+
+    args_put(a_fmt, (char*) (rec + 1), a_args);
+    buffer_commit(this, rec);
+    return 0;
+}
+
+/*******************************************************************************/
+static int buffer_put_kv(log4c_binlog_buffer_t* this,
+			 const log4c_category_t* a_category, int a_priority,
+			 const char* a_message, const log4c_field_t* a_fields,
+			 size_t a_nfields)
+{
+    if (buffer_put_context(this, a_category) == -1)
+	return -1;
+
+    return buffer_put_strfields(this, LOG4C_BINLOG_KV, a_category, a_priority,
+				a_message, a_fields, a_nfields);
+}
+
+/*******************************************************************************/
+/* keeps the contexts of a context record for the next events of the buffer */
+static void buffer_context(log4c_binlog_buffer_t* this,
+			   const log4c_binlog_record_t* a_rec)
+{
+    const char* ndc;
+    const void* mdc;
+    size_t mdcsize;
+    int nmdc;
+
+    this->bb_ctxsize = a_rec->rec_size - sizeof(*a_rec);
+    this->bb_ctxdata = sd_realloc(this->bb_ctxdata, this->bb_ctxsize);
+    memcpy(this->bb_ctxdata, a_rec + 1, this->bb_ctxsize);
+    this->bb_ctxsegment = 0;
+
+    this->bb_nmdc = 0;
+    this->bb_ndc  = NULL;
+    if (log4c_binlog_kv_split(this->bb_ctxdata, this->bb_ctxsize, &ndc,
+			      &mdc, &mdcsize) == -1 ||
+	(nmdc = log4c_field_decode(mdc, mdcsize, NULL, 0)) < 0)
+	return;
+
+    this->bb_mdc  = sd_realloc(this->bb_mdc, (nmdc + 1) * sizeof(*this->bb_mdc));
+    this->bb_nmdc = log4c_field_decode(mdc, mdcsize, this->bb_mdc, nmdc);
+    this->bb_ndc  = *ndc ? ndc : NULL;
+}
+
+/*******************************************************************************/
+/*
+ * returns the next event of a buffer before a_tail, skipping padding and
+ * taking in contexts
+ */
+static const log4c_binlog_record_t* buffer_peek(log4c_binlog_buffer_t* this,
+						XP_UINT64 a_tail)
+{
+    while (this->bb_head < a_tail) {
+	const log4c_binlog_record_t* rec = (const log4c_binlog_record_t*)
+	    (this->bb_data + (this->bb_head & (this->bb_size - 1)));
+
+	if (rec->rec_type == LOG4C_BINLOG_CONTEXT)
+	    buffer_context(this, rec);
+	else if (rec->rec_type != LOG4C_BINLOG_PAD)
+	    return rec;
+	SD_ATOMIC_STORE_RELEASE(&this->bb_head, this->bb_head + rec->rec_size);
+    }
+    return NULL;
+}
+
+/*******************************************************************************/
+static void record_dispatch(const log4c_binlog_buffer_t* a_buffer,
+			    const log4c_binlog_record_t* a_rec)
+{
+    const log4c_category_t* cat = log4c_category_get_by_id(a_rec->rec_category);
+    const log4c_binlog_format_t* fmt = NULL;
+    log4c_logging_event_t evt;
+    const char* message = NULL;
+    const void* fields = NULL;
+    size_t fieldsize = 0;
+    int nfields = 0;
+    int n;
+
+    if (!cat)
+	return;
+
+    if (a_rec->rec_type == LOG4C_BINLOG_KV) {
+	if (log4c_binlog_kv_split(a_rec + 1, a_rec->rec_size - sizeof(*a_rec),
+				  &message, &fields, &fieldsize) == -1 ||
+	    (nfields = log4c_field_decode(fields, fieldsize, NULL, 0)) < 0)
+	    return;
+	if ((size_t) nfields > binlog_nfields) {
+	    binlog_nfields = nfields;
+	    binlog_fields = sd_realloc(binlog_fields,
+				       binlog_nfields * sizeof(*binlog_fields));
+	}
+	log4c_field_decode(fields, fieldsize, binlog_fields, nfields);
+	n = (int) strlen(message);
+    }
+    else if ((fmt = dict_get(a_rec->rec_format)) == NULL ||
+	     (n = log4c_binlog_format_render(fmt, a_rec + 1,
+					     a_rec->rec_size - sizeof(*a_rec),
+					     binlog_text, binlog_textsize)) < 0)
+	return;
+
+    if (message) {
+	if ((size_t) n >= binlog_textsize) {
+	    binlog_textsize = n + 1;
+	    binlog_text = sd_realloc(binlog_text, binlog_textsize);
+	}
+	memcpy(binlog_text, message, n + 1);
+    }
+    else if ((size_t) n >= binlog_textsize) {
+	binlog_textsize = n + 1;
+	binlog_text = sd_realloc(binlog_text, binlog_textsize);
+	log4c_binlog_format_render(fmt, a_rec + 1,
+				   a_rec->rec_size - sizeof(*a_rec),
+				   binlog_text, binlog_textsize);
+    }
+
+    /* one buffer for all the events, sized again when bufsize changes */
+    if (!binlog_evtbuf.buf_data ||
+	binlog_evtbuf.buf_maxsize != log4c_rc->config.bufsize) {
+	binlog_evtbuf.buf_maxsize = log4c_rc->config.bufsize;
+	binlog_evtbuf.buf_size = binlog_evtbuf.buf_maxsize ?
+	    binlog_evtbuf.buf_maxsize : LOG4C_BUFFER_SIZE_DEFAULT;
+	binlog_evtbuf.buf_data = sd_realloc(binlog_evtbuf.buf_data,
+					    binlog_evtbuf.buf_size);
+    }
+    evt.evt_buffer = binlog_evtbuf;
+
+    if (evt.evt_buffer.buf_maxsize && (size_t) n >= evt.evt_buffer.buf_maxsize) {
+	sd_error("truncating message of %d bytes (bufsize = %d)", n,
+		 evt.evt_buffer.buf_size);
+	binlog_text[evt.evt_buffer.buf_maxsize - 1] = '\0';
+    }
+
+    evt.evt_category		= log4c_category_get_name(cat);
+    evt.evt_priority		= a_rec->rec_priority;
+    evt.evt_msg			= binlog_text;
+    evt.evt_loc			= NULL;
+    evt.evt_fields		= nfields ? binlog_fields : NULL;
+    evt.evt_nfields		= nfields;
+    evt.evt_sequence		= a_rec->rec_sequence;
+    evt.evt_thread		= &a_buffer->bb_self;
+    evt.evt_mdc			= a_buffer->bb_nmdc ? a_buffer->bb_mdc : NULL;
+    evt.evt_nmdc		= a_buffer->bb_nmdc;
+    evt.evt_ndc			= a_buffer->bb_ndc;
+    log4c_logging_event_set_time(&evt, a_rec->rec_realtime, a_rec->rec_monotonic);
+
+    __log4c_category_dispatch(cat, &evt);
+
+    /* the layouts may have resized it */
+    binlog_evtbuf = evt.evt_buffer;
+}
+
+/*******************************************************************************/
+static void writer_close(void)
+{
+    if (binlog_writer.sw_fp)
+	fclose(binlog_writer.sw_fp);
+    binlog_writer.sw_fp = NULL;
+}
+
+/*******************************************************************************/
+static int writer_open(void)
+{
+    log4c_binlog_header_t hdr;
+    char* name;
+
+    writer_close();
+
+    name = sd_sprintf("%s.%u", binlog_writer.sw_prefix, binlog_writer.sw_number);
+    binlog_writer.sw_fp = fopen(name, "wb");
+    if (!binlog_writer.sw_fp) {
+	sd_error("failed to open binlog segment '%s'", name);
+	free(name);
+	return -1;
+    }
+    free(name);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.hdr_magic, LOG4C_BINLOG_MAGIC, sizeof(hdr.hdr_magic));
+    hdr.hdr_version   = LOG4C_BINLOG_VERSION;
+    hdr.hdr_byteorder = LOG4C_BINLOG_BYTEORDER;
+    hdr.hdr_segment   = binlog_writer.sw_number++;
+    binlog_nsegments++;
+    fwrite(&hdr, sizeof(hdr), 1, binlog_writer.sw_fp);
+
+    binlog_writer.sw_size = sizeof(hdr);
+    memset(binlog_writer.sw_formats, 0, binlog_writer.sw_nformats);
+    memset(binlog_writer.sw_categories, 0, binlog_writer.sw_ncategories);
+    memset(binlog_writer.sw_threads, 0, binlog_writer.sw_nthreads);
+    return 0;
+}
+
+/*******************************************************************************/
+/*
+ * writes the definition of a format, category or thread unless already in
+ * the segment. a_value is the id of a thread.
+ */
+static void writer_define(int a_type, unsigned int a_id, const char* a_string,
+			  unsigned long long a_value, char** a_written,
+			  size_t* a_nwritten)
+{
+    static const char zeros[8];
+    log4c_binlog_record_t rec;
+    size_t len;
+
+    if (a_id >= *a_nwritten) {
+	size_t n = *a_nwritten ? *a_nwritten : 64;
+
+	while (n <= a_id)
+	    n *= 2;
+	*a_written = sd_realloc(*a_written, n);
+	memset(*a_written + *a_nwritten, 0, n - *a_nwritten);
+	*a_nwritten = n;
+    }
+    if ((*a_written)[a_id])
+	return;
+    (*a_written)[a_id] = 1;
+
+    len = strlen(a_string) + 1;
+    memset(&rec, 0, sizeof(rec));
+    rec.rec_size = (unsigned int) BINLOG_ALIGN(sizeof(rec) + len);
+    rec.rec_type = a_type;
+    if (a_type == LOG4C_BINLOG_FORMAT)
+	rec.rec_format = a_id;
+    else if (a_type == LOG4C_BINLOG_CATEGORY)
+	rec.rec_category = a_id;
+    else {
+	rec.rec_thread	 = a_id;
+	rec.rec_sequence = a_value;
+    }
+
+    fwrite(&rec, sizeof(rec), 1, binlog_writer.sw_fp);
+    fwrite(a_string, len, 1, binlog_writer.sw_fp);
+    fwrite(zeros, rec.rec_size - sizeof(rec) - len, 1, binlog_writer.sw_fp);
+    binlog_writer.sw_size += rec.rec_size;
+}
+
+/*******************************************************************************/
+static void record_write(log4c_binlog_buffer_t* a_buffer,
+			 const log4c_binlog_record_t* a_rec)
+{
+    const log4c_category_t* cat = log4c_category_get_by_id(a_rec->rec_category);
+    const log4c_binlog_format_t* fmt = NULL;
+
+    if (!cat || (a_rec->rec_type == LOG4C_BINLOG_EVENT &&
+		 (fmt = dict_get(a_rec->rec_format)) == NULL))
+	return;
+
+    if (!binlog_writer.sw_fp ||
+	(binlog_writer.sw_maxsize && binlog_writer.sw_size >= binlog_writer.sw_maxsize))
+	if (writer_open() == -1)
+	    return;
+
+    if (fmt)
+	writer_define(LOG4C_BINLOG_FORMAT, a_rec->rec_format, fmt->fmt_string,
+		      0, &binlog_writer.sw_formats, &binlog_writer.sw_nformats);
+    writer_define(LOG4C_BINLOG_CATEGORY, a_rec->rec_category,
+		  log4c_category_get_name(cat), 0,
+		  &binlog_writer.sw_categories, &binlog_writer.sw_ncategories);
+    writer_define(LOG4C_BINLOG_THREAD, a_rec->rec_thread,
+		  a_buffer->bb_self.th_name, a_buffer->bb_self.th_id,
+		  &binlog_writer.sw_threads, &binlog_writer.sw_nthreads);
+
+    /* the contexts of the thread, when they changed or in a new segment */
+    if (a_buffer->bb_ctxdata && a_buffer->bb_ctxsegment != binlog_nsegments) {
+	log4c_binlog_record_t rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.rec_size   = (unsigned int) (sizeof(rec) + a_buffer->bb_ctxsize);
+	rec.rec_type   = LOG4C_BINLOG_CONTEXT;
+	rec.rec_thread = a_rec->rec_thread;
+	fwrite(&rec, sizeof(rec), 1, binlog_writer.sw_fp);
+	fwrite(a_buffer->bb_ctxdata, a_buffer->bb_ctxsize, 1, binlog_writer.sw_fp);
+	binlog_writer.sw_size += rec.rec_size;
+	a_buffer->bb_ctxsegment = binlog_nsegments;
+    }
+
+    fwrite(a_rec, a_rec->rec_size, 1, binlog_writer.sw_fp);
+    binlog_writer.sw_size += a_rec->rec_size;
+}
+
+/*******************************************************************************/
+/*
+ * Handles the records published so far by all threads, oldest first, then
+ * frees the empty buffers of the threads which have exited. Returns the
+ * number of records handled.
+ */
+static size_t binlog_drain(void)
+{
+    log4c_binlog_buffer_t** b;
+    size_t i, n = 0, count = 0;
+
+    BINLOG_LOCK();
+    for (b = &binlog_buffers; *b; b = &(*b)->bb_next)
+	n++;
+    if (n > binlog_nsnapshot) {
+	binlog_snapshot  = sd_realloc(binlog_snapshot, n * sizeof(*binlog_snapshot));
+	binlog_tails     = sd_realloc(binlog_tails, n * sizeof(*binlog_tails));
+	binlog_nsnapshot = n;
+    }
+    for (i = 0, b = &binlog_buffers; *b; b = &(*b)->bb_next, i++) {
+	binlog_snapshot[i] = *b;
+	binlog_tails[i]    = SD_ATOMIC_LOAD_ACQUIRE(&(*b)->bb_tail);
+    }
+    BINLOG_UNLOCK();
+
+    for (;;) {
+	const log4c_binlog_record_t* oldest = NULL;
+	size_t oldest_i = 0;
+
+	for (i = 0; i < n; i++) {
+	    const log4c_binlog_record_t* rec =
+		buffer_peek(binlog_snapshot[i], binlog_tails[i]);
+
+	    /* on the monotonic clock, then in the order of the threads */
+	    if (rec && (!oldest || rec->rec_monotonic < oldest->rec_monotonic ||
+			(rec->rec_monotonic == oldest->rec_monotonic &&
+			 rec->rec_thread < oldest->rec_thread)))
+	    {
+		oldest   = rec;
+		oldest_i = i;
+	    }
+	}
+	if (!oldest)
+	    break;
+
+	if (binlog_writer.sw_prefix)
+	    record_write(binlog_snapshot[oldest_i], oldest);
+	else
+	    record_dispatch(binlog_snapshot[oldest_i], oldest);
+
+	SD_ATOMIC_STORE_RELEASE(&binlog_snapshot[oldest_i]->bb_head,
+				binlog_snapshot[oldest_i]->bb_head + oldest->rec_size);
+	count++;
+    }
+
+    BINLOG_LOCK();
+    for (b = &binlog_buffers; *b; ) {
+	log4c_binlog_buffer_t* this = *b;
+
+	if (SD_ATOMIC_LOAD_ACQUIRE(&this->bb_orphan) &&
+	    SD_ATOMIC_LOAD_ACQUIRE(&this->bb_tail) == this->bb_head)
+	{
+	    *b = this->bb_next;
+	    binlog_retired_drops += this->bb_drops;
+	    free(this->bb_ctxdata);
+	    free(this->bb_mdc);
+	    free(this->bb_data);
+	    free(this);
+	}
+	else
+	    b = &this->bb_next;
+    }
+    BINLOG_UNLOCK();
+
+    return count;
+}
+
+/*******************************************************************************/
+/* whether a buffer holds records not handled yet */
+static int binlog_pending(void)
+{
+    const log4c_binlog_buffer_t* b;
+    int pending = 0;
+
+    BINLOG_LOCK();
+    for (b = binlog_buffers; b && !pending; b = b->bb_next)
+	pending = SD_ATOMIC_LOAD_ACQUIRE(&b->bb_tail) != b->bb_head;
+    BINLOG_UNLOCK();
+    return pending;
+}
+
+/*******************************************************************************/
+static void* binlog_consumer(void* a_arg)
+{
+    (void) a_arg;
+
+    for (;;) {
+	/* read before draining: the flush covers what was logged before it */
+	XP_UINT64 flush = SD_ATOMIC_LOAD_ACQUIRE(&binlog_flush_requests);
+	struct timespec ts;
+	size_t n;
+
+	/* the events logged from signal handlers go to the appenders too */
+	n = binlog_drain() + log4c_sigsafe_drain();
+
+	if (flush != binlog_flushed) {
+	    if (binlog_writer.sw_fp)
+		fflush(binlog_writer.sw_fp);
+	    SD_ATOMIC_STORE_RELEASE(&binlog_flushed, flush);
+	}
+	if (n > 0)
+	    continue;
+
+	if (binlog_writer.sw_fp)
+	    fflush(binlog_writer.sw_fp);
+	if (SD_ATOMIC_LOAD_ACQUIRE(&binlog_stopping))
+	    break;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += BINLOG_WAIT_MS * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+	    ts.tv_sec++;
+	    ts.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&binlog_wait_mutex);
+	/* a full barrier, so that either a producer sees the flag or
+	   binlog_pending() sees its record */
+	SD_ATOMIC_CAS(&binlog_sleeping, 0, 1);
+	if (!binlog_pending() && !SD_ATOMIC_LOAD_ACQUIRE(&binlog_stopping) &&
+	    SD_ATOMIC_LOAD_ACQUIRE(&binlog_flush_requests) == binlog_flushed)
+	    pthread_cond_timedwait(&binlog_wakeup, &binlog_wait_mutex, &ts);
+	SD_ATOMIC_STORE(&binlog_sleeping, 0);
+	pthread_mutex_unlock(&binlog_wait_mutex);
+    }
+
+    return NULL;
+}
+#endif
+
+/*******************************************************************************/
+extern void log4c_category_binlog(const log4c_category_t* a_category,
+				  int a_priority,
+				  log4c_binlog_site_t* a_site,
+				  const char* a_format, ...)
+{
+    va_list args;
+#ifdef BINLOG_THREADS
+    log4c_binlog_buffer_t* buffer;
+    int id;
+#endif
+
+    if (!log4c_category_is_priority_enabled(a_category, a_priority))
+	return;
+
+    va_start(args, a_format);
+#ifdef BINLOG_THREADS
+    /* the events kept for a backtrace are not deferred */
+    if (SD_ATOMIC_LOAD_ACQUIRE(&binlog_running) &&
+	!__log4c_category_is_backtraced(a_category, a_priority) &&
+	(id = site_id(a_site, a_format)) >= 0 &&
+	(buffer = buffer_get()) != NULL) {
+	__log4c_backtrace_trigger(a_priority);
+	buffer_put(buffer, a_category, a_priority, id, dict_get(id), args);
+    }
+    else
+#endif
+	log4c_category_vlog(a_category, a_priority, a_format, args);
+    va_end(args);
+}
+
+/*******************************************************************************/
+extern void log4c_category_binlog_kv(const log4c_category_t* a_category,
+				     int a_priority, const char* a_message,
+				     const log4c_field_t* a_fields,
+				     size_t a_nfields)
+{
+#ifdef BINLOG_THREADS
+    log4c_binlog_buffer_t* buffer;
+#endif
+
+    if (!log4c_category_is_priority_enabled(a_category, a_priority))
+	return;
+
+#ifdef BINLOG_THREADS
+    if (SD_ATOMIC_LOAD_ACQUIRE(&binlog_running) &&
+	!__log4c_category_is_backtraced(a_category, a_priority) &&
+	(buffer = buffer_get()) != NULL) {
+	__log4c_backtrace_trigger(a_priority);
+	buffer_put_kv(buffer, a_category, a_priority, a_message ? a_message : "",
+		      a_fields, a_nfields);
+    }
+    else
+#endif
+	log4c_category_log_kv(a_category, a_priority, a_message, a_fields,
+			      a_nfields);
+}
+
+/*******************************************************************************/
+extern int log4c_binlog_kv_split(const void* a_args, size_t a_argsize,
+				 const char** a_message, const void** a_fields,
+				 size_t* a_fieldsize)
+{
+    const char* in = a_args;
+    XP_UINT32 len;
+
+    if (a_argsize < 8)
+	return -1;
+    len = *(const XP_UINT32*) in;
+    if (a_argsize < BINLOG_ALIGN(4 + (size_t) len + 1) || in[4 + len])
+	return -1;
+
+    *a_message   = in + 4;
+    *a_fields    = in + BINLOG_ALIGN(4 + (size_t) len + 1);
+    *a_fieldsize = a_argsize - BINLOG_ALIGN(4 + (size_t) len + 1);
+    return 0;
+}
+
+/*******************************************************************************/
+extern int log4c_binlog_start(const char* a_prefix, size_t a_segsize,
+			      size_t a_bufsize)
+{
+#ifdef BINLOG_THREADS
+    size_t size = BINLOG_BUFSIZE_MIN;
+
+    BINLOG_LOCK();
+    if (binlog_running) {
+	BINLOG_UNLOCK();
+	return -1;
+    }
+
+    if (!a_bufsize)
+	size = BINLOG_BUFSIZE_DEFAULT;
+    while (size < a_bufsize)
+	size <<= 1;
+    binlog_bufsize = size;
+
+    binlog_writer.sw_prefix  = a_prefix ? sd_strdup(a_prefix) : NULL;
+    binlog_writer.sw_maxsize = a_segsize;
+    binlog_writer.sw_number  = 0;
+    binlog_stopping = 0;
+
+    if (pthread_create(&binlog_thread, NULL, binlog_consumer, NULL)) {
+	sd_error("failed to start the binlog thread");
+	free(binlog_writer.sw_prefix);
+	binlog_writer.sw_prefix = NULL;
+	BINLOG_UNLOCK();
+	return -1;
+    }
+
+    SD_ATOMIC_STORE_RELEASE(&binlog_running, 1);
+    BINLOG_UNLOCK();
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*******************************************************************************/
+extern int log4c_binlog_stop(void)
+{
+#ifdef BINLOG_THREADS
+    BINLOG_LOCK();
+    if (!binlog_running) {
+	BINLOG_UNLOCK();
+	return -1;
+    }
+    SD_ATOMIC_STORE_RELEASE(&binlog_running, 0);
+    SD_ATOMIC_STORE_RELEASE(&binlog_stopping, 1);
+    BINLOG_UNLOCK();
+
+    binlog_wake();
+    pthread_join(binlog_thread, NULL);
+
+    free(binlog_evtbuf.buf_data);
+    memset(&binlog_evtbuf, 0, sizeof(binlog_evtbuf));
+
+    writer_close();
+    free(binlog_writer.sw_prefix);
+    free(binlog_writer.sw_formats);
+    free(binlog_writer.sw_categories);
+    free(binlog_writer.sw_threads);
+    memset(&binlog_writer, 0, sizeof(binlog_writer));
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*******************************************************************************/
+extern int log4c_binlog_flush(void)
+{
+#ifdef BINLOG_THREADS
+    XP_UINT64 request;
+
+    if (!SD_ATOMIC_LOAD_ACQUIRE(&binlog_running))
+	return -1;
+
+    /*
+     * the background thread handles the records published before the
+     * request in the first pass which sees it, then flushes the segment:
+     * other threads logging meanwhile do not hold it back
+     */
+    request = SD_ATOMIC_ADD(&binlog_flush_requests, 1) + 1;
+    binlog_wake();
+    while (SD_ATOMIC_LOAD_ACQUIRE(&binlog_flushed) < request) {
+	struct timespec ts = { 0, 100000 };
+
+	if (!SD_ATOMIC_LOAD_ACQUIRE(&binlog_running))
+	    return -1;
+	nanosleep(&ts, NULL);
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*******************************************************************************/
+extern unsigned long long log4c_binlog_get_drops(void)
+{
+#ifdef BINLOG_THREADS
+    log4c_binlog_buffer_t* b;
+    XP_UINT64 drops;
+
+    BINLOG_LOCK();
+    drops = binlog_retired_drops;
+    for (b = binlog_buffers; b; b = b->bb_next)
+	drops += SD_ATOMIC_LOAD(&b->bb_drops);
+    BINLOG_UNLOCK();
+    return drops;
+#else
+    return 0;
+#endif
+}
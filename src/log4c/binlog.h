@@ -0,0 +1,261 @@
+/* $Id$
+ *
+ * binlog.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_binlog_h
+#define log4c_binlog_h
+
+/**
+ * @file binlog.h
+ *
+ * @brief deferred formatting of log messages.
+ *
+ * LOG4C_BINLOG() logs like log4c_category_log() without formatting the
+ * message. The first call at a call site registers its format string in
+ * a dictionary. Every call then copies the raw arguments into a buffer of
+ * the calling thread, with the format id, the category id, the priority,
+ * a timestamp and the number of the thread, preceded by the diagnostic
+ * contexts of the thread when they changed. Strings are copied, so the
+ * arguments need not outlive the call.
+ *
+ * A background thread started with log4c_binlog_start() empties the
+ * buffers in timestamp order. It either formats the messages and sends
+ * them to the appenders of their category, or writes the records as they
+ * are to binary segment files, which log4c-decode turns into text. It
+ * also sends the events of log4c_sigsafe_log() to their appenders.
+ *
+ * The message is logged right away, like log4c_category_log() does, when
+ * the background thread is not running or when the format has
+ * conversions which can not be deferred: %n, positional arguments, wide
+ * characters and conversions unknown to C99. When the buffer of a thread
+ * is full, the message is dropped and counted.
+ **/
+
+#include <stddef.h>
+#include <log4c/defs.h>
+#include <log4c/category.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The state of a call site: the id of its format, plus one, 0 until the
+ * first call or -1 if the format can not be deferred.
+ **/
+typedef struct {
+    int		site_id;
+} log4c_binlog_site_t;
+
+/**
+ * Logs a message with deferred formatting. The arguments are only
+ * evaluated when the priority is enabled.
+ *
+ * @param a_category the log4c_category_t object
+ * @param a_priority the priority of the message
+ * @param ... the format, a string literal, and its arguments
+ **/
+#define LOG4C_BINLOG(a_category, a_priority, ...) \
+    do { \
+	static log4c_binlog_site_t __log4c_binlog_site; \
+	if (log4c_category_is_priority_enabled(a_category, a_priority)) \
+	    log4c_category_binlog(a_category, a_priority, \
+				  &__log4c_binlog_site, __VA_ARGS__); \
+    } while (0)
+
+/**
+ * @internal
+ * The function behind LOG4C_BINLOG().
+ **/
+LOG4C_API void log4c_category_binlog(const log4c_category_t* a_category,
+				     int a_priority,
+				     log4c_binlog_site_t* a_site,
+				     const char* a_format, ...);
+
+/**
+ * Logs a message with key/value fields like log4c_category_log_kv(),
+ * deferring the rendering of the fields. The message and the fields are
+ * copied into the buffer of the thread; segment files hold them encoded
+ * as they are.
+ *
+ * @param a_category the log4c_category_t object
+ * @param a_priority the priority of the message
+ * @param a_message the message, which is not a format
+ * @param a_fields the fields
+ * @param a_nfields the number of fields
+ **/
+LOG4C_API void log4c_category_binlog_kv(const log4c_category_t* a_category,
+					int a_priority,
+					const char* a_message,
+					const log4c_field_t* a_fields,
+					size_t a_nfields);
+
+/**
+ * Registers a format in the dictionary.
+ *
+ * @param a_format the format
+ * @returns the id of the format, the same for equal strings, or -1 if it
+ * can not be deferred
+ **/
+LOG4C_API int log4c_binlog_register(const char* a_format);
+
+/**
+ * Starts the background thread.
+ *
+ * @param a_prefix NULL to send the messages to the appenders, or the
+ * prefix of the segment files to write: prefix.0, prefix.1, ...
+ * @param a_segsize the size after which a new segment is started, 0 for
+ * a single segment
+ * @param a_bufsize the size of the buffers of the threads which start
+ * logging from now on, rounded up to a power of two, 0 for 1MB
+ * @returns 0 or -1 if it is already running or on error
+ **/
+LOG4C_API int log4c_binlog_start(const char* a_prefix, size_t a_segsize,
+				 size_t a_bufsize);
+
+/**
+ * Stops the background thread once it has emptied the buffers.
+ *
+ * @returns 0 or -1 if it was not running
+ **/
+LOG4C_API int log4c_binlog_stop(void);
+
+/**
+ * Waits until the background thread has handled the messages logged
+ * before the call.
+ *
+ * @returns 0 or -1 if it is not running
+ **/
+LOG4C_API int log4c_binlog_flush(void);
+
+/**
+ * @returns the number of messages dropped because a buffer was full
+ **/
+LOG4C_API unsigned long long log4c_binlog_get_drops(void);
+
+/**
+ * A parsed format, which renders the arguments of a record.
+ **/
+typedef struct __log4c_binlog_format log4c_binlog_format_t;
+
+/**
+ * Parses a format.
+ *
+ * @param a_format the format
+ * @returns the parsed format, or NULL if it can not be deferred
+ **/
+LOG4C_API log4c_binlog_format_t* log4c_binlog_format_new(const char* a_format);
+
+/**
+ * Destructor for log4c_binlog_format_t.
+ **/
+LOG4C_API void log4c_binlog_format_delete(log4c_binlog_format_t* a_format);
+
+/**
+ * Renders the arguments of a record, like snprintf().
+ *
+ * @param a_format the parsed format
+ * @param a_args the arguments, following the record header
+ * @param a_argsize the size of the arguments
+ * @param a_buf the buffer to write to
+ * @param a_bufsize the size of the buffer
+ * @returns the length of the message, which was truncated if it is not
+ * less than @a a_bufsize, or -1 if the arguments are corrupted
+ **/
+LOG4C_API int log4c_binlog_format_render(const log4c_binlog_format_t* a_format,
+					 const void* a_args, size_t a_argsize,
+					 char* a_buf, size_t a_bufsize);
+
+/**
+ * Splits the arguments of a LOG4C_BINLOG_KV record.
+ *
+ * @param a_args the arguments, following the record header
+ * @param a_argsize the size of the arguments
+ * @param a_message the message
+ * @param a_fields the encoded fields, for log4c_field_decode()
+ * @param a_fieldsize the size of the encoded fields
+ * @returns 0 or -1 if the arguments are corrupted
+ **/
+LOG4C_API int log4c_binlog_kv_split(const void* a_args, size_t a_argsize,
+				    const char** a_message,
+				    const void** a_fields,
+				    size_t* a_fieldsize);
+
+/**
+ * Segment files start with a log4c_binlog_header_t followed by records.
+ * Each record starts with a log4c_binlog_record_t. Records are aligned
+ * on 8 bytes and written in the byte order of the writer.
+ *
+ * @li @c LOG4C_BINLOG_FORMAT records define a format: @c rec_format is
+ * its id and the format string follows.
+ * @li @c LOG4C_BINLOG_CATEGORY records define a category: @c rec_category
+ * is its id and the name follows.
+ * @li @c LOG4C_BINLOG_EVENT records are messages: the arguments follow, 8
+ * bytes for each integer, pointer or double and for each '*' width or
+ * precision, 16 bytes for each long double, and for each string its
+ * length on 4 bytes, 0xffffffff for NULL, then its characters, padded
+ * to 8 bytes.
+ * @li @c LOG4C_BINLOG_KV records are messages with key/value fields:
+ * the message follows, encoded like a string argument, then the fields
+ * encoded by log4c_field_encode(). @c rec_format is not used.
+ * @li @c LOG4C_BINLOG_THREAD records define a thread: @c rec_thread is
+ * its number, @c rec_sequence its id and the name follows.
+ * @li @c LOG4C_BINLOG_CONTEXT records hold the diagnostic contexts of a
+ * thread for its next events: @c rec_thread is its number, the NDC
+ * follows, encoded like a string argument and empty when there is none,
+ * then the MDC encoded by log4c_field_encode(). A thread writes one when
+ * its contexts change, and again at the start of each segment.
+ *
+ * A segment defines the formats, categories and threads its events use,
+ * so that segments can be decoded separately.
+ **/
+#define LOG4C_BINLOG_MAGIC	"L4CB"
+#define LOG4C_BINLOG_VERSION	2
+#define LOG4C_BINLOG_BYTEORDER	0x01020304
+
+typedef struct {
+    char		hdr_magic[4];
+    unsigned int	hdr_version;
+    unsigned int	hdr_byteorder;
+    unsigned int	hdr_segment;
+} log4c_binlog_header_t;
+
+enum {
+    LOG4C_BINLOG_PAD = 0,
+    LOG4C_BINLOG_FORMAT,
+    LOG4C_BINLOG_CATEGORY,
+    LOG4C_BINLOG_EVENT,
+    LOG4C_BINLOG_KV,
+    LOG4C_BINLOG_THREAD,
+    LOG4C_BINLOG_CONTEXT
+};
+
+/**
+ * @li @c rec_size the size of the record, header included
+ * @li @c rec_type the type of the record
+ * @li @c rec_format the format id
+ * @li @c rec_category the category id
+ * @li @c rec_priority the priority
+ * @li @c rec_thread the number of the logging thread, in order of first use
+ * @li @c rec_realtime the time in nanoseconds since the epoch
+ * @li @c rec_monotonic the time in nanoseconds on the monotonic clock,
+ * see log4c_logging_event_t
+ * @li @c rec_sequence the number of the record among those of its
+ * thread, from 1
+ **/
+typedef struct {
+    unsigned int	rec_size;
+    unsigned int	rec_type;
+    unsigned int	rec_format;
+    unsigned int	rec_category;
+    int			rec_priority;
+    unsigned int	rec_thread;
+    unsigned long long	rec_realtime;
+    unsigned long long	rec_monotonic;
+    unsigned long long	rec_sequence;
+} log4c_binlog_record_t;
+
+__LOG4C_END_DECLS
+
+#endif
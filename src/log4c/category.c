@@ -11,6 +11,7 @@ static const char version[] = "$Id$";
 #include "config.h"
 #endif
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #ifdef  HAVE_ALLOCA_H
@@ -19,26 +20,144 @@ static const char version[] = "$Id$";
 #include <sd/sprintf.h>
 #include <sd/malloc.h>
 #include <sd/factory.h>
+#include <sd/list.h>
 #include <log4c/appender.h>
 #include <log4c/priority.h>
 #include <log4c/logging_event.h>
 #include <log4c/category.h>
 #include <log4c/rc.h>
+#include <log4c/stats.h>
+#include <log4c/context.h>
+#include <log4c/backtrace.h>
 #include <sd/error.h>
 #include <sd/sd_xplatform.h>
+#include "trace.h"
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define CATEGORY_PTHREADS
+#endif
+
+/*
+ * Categories are interned in a prefix trie keyed by dot segments. Each node
+ * only records the last segment of its category name, so "a.b.c" and
+ * "a.b.d" hang off the same "a" and "a.b" nodes, resolving a parent is a
+ * pointer hop and the whole hierarchy can be walked without hashing.
+ *
+ * Nodes are embedded in their category. The top of the trie is a static
+ * node without a category: "root" and every dot-less name are its
+ * children.
+ */
+typedef struct __log4c_category_node {
+  const char*				cn_segment;
+  size_t				cn_seglen;
+  unsigned int				cn_hash;
+  struct __log4c_category_node*		cn_parent;
+  struct __log4c_category_node*		cn_children;
+  struct __log4c_category_node*		cn_last_child;
+  struct __log4c_category_node*		cn_next;
+  struct __log4c_category_node**	cn_index;
+  size_t				cn_index_size;
+  size_t				cn_nchildren;
+} log4c_category_node_t;
+
+/*
+ * State read on every logging call is kept apart from the category, in a
+ * dense table indexed by the category id:
+ *
+ * @li @c hot_priority the effective priority, propagated down the hierarchy
+ * when a priority is set.
+ * @li @c hot_appenders the dispatch plan: the NULL terminated list of
+ * appenders an event goes to, following additivity.
+ * @li @c hot_own_plan whether @c hot_appenders was allocated for this
+ * category rather than shared with its parent.
+ * @li @c hot_backtrace the effective backtrace priority, -1 when there is
+ * none, propagated like @c hot_priority.
+ * @li @c hot_needs what the appenders of the plan and their layouts read
+ * from the events, the LOG4C_NEEDS_* flags. Computed with the plan, and
+ * again for all categories when an appender or a layout changes type.
+ *
+ * The table is made of fixed size pages which never move once allocated.
+ */
+typedef struct {
+  int				hot_priority;
+  log4c_appender_t**		hot_appenders;
+  int				hot_own_plan;
+  log4c_category_t*		hot_category;
+  int				hot_backtrace;
+  int				hot_needs;
+} log4c_category_hot_t;
+
+#define CATEGORY_HOT_PAGE_SHIFT	10
+#define CATEGORY_HOT_PAGE_SIZE	(1 << CATEGORY_HOT_PAGE_SHIFT)
+#define CATEGORY_HOT_NPAGES	4096
 
 struct __log4c_category {
   char*			cat_name;
   int				cat_priority;
+  int				cat_backtrace;
   int				cat_additive;
   const log4c_category_t*	cat_parent;
   log4c_appender_t*		cat_appender;
+  int				cat_id;
+  log4c_category_hot_t*		cat_hot;
+  log4c_category_node_t		cat_node;
 };
 
 sd_factory_t* log4c_category_factory = NULL;
 
 static const char LOG4C_CATEGORY_DEFAULT[] = "root";
 
+static log4c_category_node_t trie_top;
+
+/* the categories out of the trie, chained by cn_next */
+static log4c_category_node_t* trie_unlinked = NULL;
+
+static log4c_category_hot_t* hot_pages[CATEGORY_HOT_NPAGES];
+static int hot_ncategories = 0;
+
+/* dispatch plans replaced while another thread may still be walking them */
+static sd_list_t* hot_retired_plans = NULL;
+
+static log4c_appender_t* no_appenders[] = { NULL };
+
+/* non zero while the factory creates a category: only those are linked */
+static int category_factory_depth = 0;
+
+/*
+ * The priority override of the thread, -1 when it has none since
+ * LOG4C_PRIORITY_NOTSET would enable every priority. A thread which exits
+ * with an override gives it up through the destructor of the key.
+ */
+int __log4c_category_overrides = 0;
+
+#ifdef SD_TLS
+static SD_TLS int override_priority = -1;
+#elif !defined(CATEGORY_PTHREADS)
+static int override_priority = -1;
+#endif
+
+/*
+ * Without thread local storage the key holds the override itself, plus
+ * one so that NULL is no override.
+ */
+#ifdef CATEGORY_PTHREADS
+static pthread_once_t override_once = PTHREAD_ONCE_INIT;
+static pthread_key_t override_key;
+#endif
+
+/* children are looked up linearly until a node has this many of them */
+#define CATEGORY_NODE_INDEX_MIN 8
+
+#define node_category(n) \
+  ((log4c_category_t*) ((char*) (n) - offsetof(log4c_category_t, cat_node)))
+
+
+static log4c_category_t* category_lookup(const char* a_name);
+static void category_link(log4c_category_t* a_category, int a_linked);
+static void category_hot_reset(void);
+static void category_hot_update(log4c_category_t* a_category);
+static void category_hot_propagate(log4c_category_t* a_category);
 
 /**
 * @bug the root category name should be "" not "root". *
@@ -53,54 +172,146 @@ extern log4c_category_t* log4c_category_get(const char* a_name)
     (void*) log4c_category_print,
   };
   
+  log4c_category_t* cat;
+
   if (!log4c_category_factory) {
     log4c_category_factory = sd_factory_new("log4c_category_factory",
       &log4c_category_factory_ops);
+
+    /* the previous categories, if any, went away with the old factory */
+    free(trie_top.cn_index);
+    memset(&trie_top, 0, sizeof(trie_top));
+    category_hot_reset();
   }
   
-  return sd_factory_get(log4c_category_factory, a_name);
+  if ( (cat = category_lookup(a_name)) != NULL)
+    return cat;
+
+  category_factory_depth++;
+  cat = sd_factory_get(log4c_category_factory, a_name);
+  category_factory_depth--;
+  return cat;
 }
 
 /*******************************************************************************/
 extern int log4c_category_list(log4c_category_t** a_cats, int a_ncats)
 {
-  return sd_factory_list(log4c_category_factory, (void**) a_cats, a_ncats);
+  const log4c_category_node_t* node;
+  int n = 0;
+
+  if (!log4c_category_factory || !a_cats || a_ncats <= 0)
+    return -1;
+
+  /* pre-order walk of the trie, without recursion */
+  node = trie_top.cn_children;
+  while (node) {
+    if (n < a_ncats)
+      a_cats[n] = node_category(node);
+    n++;
+
+    if (node->cn_children) {
+      node = node->cn_children;
+      continue;
+    }
+    while (node && !node->cn_next)
+      node = node->cn_parent != &trie_top ? node->cn_parent : NULL;
+    if (node)
+      node = node->cn_next;
+  }
+
+  return n;
+}
+
+/*******************************************************************************/
+extern log4c_category_t* log4c_category_get_by_id(int a_id)
+{
+  if (a_id < 0 || a_id >= hot_ncategories)
+    return NULL;
+
+  return hot_pages[a_id >> CATEGORY_HOT_PAGE_SHIFT]
+    [a_id & (CATEGORY_HOT_PAGE_SIZE - 1)].hot_category;
 }
 
 /*******************************************************************************/
-static const char* dot_dirname(char* a_string);
+extern int log4c_category_get_count(void)
+{
+  return hot_ncategories;
+}
 
+/*******************************************************************************/
 extern log4c_category_t* log4c_category_new(const char* a_name)
 {
   log4c_category_t* this;
+  log4c_category_t* root = NULL;
+  log4c_category_hot_t** page;
+  int linked = category_factory_depth > 0;
+  size_t len;
   
   if (!a_name)
     return NULL;
+
+  if (hot_ncategories >> CATEGORY_HOT_PAGE_SHIFT >= CATEGORY_HOT_NPAGES) {
+    sd_error("too many categories (%d), not creating '%s'", 
+	     hot_ncategories, a_name);
+    return NULL;
+  }
+
+  /* top level categories hang off root: make sure it comes first */
+  if (!strchr(a_name, '.') && strcmp(LOG4C_CATEGORY_DEFAULT, a_name))
+    root = log4c_category_get(LOG4C_CATEGORY_DEFAULT);
   
-  this		= sd_calloc(1, sizeof(log4c_category_t));
-  this->cat_name	= sd_strdup(a_name);
+  /* the name is stored in the same block as the category */
+  len			= strlen(a_name);
+  this			= sd_calloc(1, sizeof(log4c_category_t) + len + 1);
+  this->cat_name	= memcpy(this + 1, a_name, len + 1);
   this->cat_priority	= LOG4C_PRIORITY_NOTSET;
+  this->cat_backtrace	= LOG4C_PRIORITY_NOTSET;
   this->cat_additive	= 1;
   this->cat_appender	= NULL;
   this->cat_parent	= NULL;
   
+  category_link(this, linked);
+
   /* skip root category because it has a NULL parent */
-  if (strcmp(LOG4C_CATEGORY_DEFAULT, a_name)) {
-    char* tmp = sd_strdup(this->cat_name);
-    
-    this->cat_parent = log4c_category_get(dot_dirname(tmp));
-    free(tmp);
-  }
+  if (this->cat_node.cn_parent != &trie_top)
+    this->cat_parent = node_category(this->cat_node.cn_parent);
+  else
+    this->cat_parent = root;
+
+  /* ancestors may have been created meanwhile: take the id last */
+  page = &hot_pages[hot_ncategories >> CATEGORY_HOT_PAGE_SHIFT];
+  if (!*page)
+    *page = sd_calloc(CATEGORY_HOT_PAGE_SIZE, sizeof(log4c_category_hot_t));
+
+  this->cat_id	= hot_ncategories++;
+  this->cat_hot	= &(*page)[this->cat_id & (CATEGORY_HOT_PAGE_SIZE - 1)];
+  this->cat_hot->hot_category = this;
+  category_hot_update(this);
+
   return this;
 }
 
 /*******************************************************************************/
 extern void log4c_category_delete(log4c_category_t* this)
 {
+  log4c_category_node_t** node;
+
   if (!this) 
     return;
   
-  free(this->cat_name);
+  for (node = &trie_unlinked; *node; node = &(*node)->cn_next)
+    if (*node == &this->cat_node) {
+      *node = this->cat_node.cn_next;
+      break;
+    }
+
+  if (this->cat_hot->hot_own_plan)
+    free(this->cat_hot->hot_appenders);
+  this->cat_hot->hot_category = NULL;
+  if (this->cat_backtrace != LOG4C_PRIORITY_NOTSET)
+    SD_ATOMIC_ADD(&__log4c_category_overrides, -1);
+
+  free(this->cat_node.cn_index);
   free(this);
 }
 
@@ -116,18 +327,19 @@ extern int log4c_category_get_priority(const log4c_category_t* this)
   return (this ? this->cat_priority : LOG4C_PRIORITY_UNKNOWN);
 }
 
+/*******************************************************************************/
+extern int log4c_category_get_id(const log4c_category_t* this)
+{
+  return (this ? this->cat_id : -1);
+}
+
 /*******************************************************************************/
 extern int log4c_category_get_chainedpriority(const log4c_category_t* this)
 {
-  const log4c_category_t* cat = this;
-  
   if (!this) 
     return LOG4C_PRIORITY_UNKNOWN;
   
-  while (cat->cat_priority == LOG4C_PRIORITY_NOTSET && cat->cat_parent)
-    cat = cat->cat_parent;
-	
-  return cat->cat_priority;
+  return this->cat_hot->hot_priority;
 }
 
 /*******************************************************************************/
@@ -152,6 +364,30 @@ extern int log4c_category_set_priority(log4c_category_t* this, int a_priority)
   
   previous = this->cat_priority;
   this->cat_priority = a_priority;
+  category_hot_propagate(this);
+  return previous;
+}
+
+/*******************************************************************************/
+extern int log4c_category_get_backtrace(const log4c_category_t* this)
+{
+  return (this ? this->cat_backtrace : LOG4C_PRIORITY_UNKNOWN);
+}
+
+/*******************************************************************************/
+extern int log4c_category_set_backtrace(log4c_category_t* this, int a_priority)
+{
+  int previous;
+
+  if (!this)
+    return LOG4C_PRIORITY_UNKNOWN;
+
+  previous = this->cat_backtrace;
+  this->cat_backtrace = a_priority;
+  if ((previous == LOG4C_PRIORITY_NOTSET) != (a_priority == LOG4C_PRIORITY_NOTSET))
+    SD_ATOMIC_ADD(&__log4c_category_overrides,
+		  a_priority == LOG4C_PRIORITY_NOTSET ? -1 : 1);
+  category_hot_propagate(this);
   return previous;
 }
 
@@ -171,6 +407,7 @@ extern const log4c_appender_t* log4c_category_set_appender(
   
   previous = this->cat_appender;
   this->cat_appender = a_appender;
+  category_hot_propagate(this);
   return previous;
 }
 
@@ -184,6 +421,7 @@ extern int log4c_category_set_additivity(log4c_category_t* this, int a_additivit
   
   previous = this->cat_additive;
   this->cat_additive = a_additivity;
+  category_hot_propagate(this);
   return previous;
 }
 
@@ -202,32 +440,144 @@ extern void log4c_category_print(const log4c_category_t* this, FILE* a_stream)
       );
 }
 
+#ifdef CATEGORY_PTHREADS
 /*******************************************************************************/
-extern void __log4c_category_vlog(const log4c_category_t* this, 
+static void override_exit(void* a_unused)
+{
+  SD_ATOMIC_ADD(&__log4c_category_overrides, -1);
+}
+
+/*******************************************************************************/
+static void override_init(void)
+{
+  pthread_key_create(&override_key, override_exit);
+}
+#endif
+
+/*******************************************************************************/
+static int override_get(void)
+{
+#if defined(SD_TLS) || !defined(CATEGORY_PTHREADS)
+  return override_priority;
+#else
+  pthread_once(&override_once, override_init);
+  return (int) (size_t) pthread_getspecific(override_key) - 1;
+#endif
+}
+
+/*******************************************************************************/
+static void override_set(int a_priority)
+{
+#if defined(SD_TLS) || !defined(CATEGORY_PTHREADS)
+  override_priority = a_priority;
+#else
+  pthread_once(&override_once, override_init);
+  pthread_setspecific(override_key, (void*) (size_t) (a_priority + 1));
+#endif
+}
+
+/*******************************************************************************/
+extern int __log4c_category_set_override(int a_priority)
+{
+  int previous = override_get();
+
+  if (a_priority == LOG4C_PRIORITY_NOTSET)
+    a_priority = -1;
+  if ((previous == -1) == (a_priority == -1)) {
+    override_set(a_priority);
+    return previous == -1 ? LOG4C_PRIORITY_NOTSET : previous;
+  }
+
+#if defined(CATEGORY_PTHREADS) && defined(SD_TLS)
+  pthread_once(&override_once, override_init);
+  pthread_setspecific(override_key, a_priority == -1 ? NULL : (void*) 1);
+#endif
+  override_set(a_priority);
+  SD_ATOMIC_ADD(&__log4c_category_overrides, a_priority == -1 ? -1 : 1);
+  return previous == -1 ? LOG4C_PRIORITY_NOTSET : previous;
+}
+
+/*******************************************************************************/
+extern int __log4c_category_is_overridden(const log4c_category_t* this,
+					  int a_priority)
+{
+  return override_get() >= a_priority ||
+    (this && this->cat_hot->hot_backtrace >= a_priority);
+}
+
+/*******************************************************************************/
+extern int __log4c_category_is_backtraced(const log4c_category_t* this,
+					  int a_priority)
+{
+  return this && a_priority > this->cat_hot->hot_priority &&
+    a_priority > override_get() &&
+    a_priority <= this->cat_hot->hot_backtrace;
+}
+
+/*******************************************************************************/
+extern int log4c_category_set_thread_priority(int a_priority)
+{
+  int ret = 0;
+
+  if (a_priority == LOG4C_PRIORITY_NOTSET)
+    log4c_mdc_remove(LOG4C_MDC_PRIORITY);
+  else
+    ret = log4c_mdc_put(LOG4C_MDC_PRIORITY, log4c_priority_to_string(a_priority));
+
+  /* the MDC rounds the priority down to its name */
+  __log4c_category_set_override(a_priority);
+  return ret;
+}
+
+/*******************************************************************************/
+extern int log4c_category_get_thread_priority(void)
+{
+  int priority = override_get();
+
+  return priority == -1 ? LOG4C_PRIORITY_NOTSET : priority;
+}
+
+/*******************************************************************************/
+/* the clock is only read when a layout or an appender of the plan needs it */
+static void category_event_stamp(const log4c_category_t* this,
+  log4c_logging_event_t* a_event)
+{
+  __log4c_logging_event_stamp(a_event, this->cat_hot->hot_needs);
+}
+
+/*******************************************************************************/
+/* a_parsed is the format of a call site, or NULL */
+static void category_vlog(const log4c_category_t* this, 
   const log4c_location_info_t* a_locinfo, 
   int a_priority,
+  const sd_format_t* a_parsed,
   const char* a_format, 
   va_list a_args)
 {
   char* message;
   log4c_logging_event_t evt;
-  const log4c_category_t* cat;
-  int yes = 0;
   
   if (!this)
     return;
   
+  LOG4C_TRACE2(vlog_entry, this->cat_name, a_priority);
+
   /* check if an appender is defined in the category hierarchy */
-  for (cat = this; cat; cat = cat->cat_parent) {
-    if (cat->cat_appender)
-	    yes++;
-  }
-  
-  if (!yes)
+  if (!*this->cat_hot->hot_appenders) {
+    LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, NULL);
     return;
+  }
 
   log4c_reread();
 
+  if (__log4c_category_is_backtraced(this, a_priority)) {
+    __log4c_backtrace_vput(this, a_locinfo, a_priority, a_parsed, a_format,
+      a_args);
+    LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, NULL);
+    return;
+  }
+  __log4c_backtrace_trigger(a_priority);
+
   /* when there is no limit on the buffer size, we use malloc() to
   * give the user the possiblity to reallocate if necessary. When
   * the buffer is limited in size, we use alloca() for more
@@ -238,16 +588,28 @@ extern void __log4c_category_vlog(const log4c_category_t* this,
   if (!evt.evt_buffer.buf_maxsize) {
     evt.evt_buffer.buf_size = LOG4C_BUFFER_SIZE_DEFAULT;
     evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
-    message = sd_vsprintf(a_format, a_args);
   }
   else {
-    size_t n;
-    
     evt.evt_buffer.buf_size = evt.evt_buffer.buf_maxsize;
     evt.evt_buffer.buf_data = alloca(evt.evt_buffer.buf_size);
+  }
+
+  /* a format with no conversion is the message itself */
+  if (sd_format_is_literal(a_parsed) &&
+      (!evt.evt_buffer.buf_maxsize ||
+       sd_format_get_length(a_parsed) < evt.evt_buffer.buf_size))
+    message = (char*) a_format;
+  else if (!evt.evt_buffer.buf_maxsize)
+    message = a_parsed ? sd_format_vsprintf(a_parsed, a_args) :
+      sd_vsprintf(a_format, a_args);
+  else {
+    size_t n;
+    
     message = alloca(evt.evt_buffer.buf_size);
     
-    if ( (n = (size_t)vsnprintf(message, evt.evt_buffer.buf_size, a_format, a_args))
+    if ( (n = (size_t) (a_parsed ?
+      sd_format_vsnprintf(a_parsed, message, evt.evt_buffer.buf_size, a_args) :
+      sd_vsnprintf(message, evt.evt_buffer.buf_size, a_format, a_args)))
       >= evt.evt_buffer.buf_size)
     sd_error("truncating message of %d bytes (bufsize = %d)", n, 
       evt.evt_buffer.buf_size);
@@ -257,33 +619,490 @@ extern void __log4c_category_vlog(const log4c_category_t* this,
   evt.evt_priority	= a_priority;
   evt.evt_msg	        = message;
   evt.evt_loc	        = a_locinfo;
-  SD_GETTIMEOFDAY(&evt.evt_timestamp, NULL);
+  evt.evt_fields	= NULL;
+  evt.evt_nfields	= 0;
+  category_event_stamp(this, &evt);
   
-  for (cat = this; cat; cat = cat->cat_parent) {
-    if (cat->cat_appender)
-	    log4c_appender_append(cat->cat_appender, &evt);
-    
-    if (!cat->cat_additive) break;	
-  }
+  __log4c_category_dispatch(this, &evt);
   
+  LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, message);
+
   if (!evt.evt_buffer.buf_maxsize) {
-    free(message);
+    if (message != a_format)
+      free(message);
     free(evt.evt_buffer.buf_data);
   }
 }
 
 /*******************************************************************************/
-static const char* dot_dirname(char* a_string)
+extern void __log4c_category_vlog(const log4c_category_t* this, 
+  const log4c_location_info_t* a_locinfo, 
+  int a_priority,
+  const char* a_format, 
+  va_list a_args)
 {
-  char* p;
-  
-  if (!a_string)
+  category_vlog(this, a_locinfo, a_priority, NULL, a_format, a_args);
+}
+
+/*******************************************************************************/
+static void category_log_message(const log4c_category_t* this,
+  const log4c_location_info_t* a_locinfo,
+  int a_priority,
+  const char* a_message,
+  size_t a_len,
+  const log4c_field_t* a_fields,
+  size_t a_nfields)
+{
+  const char* message = a_message;
+  log4c_logging_event_t evt;
+
+  if (!this)
+    return;
+
+  LOG4C_TRACE2(vlog_entry, this->cat_name, a_priority);
+
+  if (!*this->cat_hot->hot_appenders) {
+    LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, NULL);
+    return;
+  }
+
+  log4c_reread();
+
+  if (__log4c_category_is_backtraced(this, a_priority)) {
+    __log4c_backtrace_put(this, a_locinfo, a_priority, a_message, a_len,
+      a_fields, a_nfields);
+    LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, NULL);
+    return;
+  }
+  __log4c_backtrace_trigger(a_priority);
+
+  evt.evt_buffer.buf_maxsize = log4c_rc->config.bufsize;
+
+  if (!evt.evt_buffer.buf_maxsize) {
+    evt.evt_buffer.buf_size = LOG4C_BUFFER_SIZE_DEFAULT;
+    evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
+  }
+  else {
+    evt.evt_buffer.buf_size = evt.evt_buffer.buf_maxsize;
+    evt.evt_buffer.buf_data = alloca(evt.evt_buffer.buf_size);
+
+    /* truncated like a formatted message */
+    if (a_len >= evt.evt_buffer.buf_size) {
+      char* truncated = alloca(evt.evt_buffer.buf_size);
+
+      memcpy(truncated, a_message, evt.evt_buffer.buf_size - 1);
+      truncated[evt.evt_buffer.buf_size - 1] = '\0';
+      message = truncated;
+      sd_error("truncating message of %d bytes (bufsize = %d)", (int) a_len,
+	evt.evt_buffer.buf_size);
+    }
+  }
+
+  evt.evt_category	= this->cat_name;
+  evt.evt_priority	= a_priority;
+  evt.evt_msg	        = message;
+  evt.evt_loc	        = a_locinfo;
+  evt.evt_fields	= a_fields;
+  evt.evt_nfields	= a_nfields;
+  category_event_stamp(this, &evt);
+
+  __log4c_category_dispatch(this, &evt);
+
+  LOG4C_TRACE3(vlog_return, this->cat_name, a_priority, message);
+
+  if (!evt.evt_buffer.buf_maxsize)
+    free(evt.evt_buffer.buf_data);
+}
+
+/*******************************************************************************/
+extern void __log4c_category_log_message(const log4c_category_t* this,
+  const log4c_location_info_t* a_locinfo,
+  int a_priority,
+  const char* a_message,
+  size_t a_len)
+{
+  category_log_message(this, a_locinfo, a_priority, a_message, a_len, NULL, 0);
+}
+
+/*******************************************************************************/
+extern void log4c_category_log_kv(const log4c_category_t* this,
+  int a_priority,
+  const char* a_message,
+  const log4c_field_t* a_fields,
+  size_t a_nfields)
+{
+  const log4c_location_info_t locinfo = LOG4C_LOCATION_INFO_INITIALIZER(NULL);
+
+  if (!log4c_category_is_priority_enabled(this, a_priority))
+    return;
+
+  if (!a_message)
+    a_message = "";
+  category_log_message(this, &locinfo, a_priority, a_message,
+    strlen(a_message), a_fields, a_nfields);
+}
+
+/*******************************************************************************/
+/*
+ * The format of a site is parsed on its first call and published with a
+ * compare and swap: threads racing on the first call all parse it, one
+ * wins, the others free theirs. The formats of the sites are never
+ * freed, since the sites are static and outlive log4c_fini().
+ */
+static const sd_format_t* category_site_format(log4c_category_site_t* a_site,
+  const char* a_format)
+{
+  sd_format_t* format = SD_ATOMIC_LOAD_ACQUIRE(&a_site->site_format);
+
+  if (!format) {
+    sd_format_t* parsed = sd_format_new(a_format);
+
+    if (SD_ATOMIC_CAS(&a_site->site_format, NULL, parsed))
+      format = parsed;
+    else {
+      sd_format_delete(parsed);
+      format = SD_ATOMIC_LOAD_ACQUIRE(&a_site->site_format);
+    }
+  }
+
+  /* the site is keyed by the format pointer */
+  return sd_format_get_string(format) == a_format ? format : NULL;
+}
+
+/*******************************************************************************/
+extern void log4c_category_log_site(const log4c_category_t* this,
+  int a_priority,
+  log4c_category_site_t* a_site,
+  const char* a_format, ...)
+{
+  va_list va;
+
+  va_start(va, a_format);
+  category_vlog(this, &a_site->site_locinfo, a_priority,
+    category_site_format(a_site, a_format), a_format, va);
+  va_end(va);
+}
+
+/*******************************************************************************/
+extern void __log4c_category_dispatch(const log4c_category_t* this,
+  log4c_logging_event_t* a_event)
+{
+  log4c_appender_t** appenders;
+
+  __log4c_stats_category(this->cat_id);
+
+  for (appenders = this->cat_hot->hot_appenders; *appenders; appenders++)
+    log4c_appender_append(*appenders, a_event);
+}
+
+/*******************************************************************************/
+static unsigned int segment_hash(const char* a_segment, size_t a_len)
+{
+  unsigned int h = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < a_len; i++)
+    h = (h ^ (unsigned char) a_segment[i]) * 16777619U;
+
+  return h;
+}
+
+/*******************************************************************************/
+static void node_index_add(log4c_category_node_t* this,
+  log4c_category_node_t* a_child)
+{
+  size_t mask = this->cn_index_size - 1;
+  size_t i = a_child->cn_hash & mask;
+
+  while (this->cn_index[i])
+    i = (i + 1) & mask;
+
+  this->cn_index[i] = a_child;
+}
+
+/*******************************************************************************/
+static void node_index_rebuild(log4c_category_node_t* this)
+{
+  log4c_category_node_t* child;
+
+  free(this->cn_index);
+  this->cn_index_size = this->cn_index_size ? 
+    this->cn_index_size * 2 : 4 * CATEGORY_NODE_INDEX_MIN;
+  this->cn_index = sd_calloc(this->cn_index_size, sizeof(*this->cn_index));
+
+  for (child = this->cn_children; child; child = child->cn_next)
+    node_index_add(this, child);
+}
+
+/*******************************************************************************/
+static log4c_category_node_t* node_child_find(
+  const log4c_category_node_t* this,
+  const char* a_segment, size_t a_len, unsigned int a_hash)
+{
+  log4c_category_node_t* child;
+
+  if (this->cn_index) {
+    size_t mask = this->cn_index_size - 1;
+    size_t i;
+
+    for (i = a_hash & mask; (child = this->cn_index[i]) != NULL;
+	 i = (i + 1) & mask)
+    {
+      if (child->cn_hash == a_hash && child->cn_seglen == a_len &&
+	  !memcmp(child->cn_segment, a_segment, a_len))
+	return child;
+    }
     return NULL;
-  
-  if ( (p = strrchr(a_string, '.')) == NULL)
-    return LOG4C_CATEGORY_DEFAULT;
-  
-  *p = '\0';
-  return a_string;
+  }
+
+  for (child = this->cn_children; child; child = child->cn_next) {
+    if (child->cn_hash == a_hash && child->cn_seglen == a_len &&
+	!memcmp(child->cn_segment, a_segment, a_len))
+      return child;
+  }
+  return NULL;
 }
 
+/*******************************************************************************/
+static void node_child_add(log4c_category_node_t* this,
+  log4c_category_node_t* a_child)
+{
+  a_child->cn_parent = this;
+
+  /* keep children in creation order */
+  if (this->cn_last_child)
+    this->cn_last_child->cn_next = a_child;
+  else
+    this->cn_children = a_child;
+  this->cn_last_child = a_child;
+  this->cn_nchildren++;
+
+  if (this->cn_nchildren < CATEGORY_NODE_INDEX_MIN)
+    return;
+
+  /* keep the index at most half full */
+  if (this->cn_nchildren * 2 > this->cn_index_size)
+    node_index_rebuild(this);
+  else
+    node_index_add(this, a_child);
+}
+
+/*******************************************************************************/
+static log4c_category_t* category_lookup(const char* a_name)
+{
+  const log4c_category_node_t* node = &trie_top;
+  const char* segment = a_name;
+  const char* dot;
+
+  if (!a_name)
+    return NULL;
+
+  for (;;) {
+    size_t len = (dot = strchr(segment, '.')) ? 
+      (size_t) (dot - segment) : strlen(segment);
+
+    node = node_child_find(node, segment, len, segment_hash(segment, len));
+    if (!node)
+      return NULL;
+
+    if (!dot)
+      return node_category(node);
+    segment = dot + 1;
+  }
+}
+
+/*******************************************************************************/
+/*
+ * Attach a new category to the trie, creating its missing ancestors first
+ * so that categories keep being registered in the factory parent first.
+ * The trie belongs to the factory: a category which does not come from it
+ * only gets a parent.
+ */
+static void category_link(log4c_category_t* this, int a_linked)
+{
+  log4c_category_node_t* node = &trie_top;
+  log4c_category_node_t* child;
+  char* segment = this->cat_name;
+  char* dot;
+
+  while ( (dot = strchr(segment, '.')) != NULL) {
+    size_t len = dot - segment;
+    unsigned int hash = segment_hash(segment, len);
+
+    if ( (child = node_child_find(node, segment, len, hash)) == NULL) {
+      /* the name up to this dot is the ancestor's name: borrow our own
+       * buffer rather than duplicating it */
+      *dot = '\0';
+      child = &log4c_category_get(this->cat_name)->cat_node;
+      *dot = '.';
+    }
+    node = child;
+    segment = dot + 1;
+  }
+
+  this->cat_node.cn_segment = segment;
+  this->cat_node.cn_seglen  = strlen(segment);
+  this->cat_node.cn_hash    = segment_hash(segment, this->cat_node.cn_seglen);
+
+  /* categories created with log4c_category_new() behind the factory's back
+   * get a parent but are not reachable from the trie, so that deleting
+   * them leaves it intact */
+  if (!a_linked || node_child_find(node, segment, this->cat_node.cn_seglen,
+				   this->cat_node.cn_hash)) {
+    this->cat_node.cn_parent = node;
+    this->cat_node.cn_next   = trie_unlinked;
+    trie_unlinked	     = &this->cat_node;
+  } else
+    node_child_add(node, &this->cat_node);
+}
+
+
+/*******************************************************************************/
+static void category_hot_reset(void)
+{
+  sd_list_iter_t* i;
+  int j;
+
+  for (j = 0; j < CATEGORY_HOT_NPAGES && hot_pages[j]; j++) {
+    free(hot_pages[j]);
+    hot_pages[j] = NULL;
+  }
+  hot_ncategories = 0;
+
+  if (hot_retired_plans) {
+    for (i = sd_list_begin(hot_retired_plans); 
+	 i != sd_list_end(hot_retired_plans);
+	 i = sd_list_iter_next(i))
+      free(i->data);
+    sd_list_delete(hot_retired_plans);
+    hot_retired_plans = NULL;
+  }
+  trie_unlinked = NULL;
+}
+
+/*******************************************************************************/
+static int category_plan_needs(log4c_appender_t** a_plan)
+{
+  int needs = 0;
+
+  for (; *a_plan; a_plan++)
+    if (((needs |= log4c_appender_get_needs(*a_plan)) & LOG4C_NEEDS_ALL) ==
+	LOG4C_NEEDS_ALL)
+      break;
+
+  return needs;
+}
+
+/*******************************************************************************/
+extern void __log4c_category_refresh_needs(void)
+{
+  int i;
+
+  for (i = 0; i < hot_ncategories; i++) {
+    log4c_category_hot_t* hot = &hot_pages[i >> CATEGORY_HOT_PAGE_SHIFT]
+      [i & (CATEGORY_HOT_PAGE_SIZE - 1)];
+
+    if (hot->hot_category)
+      hot->hot_needs = category_plan_needs(hot->hot_appenders);
+  }
+}
+
+/*******************************************************************************/
+/*
+ * Recompute the hot state of a category from its own settings and the hot
+ * state of its parent, which must be up to date.
+ */
+static void category_hot_update(log4c_category_t* this)
+{
+  log4c_category_hot_t* hot = this->cat_hot;
+  log4c_appender_t** inherited = no_appenders;
+  log4c_appender_t** plan;
+  log4c_appender_t** old = hot->hot_appenders;
+  size_t n = 0;
+
+  if (this->cat_priority != LOG4C_PRIORITY_NOTSET || !this->cat_parent)
+    hot->hot_priority = this->cat_priority;
+  else
+    hot->hot_priority = this->cat_parent->cat_hot->hot_priority;
+
+  if (this->cat_backtrace != LOG4C_PRIORITY_NOTSET)
+    hot->hot_backtrace = this->cat_backtrace;
+  else
+    hot->hot_backtrace = this->cat_parent ?
+      this->cat_parent->cat_hot->hot_backtrace : -1;
+
+  if (this->cat_additive && this->cat_parent)
+    inherited = this->cat_parent->cat_hot->hot_appenders;
+
+  /* without an appender of its own a category shares its parent's plan */
+  if (!this->cat_appender) {
+    plan = inherited;
+  } else {
+    while (inherited[n])
+      n++;
+
+    if (hot->hot_own_plan && old[0] == this->cat_appender) {
+      size_t i;
+
+      for (i = 0; i <= n && old[i + 1] == inherited[i]; i++)
+	;
+      if (i > n)
+	return;
+    }
+
+    plan = sd_malloc((n + 2) * sizeof(*plan));
+    plan[0] = this->cat_appender;
+    memcpy(plan + 1, inherited, (n + 1) * sizeof(*plan));
+  }
+
+  /* owned plans are kept until the next cleanup: a logging call may
+     still be walking them */
+  if (hot->hot_own_plan) {
+    if (!hot_retired_plans)
+      hot_retired_plans = sd_list_new(16);
+    sd_list_add(hot_retired_plans, old);
+  }
+
+  hot->hot_appenders = plan;
+  hot->hot_own_plan  = (this->cat_appender != NULL);
+  hot->hot_needs     = category_plan_needs(plan);
+}
+
+/*******************************************************************************/
+/*
+ * Refresh a category and every category below it. Parents come before their
+ * children in a pre-order walk of the trie. All categories are below root,
+ * including the top level ones which are not its children in the trie.
+ * The categories out of the trie come last: their parents are in it.
+ */
+static void category_hot_propagate(log4c_category_t* this)
+{
+  const log4c_category_node_t* top = &this->cat_node;
+  const log4c_category_node_t* node;
+  const log4c_category_t* parent;
+
+  category_hot_update(this);
+  if (!this->cat_parent)
+    top = &trie_top;
+
+  node = top->cn_children;
+  while (node) {
+    category_hot_update(node_category(node));
+
+    if (node->cn_children) {
+      node = node->cn_children;
+      continue;
+    }
+    while (node != top && !node->cn_next)
+      node = node->cn_parent;
+    node = node != top ? node->cn_next : NULL;
+  }
+
+  for (node = trie_unlinked; node; node = node->cn_next) {
+    for (parent = node_category(node)->cat_parent; parent && parent != this;
+	 parent = parent->cat_parent)
+      ;
+    if (parent)
+      category_hot_update(node_category(node));
+  }
+}
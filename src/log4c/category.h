@@ -25,6 +25,7 @@
 #include <log4c/defs.h>
 #include <log4c/priority.h>
 #include <log4c/location_info.h>
+#include <log4c/logging_event.h>
 
 __LOG4C_BEGIN_DECLS
 
@@ -56,6 +57,20 @@ LOG4C_API log4c_category_t* log4c_category_get(const char* a_name);
  **/
 LOG4C_API int log4c_category_list(log4c_category_t** a_cats, int a_ncats);
 
+/**
+ * Returns the category with the given id.
+ *
+ * @param a_id the category id, as returned by log4c_category_get_id()
+ * @returns the category or NULL if no category has this id.
+ **/
+LOG4C_API log4c_category_t* log4c_category_get_by_id(int a_id);
+
+/**
+ * Returns the number of categories. Category ids range from 0 to this
+ * number minus one.
+ **/
+LOG4C_API int log4c_category_get_count(void);
+
 /**
  * Constructor for a log4c_category_t.
  *
@@ -98,6 +113,14 @@ LOG4C_API const struct __log4c_appender* log4c_category_get_appender(
  **/
 LOG4C_API int log4c_category_get_additivity(const log4c_category_t* a_category);
 
+/**
+ * Returns the id of this log4c_category_t. Ids are small integers given
+ * in order of creation, which can be used to index per category tables.
+ * @param a_category the log4c_category_t object
+ * @return the id or -1 if @a a_category is NULL
+ **/
+LOG4C_API int log4c_category_get_id(const log4c_category_t* a_category);
+
 /**
  * Returns the assigned Priority, if any, for this log4c_category_t.
  * @param a_category the log4c_category_t object
@@ -112,9 +135,8 @@ LOG4C_API int log4c_category_get_priority(const log4c_category_t* a_category);
  *
  * @param a_category the log4c_category_t object
  *
- * @todo the log4c_category_t is designed so that this method executes as
- * quickly as possible. It could even be faster if the set priority was
- * propagated through the children hierarchy of a category.
+ * The priority is propagated through the children hierarchy of a category
+ * when it is set, so this method does not walk the hierarchy.
  **/
 LOG4C_API int log4c_category_get_chainedpriority(const log4c_category_t* a_category);
 
@@ -148,6 +170,28 @@ LOG4C_API int log4c_category_set_priority(log4c_category_t* a_category,
  **/
 LOG4C_API int log4c_category_set_additivity(log4c_category_t* a_category,
                                          int a_additivity);
+/**
+ * Sets the backtrace priority of this category: the events it does not
+ * log, down to this priority, are kept in a ring of the calling thread
+ * and logged ahead of the next event of the trigger priority. See
+ * backtrace.h.
+ *
+ * @param a_category the log4c_category_t object
+ * @param a_priority the backtrace priority. Use LOG4C_PRIORITY_NOTSET to
+ * let the category use the backtrace priority of its parent.
+ * @return the previous backtrace priority
+ **/
+LOG4C_API int log4c_category_set_backtrace(log4c_category_t* a_category,
+					   int a_priority);
+
+/**
+ * Returns the backtrace priority of this category.
+ *
+ * @param a_category the log4c_category_t object
+ * @returns the backtrace priority, LOG4C_PRIORITY_NOTSET if it has none
+ **/
+LOG4C_API int log4c_category_get_backtrace(const log4c_category_t* a_category);
+
 /**
  * prints the log4c_category_t object on a stream
  *
@@ -156,9 +200,78 @@ LOG4C_API int log4c_category_set_additivity(log4c_category_t* a_category,
  **/ 
 LOG4C_API void log4c_category_print(const log4c_category_t* a_category, FILE* a_stream); 
 
+/**
+ * The key of the MDC which holds the priority override of a thread.
+ **/
+#define LOG4C_MDC_PRIORITY	"log4c.priority"
+
+/**
+ * Overrides the priority of all the categories for the calling thread:
+ * they log the events of this priority or higher from this thread, on
+ * top of the events their own priority enables. This traces one request
+ * at a debug priority without enabling it for the whole category.
+ *
+ * The override is kept in the MDC under the key LOG4C_MDC_PRIORITY, as
+ * the name of the priority. Putting that key with log4c_mdc_put() in
+ * another thread, such as the worker a request is handed to, sets the
+ * same override there; removing it or clearing the MDC clears it.
+ *
+ * @param a_priority the priority, or LOG4C_PRIORITY_NOTSET to clear the
+ * override
+ * @returns 0 or -1 if the MDC is full, in which case the override is set
+ * but does not show in the MDC
+ **/
+LOG4C_API int log4c_category_set_thread_priority(int a_priority);
+
+/**
+ * @returns the priority override of the calling thread, or
+ * LOG4C_PRIORITY_NOTSET
+ **/
+LOG4C_API int log4c_category_get_thread_priority(void);
+
+/**
+ * @internal
+ * The number of threads which have a priority override, plus the number
+ * of categories which have a backtrace priority. The categories only look
+ * the overrides and the backtraces up while it is not 0.
+ **/
+LOG4C_DATA int __log4c_category_overrides;
+
+/**
+ * @internal
+ * Sets the priority override of the calling thread, without the MDC.
+ *
+ * @returns the previous override
+ **/
+LOG4C_API int __log4c_category_set_override(int a_priority);
+
+/**
+ * @internal
+ * @returns whether the priority override of the calling thread or the
+ * backtrace priority of the category enables the priority @a a_priority
+ **/
+LOG4C_API int __log4c_category_is_overridden(const log4c_category_t* a_category,
+					     int a_priority);
+
+/**
+ * @internal
+ * @returns whether an event of priority @a a_priority goes to the
+ * backtrace of the calling thread rather than to the appenders
+ **/
+LOG4C_API int __log4c_category_is_backtraced(const log4c_category_t* a_category,
+					     int a_priority);
+
+/**
+ * @internal
+ * Recomputes what the appenders of each category read from the events,
+ * after an appender or a layout changed type or layout.
+ **/
+LOG4C_API void __log4c_category_refresh_needs(void);
+
 /** 
  * Returns true if the chained priority of the log4c_category_t is equal to
- * or higher than given priority.
+ * or higher than given priority, or if the priority override of the
+ * calling thread or the backtrace priority of the category is.
  * @param a_category the log4c_category_t object
  * @param a_priority The priority to compare with.
  * @returns whether logging is enable for this priority.
@@ -167,13 +280,45 @@ LOG4C_API void log4c_category_print(const log4c_category_t* a_category, FILE* a_
 static inline int log4c_category_is_priority_enabled(const log4c_category_t* a_category,
 						     int a_priority)
 {
-    return log4c_category_get_chainedpriority(a_category) >= a_priority;
+    return log4c_category_get_chainedpriority(a_category) >= a_priority ||
+	(__log4c_category_overrides &&
+	 __log4c_category_is_overridden(a_category, a_priority));
 }
 #else
 #define log4c_category_is_priority_enabled(a,b) \
-  (log4c_category_get_chainedpriority(a) >= b)
+  (log4c_category_get_chainedpriority(a) >= b || \
+   (__log4c_category_overrides && __log4c_category_is_overridden(a,b)))
 #endif
 
+/**
+ * @brief compile time description of a category
+ *
+ * Descriptors are generated from a log4crc file by the log4c-genheader
+ * tool. @c priority is the chained priority the category has in that file.
+ **/
+typedef struct {
+    const char*	name;
+    int		priority;
+} log4c_static_category_t;
+
+/**
+ * Returns true if the priority @a a_priority is enabled in the category
+ * described by @a a_static, a generated descriptor.
+ *
+ * The descriptors are constant: with a constant priority this is a
+ * constant expression and the compiler drops the logging statements it
+ * guards. Changes made to the configuration at runtime can not enable
+ * them again.
+ **/
+#define log4c_static_category_is_priority_enabled(a_static, a_priority) \
+  ((a_static).priority >= (a_priority))
+
+/**
+ * Returns the category described by @a a_static.
+ **/
+#define log4c_static_category_get(a_static) \
+  log4c_category_get((a_static).name)
+
 /**
  * Return true if the category will log messages with priority @c
  * LOG4C_PRIORITY_FATAL.
@@ -337,6 +482,27 @@ LOG4C_API void __log4c_category_vlog(const log4c_category_t* a_category,
 				  const char* a_format, 
 				  va_list a_args);
 
+/**
+ * @internal
+ * Logs a message which is already formatted, as __log4c_category_vlog()
+ * does once it has formatted it.
+ *
+ * @param a_message the message, terminated by a '\0'
+ * @param a_len the length of the message
+ **/
+LOG4C_API void __log4c_category_log_message(const log4c_category_t* a_category,
+					    const log4c_location_info_t* a_locinfo,
+					    int a_priority,
+					    const char* a_message,
+					    size_t a_len);
+
+/**
+ * @internal
+ * Counts an event and sends it to the appenders of a category.
+ **/
+LOG4C_API void __log4c_category_dispatch(const log4c_category_t* a_category,
+					 log4c_logging_event_t* a_event);
+
 /**
  * @internal
  *
@@ -379,6 +545,24 @@ static LOG4C_INLINE void log4c_category_log(const log4c_category_t* a_category,
     }
 }
 
+/**
+ * Logs a message with the specified priority and key/value fields. The
+ * fields are attached to the event as they are: the layouts which write
+ * text render them after the message, the others can read them from
+ * the event. See field.h.
+ *
+ * @param a_category the log4c_category_t object
+ * @param a_priority the priority of the message
+ * @param a_message the message, which is not a format
+ * @param a_fields the fields
+ * @param a_nfields the number of fields
+ **/
+LOG4C_API void log4c_category_log_kv(const log4c_category_t* a_category,
+				     int a_priority,
+				     const char* a_message,
+				     const log4c_field_t* a_fields,
+				     size_t a_nfields);
+
 /** 
  * Log a message with the specified priority and a user location info.
  * @param a_category the log4c_category_t object
@@ -593,6 +777,47 @@ static LOG4C_INLINE void __log4c_category_trace(const log4c_category_t* a_catego
 #  define log4c_category_trace __log4c_category_trace
 #endif  /* __GNUC__ */
 
+/**
+ * The state of a LOG4C_LOG() call site: its location and its format,
+ * parsed on the first call.
+ **/
+typedef struct {
+    log4c_location_info_t	site_locinfo;
+    struct __sd_format*		site_format;
+} log4c_category_site_t;
+
+/**
+ * Logs a message like log4c_category_log(), from a call site which parses
+ * its format once. Later calls go straight from one conversion to the
+ * next, and a format with no conversion is used as the message without
+ * being copied. The location of the call is passed to the appenders.
+ *
+ * The format should be a string literal: it is referenced for the life of
+ * the program. When a call site is given other formats, only the first
+ * one is parsed, the others are formatted as usual.
+ *
+ * @param a_category the log4c_category_t object
+ * @param a_priority the priority of the message
+ * @param ... the format and its arguments
+ **/
+#define LOG4C_LOG(a_category, a_priority, ...) \
+    do { \
+	static log4c_category_site_t __log4c_category_site = \
+	    { LOG4C_LOCATION_INFO_INITIALIZER(NULL), NULL }; \
+	if (log4c_category_is_priority_enabled(a_category, a_priority)) \
+	    log4c_category_log_site(a_category, a_priority, \
+				    &__log4c_category_site, __VA_ARGS__); \
+    } while (0)
+
+/**
+ * @internal
+ * The function behind LOG4C_LOG().
+ **/
+LOG4C_API void log4c_category_log_site(const log4c_category_t* a_category,
+				       int a_priority,
+				       log4c_category_site_t* a_site,
+				       const char* a_format, ...);
+
 /**
  * Helper macro to define static categories.
  *
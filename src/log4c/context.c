@@ -0,0 +1,258 @@
+static const char version[] = "$Id$";
+
+/*
+ * context.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/context.h>
+#include <log4c/category.h>
+#include <sd/sd_xplatform.h>
+#include <sd/malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define CONTEXT_PTHREADS
+#endif
+
+/*
+ * The fields of the MDC point to the key and value of their slot. The
+ * NDC holds its entries separated by spaces; cx_starts are their
+ * offsets.
+ */
+typedef struct {
+    log4c_field_t	cx_mdc[LOG4C_MDC_MAX];
+    char		cx_keys[LOG4C_MDC_MAX][LOG4C_MDC_KEY_MAX];
+    char		cx_values[LOG4C_MDC_MAX][LOG4C_MDC_VALUE_MAX];
+    size_t		cx_nmdc;
+    char		cx_ndc[LOG4C_NDC_SIZE];
+    size_t		cx_starts[LOG4C_NDC_MAX];
+    int			cx_depth;
+    unsigned int	cx_version;
+} context_t;
+
+#ifdef SD_TLS
+static SD_TLS context_t context;
+#elif defined(CONTEXT_PTHREADS)
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+static pthread_key_t context_key;
+
+/*******************************************************************************/
+static void context_key_create(void)
+{
+    pthread_key_create(&context_key, free);
+}
+#else
+static context_t context;
+#endif
+
+/*******************************************************************************/
+/* the context of the thread, allocated when it first uses one without TLS */
+static context_t* context_get(void)
+{
+#if defined(SD_TLS) || !defined(CONTEXT_PTHREADS)
+    return &context;
+#else
+    context_t* this;
+
+    pthread_once(&context_once, context_key_create);
+    if ((this = pthread_getspecific(context_key)) == NULL) {
+	this = sd_calloc(1, sizeof(*this));
+	pthread_setspecific(context_key, this);
+    }
+    return this;
+#endif
+}
+
+/*******************************************************************************/
+static void copy(char* a_dest, const char* a_src, size_t a_size)
+{
+    size_t len = strlen(a_src);
+
+    if (len >= a_size)
+	len = a_size - 1;
+    memcpy(a_dest, a_src, len);
+    a_dest[len] = '\0';
+}
+
+/*******************************************************************************/
+static int mdc_find(const context_t* this, const char* a_key)
+{
+    size_t i;
+
+    for (i = 0; i < this->cx_nmdc; i++)
+	if (!strncmp(this->cx_keys[i], a_key, LOG4C_MDC_KEY_MAX - 1))
+	    return (int) i;
+    return -1;
+}
+
+/*******************************************************************************/
+/* the key LOG4C_MDC_PRIORITY carries the priority override of the thread */
+static void mdc_override(const char* a_key, const char* a_value)
+{
+    int priority;
+
+    if (strcmp(a_key, LOG4C_MDC_PRIORITY))
+	return;
+
+    priority = a_value ? log4c_priority_to_int(a_value) : LOG4C_PRIORITY_NOTSET;
+    __log4c_category_set_override(priority == LOG4C_PRIORITY_UNKNOWN ?
+				  LOG4C_PRIORITY_NOTSET : priority);
+}
+
+/*******************************************************************************/
+extern int log4c_mdc_put(const char* a_key, const char* a_value)
+{
+    context_t* this = context_get();
+    int i;
+
+    if (!a_key)
+	return -1;
+
+    if ((i = mdc_find(this, a_key)) != -1 &&
+	!strncmp(this->cx_values[i], a_value ? a_value : "",
+		 LOG4C_MDC_VALUE_MAX - 1))
+	return 0;
+
+    if (i == -1) {
+	if (this->cx_nmdc == LOG4C_MDC_MAX)
+	    return -1;
+	i = (int) this->cx_nmdc++;
+	copy(this->cx_keys[i], a_key, LOG4C_MDC_KEY_MAX);
+	this->cx_mdc[i] = log4c_field_string(this->cx_keys[i],
+					     this->cx_values[i]);
+    }
+    copy(this->cx_values[i], a_value ? a_value : "", LOG4C_MDC_VALUE_MAX);
+    mdc_override(a_key, a_value);
+
+    this->cx_version++;
+    return 0;
+}
+
+/*******************************************************************************/
+extern const char* log4c_mdc_get(const char* a_key)
+{
+    context_t* this = context_get();
+    int i;
+
+    if (!a_key || (i = mdc_find(this, a_key)) == -1)
+	return NULL;
+    return this->cx_values[i];
+}
+
+/*******************************************************************************/
+extern void log4c_mdc_remove(const char* a_key)
+{
+    context_t* this = context_get();
+    size_t i;
+    int found;
+
+    if (!a_key || (found = mdc_find(this, a_key)) == -1)
+	return;
+
+    /* the keys keep the order they were put in */
+    for (i = found; i + 1 < this->cx_nmdc; i++) {
+	memcpy(this->cx_keys[i], this->cx_keys[i + 1], LOG4C_MDC_KEY_MAX);
+	memcpy(this->cx_values[i], this->cx_values[i + 1],
+	       LOG4C_MDC_VALUE_MAX);
+    }
+    this->cx_nmdc--;
+    mdc_override(a_key, NULL);
+    this->cx_version++;
+}
+
+/*******************************************************************************/
+extern void log4c_mdc_clear(void)
+{
+    context_t* this = context_get();
+
+    if (this->cx_nmdc)
+	__log4c_category_set_override(LOG4C_PRIORITY_NOTSET);
+    this->cx_nmdc = 0;
+    this->cx_version++;
+}
+
+/*******************************************************************************/
+extern int log4c_ndc_push(const char* a_message)
+{
+    context_t* this = context_get();
+    size_t start = this->cx_depth ?
+	this->cx_starts[this->cx_depth - 1] +
+	strlen(this->cx_ndc + this->cx_starts[this->cx_depth - 1]) : 0;
+    size_t len;
+
+    if (!a_message || this->cx_depth == LOG4C_NDC_MAX)
+	return -1;
+
+    if (this->cx_depth)
+	start++;
+    len = strlen(a_message);
+    if (start + len >= LOG4C_NDC_SIZE)
+	return -1;
+
+    if (this->cx_depth)
+	this->cx_ndc[start - 1] = ' ';
+    memcpy(this->cx_ndc + start, a_message, len + 1);
+    this->cx_starts[this->cx_depth++] = start;
+
+    this->cx_version++;
+    return 0;
+}
+
+/*******************************************************************************/
+extern void log4c_ndc_pop(void)
+{
+    context_t* this = context_get();
+    size_t start;
+
+    if (!this->cx_depth)
+	return;
+
+    start = this->cx_starts[--this->cx_depth];
+    this->cx_ndc[start ? start - 1 : 0] = '\0';
+    this->cx_version++;
+}
+
+/*******************************************************************************/
+extern const char* log4c_ndc_get(void)
+{
+    context_t* this = context_get();
+
+    return this->cx_depth ? this->cx_ndc : NULL;
+}
+
+/*******************************************************************************/
+extern int log4c_ndc_get_depth(void)
+{
+    context_t* this = context_get();
+
+    return this->cx_depth;
+}
+
+/*******************************************************************************/
+extern void log4c_ndc_clear(void)
+{
+    context_t* this = context_get();
+
+    this->cx_depth = 0;
+    this->cx_version++;
+}
+
+/*******************************************************************************/
+extern unsigned int __log4c_context_get(const log4c_field_t** a_mdc,
+					size_t* a_nmdc, const char** a_ndc)
+{
+    context_t* this = context_get();
+
+    *a_mdc  = this->cx_nmdc ? this->cx_mdc : NULL;
+    *a_nmdc = this->cx_nmdc;
+    *a_ndc  = this->cx_depth ? this->cx_ndc : NULL;
+    return this->cx_version;
+}
@@ -0,0 +1,130 @@
+/* $Id$
+ *
+ * context.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_context_h
+#define log4c_context_h
+
+/**
+ * @file context.h
+ *
+ * @brief the diagnostic contexts of the logging threads.
+ *
+ * Each thread has a mapped diagnostic context (MDC), a small set of
+ * key/value strings such as a request id, and a nested diagnostic
+ * context (NDC), a stack of strings such as the steps of the current
+ * operation. Both are kept in thread-local storage of a fixed size:
+ * setting them does not allocate and logging an event only references
+ * them.
+ *
+ * @code
+ * log4c_mdc_put("request", request_id);
+ * log4c_ndc_push("checkout");
+ * log4c_category_info(cat, "payment refused");
+ * log4c_ndc_pop();
+ * @endcode
+ *
+ * The pattern layout writes them with %X and %x, the json layout as
+ * its "mdc" and "ndc" members. Deferred events logged by LOG4C_BINLOG()
+ * carry the contexts the thread had when it logged them.
+ *
+ * The key LOG4C_MDC_PRIORITY of category.h is the priority override of
+ * the thread: see log4c_category_set_thread_priority().
+ **/
+
+#include <stddef.h>
+#include <log4c/defs.h>
+#include <log4c/field.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The number of keys a MDC holds.
+ **/
+#define LOG4C_MDC_MAX		16
+
+/**
+ * The longest key and value kept in a MDC, '\0' included.
+ **/
+#define LOG4C_MDC_KEY_MAX	32
+#define LOG4C_MDC_VALUE_MAX	128
+
+/**
+ * The deepest NDC, and the size of the text of all its entries, '\0'
+ * included.
+ **/
+#define LOG4C_NDC_MAX		16
+#define LOG4C_NDC_SIZE		256
+
+/**
+ * Sets a key of the MDC of the calling thread.
+ *
+ * @param a_key the key, cut to LOG4C_MDC_KEY_MAX - 1 characters
+ * @param a_value the value, cut to LOG4C_MDC_VALUE_MAX - 1 characters
+ * @returns 0 or -1 if the key is new and the MDC is full
+ **/
+LOG4C_API int log4c_mdc_put(const char* a_key, const char* a_value);
+
+/**
+ * @returns the value of a key in the MDC of the calling thread, or NULL
+ **/
+LOG4C_API const char* log4c_mdc_get(const char* a_key);
+
+/**
+ * Removes a key from the MDC of the calling thread.
+ **/
+LOG4C_API void log4c_mdc_remove(const char* a_key);
+
+/**
+ * Empties the MDC of the calling thread.
+ **/
+LOG4C_API void log4c_mdc_clear(void);
+
+/**
+ * Pushes an entry on the NDC of the calling thread. The NDC reads as
+ * its entries separated by spaces.
+ *
+ * @param a_message the entry
+ * @returns 0 or -1 if the NDC is full, in which case nothing is pushed
+ **/
+LOG4C_API int log4c_ndc_push(const char* a_message);
+
+/**
+ * Pops the last entry pushed on the NDC of the calling thread.
+ **/
+LOG4C_API void log4c_ndc_pop(void);
+
+/**
+ * @returns the NDC of the calling thread, NULL when it is empty
+ **/
+LOG4C_API const char* log4c_ndc_get(void);
+
+/**
+ * @returns the number of entries of the NDC of the calling thread
+ **/
+LOG4C_API int log4c_ndc_get_depth(void);
+
+/**
+ * Empties the NDC of the calling thread.
+ **/
+LOG4C_API void log4c_ndc_clear(void);
+
+/**
+ * @internal
+ * Gets the contexts of the calling thread, valid until it changes them.
+ *
+ * @param a_mdc the fields of the MDC, NULL when it is empty
+ * @param a_nmdc the number of fields
+ * @param a_ndc the NDC, NULL when it is empty
+ * @returns a number which changes each time the thread changes its
+ * contexts, 0 before the first change
+ **/
+LOG4C_API unsigned int __log4c_context_get(const log4c_field_t** a_mdc,
+					   size_t* a_nmdc, const char** a_ndc);
+
+__LOG4C_END_DECLS
+
+#endif
@@ -0,0 +1,285 @@
+static const char version[] = "$Id$";
+
+/*
+ * field.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/field.h>
+#include <sd/sprintf.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FIELD_ALIGN(n)		(((n) + 7) & ~(size_t) 7)
+#define FIELD_NULL_STRING	0xffffffffU
+
+/* the text being rendered: what does not fit is counted, not written */
+typedef struct {
+    char*	r_buf;
+    size_t	r_size;
+    size_t	r_len;
+} render_t;
+
+/*******************************************************************************/
+static void render_chars(render_t* this, const char* a_chars, size_t a_len)
+{
+    if (this->r_len < this->r_size)
+	memcpy(this->r_buf + this->r_len, a_chars,
+	       a_len < this->r_size - this->r_len ? a_len :
+	       this->r_size - this->r_len);
+    this->r_len += a_len;
+}
+
+/*******************************************************************************/
+static int needs_quotes(const char* a_string)
+{
+    const unsigned char* p = (const unsigned char*) a_string;
+
+    if (!*p)
+	return 1;
+    for (; *p; p++)
+	if (*p <= ' ' || *p == '"' || *p == '=' || *p == '\\' || *p == 0x7f)
+	    return 1;
+    return 0;
+}
+
+/*******************************************************************************/
+static void render_string(render_t* this, const char* a_string)
+{
+    const char* p;
+    const char* run;
+
+    if (!a_string) {
+	render_chars(this, "(null)", 6);
+	return;
+    }
+    if (!needs_quotes(a_string)) {
+	render_chars(this, a_string, strlen(a_string));
+	return;
+    }
+
+    render_chars(this, "\"", 1);
+    for (run = p = a_string; *p; p++) {
+	unsigned char c = (unsigned char) *p;
+	char escape[5];
+
+	if (c >= ' ' && c != '"' && c != '\\' && c != 0x7f)
+	    continue;
+
+	render_chars(this, run, p - run);
+	run = p + 1;
+	switch (c) {
+	case '"':  render_chars(this, "\\\"", 2); break;
+	case '\\': render_chars(this, "\\\\", 2); break;
+	case '\n': render_chars(this, "\\n", 2); break;
+	case '\r': render_chars(this, "\\r", 2); break;
+	case '\t': render_chars(this, "\\t", 2); break;
+	default:
+	    sd_snprintf(escape, sizeof(escape), "\\x%02x", c);
+	    render_chars(this, escape, 4);
+	    break;
+	}
+    }
+    render_chars(this, run, p - run);
+    render_chars(this, "\"", 1);
+}
+
+/*******************************************************************************/
+extern int log4c_field_render(const log4c_field_t* a_fields, size_t a_nfields,
+			      char* a_buf, size_t a_size)
+{
+    render_t r;
+    size_t i;
+
+    r.r_buf  = a_buf;
+    r.r_size = a_buf && a_size ? a_size - 1 : 0;
+    r.r_len  = 0;
+
+    for (i = 0; i < a_nfields; i++) {
+	const log4c_field_t* f = &a_fields[i];
+	char number[32];
+	int n = 0;
+
+	render_chars(&r, " ", 1);
+	render_chars(&r, f->f_key, strlen(f->f_key));
+	render_chars(&r, "=", 1);
+
+	switch (f->f_type) {
+	case LOG4C_FIELD_INT:
+	    n = sd_snprintf(number, sizeof(number), "%lld", f->f_value.v_int);
+	    break;
+	case LOG4C_FIELD_UINT:
+	    n = sd_snprintf(number, sizeof(number), "%llu", f->f_value.v_uint);
+	    break;
+	case LOG4C_FIELD_DOUBLE:
+	    n = sd_snprintf(number, sizeof(number), "%g", f->f_value.v_double);
+	    break;
+	case LOG4C_FIELD_BOOL:
+	    n = sd_snprintf(number, sizeof(number), "%s",
+			    f->f_value.v_bool ? "true" : "false");
+	    break;
+	case LOG4C_FIELD_STRING:
+	    render_string(&r, f->f_value.v_string);
+	    break;
+	default:
+	    render_chars(&r, "?", 1);
+	    break;
+	}
+	if (n > 0)
+	    render_chars(&r, number, (size_t) n);
+    }
+
+    if (a_buf && a_size)
+	a_buf[r.r_len < r.r_size ? r.r_len : r.r_size] = '\0';
+
+    return (int) r.r_len;
+}
+
+/*******************************************************************************/
+static size_t field_size(const log4c_field_t* a_field)
+{
+    size_t size = FIELD_ALIGN(8 + strlen(a_field->f_key) + 1);
+
+    if (a_field->f_type != LOG4C_FIELD_STRING)
+	return size + 8;
+    if (!a_field->f_value.v_string)
+	return size + 8;
+    return size + FIELD_ALIGN(4 + strlen(a_field->f_value.v_string) + 1);
+}
+
+/*******************************************************************************/
+extern size_t log4c_field_encoded_size(const log4c_field_t* a_fields,
+				       size_t a_nfields)
+{
+    size_t size = 0;
+    size_t i;
+
+    for (i = 0; i < a_nfields; i++)
+	size += field_size(&a_fields[i]);
+
+    return size;
+}
+
+/*******************************************************************************/
+/* writes a length on 4 bytes and the characters, padded to 8 bytes */
+static char* put_string(char* a_out, const char* a_string, size_t a_len,
+			size_t a_header)
+{
+    size_t size = FIELD_ALIGN(a_header + a_len + 1);
+
+    memcpy(a_out + a_header, a_string, a_len);
+    memset(a_out + a_header + a_len, 0, size - a_header - a_len);
+    return a_out + size;
+}
+
+/*******************************************************************************/
+extern size_t log4c_field_encode(const log4c_field_t* a_fields,
+				 size_t a_nfields, void* a_buf)
+{
+    char* out = a_buf;
+    size_t i;
+
+    for (i = 0; i < a_nfields; i++) {
+	const log4c_field_t* f = &a_fields[i];
+	size_t keylen = strlen(f->f_key);
+
+	((XP_UINT32*) out)[0] = (XP_UINT32) f->f_type;
+	((XP_UINT32*) out)[1] = (XP_UINT32) keylen;
+	out = put_string(out, f->f_key, keylen, 8);
+
+	switch (f->f_type) {
+	case LOG4C_FIELD_STRING:
+	    if (!f->f_value.v_string) {
+		*(XP_UINT32*) out = FIELD_NULL_STRING;
+		memset(out + 4, 0, 4);
+		out += 8;
+	    } else {
+		size_t len = strlen(f->f_value.v_string);
+
+		*(XP_UINT32*) out = (XP_UINT32) len;
+		out = put_string(out, f->f_value.v_string, len, 4);
+	    }
+	    break;
+	case LOG4C_FIELD_DOUBLE:
+	    memcpy(out, &f->f_value.v_double, 8);
+	    out += 8;
+	    break;
+	case LOG4C_FIELD_BOOL:
+	    *(XP_INT64*) out = f->f_value.v_bool;
+	    out += 8;
+	    break;
+	default:
+	    *(XP_INT64*) out = (XP_INT64) f->f_value.v_int;
+	    out += 8;
+	    break;
+	}
+    }
+
+    return out - (char*) a_buf;
+}
+
+/*******************************************************************************/
+extern int log4c_field_decode(const void* a_data, size_t a_size,
+			      log4c_field_t* a_fields, size_t a_nfields)
+{
+    const char* in = a_data;
+    const char* end = in + a_size;
+    int n = 0;
+
+    while (in < end) {
+	log4c_field_t f;
+	XP_UINT32 len;
+
+	if (end - in < 8)
+	    return -1;
+	f.f_type = (int) ((const XP_UINT32*) in)[0];
+	len = ((const XP_UINT32*) in)[1];
+	if ((size_t) (end - in) < FIELD_ALIGN(8 + (size_t) len + 1) || in[8 + len])
+	    return -1;
+	f.f_key = in + 8;
+	in += FIELD_ALIGN(8 + (size_t) len + 1);
+
+	if (end - in < 8)
+	    return -1;
+	switch (f.f_type) {
+	case LOG4C_FIELD_INT:
+	    f.f_value.v_int = *(const XP_INT64*) in;
+	    in += 8;
+	    break;
+	case LOG4C_FIELD_UINT:
+	    f.f_value.v_uint = *(const XP_UINT64*) in;
+	    in += 8;
+	    break;
+	case LOG4C_FIELD_DOUBLE:
+	    memcpy(&f.f_value.v_double, in, 8);
+	    in += 8;
+	    break;
+	case LOG4C_FIELD_BOOL:
+	    f.f_value.v_bool = *(const XP_INT64*) in != 0;
+	    in += 8;
+	    break;
+	case LOG4C_FIELD_STRING:
+	    len = *(const XP_UINT32*) in;
+	    if (len == FIELD_NULL_STRING) {
+		f.f_value.v_string = NULL;
+		in += 8;
+		break;
+	    }
+	    if ((size_t) (end - in) < FIELD_ALIGN(4 + (size_t) len + 1) || in[4 + len])
+		return -1;
+	    f.f_value.v_string = in + 4;
+	    in += FIELD_ALIGN(4 + (size_t) len + 1);
+	    break;
+	default:
+	    return -1;
+	}
+
+	if (a_fields && (size_t) n < a_nfields)
+	    a_fields[n] = f;
+	n++;
+    }
+
+    return n;
+}
@@ -0,0 +1,193 @@
+/* $Id$
+ *
+ * field.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_field_h
+#define log4c_field_h
+
+/**
+ * @file field.h
+ *
+ * @brief typed key/value fields of a logging event.
+ *
+ * log4c_category_log_kv() attaches fields to an event without formatting
+ * them. The layouts which write text render them only when they are
+ * called, after the message, as " key=value" pairs; binary writers such
+ * as the binlog segments encode them as they are.
+ *
+ * @code
+ * log4c_field_t fields[3];
+ *
+ * fields[0] = log4c_field_string("user", user);
+ * fields[1] = log4c_field_uint("req", req);
+ * fields[2] = log4c_field_int("latency", latency);
+ * log4c_category_log_kv(cat, LOG4C_PRIORITY_INFO, "request done", fields, 3);
+ * @endcode
+ *
+ * The keys and strings are referenced, not copied: they must live until
+ * the call returns.
+ **/
+
+#include <stddef.h>
+#include <log4c/defs.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The types of the fields.
+ **/
+typedef enum {
+    LOG4C_FIELD_INT = 1,
+    LOG4C_FIELD_UINT,
+    LOG4C_FIELD_DOUBLE,
+    LOG4C_FIELD_BOOL,
+    LOG4C_FIELD_STRING
+} log4c_field_type_t;
+
+/**
+ * @brief a typed key/value pair
+ *
+ * @li @c f_key the key
+ * @li @c f_type the type of the value
+ * @li @c f_value the value, in the member of its type
+ **/
+typedef struct {
+    const char*	f_key;
+    int		f_type;
+    union {
+	long long		v_int;
+	unsigned long long	v_uint;
+	double			v_double;
+	int			v_bool;
+	const char*		v_string;
+    } f_value;
+} log4c_field_t;
+
+/**
+ * Makes a signed integer field.
+ **/
+static inline log4c_field_t log4c_field_int(const char* a_key, long long a_value)
+{
+    log4c_field_t f;
+
+    f.f_key = a_key;
+    f.f_type = LOG4C_FIELD_INT;
+    f.f_value.v_int = a_value;
+    return f;
+}
+
+/**
+ * Makes an unsigned integer field.
+ **/
+static inline log4c_field_t log4c_field_uint(const char* a_key,
+					     unsigned long long a_value)
+{
+    log4c_field_t f;
+
+    f.f_key = a_key;
+    f.f_type = LOG4C_FIELD_UINT;
+    f.f_value.v_uint = a_value;
+    return f;
+}
+
+/**
+ * Makes a floating point field.
+ **/
+static inline log4c_field_t log4c_field_double(const char* a_key, double a_value)
+{
+    log4c_field_t f;
+
+    f.f_key = a_key;
+    f.f_type = LOG4C_FIELD_DOUBLE;
+    f.f_value.v_double = a_value;
+    return f;
+}
+
+/**
+ * Makes a boolean field.
+ **/
+static inline log4c_field_t log4c_field_bool(const char* a_key, int a_value)
+{
+    log4c_field_t f;
+
+    f.f_key = a_key;
+    f.f_type = LOG4C_FIELD_BOOL;
+    f.f_value.v_bool = a_value != 0;
+    return f;
+}
+
+/**
+ * Makes a string field. The string may be NULL.
+ **/
+static inline log4c_field_t log4c_field_string(const char* a_key,
+					       const char* a_value)
+{
+    log4c_field_t f;
+
+    f.f_key = a_key;
+    f.f_type = LOG4C_FIELD_STRING;
+    f.f_value.v_string = a_value;
+    return f;
+}
+
+/**
+ * Renders fields as text, like snprintf(): " key=value" for each field.
+ * Strings which are empty or hold spaces, quotes, '=' or control
+ * characters are quoted, with '"' and '\\' escaped and control
+ * characters written as \\n, \\t or \\xHH.
+ *
+ * @param a_fields the fields
+ * @param a_nfields the number of fields
+ * @param a_buf the buffer to write to
+ * @param a_size the size of the buffer
+ * @returns the length of the text, which was truncated if it is not
+ * less than @a a_size
+ **/
+LOG4C_API int log4c_field_render(const log4c_field_t* a_fields, size_t a_nfields,
+				 char* a_buf, size_t a_size);
+
+/**
+ * The binary encoding of a field, in the byte order of the writer and
+ * aligned on 8 bytes: its type and the length of its key on 4 bytes
+ * each, then the characters of the key and a '\\0', padded to 8 bytes,
+ * then the value: 8 bytes for numbers and booleans, and for strings
+ * their length on 4 bytes, 0xffffffff for NULL, then their characters
+ * and a '\\0', padded to 8 bytes.
+ *
+ * @param a_fields the fields
+ * @param a_nfields the number of fields
+ * @returns the size of the encoded fields
+ **/
+LOG4C_API size_t log4c_field_encoded_size(const log4c_field_t* a_fields,
+					  size_t a_nfields);
+
+/**
+ * Encodes fields.
+ *
+ * @param a_fields the fields
+ * @param a_nfields the number of fields
+ * @param a_buf the buffer, of at least log4c_field_encoded_size() bytes
+ * and aligned on 8 bytes
+ * @returns the size of the encoded fields
+ **/
+LOG4C_API size_t log4c_field_encode(const log4c_field_t* a_fields,
+				    size_t a_nfields, void* a_buf);
+
+/**
+ * Decodes fields. The keys and strings point into @a a_data.
+ *
+ * @param a_data the encoded fields, aligned on 8 bytes
+ * @param a_size the size of the encoded fields
+ * @param a_fields the fields to fill, or NULL to count them
+ * @param a_nfields the number of fields @a a_fields can hold
+ * @returns the number of fields, or -1 if the data is corrupted
+ **/
+LOG4C_API int log4c_field_decode(const void* a_data, size_t a_size,
+				 log4c_field_t* a_fields, size_t a_nfields);
+
+__LOG4C_END_DECLS
+
+#endif
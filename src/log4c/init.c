@@ -18,19 +18,25 @@ static const char version[] = "$Id$";
 #include <log4c/rollingpolicy.h>
 #include <log4c/rc.h>
 #include <log4c/version.h>
+#include <log4c/stats.h>
+#include <log4c/binlog.h>
+#include <log4c/sigsafe.h>
 #include <sd/error.h>
 #include <sd/sprintf.h>
 #include <sd/factory.h>
 #include <sd/sd_xplatform.h>
 #include <sd/stringutil.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h> 
+#include "trace.h"
 
 #include "appender_type_stream.h"
 #include "appender_type_stream2.h"
 #include "appender_type_syslog.h"
 #include "appender_type_mmap.h"
+#include "appender_type_flightrecorder.h"
 #include "appender_type_rollingfile.h"
 #include "appender_type_socket.h"	/* JAN: added to use new socket appender */
 #include "rollingpolicy_type_sizewin.h"
@@ -40,6 +46,8 @@ static const char version[] = "$Id$";
 #include "layout_type_dated_r.h"
 #include "layout_type_null.h"		/* JAN: added new NULL layout */
 #include "layout_type_ISO8601.h" 	/* JAN: added new ISO 8601 layout type */
+#include "layout_type_json.h"
+#include "layout_type_pattern.h"
 
 #if defined(__LOG4C_DEBUG__) && defined(__GLIBC__)
 #include <mcheck.h>
@@ -58,6 +66,8 @@ static const log4c_layout_type_t * const layout_types[] = {
 #endif
 	,&log4c_layout_type_null	/* JAN: added new NULL layout */
 	,&log4c_layout_type_ISO8601	/* JAN: added new ISO 8601 layout */
+	,&log4c_layout_type_json
+	,&log4c_layout_type_pattern
 };
 static size_t nlayout_types = sizeof(layout_types) / sizeof(layout_types[0]);
 
@@ -76,6 +86,9 @@ static const log4c_appender_type_t * const appender_types[] = {
 	,&log4c_appender_type_socket
 	,&log4c_appender_type_file
 	,&log4c_appender_type_ansicolor
+#ifndef _WIN32
+	,&log4c_appender_type_flightrecorder
+#endif
 };
 static size_t nappender_types = sizeof(appender_types) / sizeof(appender_types[0]);
 
@@ -105,6 +118,26 @@ static const int nrcfiles = sizeof(rcfiles) / sizeof(rcfiles[0]);
 
 int reread_flag = 0;
 
+/*
+ * Loads a configuration file, from its binary image when there is an up to
+ * date one, see log4c_rc_compile().
+ */
+static int load_config_file(const char* a_name)
+{
+	char image[sizeof(((rcfile_t*) 0)->name) + sizeof(LOG4C_RC_IMAGE_SUFFIX)];
+
+	if (strlen(a_name) < sizeof(((rcfile_t*) 0)->name)) {
+		sprintf(image, "%s" LOG4C_RC_IMAGE_SUFFIX, a_name);
+		if (!SD_ACCESS_READ(image) && 
+		    log4c_rc_load_image(log4c_rc, image, a_name) == 0) {
+			sd_debug("loaded image %s", image);
+			return 0;
+		}
+	}
+
+	return log4c_rc_load(log4c_rc, a_name);
+}
+
 static int load_config_files(rcfile_t rcfiles[], int nrcfiles, int failonmissing)
 {
 	int ret = 0;
@@ -120,7 +153,7 @@ static int load_config_files(rcfile_t rcfiles[], int nrcfiles, int failonmissing
 		if (SD_STAT_CTIME(rcfiles[j].name,&rcfiles[j].ctime) != 0)
 			sd_error("sd_stat_ctime %s failed", rcfiles[j].name);
 		rcfiles[j].exists=1;
-		if (log4c_load(rcfiles[j].name) == -1) {
+		if (load_config_file(rcfiles[j].name) == -1) {
 			sd_error("loading %s failed", rcfiles[j].name);
 			ret = -1;
 		}
@@ -252,6 +285,7 @@ extern int log4c_init(void)
 void __log4c_reread(void)
 {
 	time_t file_ctime;
+	int ret;
 	int i;
 
 	for (i = 0; i < nrcfiles; i++){
@@ -261,7 +295,10 @@ void __log4c_reread(void)
 			if (file_ctime != rcfiles[i].ctime){
 				sd_debug("Need reread on file %s\n",rcfiles[i].name);
 				SD_STAT_CTIME(rcfiles[i].name,&rcfiles[i].ctime);
-				if (log4c_rc_load(log4c_rc, rcfiles[i].name) == -1){
+				LOG4C_TRACE1(reread_start, rcfiles[i].name);
+				ret = load_config_file(rcfiles[i].name);
+				LOG4C_TRACE2(reread_end, rcfiles[i].name, ret);
+				if (ret == -1){
 					sd_error("re-loading config file %s failed", rcfiles[i].name);
 				}
 				else
@@ -311,6 +348,10 @@ extern int log4c_fini(void)
 
 	log4c_is_init--;
 
+	/* drain the deferred messages while the appenders still exist */
+	log4c_binlog_stop();
+	log4c_sigsafe_drain();
+
 	sd_debug("cleaning up category, appender, layout and"
 		"rollingpolicy instances");
 	if (log4c_category_factory) {
@@ -322,6 +363,7 @@ extern int log4c_fini(void)
 		sd_factory_delete(log4c_appender_factory);
 		log4c_appender_factory = NULL;
 	}
+	__log4c_flightrecorder_cleanup();
 
 	if (log4c_layout_factory) {
 		sd_factory_delete(log4c_layout_factory);
@@ -333,6 +375,9 @@ extern int log4c_fini(void)
 		log4c_rollingpolicy_factory = NULL;
 	}
 
+	/* category ids are given again from 0 after a new init */
+	log4c_stats_reset();
+
 #ifdef __SD_DEBUG__
 	if( getenv("SD_DEBUG")){
 		sd_debug("Instance dump after cleanup:");
@@ -8,7 +8,12 @@ static const char version[] = "$Id$";
  * See the COPYING file for the terms of usage and distribution.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <log4c/layout.h>
+#include <log4c/category.h>
 #include <log4c/layout_type_basic.h>
 #include <log4c/layout_type_dated.h>
 #include <log4c/priority.h>
@@ -18,6 +23,7 @@ static const char version[] = "$Id$";
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "trace.h"
 
 struct __log4c_layout
 {
@@ -160,6 +166,7 @@ extern const log4c_layout_type_t* log4c_layout_set_type(
 
     previous = this->lo_type;
     this->lo_type = a_type;
+    __log4c_category_refresh_needs();
     return previous;
 }
 
@@ -187,6 +194,8 @@ extern const char* log4c_layout_format(
     const log4c_layout_t*		this, 
     const log4c_logging_event_t*a_event)
 {
+    const char* rendered;
+
     if (!this)
 	return NULL;
     
@@ -196,7 +205,12 @@ extern const char* log4c_layout_format(
     if (!this->lo_type->format)
 	return NULL;
 
-    return this->lo_type->format(this, a_event);
+    LOG4C_TRACE2(layout_format_start, this->lo_name, a_event->evt_category);
+    rendered = this->lo_type->format(this, a_event);
+    LOG4C_TRACE3(layout_format_end, this->lo_name, a_event->evt_category,
+		 rendered);
+
+    return rendered;
 }
 
 /*******************************************************************************/
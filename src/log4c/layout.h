@@ -42,10 +42,14 @@ typedef struct __log4c_layout log4c_layout_t;
  * 
  * @li @c name layout type name 
  * @li @c format 
+ * @li @c needs what the layout reads from the event, LOG4C_NEEDS_TIME,
+ * LOG4C_NEEDS_THREAD and LOG4C_NEEDS_CONTEXT, or LOG4C_NEEDS_NONE. 0 for
+ * everything.
  **/
 typedef struct log4c_layout_type {
     const char* name;
     const char* (*format) (const log4c_layout_t*, const log4c_logging_event_t*);
+    int needs;
 } log4c_layout_type_t;
 
 /**
@@ -71,6 +75,7 @@ LOG4C_API const log4c_layout_type_t* log4c_layout_type_get(const char* a_name);
  * const log4c_layout_type_t log4c_layout_type_xml = {
  *    "s13_xml",
  *    xml_format,
+ *    LOG4C_NEEDS_TIME,
  * };
  *  
  * log4c_layout_type_set(&log4c_layout_type_xml);
@@ -47,7 +47,7 @@ static const char* ISO8601_format(const log4c_layout_t * a_layout,
 		localtime_r(&tv.tv_sec, &tm);
 
 		res = snprintf(buffer, bufferSize,
-			"%04d-%02d-%02dT%02d:%02d:%02d.%03d %-8s %-60s:   %s\n",
+			"%04d-%02d-%02dT%02d:%02d:%02d.%03d %-8s %-60s:   %s",
 			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
 			tm.tm_hour, tm.tm_min, tm.tm_sec,
 			tv.tv_usec / 1000,
@@ -67,7 +67,7 @@ static const char* ISO8601_format(const log4c_layout_t * a_layout,
 		 *       terminated if the output was truncated.
 		 */
 		res = snprintf(buffer, bufferSize,
-			"%04d-%02d-%02dT%02d:%02d:%02d.%03ld %-8s %-60s:   %s\n",
+			"%04d-%02d-%02dT%02d:%02d:%02d.%03ld %-8s %-60s:   %s",
 			stime.wYear, stime.wMonth , stime.wDay,
 			stime.wHour, stime.wMinute, stime.wSecond,
 			stime.wMilliseconds,
@@ -75,6 +75,8 @@ static const char* ISO8601_format(const log4c_layout_t * a_layout,
 			a_event->evt_category, a_event->evt_msg);
 #endif
 
+		res = log4c_logging_event_end_line(a_event, buffer, bufferSize, res);
+
 		/* If the output was truncated ellipsize the message and line-terminate it */
 		if(res >= bufferSize)
 		{
@@ -97,4 +99,5 @@ static const char* ISO8601_format(const log4c_layout_t * a_layout,
 const log4c_layout_type_t log4c_layout_type_ISO8601 = {
     "ISO8601",
     ISO8601_format,
+    LOG4C_NEEDS_TIME,
 };
@@ -21,9 +21,11 @@ static const char* basic_format(
 {
     static char buffer[1024];
 
-    int res = snprintf(buffer, sizeof(buffer), "%-8s %s - %s\n",
+    int res = snprintf(buffer, sizeof(buffer), "%-8s %s - %s",
 	     log4c_priority_to_string(a_event->evt_priority),
 	     a_event->evt_category, a_event->evt_msg);
+
+    res = log4c_logging_event_end_line(a_event, buffer, sizeof(buffer), res);
     
 	/* If the output was truncated ellipsize the message and line-terminate it */
 	if(res >= sizeof(buffer))
@@ -42,4 +44,5 @@ static const char* basic_format(
 const log4c_layout_type_t log4c_layout_type_basic = {
     "basic",
     basic_format,
+    LOG4C_NEEDS_NONE,
 };
@@ -21,9 +21,11 @@ static const char* basic_r_format(
     int n, i;
 
     n = snprintf(a_event->evt_buffer.buf_data, a_event->evt_buffer.buf_size,
-		 "%-8s %s - %s\n",
+		 "%-8s %s - %s",
 		 log4c_priority_to_string(a_event->evt_priority),
 		 a_event->evt_category, a_event->evt_msg);
+    n = log4c_logging_event_end_line(a_event, a_event->evt_buffer.buf_data,
+				     a_event->evt_buffer.buf_size, n);
 
     if (n >= a_event->evt_buffer.buf_size) {
 	/*
@@ -41,4 +43,5 @@ static const char* basic_r_format(
 const log4c_layout_type_t log4c_layout_type_basic_r = {
     "basic_r",
     basic_r_format,
+    LOG4C_NEEDS_NONE,
 };
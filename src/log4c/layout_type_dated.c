@@ -36,7 +36,7 @@ static const char* dated_format(
 	localtime_r(&tv.tv_sec, &tm);
 
 	//gmtime_r(&a_event->evt_timestamp.tv_sec, &tm);
-    res = snprintf(buffer, sizeof(buffer), "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s- %s\n",
+    res = sd_snprintf(buffer, sizeof(buffer), "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s- %s",
              tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
              tm.tm_hour, tm.tm_min, tm.tm_sec,
              a_event->evt_timestamp.tv_usec / 1000,
@@ -51,7 +51,7 @@ static const char* dated_format(
 
 	if ( FileTimeToSystemTime(&fileTimeLocal, &stime)){
     //if ( FileTimeToSystemTime(&a_event->evt_timestamp, &stime)){
-    res = snprintf(buffer, sizeof(buffer), "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s- %s\n",
+    res = snprintf(buffer, sizeof(buffer), "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s- %s",
              stime.wYear, stime.wMonth , stime.wDay,
              stime.wHour, stime.wMinute, stime.wSecond,
              stime.wMilliseconds,
@@ -60,6 +60,8 @@ static const char* dated_format(
         }
 #endif
 
+	res = log4c_logging_event_end_line(a_event, buffer, sizeof(buffer), res);
+
 	/* If the output was truncated ellipsize the message and line-terminate it */
 	if(res >= sizeof(buffer))
 	{
@@ -77,4 +79,5 @@ static const char* dated_format(
 const log4c_layout_type_t log4c_layout_type_dated = {
     "dated",
     dated_format,
+    LOG4C_NEEDS_TIME,
 };
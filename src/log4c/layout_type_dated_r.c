@@ -38,13 +38,15 @@ static const char* dated_r_format(
     }
 #endif
 
-    n = snprintf(a_event->evt_buffer.buf_data, a_event->evt_buffer.buf_size,
-		 "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s - %s\n",
-		 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-		 tm.tm_hour, tm.tm_min, tm.tm_sec,
-		 a_event->evt_timestamp.tv_usec / 1000,
-		 log4c_priority_to_string(a_event->evt_priority),
-		 a_event->evt_category, a_event->evt_msg);
+    n = sd_snprintf(a_event->evt_buffer.buf_data, a_event->evt_buffer.buf_size,
+		    "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s - %s",
+		    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+		    tm.tm_hour, tm.tm_min, tm.tm_sec,
+		    a_event->evt_timestamp.tv_usec / 1000,
+		    log4c_priority_to_string(a_event->evt_priority),
+		    a_event->evt_category, a_event->evt_msg);
+    n = log4c_logging_event_end_line(a_event, a_event->evt_buffer.buf_data,
+				     a_event->evt_buffer.buf_size, n);
 
     if (n >= a_event->evt_buffer.buf_size) {
 	/*
@@ -62,4 +64,5 @@ static const char* dated_r_format(
 const log4c_layout_type_t log4c_layout_type_dated_r = {
     "dated_r",
     dated_r_format,
+    LOG4C_NEEDS_TIME,
 };
@@ -0,0 +1,288 @@
+static const char version[] = "$Id$";
+
+/*
+ * layout_type_json.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/layout.h>
+#include <log4c/layout_type_json.h>
+#include <log4c/priority.h>
+#include <sd/json.h>
+#include <sd/sprintf.h>
+#include <sd/malloc.h>
+#include <sd/error.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* the object being written; o_size leaves room for the '\0' */
+typedef struct {
+    char*	o_buf;
+    size_t	o_size;
+    size_t	o_len;
+} json_out_t;
+
+#define JSON_NOCUT		((size_t) -1)
+#define JSON_LITERAL(o, s)	json_chars(o, s, sizeof(s) - 1)
+
+#ifdef SD_TLS
+/* the date of the last second written by the thread */
+static SD_TLS time_t json_sec = (time_t) -1;
+static SD_TLS char json_date[24];
+#endif
+
+/*******************************************************************************/
+static int json_chars(json_out_t* this, const char* a_chars, size_t a_len)
+{
+    if (this->o_size - this->o_len < a_len)
+	return -1;
+
+    memcpy(this->o_buf + this->o_len, a_chars, a_len);
+    this->o_len += a_len;
+    return 0;
+}
+
+/*******************************************************************************/
+/* a quoted string, or as much of it as fits in a_room unless JSON_NOCUT */
+static int json_string(json_out_t* this, const char* a_string, size_t a_room)
+{
+    size_t len, room;
+
+    if (!a_string)
+	return JSON_LITERAL(this, "null");
+
+    if (JSON_LITERAL(this, "\"") == -1 || this->o_len == this->o_size)
+	return -1;
+
+    len  = strlen(a_string);
+    room = this->o_size - this->o_len - 1;
+    if (room > a_room)
+	room = a_room;
+    this->o_len += sd_json_escape(this->o_buf + this->o_len, room, a_string, &len);
+
+    if (a_room == JSON_NOCUT && a_string[len])
+	return -1;
+    return JSON_LITERAL(this, "\"");
+}
+
+/*******************************************************************************/
+static int json_timestamp(json_out_t* this, const log4c_logging_event_t* a_event)
+{
+    char buffer[40];
+    const char* date = buffer;
+    int n;
+
+#ifdef SD_TLS
+    if (a_event->evt_timestamp.tv_sec == json_sec)
+	date = json_date;
+    else
+#endif
+    {
+	struct tm tm;
+
+#ifndef _WIN32
+	gmtime_r(&a_event->evt_timestamp.tv_sec, &tm);
+#else
+	tm = *gmtime(&a_event->evt_timestamp.tv_sec);
+#endif
+	sd_snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d",
+		    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+		    tm.tm_hour, tm.tm_min, tm.tm_sec);
+#ifdef SD_TLS
+	memcpy(json_date, buffer, sizeof(json_date));
+	json_sec = a_event->evt_timestamp.tv_sec;
+#endif
+    }
+
+    if (json_chars(this, date, strlen(date)) == -1)
+	return -1;
+
+    n = sd_snprintf(buffer, sizeof(buffer), ".%06ldZ",
+		    (long) a_event->evt_timestamp.tv_usec);
+    return json_chars(this, buffer, n);
+}
+
+/*******************************************************************************/
+static int json_thread(json_out_t* this, const log4c_thread_t* a_thread)
+{
+    char number[24];
+    int n;
+
+    if (!a_thread)
+	return 0;
+
+    n = sd_snprintf(number, sizeof(number), "%lu", a_thread->th_id);
+    if (JSON_LITERAL(this, ",\"thread\":") == -1 ||
+	json_string(this, a_thread->th_name, JSON_NOCUT) == -1 ||
+	JSON_LITERAL(this, ",\"tid\":") == -1)
+	return -1;
+    return json_chars(this, number, n);
+}
+
+/*******************************************************************************/
+static int json_field(json_out_t* this, const log4c_field_t* a_field)
+{
+    char number[40];
+    int n;
+
+    if (json_string(this, a_field->f_key, JSON_NOCUT) == -1 ||
+	JSON_LITERAL(this, ":") == -1)
+	return -1;
+
+    switch (a_field->f_type) {
+    case LOG4C_FIELD_INT:
+	n = sd_snprintf(number, sizeof(number), "%lld", a_field->f_value.v_int);
+	return json_chars(this, number, n);
+    case LOG4C_FIELD_UINT:
+	n = sd_snprintf(number, sizeof(number), "%llu", a_field->f_value.v_uint);
+	return json_chars(this, number, n);
+    case LOG4C_FIELD_DOUBLE:
+	/* JSON has no infinities nor NaNs */
+	if (a_field->f_value.v_double - a_field->f_value.v_double != 0)
+	    return JSON_LITERAL(this, "null");
+	n = sd_snprintf(number, sizeof(number), "%.17g", a_field->f_value.v_double);
+	return json_chars(this, number, n);
+    case LOG4C_FIELD_BOOL:
+	return a_field->f_value.v_bool ? JSON_LITERAL(this, "true") :
+	    JSON_LITERAL(this, "false");
+    case LOG4C_FIELD_STRING:
+	return json_string(this, a_field->f_value.v_string, JSON_NOCUT);
+    }
+    return JSON_LITERAL(this, "null");
+}
+
+/*******************************************************************************/
+/* a member named in a_start holding the fields, unless there are none */
+static int json_fields(json_out_t* this, const char* a_start,
+		       const log4c_field_t* a_fields, size_t a_nfields)
+{
+    size_t i;
+
+    if (!a_nfields)
+	return 0;
+
+    if (json_chars(this, a_start, strlen(a_start)) == -1)
+	return -1;
+    for (i = 0; i < a_nfields; i++)
+	if ((i && JSON_LITERAL(this, ",") == -1) ||
+	    json_field(this, &a_fields[i]) == -1)
+	    return -1;
+    return JSON_LITERAL(this, "}");
+}
+
+/*******************************************************************************/
+/*
+ * Writes the object, the message cut to a_msgroom bytes unless
+ * JSON_NOCUT. Returns -1 if it does not fit.
+ */
+static int json_render(json_out_t* this, const log4c_logging_event_t* a_event,
+		       size_t a_msgroom, int a_fields)
+{
+    const log4c_location_info_t* loc = a_event->evt_loc;
+
+    this->o_len = 0;
+
+    if (JSON_LITERAL(this, "{\"timestamp\":\"") == -1 ||
+	json_timestamp(this, a_event) == -1 ||
+	JSON_LITERAL(this, "\",\"priority\":") == -1 ||
+	json_string(this, log4c_priority_to_string(a_event->evt_priority),
+		    JSON_NOCUT) == -1 ||
+	JSON_LITERAL(this, ",\"category\":") == -1 ||
+	json_string(this, a_event->evt_category, JSON_NOCUT) == -1 ||
+	json_thread(this, a_event->evt_thread) == -1 ||
+	(a_event->evt_ndc &&
+	 (JSON_LITERAL(this, ",\"ndc\":") == -1 ||
+	  json_string(this, a_event->evt_ndc, JSON_NOCUT) == -1)) ||
+	JSON_LITERAL(this, ",\"message\":") == -1 ||
+	json_string(this, a_event->evt_msg ? a_event->evt_msg : "",
+		    a_msgroom) == -1)
+	return -1;
+
+    if (loc && loc->loc_file) {
+	char number[16];
+	int n = sd_snprintf(number, sizeof(number), "%d", loc->loc_line);
+
+	if (JSON_LITERAL(this, ",\"file\":") == -1 ||
+	    json_string(this, loc->loc_file, JSON_NOCUT) == -1 ||
+	    JSON_LITERAL(this, ",\"line\":") == -1 ||
+	    json_chars(this, number, n) == -1)
+	    return -1;
+
+	if (loc->loc_function && strcmp(loc->loc_function, "(nil)") &&
+	    (JSON_LITERAL(this, ",\"function\":") == -1 ||
+	     json_string(this, loc->loc_function, JSON_NOCUT) == -1))
+	    return -1;
+    }
+
+    if (a_fields &&
+	(json_fields(this, ",\"mdc\":{", a_event->evt_mdc,
+		     a_event->evt_nmdc) == -1 ||
+	 json_fields(this, ",\"fields\":{", a_event->evt_fields,
+		     a_event->evt_nfields) == -1))
+	return -1;
+
+    if (a_msgroom != JSON_NOCUT && JSON_LITERAL(this, ",\"truncated\":true") == -1)
+	return -1;
+
+    if (JSON_LITERAL(this, "}\n") == -1)
+	return -1;
+
+    this->o_buf[this->o_len] = '\0';
+    return 0;
+}
+
+/*******************************************************************************/
+static const char* json_format(
+    const log4c_layout_t*	  	a_layout,
+    const log4c_logging_event_t*	a_event)
+{
+    /* the buffer of the event is ours to grow when it is not limited */
+    log4c_buffer_t* buffer = (log4c_buffer_t*) &a_event->evt_buffer;
+    json_out_t out;
+    int fields = 1;
+
+    if (!buffer->buf_maxsize && buffer->buf_size < LOG4C_BUFFER_SIZE_DEFAULT) {
+	buffer->buf_size = LOG4C_BUFFER_SIZE_DEFAULT;
+	buffer->buf_data = sd_realloc(buffer->buf_data, buffer->buf_size);
+    }
+    if (!buffer->buf_data || buffer->buf_size < 2)
+	return "";
+
+    for (;;) {
+	out.o_buf  = buffer->buf_data;
+	out.o_size = buffer->buf_size - 1;
+	if (json_render(&out, a_event, JSON_NOCUT, 1) == 0)
+	    return out.o_buf;
+	if (buffer->buf_maxsize)
+	    break;
+
+	buffer->buf_size *= 2;
+	buffer->buf_data = sd_realloc(buffer->buf_data, buffer->buf_size);
+    }
+
+    /* measure the object without the message, then fill the room left */
+    if (json_render(&out, a_event, 0, 1) == -1) {
+	fields = 0;
+	if (json_render(&out, a_event, 0, 0) == -1) {
+	    sd_error("json layout: event does not fit in %d bytes",
+		     (int) buffer->buf_size);
+	    return "";
+	}
+    }
+    json_render(&out, a_event, out.o_size - out.o_len, fields);
+    return out.o_buf;
+}
+
+/*******************************************************************************/
+const log4c_layout_type_t log4c_layout_type_json = {
+    "json",
+    json_format,
+    LOG4C_NEEDS_TIME | LOG4C_NEEDS_THREAD | LOG4C_NEEDS_CONTEXT,
+};
@@ -0,0 +1,44 @@
+/* $Id$
+ *
+ * layout_type_json.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_layout_type_json_h
+#define log4c_layout_type_json_h
+
+/**
+ * @file layout_type_json.h
+ *
+ * @brief Implements a JSON layout: one object per line.
+ *
+ * @code
+ * {"timestamp":"2024-01-02T03:04:05.678901Z","priority":"ERROR",
+ *  "category":"app.db","thread":"worker-1","tid":4242,"ndc":"checkout",
+ *  "message":"...","file":"db.c","line":42,"function":"db_open",
+ *  "mdc":{"request":"r-17"},"fields":{"user":"alice","rows":12}}
+ * @endcode
+ *
+ * The timestamp is in UTC. The thread is written when the event has
+ * one, see log4c_thread_t, the contexts of the thread when they are not
+ * empty, see context.h. The location is written when the event has
+ * one, the fields when it has some. Doubles which are not finite are
+ * written as null.
+ *
+ * The object is written in the buffer of the event. When the buffer is
+ * limited by the bufsize of the configuration and the object does not
+ * fit, the message is cut, the MDC and the fields are dropped if they do
+ * not fit either, and the object gets a "truncated":true member.
+ **/
+
+#include <log4c/defs.h>
+#include <log4c/layout.h>
+
+__LOG4C_BEGIN_DECLS
+
+extern const log4c_layout_type_t log4c_layout_type_json;
+
+__LOG4C_END_DECLS
+
+#endif
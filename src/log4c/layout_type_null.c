@@ -28,5 +28,6 @@ static const char* null_format(const log4c_layout_t * a_layout,
 const log4c_layout_type_t log4c_layout_type_null = {
     	"null",
     	null_format,
+    	LOG4C_NEEDS_NONE,
 };
 
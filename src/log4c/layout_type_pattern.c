@@ -0,0 +1,415 @@
+static const char version[] = "$Id$";
+
+/*
+ * layout_type_pattern.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/layout.h>
+#include <log4c/layout_type_pattern.h>
+#include <log4c/priority.h>
+#include <sd/sprintf.h>
+#include <sd/malloc.h>
+#include <sd/error.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PATTERN_DEFAULT		"%d{%Y%m%d %H:%M:%S}.%.3N %-8p %c - %m%K%n"
+#define PATTERN_DATE_DEFAULT	"%Y-%m-%d %H:%M:%S"
+#define PATTERN_CONVERSIONS	"cpmKXxFLMdNToqtin"
+
+/*
+ * A conversion, or a piece of text when pc_conv is 0. pc_arg and pc_len
+ * are the text or the argument in braces, which is also terminated by a
+ * '\0'.
+ */
+typedef struct {
+    int		pc_conv;
+    int		pc_left;
+    int		pc_min;
+    int		pc_max;
+    const char*	pc_arg;
+    size_t	pc_len;
+} pattern_conv_t;
+
+typedef struct {
+    char*		pt_strings;
+    size_t		pt_nconvs;
+    pattern_conv_t	pt_convs[1];
+} pattern_t;
+
+/* the line being written, continued like snprintf() */
+typedef struct {
+    char*	po_buf;
+    size_t	po_size;
+    size_t	po_len;
+} pattern_out_t;
+
+static pattern_t* pattern_default = NULL;
+
+#ifdef SD_TLS
+/* the date of the last second written by the thread, and its format */
+static SD_TLS time_t pattern_sec = (time_t) -1;
+static SD_TLS const char* pattern_datefmt;
+static SD_TLS char pattern_datebuf[64];
+static SD_TLS size_t pattern_datelen;
+#endif
+
+/*******************************************************************************/
+static pattern_t* pattern_new(const char* a_pattern)
+{
+    size_t len = strlen(a_pattern);
+    pattern_t* this = sd_calloc(1, sizeof(*this) + len * sizeof(pattern_conv_t));
+    char* s;
+
+    /* text and arguments point in a copy where the '%' and the closing
+       braces become '\0' */
+    this->pt_strings = memcpy(sd_malloc(len + 1), a_pattern, len + 1);
+
+    for (s = this->pt_strings; *s; ) {
+	pattern_conv_t* conv = &this->pt_convs[this->pt_nconvs++];
+
+	if (*s != '%' || s[1] == '%') {
+	    conv->pc_arg = s;
+	    if (*s == '%')
+		*s++ = '\0', conv->pc_arg = s++;
+	    while (*s && *s != '%')
+		s++;
+	    conv->pc_len = s - conv->pc_arg;
+	    continue;
+	}
+
+	*s++ = '\0';
+	conv->pc_max = -1;
+	if (*s == '-') {
+	    conv->pc_left = 1;
+	    s++;
+	}
+	while (*s >= '0' && *s <= '9')
+	    conv->pc_min = conv->pc_min * 10 + *s++ - '0';
+	if (*s == '.') {
+	    conv->pc_max = 0;
+	    for (s++; *s >= '0' && *s <= '9'; s++)
+		conv->pc_max = conv->pc_max * 10 + *s - '0';
+	}
+
+	if (!*s || !strchr(PATTERN_CONVERSIONS, *s)) {
+	    sd_error("pattern '%s': unknown conversion '%%%c'", a_pattern,
+		     *s ? *s : ' ');
+	    goto error;
+	}
+	conv->pc_conv = *s++;
+
+	if (*s == '{') {
+	    char* end = strchr(++s, '}');
+
+	    if (!end) {
+		sd_error("pattern '%s': unterminated '{'", a_pattern);
+		goto error;
+	    }
+	    *end = '\0';
+	    conv->pc_arg = s;
+	    conv->pc_len = end - s;
+	    s = end + 1;
+	}
+    }
+    return this;
+
+ error:
+    free(this->pt_strings);
+    free(this);
+    return NULL;
+}
+
+/*******************************************************************************/
+/* whether the lines of the pattern end with a %n or a newline */
+static int pattern_ends_line(const pattern_t* this)
+{
+    const pattern_conv_t* last;
+
+    if (!this->pt_nconvs)
+	return 0;
+    last = &this->pt_convs[this->pt_nconvs - 1];
+    if (last->pc_conv == 'n')
+	return 1;
+    return !last->pc_conv && last->pc_len && last->pc_arg[last->pc_len - 1] == '\n';
+}
+
+/*******************************************************************************/
+static void pattern_put(pattern_out_t* this, const char* a_s, size_t a_len)
+{
+    if (this->po_len < this->po_size) {
+	size_t room = this->po_size - this->po_len;
+
+	memcpy(this->po_buf + this->po_len, a_s, a_len < room ? a_len : room);
+    }
+    this->po_len += a_len;
+}
+
+/*******************************************************************************/
+static void pattern_pad(pattern_out_t* this, int a_n)
+{
+    static const char spaces[] = "                                ";
+
+    while (a_n > 0) {
+	int n = a_n < (int) sizeof(spaces) - 1 ? a_n : (int) sizeof(spaces) - 1;
+
+	pattern_put(this, spaces, n);
+	a_n -= n;
+    }
+}
+
+/*******************************************************************************/
+/* a string within the widths of the conversion */
+static void pattern_string(pattern_out_t* this, const pattern_conv_t* a_conv,
+			   const char* a_s, size_t a_len)
+{
+    if (a_conv->pc_max >= 0 && a_len > (size_t) a_conv->pc_max)
+	a_len = a_conv->pc_max;
+
+    if (!a_conv->pc_left)
+	pattern_pad(this, a_conv->pc_min - (int) a_len);
+    pattern_put(this, a_s, a_len);
+    if (a_conv->pc_left)
+	pattern_pad(this, a_conv->pc_min - (int) a_len);
+}
+
+/*******************************************************************************/
+static void pattern_fields(pattern_out_t* this, const log4c_field_t* a_fields,
+			   size_t a_nfields)
+{
+    this->po_len += log4c_field_render(a_fields, a_nfields,
+				       this->po_len < this->po_size ?
+				       this->po_buf + this->po_len : NULL,
+				       this->po_len < this->po_size ?
+				       this->po_size - this->po_len + 1 : 0);
+}
+
+/*******************************************************************************/
+static void pattern_date(pattern_out_t* this, const pattern_conv_t* a_conv,
+			 time_t a_sec)
+{
+    const char* format = a_conv->pc_arg ? a_conv->pc_arg : PATTERN_DATE_DEFAULT;
+    char buffer[64];
+    struct tm tm;
+    size_t n;
+
+#ifdef SD_TLS
+    if (a_sec == pattern_sec && format == pattern_datefmt) {
+	pattern_string(this, a_conv, pattern_datebuf, pattern_datelen);
+	return;
+    }
+#endif
+
+#ifndef _WIN32
+    gmtime_r(&a_sec, &tm);
+#else
+    tm = *gmtime(&a_sec);
+#endif
+    n = strftime(buffer, sizeof(buffer), format, &tm);
+
+#ifdef SD_TLS
+    memcpy(pattern_datebuf, buffer, n);
+    pattern_datelen = n;
+    pattern_datefmt = format;
+    pattern_sec	    = a_sec;
+#endif
+    pattern_string(this, a_conv, buffer, n);
+}
+
+/*******************************************************************************/
+static void pattern_render(const pattern_t* a_pattern, pattern_out_t* this,
+			   const log4c_logging_event_t* a_event)
+{
+    const log4c_location_info_t* loc = a_event->evt_loc;
+    size_t i;
+
+    this->po_len = 0;
+
+    for (i = 0; i < a_pattern->pt_nconvs; i++) {
+	const pattern_conv_t* conv = &a_pattern->pt_convs[i];
+	const char* s = NULL;
+	char number[32];
+	int n = -1;
+
+	switch (conv->pc_conv) {
+	case 0:
+	    pattern_put(this, conv->pc_arg, conv->pc_len);
+	    continue;
+	case 'c':
+	    s = a_event->evt_category;
+	    break;
+	case 'p':
+	    s = log4c_priority_to_string(a_event->evt_priority);
+	    break;
+	case 'm':
+	    s = a_event->evt_msg;
+	    break;
+	case 'K':
+	    pattern_fields(this, a_event->evt_fields, a_event->evt_nfields);
+	    continue;
+	case 'X':
+	    if (conv->pc_arg) {
+		size_t j;
+
+		s = "";
+		for (j = 0; j < a_event->evt_nmdc; j++)
+		    if (!strcmp(a_event->evt_mdc[j].f_key, conv->pc_arg)) {
+			s = a_event->evt_mdc[j].f_value.v_string;
+			break;
+		    }
+		break;
+	    }
+	    pattern_fields(this, a_event->evt_mdc, a_event->evt_nmdc);
+	    continue;
+	case 'x':
+	    s = a_event->evt_ndc ? a_event->evt_ndc : "";
+	    break;
+	case 'F':
+	    s = loc && loc->loc_file ? loc->loc_file : "?";
+	    break;
+	case 'L':
+	    if (loc && loc->loc_file)
+		n = sd_snprintf(number, sizeof(number), "%d", loc->loc_line);
+	    else
+		s = "?";
+	    break;
+	case 'M':
+	    s = loc && loc->loc_function && strcmp(loc->loc_function, "(nil)") ?
+		loc->loc_function : "?";
+	    break;
+	case 'd':
+	    pattern_date(this, conv,
+			 (time_t) (a_event->evt_realtime_ns / 1000000000));
+	    continue;
+	case 'N': {
+	    int digits = conv->pc_max >= 0 && conv->pc_max < 9 ? conv->pc_max : 9;
+	    unsigned long fraction = (unsigned long) (a_event->evt_realtime_ns % 1000000000);
+	    int j;
+
+	    if (!digits)
+		continue;
+	    for (j = digits; j < 9; j++)
+		fraction /= 10;
+	    n = sd_snprintf(number, sizeof(number), "%0*lu", digits, fraction);
+	    if (!conv->pc_left)
+		pattern_pad(this, conv->pc_min - n);
+	    pattern_put(this, number, n);
+	    if (conv->pc_left)
+		pattern_pad(this, conv->pc_min - n);
+	    continue;
+	}
+	case 'T':
+	    n = sd_snprintf(number, sizeof(number), "%llu", a_event->evt_realtime_ns);
+	    break;
+	case 'o':
+	    n = sd_snprintf(number, sizeof(number), "%llu", a_event->evt_monotonic_ns);
+	    break;
+	case 'q':
+	    n = sd_snprintf(number, sizeof(number), "%llu", a_event->evt_sequence);
+	    break;
+	case 't':
+	    s = a_event->evt_thread ? a_event->evt_thread->th_name : "?";
+	    break;
+	case 'i':
+	    if (a_event->evt_thread)
+		n = sd_snprintf(number, sizeof(number), "%lu",
+				a_event->evt_thread->th_id);
+	    else
+		s = "?";
+	    break;
+	case 'n':
+	    pattern_put(this, "\n", 1);
+	    continue;
+	}
+
+	if (n >= 0)
+	    pattern_string(this, conv, number, n);
+	else
+	    pattern_string(this, conv, s ? s : "(null)", s ? strlen(s) : 6);
+    }
+
+    if (this->po_len <= this->po_size)
+	this->po_buf[this->po_len] = '\0';
+}
+
+/*******************************************************************************/
+static const char* pattern_format(
+    const log4c_layout_t*	  	a_layout,
+    const log4c_logging_event_t*	a_event)
+{
+    /* the buffer of the event is ours to grow when it is not limited */
+    log4c_buffer_t* buffer = (log4c_buffer_t*) &a_event->evt_buffer;
+    const pattern_t* pattern = log4c_layout_get_udata(a_layout);
+    pattern_out_t out;
+
+    if (!pattern) {
+	pattern = SD_ATOMIC_LOAD_ACQUIRE(&pattern_default);
+	if (!pattern) {
+	    pattern_t* parsed = pattern_new(PATTERN_DEFAULT);
+
+	    if (SD_ATOMIC_CAS(&pattern_default, NULL, parsed))
+		pattern = parsed;
+	    else {
+		free(parsed->pt_strings);
+		free(parsed);
+		pattern = SD_ATOMIC_LOAD_ACQUIRE(&pattern_default);
+	    }
+	}
+    }
+
+    if (!buffer->buf_data || buffer->buf_size < 5)
+	return "";
+
+    out.po_buf  = buffer->buf_data;
+    out.po_size = buffer->buf_size - 1;
+    pattern_render(pattern, &out, a_event);
+
+    if (out.po_len <= out.po_size)
+	return out.po_buf;
+
+    if (!buffer->buf_maxsize) {
+	buffer->buf_size = out.po_len + 1;
+	buffer->buf_data = sd_realloc(buffer->buf_data, buffer->buf_size);
+
+	out.po_buf  = buffer->buf_data;
+	out.po_size = buffer->buf_size - 1;
+	pattern_render(pattern, &out, a_event);
+	return out.po_buf;
+    }
+
+    /* show that the line was cut, and keep its end of line */
+    if (pattern_ends_line(pattern))
+	memcpy(out.po_buf + out.po_size - 4, "...\n", 5);
+    else
+	memcpy(out.po_buf + out.po_size - 3, "...", 4);
+    return out.po_buf;
+}
+
+/*******************************************************************************/
+extern int log4c_layout_pattern_set(log4c_layout_t* a_layout,
+				    const char* a_pattern)
+{
+    pattern_t* pattern;
+
+    if (!a_layout || !a_pattern || (pattern = pattern_new(a_pattern)) == NULL)
+	return -1;
+
+    log4c_layout_set_udata(a_layout, pattern);
+    return 0;
+}
+
+/*******************************************************************************/
+const log4c_layout_type_t log4c_layout_type_pattern = {
+    "pattern",
+    pattern_format,
+    LOG4C_NEEDS_TIME | LOG4C_NEEDS_THREAD | LOG4C_NEEDS_CONTEXT,
+};
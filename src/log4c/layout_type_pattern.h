@@ -0,0 +1,76 @@
+/* $Id$
+ *
+ * layout_type_pattern.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_layout_type_pattern_h
+#define log4c_layout_type_pattern_h
+
+/**
+ * @file layout_type_pattern.h
+ *
+ * @brief Implements a layout which writes events after a pattern, in
+ * the manner of the PatternLayout of log4j.
+ *
+ * The pattern is text with conversions, each made of a '%', an optional
+ * '-' to pad on the right, an optional minimum width, an optional '.'
+ * and maximum width, then one of:
+ *
+ * @li @c c the category
+ * @li @c p the priority
+ * @li @c m the message
+ * @li @c K the key/value fields, each as " key=value"
+ * @li @c X the value of the key of the MDC in the braces which follow,
+ * %X{request}, or without braces the whole MDC like the fields
+ * @li @c x the NDC
+ * @li @c F @c L @c M the file, line and function of the call, "?" when
+ * they are unknown
+ * @li @c d the date in UTC, formatted by strftime() after the format in
+ * the braces which follow, "%Y-%m-%d %H:%M:%S" without: %d{%H:%M:%S}
+ * @li @c N the fraction of the second, to as many digits as the maximum
+ * width gives, 9 by default: %.3N for milliseconds
+ * @li @c T the time in nanoseconds since the epoch
+ * @li @c o the monotonic time in nanoseconds
+ * @li @c q the sequence number of the event in its thread
+ * @li @c t @c i the name and the id of the thread, see log4c_thread_t
+ * @li @c n a newline
+ * @li @c % a '%'
+ *
+ * The default pattern, "%d{%Y%m%d %H:%M:%S}.%.3N %-8p %c - %m%K%n",
+ * writes what the dated_r layout does. The pattern of a layout is set
+ * with log4c_layout_pattern_set() or by the "pattern" attribute of its
+ * element in log4crc:
+ * @code
+ * <layout name="precise" type="pattern" pattern="%d.%N %o %q %p %c %m%n"/>
+ * @endcode
+ *
+ * The line is cut and ends with "..." when it does not fit in a buffer
+ * limited by the bufsize of the configuration, followed by a newline when
+ * the pattern ends with one.
+ **/
+
+#include <log4c/defs.h>
+#include <log4c/layout.h>
+
+__LOG4C_BEGIN_DECLS
+
+extern const log4c_layout_type_t log4c_layout_type_pattern;
+
+/**
+ * Sets the pattern of a layout of type pattern. The pattern it
+ * replaces is not freed, since another thread may be formatting an
+ * event with it.
+ *
+ * @param a_layout the layout
+ * @param a_pattern the pattern
+ * @returns 0 or -1 if the pattern has an unknown conversion or an
+ * unterminated brace, in which case the layout keeps its pattern
+ **/
+LOG4C_API int log4c_layout_pattern_set(log4c_layout_t* a_layout,
+				       const char* a_pattern);
+
+__LOG4C_END_DECLS
+
+#endif
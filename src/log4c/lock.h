@@ -0,0 +1,63 @@
+/* $Id$
+ *
+ * lock.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_lock_h
+#define log4c_lock_h
+
+/**
+ * @file lock.h
+ *
+ * @brief profiled locking of the internal mutexes of appenders.
+ *
+ * Each lock belongs to a site, which adds up the counters of all its
+ * locks. When lock profiling is enabled, __log4c_lock() measures the wait
+ * and returns the time the lock was acquired, which is handed back to
+ * __log4c_unlock() to measure the hold time. When it is disabled they
+ * are plain pthread calls.
+ **/
+
+#include <pthread.h>
+#include <log4c/defs.h>
+#include <log4c/stats.h>
+
+__LOG4C_BEGIN_DECLS
+
+typedef struct {
+    const char*		site_name;
+    log4c_lock_stats_t	site_stats;
+} log4c_lock_site_t;
+
+LOG4C_DATA log4c_lock_site_t __log4c_lock_site_rollingfile;
+LOG4C_DATA log4c_lock_site_t __log4c_lock_site_file;
+LOG4C_DATA log4c_lock_site_t __log4c_lock_site_ansicolor;
+
+/**
+ * Locks a mutex.
+ *
+ * @param a_site the site of the mutex
+ * @param a_mutex the mutex
+ * @param a_acquired where to store the time the lock was acquired, 0 when
+ * not profiling
+ * @returns the return code of pthread_mutex_lock()
+ **/
+LOG4C_API int __log4c_lock(log4c_lock_site_t* a_site, pthread_mutex_t* a_mutex,
+			   unsigned long long* a_acquired);
+
+/**
+ * Unlocks a mutex.
+ *
+ * @param a_site the site of the mutex
+ * @param a_mutex the mutex
+ * @param a_acquired the time returned by __log4c_lock()
+ * @returns the return code of pthread_mutex_unlock()
+ **/
+LOG4C_API int __log4c_unlock(log4c_lock_site_t* a_site, pthread_mutex_t* a_mutex,
+			     unsigned long long a_acquired);
+
+__LOG4C_END_DECLS
+
+#endif
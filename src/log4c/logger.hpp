@@ -0,0 +1,573 @@
+/* $Id$
+ *
+ * logger.hpp
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_logger_hpp
+#define log4c_logger_hpp
+
+/**
+ * @file logger.hpp
+ *
+ * @brief type safe C++17 front end.
+ *
+ * log4c::logger wraps a log4c_category_t. Its methods take a format made
+ * with LOG4C_FMT() and the arguments as they are, with no va_list:
+ *
+ * @code
+ * log4c::logger log("app.db");
+ *
+ * log.info(LOG4C_FMT("%s: %d rows in %.3f s"), table, rows, seconds);
+ * @endcode
+ *
+ * LOG4C_FMT() turns a string literal into a compile time constant, which
+ * lets the methods check at compile time that the arguments agree with
+ * the conversions of the format: integers for @c %d @c %i @c %u @c %o
+ * @c %x @c %X @c %c and the '*' widths and precisions, floating point
+ * numbers for @c %f @c %e @c %g @c %a, <tt>const char*</tt>,
+ * <tt>std::string</tt> and <tt>std::string_view</tt> for @c %s, pointers
+ * for @c %p. A format which does not agree does not compile.
+ *
+ * Length modifiers are accepted and ignored: integers are printed with
+ * their own type, as signed ones by @c %d and @c %i, as unsigned ones by
+ * the others. @c %n and positional arguments are not supported.
+ *
+ * The message is written in a buffer on the stack, which grows on the
+ * heap for long messages. Conversions without flags, width nor precision
+ * of integers and strings are written directly, strings of a
+ * std::string_view without looking for their end, the others with
+ * snprintf(). The file and line of LOG4C_FMT() are the location of the
+ * event.
+ **/
+
+#if !defined(__cplusplus) || __cplusplus < 201703L
+#error "log4c/logger.hpp needs C++17"
+#endif
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <log4c/category.h>
+
+/**
+ * Makes a format for the methods of log4c::logger.
+ *
+ * @param a_format a string literal
+ **/
+#define LOG4C_FMT(a_format) \
+    [] () constexpr { \
+	return ::log4c::detail::format_t{ std::string_view(a_format), \
+					  __FILE__, __LINE__ }; \
+    }
+
+namespace log4c {
+
+namespace detail {
+
+struct format_t {
+    std::string_view	text;
+    const char*		file;
+    int			line;
+};
+
+enum arg_kind {
+    ARG_INTEGER,
+    ARG_FLOATING,
+    ARG_CSTRING,
+    ARG_STRING,
+    ARG_POINTER,
+    ARG_OTHER
+};
+
+enum format_check {
+    FORMAT_OK,
+    FORMAT_TOO_FEW,
+    FORMAT_TOO_MANY,
+    FORMAT_BAD_TYPE,
+    FORMAT_UNSUPPORTED
+};
+
+template<class T>
+constexpr arg_kind kind_of()
+{
+    using U = std::decay_t<T>;
+
+    if constexpr (std::is_integral_v<U>)
+	return ARG_INTEGER;
+    else if constexpr (std::is_floating_point_v<U>)
+	return ARG_FLOATING;
+    else if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, const char*>)
+	return ARG_CSTRING;
+    else if constexpr (std::is_same_v<U, std::string> ||
+		       std::is_same_v<U, std::string_view>)
+	return ARG_STRING;
+    else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>)
+	return ARG_POINTER;
+    else
+	return ARG_OTHER;
+}
+
+/*
+ * A conversion of a format: the text from its '%' to the length
+ * modifier, then the conversion character. Widths and precisions are -1
+ * when absent and -2 when given by an argument.
+ */
+struct spec_t {
+    std::size_t	begin;
+    std::size_t	modifier;
+    std::size_t	end;
+    int		width;
+    int		prec;
+    int		nstars;
+    bool	plain;
+    char	conv;
+};
+
+constexpr spec_t parse_spec(std::string_view a_fmt, std::size_t a_pos)
+{
+    spec_t spec{ a_pos, 0, 0, -1, -1, 0, true, 0 };
+    std::size_t i = a_pos + 1;
+
+    while (i < a_fmt.size() && (a_fmt[i] == '-' || a_fmt[i] == '+' ||
+				a_fmt[i] == ' ' || a_fmt[i] == '#' ||
+				a_fmt[i] == '0')) {
+	spec.plain = false;
+	i++;
+    }
+
+    if (i < a_fmt.size() && a_fmt[i] == '*') {
+	spec.width = -2;
+	spec.nstars++;
+	i++;
+    } else
+	for (; i < a_fmt.size() && a_fmt[i] >= '0' && a_fmt[i] <= '9'; i++)
+	    spec.width = (spec.width < 0 ? 0 : spec.width * 10) + (a_fmt[i] - '0');
+
+    if (i < a_fmt.size() && a_fmt[i] == '.') {
+	spec.prec = 0;
+	if (++i < a_fmt.size() && a_fmt[i] == '*') {
+	    spec.prec = -2;
+	    spec.nstars++;
+	    i++;
+	} else
+	    for (; i < a_fmt.size() && a_fmt[i] >= '0' && a_fmt[i] <= '9'; i++)
+		spec.prec = spec.prec * 10 + (a_fmt[i] - '0');
+    }
+    if (spec.width != -1 || spec.prec != -1)
+	spec.plain = false;
+
+    spec.modifier = i;
+    while (i < a_fmt.size() && (a_fmt[i] == 'h' || a_fmt[i] == 'l' ||
+				a_fmt[i] == 'L' || a_fmt[i] == 'j' ||
+				a_fmt[i] == 'z' || a_fmt[i] == 't'))
+	i++;
+
+    spec.conv = i < a_fmt.size() ? a_fmt[i] : 0;
+    spec.end  = i < a_fmt.size() ? i + 1 : i;
+    return spec;
+}
+
+/* the position of the next conversion, "%%" skipped */
+constexpr std::size_t find_spec(std::string_view a_fmt, std::size_t a_pos)
+{
+    while ((a_pos = a_fmt.find('%', a_pos)) != std::string_view::npos) {
+	if (a_pos + 1 >= a_fmt.size() || a_fmt[a_pos + 1] != '%')
+	    return a_pos;
+	a_pos += 2;
+    }
+    return a_pos;
+}
+
+constexpr bool accepts(char a_conv, arg_kind a_kind)
+{
+    switch (a_conv) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+	return a_kind == ARG_INTEGER;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+	return a_kind == ARG_FLOATING;
+    case 's':
+	return a_kind == ARG_CSTRING || a_kind == ARG_STRING;
+    case 'p':
+	return a_kind == ARG_CSTRING || a_kind == ARG_POINTER;
+    }
+    return false;
+}
+
+template<class... A>
+constexpr format_check check_format(std::string_view a_fmt)
+{
+    constexpr arg_kind kinds[] = { kind_of<A>()..., ARG_OTHER };
+    std::size_t nargs = 0;
+    std::size_t pos = 0;
+
+    while ((pos = find_spec(a_fmt, pos)) != std::string_view::npos) {
+	spec_t spec = parse_spec(a_fmt, pos);
+
+	if (!accepts(spec.conv, ARG_INTEGER) && !accepts(spec.conv, ARG_FLOATING) &&
+	    !accepts(spec.conv, ARG_STRING) && !accepts(spec.conv, ARG_POINTER))
+	    return FORMAT_UNSUPPORTED;
+
+	for (int i = 0; i <= spec.nstars; i++) {
+	    if (nargs >= sizeof...(A))
+		return FORMAT_TOO_FEW;
+	    if (!accepts(i < spec.nstars ? 'd' : spec.conv, kinds[nargs++]))
+		return FORMAT_BAD_TYPE;
+	}
+	pos = spec.end;
+    }
+
+    return nargs == sizeof...(A) ? FORMAT_OK : FORMAT_TOO_MANY;
+}
+
+/*
+ * The message: on the stack, then on the heap when it grows beyond.
+ */
+class buffer {
+public:
+    buffer() noexcept : m_data(m_local), m_size(0), m_capacity(sizeof(m_local)) {}
+    buffer(const buffer&) = delete;
+    buffer& operator=(const buffer&) = delete;
+
+    const char* c_str() noexcept { m_data[m_size] = '\0'; return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+
+    /* room for a_len more characters and the '\0' */
+    char* reserve(std::size_t a_len)
+    {
+	if (m_size + a_len >= m_capacity) {
+	    std::size_t capacity = 2 * m_capacity;
+
+	    if (capacity <= m_size + a_len)
+		capacity = m_size + a_len + 1;
+
+	    std::unique_ptr<char[]> heap(new char[capacity]);
+	    std::memcpy(heap.get(), m_data, m_size);
+	    m_heap = std::move(heap);
+	    m_data = m_heap.get();
+	    m_capacity = capacity;
+	}
+	return m_data + m_size;
+    }
+
+    void append(const char* a_chars, std::size_t a_len)
+    {
+	std::memcpy(reserve(a_len), a_chars, a_len);
+	m_size += a_len;
+    }
+
+    template<class U>
+    void append_decimal(U a_value)
+    {
+	char digits[24];
+	char* p = digits + sizeof(digits);
+	bool negative = false;
+	std::make_unsigned_t<U> v = static_cast<std::make_unsigned_t<U>>(a_value);
+
+	if constexpr (std::is_signed_v<U>) {
+	    if (a_value < 0) {
+		negative = true;
+		v = static_cast<std::make_unsigned_t<U>>(0) - v;
+	    }
+	}
+	do {
+	    *--p = static_cast<char>('0' + v % 10);
+	} while (v /= 10);
+	if (negative)
+	    *--p = '-';
+	append(p, digits + sizeof(digits) - p);
+    }
+
+    template<class... A>
+    void print(const char* a_spec, A... a_args)
+    {
+	int n = std::snprintf(reserve(0), m_capacity - m_size, a_spec, a_args...);
+
+	if (n < 0)
+	    return;
+	if (static_cast<std::size_t>(n) >= m_capacity - m_size)
+	    std::snprintf(reserve(n), m_capacity - m_size, a_spec, a_args...);
+	m_size += n;
+    }
+
+private:
+    char			m_local[512];
+    std::unique_ptr<char[]>	m_heap;
+    char*			m_data;
+    std::size_t			m_size;
+    std::size_t			m_capacity;
+};
+
+/*
+ * Formats the arguments one at a time, following the format.
+ */
+class formatter {
+public:
+    formatter(buffer& a_buffer, std::string_view a_fmt) noexcept :
+	m_buffer(a_buffer), m_fmt(a_fmt), m_pos(0), m_spec(), m_nstars(0),
+	m_in_spec(false) {}
+
+    template<class T>
+    void operator()(const T& a_arg)
+    {
+	if (!m_in_spec) {
+	    next_spec();
+	    m_in_spec = true;
+	    m_nstars = 0;
+	}
+
+	if (m_nstars < m_spec.nstars) {
+	    if constexpr (std::is_integral_v<T>)
+		m_stars[m_nstars++] = static_cast<int>(a_arg);
+	    return;
+	}
+
+	format(a_arg);
+	m_in_spec = false;
+    }
+
+    /* the text after the last conversion */
+    void finish() { next_spec(); }
+
+private:
+    /* appends the text up to the next conversion, "%%" unescaped */
+    void next_spec()
+    {
+	while (m_pos < m_fmt.size()) {
+	    std::size_t percent = m_fmt.find('%', m_pos);
+
+	    if (percent == std::string_view::npos)
+		percent = m_fmt.size();
+	    m_buffer.append(m_fmt.data() + m_pos, percent - m_pos);
+	    m_pos = percent;
+	    if (percent == m_fmt.size())
+		return;
+
+	    if (percent + 1 < m_fmt.size() && m_fmt[percent + 1] == '%') {
+		m_buffer.append("%", 1);
+		m_pos += 2;
+		continue;
+	    }
+
+	    m_spec = parse_spec(m_fmt, percent);
+	    m_pos = m_spec.end;
+	    return;
+	}
+    }
+
+    /* the conversion with the length modifier replaced */
+    std::string spec(const char* a_modifier) const
+    {
+	std::string s(m_fmt.data() + m_spec.begin, m_spec.modifier - m_spec.begin);
+
+	s += a_modifier;
+	s += m_spec.conv;
+	return s;
+    }
+
+    template<class... A>
+    void print(const std::string& a_spec, A... a_args)
+    {
+	switch (m_nstars) {
+	case 0: m_buffer.print(a_spec.c_str(), a_args...); break;
+	case 1: m_buffer.print(a_spec.c_str(), m_stars[0], a_args...); break;
+	default: m_buffer.print(a_spec.c_str(), m_stars[0], m_stars[1], a_args...); break;
+	}
+    }
+
+    template<class T>
+    void format(const T& a_arg)
+    {
+	using U = std::decay_t<T>;
+	constexpr arg_kind kind = kind_of<T>();
+
+	if constexpr (kind == ARG_INTEGER) {
+	    using I = std::conditional_t<std::is_same_v<U, bool>, int, U>;
+	    I v = static_cast<I>(a_arg);
+
+	    if (m_spec.conv == 'c')
+		print(spec(""), static_cast<int>(v));
+	    else if (m_spec.conv == 'd' || m_spec.conv == 'i') {
+		if (m_spec.plain)
+		    m_buffer.append_decimal(static_cast<std::make_signed_t<I>>(v));
+		else
+		    print(spec("ll"), static_cast<long long>(
+			      static_cast<std::make_signed_t<I>>(v)));
+	    } else {
+		if (m_spec.plain && m_spec.conv == 'u')
+		    m_buffer.append_decimal(static_cast<std::make_unsigned_t<I>>(v));
+		else
+		    print(spec("ll"), static_cast<unsigned long long>(
+			      static_cast<std::make_unsigned_t<I>>(v)));
+	    }
+	} else if constexpr (kind == ARG_FLOATING) {
+	    if constexpr (std::is_same_v<U, long double>)
+		print(spec("L"), a_arg);
+	    else
+		print(spec(""), static_cast<double>(a_arg));
+	} else if constexpr (kind == ARG_CSTRING) {
+	    const char* s = a_arg;
+
+	    if (m_spec.conv == 'p')
+		print(spec(""), static_cast<const void*>(s));
+	    else if (m_spec.plain && s)
+		m_buffer.append(s, std::strlen(s));
+	    else
+		print(spec(""), s);
+	} else if constexpr (kind == ARG_STRING) {
+	    std::string_view s(a_arg);
+
+	    if (m_spec.plain)
+		m_buffer.append(s.data(), s.size());
+	    else {
+		/* the precision bounds the length, which is passed as one */
+		std::string sp(m_fmt.data() + m_spec.begin,
+			       m_fmt.find('.', m_spec.begin) < m_spec.modifier ?
+			       m_fmt.find('.', m_spec.begin) - m_spec.begin :
+			       m_spec.modifier - m_spec.begin);
+		std::size_t len = s.size();
+		/* the precision star is the last one */
+		int prec = m_spec.prec == -2 && m_nstars > 0 ?
+		    m_stars[m_nstars - 1] : m_spec.prec;
+
+		if (prec >= 0 && static_cast<std::size_t>(prec) < len)
+		    len = prec;
+		sp += ".*s";
+		if (m_spec.width == -2)
+		    m_buffer.print(sp.c_str(), m_stars[0], static_cast<int>(len), s.data());
+		else
+		    m_buffer.print(sp.c_str(), static_cast<int>(len), s.data());
+	    }
+	} else if constexpr (kind == ARG_POINTER)
+	    print(spec(""), static_cast<const void*>(a_arg));
+    }
+
+    buffer&		m_buffer;
+    std::string_view	m_fmt;
+    std::size_t		m_pos;
+    spec_t		m_spec;
+    int			m_stars[2];
+    int			m_nstars;
+    bool		m_in_spec;
+};
+
+template<class... A>
+void log(const log4c_category_t* a_category, int a_priority,
+	 const format_t& a_format, const A&... a_args)
+{
+    const log4c_location_info_t locinfo = { a_format.file, a_format.line,
+					    NULL, NULL };
+    buffer message;
+    formatter f(message, a_format.text);
+
+    (f(a_args), ...);
+    f.finish();
+
+    __log4c_category_log_message(a_category, &locinfo, a_priority,
+				 message.c_str(), message.size());
+}
+
+} /* namespace detail */
+
+/**
+ * @brief a category, with type safe logging methods
+ **/
+class logger {
+public:
+    /**
+     * Wraps the category @a a_name, created if it does not exist.
+     **/
+    explicit logger(const char* a_name) : m_category(log4c_category_get(a_name)) {}
+
+    /**
+     * Wraps a category.
+     **/
+    explicit logger(log4c_category_t* a_category) noexcept : m_category(a_category) {}
+
+    /**
+     * @returns the wrapped category
+     **/
+    log4c_category_t* category() const noexcept { return m_category; }
+
+    /**
+     * @returns whether the priority @a a_priority is enabled
+     **/
+    bool is_enabled(int a_priority) const noexcept
+    {
+	return log4c_category_is_priority_enabled(m_category, a_priority);
+    }
+
+    /**
+     * Logs a message with the specified priority.
+     *
+     * @param a_priority the priority of the message
+     * @param a_format the format, made with LOG4C_FMT()
+     * @param a_args the arguments of the format
+     **/
+    template<class F, class... A>
+    void log(int a_priority, F a_format, const A&... a_args) const
+    {
+	constexpr detail::format_t format = a_format();
+	constexpr detail::format_check check = detail::check_format<A...>(format.text);
+
+	static_assert(check != detail::FORMAT_TOO_FEW,
+		      "log4c: too few arguments for the format");
+	static_assert(check != detail::FORMAT_TOO_MANY,
+		      "log4c: too many arguments for the format");
+	static_assert(check != detail::FORMAT_BAD_TYPE,
+		      "log4c: an argument does not match its conversion");
+	static_assert(check != detail::FORMAT_UNSUPPORTED,
+		      "log4c: the format has an unsupported conversion");
+
+	if (is_enabled(a_priority))
+	    detail::log(m_category, a_priority, format, a_args...);
+    }
+
+    template<class F, class... A>
+    void fatal(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_FATAL, a_format, a_args...); }
+
+    template<class F, class... A>
+    void alert(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_ALERT, a_format, a_args...); }
+
+    template<class F, class... A>
+    void crit(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_CRIT, a_format, a_args...); }
+
+    template<class F, class... A>
+    void error(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_ERROR, a_format, a_args...); }
+
+    template<class F, class... A>
+    void warn(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_WARN, a_format, a_args...); }
+
+    template<class F, class... A>
+    void notice(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_NOTICE, a_format, a_args...); }
+
+    template<class F, class... A>
+    void info(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_INFO, a_format, a_args...); }
+
+    template<class F, class... A>
+    void debug(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_DEBUG, a_format, a_args...); }
+
+    template<class F, class... A>
+    void trace(F a_format, const A&... a_args) const
+    { log(LOG4C_PRIORITY_TRACE, a_format, a_args...); }
+
+private:
+    log4c_category_t*	m_category;
+};
+
+} /* namespace log4c */
+
+#endif
@@ -8,12 +8,33 @@ static const char version[] = "$Id$";
  * See the COPYING file for the terms of usage and distribution.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <log4c/logging_event.h>
 #include <log4c/category.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sd/malloc.h>
+#include <sd/clock.h>
 #include <sd/sd_xplatform.h>
 
+#if !defined(SD_TLS) && defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define EVENT_PTHREADS
+
+/* the sequence of the thread, allocated when it first logs */
+static pthread_once_t event_once = PTHREAD_ONCE_INIT;
+static pthread_key_t event_key;
+
+/*******************************************************************************/
+static void event_key_create(void)
+{
+    pthread_key_create(&event_key, free);
+}
+#endif
+
 /*******************************************************************************/
 extern log4c_logging_event_t* log4c_logging_event_new(
     const char* a_category,
@@ -27,7 +48,7 @@ extern log4c_logging_event_t* log4c_logging_event_new(
     evt->evt_priority	= a_priority;
     evt->evt_msg	= a_message;
     
-    SD_GETTIMEOFDAY(&evt->evt_timestamp, NULL);
+    __log4c_logging_event_stamp(evt, LOG4C_NEEDS_ALL);
 
     return evt;
 }
@@ -41,3 +62,101 @@ extern void log4c_logging_event_delete(log4c_logging_event_t* this)
     free(this);
 }
 
+
+/*******************************************************************************/
+extern void log4c_logging_event_set_time(log4c_logging_event_t* this,
+					 unsigned long long a_realtime,
+					 unsigned long long a_monotonic)
+{
+    this->evt_realtime_ns  = a_realtime;
+    this->evt_monotonic_ns = a_monotonic;
+#ifndef _WIN32
+    this->evt_timestamp.tv_sec  = (time_t) (a_realtime / 1000000000);
+    this->evt_timestamp.tv_usec = (long) (a_realtime % 1000000000 / 1000);
+#else
+    {
+	/* in 100ns since 1601 */
+	unsigned long long ft = a_realtime / 100 + 116444736000000000ULL;
+
+	this->evt_timestamp.dwLowDateTime  = (DWORD) ft;
+	this->evt_timestamp.dwHighDateTime = (DWORD) (ft >> 32);
+    }
+#endif
+}
+
+/*******************************************************************************/
+extern void __log4c_logging_event_stamp(log4c_logging_event_t* this,
+					int a_needs)
+{
+#ifdef SD_TLS
+    static SD_TLS unsigned long long sequence;
+
+    this->evt_sequence = ++sequence;
+#elif defined(EVENT_PTHREADS)
+    unsigned long long* sequence;
+
+    pthread_once(&event_once, event_key_create);
+    if ((sequence = pthread_getspecific(event_key)) == NULL) {
+	sequence = sd_calloc(1, sizeof(*sequence));
+	pthread_setspecific(event_key, sequence);
+    }
+    this->evt_sequence = ++*sequence;
+#else
+    this->evt_sequence = 0;
+#endif
+
+    if (a_needs & LOG4C_NEEDS_TIME) {
+	sd_clock_time_t now;
+
+	sd_clock_read(&now);
+	log4c_logging_event_set_time(this, now.ct_realtime, now.ct_monotonic);
+    }
+    else {
+	memset(&this->evt_timestamp, 0, sizeof(this->evt_timestamp));
+	this->evt_realtime_ns  = 0;
+	this->evt_monotonic_ns = 0;
+    }
+
+    this->evt_thread = (a_needs & LOG4C_NEEDS_THREAD) ? log4c_thread_get() : NULL;
+
+    if (a_needs & LOG4C_NEEDS_CONTEXT)
+	__log4c_context_get(&this->evt_mdc, &this->evt_nmdc, &this->evt_ndc);
+    else {
+	this->evt_mdc  = NULL;
+	this->evt_nmdc = 0;
+	this->evt_ndc  = NULL;
+    }
+}
+
+/*******************************************************************************/
+extern int log4c_logging_event_compare(const log4c_logging_event_t* a_a,
+				       const log4c_logging_event_t* a_b)
+{
+    if (a_a->evt_monotonic_ns != a_b->evt_monotonic_ns)
+	return a_a->evt_monotonic_ns < a_b->evt_monotonic_ns ? -1 : 1;
+    if (a_a->evt_realtime_ns != a_b->evt_realtime_ns)
+	return a_a->evt_realtime_ns < a_b->evt_realtime_ns ? -1 : 1;
+    if (a_a->evt_sequence != a_b->evt_sequence)
+	return a_a->evt_sequence < a_b->evt_sequence ? -1 : 1;
+    return 0;
+}
+
+/*******************************************************************************/
+extern int log4c_logging_event_end_line(const log4c_logging_event_t* this,
+					char* a_buf, size_t a_size, int a_len)
+{
+    size_t len = (size_t) a_len;
+
+    if (a_len < 0)
+	return a_len;
+    if (this && this->evt_nfields)
+	len += log4c_field_render(this->evt_fields, this->evt_nfields,
+				  len < a_size ? a_buf + len : NULL,
+				  len < a_size ? a_size - len : 0);
+
+    if (len + 1 < a_size) {
+	a_buf[len] = '\n';
+	a_buf[len + 1] = '\0';
+    }
+    return (int) (len + 1);
+}
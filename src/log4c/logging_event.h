@@ -23,6 +23,9 @@
 #include <log4c/defs.h>
 #include <log4c/buffer.h>
 #include <log4c/location_info.h>
+#include <log4c/field.h>
+#include <log4c/thread.h>
+#include <log4c/context.h>
 #ifndef _WIN32
 #include <sys/time.h>
 #endif
@@ -31,6 +34,24 @@ __LOG4C_BEGIN_DECLS
 
 struct __log4c_category;
 
+/**
+ * What the layout and appender types read from an event besides its
+ * category, priority, message and fields, in their @c needs member.
+ * The category only fills in what the layouts and appenders it
+ * dispatches to need.
+ *
+ * @li @c LOG4C_NEEDS_TIME @c evt_timestamp and the times in nanoseconds
+ * @li @c LOG4C_NEEDS_THREAD @c evt_thread
+ * @li @c LOG4C_NEEDS_CONTEXT @c evt_mdc and @c evt_ndc
+ * @li @c LOG4C_NEEDS_NONE nothing more: a type which leaves @c needs to
+ * 0 is assumed to need everything.
+ **/
+#define LOG4C_NEEDS_TIME	0x0001
+#define LOG4C_NEEDS_THREAD	0x0002
+#define LOG4C_NEEDS_CONTEXT	0x0004
+#define LOG4C_NEEDS_NONE	0x8000
+#define LOG4C_NEEDS_ALL		0x7fff
+
 /**
  * @brief logging event object
  * 
@@ -43,8 +64,25 @@ struct __log4c_category;
  *        format in a multi-thread environment.
  * @li @c evt_rendered_msg The application supplied message after layout format.
  * @li @c evt_timestamp The number of seconds elapsed since the epoch
- * (1/1/1970 00:00:00 UTC) until logging event was created.
+ * (1/1/1970 00:00:00 UTC) until logging event was created. Zero when no
+ * layout nor appender of the category needs it, see LOG4C_NEEDS_TIME.
  * @li @c evt_loc The event's location information 
+ * @li @c evt_fields @c evt_nfields the key/value fields of the event,
+ * not formatted, NULL and 0 when it has none
+ * @li @c evt_realtime_ns the same time as @c evt_timestamp, in nanoseconds
+ * since the epoch
+ * @li @c evt_monotonic_ns the time in nanoseconds on a clock which never
+ * goes back within a thread and which NTP adjustments do not move, to
+ * order and measure events. Both times are 0 when @c evt_timestamp is.
+ * @li @c evt_sequence the number of the event among those of its thread,
+ * from 1
+ * @li @c evt_thread the thread which logged the event, NULL when no
+ * layout nor appender of the category needs it, see LOG4C_NEEDS_THREAD
+ * @li @c evt_mdc @c evt_nmdc the MDC of the thread as string fields,
+ * NULL and 0 when it is empty, see context.h
+ * @li @c evt_ndc the NDC of the thread, NULL when it is empty. Both are
+ * NULL when no layout nor appender of the category needs them, see
+ * LOG4C_NEEDS_CONTEXT.
  **/
 typedef struct 
 {
@@ -62,6 +100,15 @@ and have the base acessor function do the mapping
     FILETIME evt_timestamp;
 #endif
     const log4c_location_info_t* evt_loc;
+    const log4c_field_t* evt_fields;
+    size_t evt_nfields;
+    unsigned long long evt_realtime_ns;
+    unsigned long long evt_monotonic_ns;
+    unsigned long long evt_sequence;
+    const log4c_thread_t* evt_thread;
+    const log4c_field_t* evt_mdc;
+    size_t evt_nmdc;
+    const char* evt_ndc;
 
 } log4c_logging_event_t;
 
@@ -71,8 +118,6 @@ and have the base acessor function do the mapping
  * @param a_category the category name
  * @param a_priority the category initial priority
  * @param a_message the message of this event
- *
- * @todo need to handle multi-threading (NDC)
  **/
 LOG4C_API log4c_logging_event_t* log4c_logging_event_new(
     const char* a_category,
@@ -84,6 +129,58 @@ LOG4C_API log4c_logging_event_t* log4c_logging_event_new(
  **/
 LOG4C_API void log4c_logging_event_delete(log4c_logging_event_t* a_event);
 
+/**
+ * Sets the times of an event: @c evt_realtime_ns, @c evt_monotonic_ns
+ * and @c evt_timestamp.
+ *
+ * @param a_event the logging event object
+ * @param a_realtime nanoseconds since the epoch
+ * @param a_monotonic nanoseconds on the monotonic clock
+ **/
+LOG4C_API void log4c_logging_event_set_time(log4c_logging_event_t* a_event,
+					    unsigned long long a_realtime,
+					    unsigned long long a_monotonic);
+
+/**
+ * @internal
+ * Stamps an event logged by the calling thread: gives it the next
+ * sequence of the thread and, when @a a_needs has LOG4C_NEEDS_TIME, the
+ * current time, which is 0 otherwise, and when it has LOG4C_NEEDS_THREAD,
+ * the identity of the thread, which is NULL otherwise, and when it has
+ * LOG4C_NEEDS_CONTEXT, references to the contexts of the thread, which
+ * are NULL otherwise.
+ **/
+LOG4C_API void __log4c_logging_event_stamp(log4c_logging_event_t* a_event,
+					   int a_needs);
+
+/**
+ * Orders events logged by several threads, for the paths which merge
+ * their streams: by monotonic time, then by wall clock time, then by
+ * sequence. Events of one thread never compare equal; events of two
+ * threads stamped on the same nanosecond do, and a merge keeps them in
+ * the order of the streams they come from so that the result does not
+ * depend on timing.
+ *
+ * @returns a negative, zero or positive number like strcmp()
+ **/
+LOG4C_API int log4c_logging_event_compare(const log4c_logging_event_t* a_a,
+					  const log4c_logging_event_t* a_b);
+
+/**
+ * Ends a line of text written by a layout: appends the fields of the
+ * event, rendered by log4c_field_render(), then a newline. The line is
+ * continued like snprintf() would.
+ *
+ * @param a_event the logging event object
+ * @param a_buf the buffer holding the line
+ * @param a_size the size of the buffer
+ * @param a_len the length of the line, as returned by snprintf()
+ * @returns the length of the whole line, which was truncated if it is
+ * not less than @a a_size
+ **/
+LOG4C_API int log4c_logging_event_end_line(const log4c_logging_event_t* a_event,
+					   char* a_buf, size_t a_size, int a_len);
+
 __LOG4C_END_DECLS
 
 #endif
@@ -17,8 +17,10 @@ static const char version[] = "$Id$";
 
 #include <log4c/rc.h>
 #include <log4c/category.h>
+#include <log4c/backtrace.h>
 #include <log4c/appender.h>
 #include <log4c/layout.h>
+#include <log4c/layout_type_pattern.h>
 #include <log4c/appender_type_rollingfile.h>
 #include <log4c/rollingpolicy.h>
 #include <log4c/rollingpolicy_type_sizewin.h>
@@ -29,8 +31,14 @@ static const char version[] = "$Id$";
 #include <sd/malloc.h>
 #include <sd/sd_xplatform.h>
 #include <sd/factory.h>
+#include <sd/hash.h>
+#include <sd/clock.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 #if !(defined(_WIN32) || defined(_WIN64)) || (_MSC_VER >= 1600)
 	#include <errno.h>
 #else
@@ -38,12 +46,110 @@ static const char version[] = "$Id$";
 #endif
 
 
-static log4c_rc_t __log4c_rc = { { 0, 0, 0, 0 } };
+static log4c_rc_t __log4c_rc = { { 0, 0, 0, 0, 0 } };
 
 log4c_rc_t* const log4c_rc = &__log4c_rc;
 
 const char * NOT_SET = "(not set)";
 
+/*
+ * Attributes read by the element loaders. The attributes of an element are
+ * sorted into a table indexed by these values in a single pass, instead of
+ * searching the attribute list for each one.
+ */
+typedef enum {
+	RC_ATTR_NAME = 0,
+	RC_ATTR_TYPE,
+	RC_ATTR_PRIORITY,
+	RC_ATTR_ADDITIVITY,
+	RC_ATTR_APPENDER,
+	RC_ATTR_LAYOUT,
+	RC_ATTR_DESTPORT,
+	RC_ATTR_DEST,
+	RC_ATTR_ROLLINGPOLICY,
+	RC_ATTR_MAXSIZE,
+	RC_ATTR_MAXNUM,
+	RC_ATTR_LEVEL,
+	RC_ATTR_VERSION,
+	RC_ATTR_CLEANUP,
+	RC_ATTR_INDEXSIZE,
+	RC_ATTR_INDEXINTERVAL,
+	RC_ATTR_PATTERN,
+	RC_ATTR_BACKTRACE,
+	RC_ATTR_TRIGGER,
+	RC_ATTR_MAX
+} rc_attr_t;
+
+static const char* const rc_attr_names[RC_ATTR_MAX] = {
+	"name", "type", "priority", "additivity", "appender", "layout",
+	"destport", "dest", "rollingpolicy", "maxsize", "maxnum", "level",
+	"version", "cleanup", "indexsize", "indexinterval", "pattern",
+	"backtrace", "trigger"
+};
+
+/* open addressing table of the attribute names, built on first use */
+#define RC_ATTR_HASH_SIZE 64
+
+static signed char rc_attr_hash[RC_ATTR_HASH_SIZE];
+static int rc_attr_hash_ready = 0;
+
+/******************************************************************************/
+static unsigned int rc_attr_hashval(const char* a_name)
+{
+	unsigned int h = 2166136261U;
+
+	while (*a_name)
+		h = (h ^ (unsigned char) *a_name++) * 16777619U;
+	return h;
+}
+
+/******************************************************************************/
+static void rc_attr_hash_init(void)
+{
+	unsigned int h;
+	int i;
+
+	if (rc_attr_hash_ready)
+		return;
+
+	memset(rc_attr_hash, -1, sizeof(rc_attr_hash));
+	for (i = 0; i < RC_ATTR_MAX; i++) {
+		h = rc_attr_hashval(rc_attr_names[i]);
+		while (rc_attr_hash[h % RC_ATTR_HASH_SIZE] != -1)
+			h++;
+		rc_attr_hash[h % RC_ATTR_HASH_SIZE] = i;
+	}
+	rc_attr_hash_ready = 1;
+}
+
+/******************************************************************************/
+static sd_domnode_t** rc_attrs_index(const sd_domnode_t* anode,
+				     sd_domnode_t* a_attrs[RC_ATTR_MAX])
+{
+	sd_list_iter_t* i;
+	unsigned int h;
+	int id;
+
+	memset(a_attrs, 0, RC_ATTR_MAX * sizeof(*a_attrs));
+
+	for (i = sd_list_begin(anode->attrs); i != sd_list_end(anode->attrs); 
+		i = sd_list_iter_next(i)) 
+	{
+		sd_domnode_t* attr = i->data;
+
+		for (h = rc_attr_hashval(attr->name);
+		     (id = rc_attr_hash[h % RC_ATTR_HASH_SIZE]) != -1; h++)
+			if (!strcmp(rc_attr_names[id], attr->name))
+				break;
+
+		/* like sd_domnode_attrs_get(), the first occurrence wins */
+		if (id != -1 && !a_attrs[id])
+			a_attrs[id] = attr;
+	}
+
+	return a_attrs;
+}
+
 /******************************************************************************/
 static long parse_byte_size (const char *astring)
 {
@@ -101,13 +207,42 @@ static int config_load(log4c_rc_t* this, sd_domnode_t* anode)
 		}
 
 		if (!strcmp(node->name, "debug")) {
-			sd_domnode_t* level = sd_domnode_attrs_get(node, "level");
+			sd_domnode_t* attrs[RC_ATTR_MAX];
+			sd_domnode_t* level = rc_attrs_index(node, attrs)[RC_ATTR_LEVEL];
 
 			if (level) {
 				this->config.debug = atoi(level->value);
 				sd_debug("activating log4c debugging. level = %d", this->config.debug);
 			}
 		}
+		if (!strcmp(node->name, "clock")) {
+			static const char* const clocks[] = { "realtime", "coarse", "tsc" };
+			int clock;
+
+			for (clock = 0; clock < 3; clock++)
+				if (node->value && !strcmp(node->value, clocks[clock]))
+					break;
+
+			if (clock == 3)
+				sd_error("unknown clock '%s'", node->value);
+			else if (sd_clock_use(clock) == -1)
+				sd_error("clock '%s' not available, using realtime",
+					 node->value);
+			else
+				sd_debug("using the %s clock", node->value);
+
+			this->config.clock = sd_clock_get();
+		}
+		if (!strcmp(node->name, "backtrace")) {
+			sd_domnode_t* attrs[RC_ATTR_MAX];
+			sd_domnode_t* trigger = rc_attrs_index(node, attrs)[RC_ATTR_TRIGGER];
+
+			if (node->value)
+				log4c_backtrace_set_size(parse_byte_size(node->value));
+			if (trigger)
+				log4c_backtrace_set_trigger(
+					log4c_priority_to_int(trigger->value));
+		}
 		if (!strcmp(node->name, "reread")) {
 			this->config.reread = atoi(node->value);
 			sd_debug("log4crc reread is %d",this->config.reread);
@@ -122,10 +257,12 @@ static int config_load(log4c_rc_t* this, sd_domnode_t* anode)
 /******************************************************************************/
 static int category_load(log4c_rc_t* this, sd_domnode_t* anode)
 {
-	sd_domnode_t*     name     = sd_domnode_attrs_get(anode, "name");
-	sd_domnode_t*     priority = sd_domnode_attrs_get(anode, "priority");
-	sd_domnode_t*     additivity = sd_domnode_attrs_get(anode, "additivity");
-	sd_domnode_t*     appender = sd_domnode_attrs_get(anode, "appender");
+	sd_domnode_t*     attrs[RC_ATTR_MAX];
+	sd_domnode_t*     name     = rc_attrs_index(anode, attrs)[RC_ATTR_NAME];
+	sd_domnode_t*     priority = attrs[RC_ATTR_PRIORITY];
+	sd_domnode_t*     additivity = attrs[RC_ATTR_ADDITIVITY];
+	sd_domnode_t*     appender = attrs[RC_ATTR_APPENDER];
+	sd_domnode_t*     backtrace = attrs[RC_ATTR_BACKTRACE];
 	log4c_category_t* cat      = NULL;
 
 	if (!name) {
@@ -153,6 +290,10 @@ static int category_load(log4c_rc_t* this, sd_domnode_t* anode)
 		log4c_category_set_appender(
 		cat, log4c_appender_get(appender->value));
 
+	if (backtrace)
+		log4c_category_set_backtrace(
+		cat, log4c_priority_to_int(backtrace->value));
+
 	return 0;
 }
 
@@ -161,9 +302,10 @@ static int category_load(log4c_rc_t* this, sd_domnode_t* anode)
 type. */
 static int appender_load(log4c_rc_t* this, sd_domnode_t* anode)
 {
-	sd_domnode_t*     name   = sd_domnode_attrs_get(anode, "name");
-	sd_domnode_t*     type   = sd_domnode_attrs_get(anode, "type");
-	sd_domnode_t*     layout = sd_domnode_attrs_get(anode, "layout");
+	sd_domnode_t*     attrs[RC_ATTR_MAX];
+	sd_domnode_t*     name   = rc_attrs_index(anode, attrs)[RC_ATTR_NAME];
+	sd_domnode_t*     type   = attrs[RC_ATTR_TYPE];
+	sd_domnode_t*     layout = attrs[RC_ATTR_LAYOUT];
 	log4c_appender_t* app    = NULL;
 	socket_udata_t* sock = NULL;
 
@@ -205,8 +347,8 @@ static int appender_load(log4c_rc_t* this, sd_domnode_t* anode)
 
 			if (!strcasecmp(type->value, "socket")) 
 			{
-				sd_domnode_t*  destport = sd_domnode_attrs_get(anode,"destport");
-				sd_domnode_t*  dest = sd_domnode_attrs_get(anode,"dest");
+				sd_domnode_t*  destport = attrs[RC_ATTR_DESTPORT];
+				sd_domnode_t*  dest = attrs[RC_ATTR_DEST];
 
 				sd_debug("destport='%s', dest='%s'",
 					(destport && destport->value ? destport->value : NOT_SET ),
@@ -227,8 +369,8 @@ static int appender_load(log4c_rc_t* this, sd_domnode_t* anode)
 					"logdir");
 				sd_domnode_t*  logprefix = sd_domnode_attrs_get_expanded(anode,
 					"prefix");
-				sd_domnode_t*  rollingpolicy_name = sd_domnode_attrs_get(anode,
-					"rollingpolicy");
+				sd_domnode_t*  rollingpolicy_name = 
+					attrs[RC_ATTR_ROLLINGPOLICY];
 
 				sd_debug("logdir='%s', prefix='%s', rollingpolicy='%s'",
 					(logdir && logdir->value ? logdir->value : NOT_SET),
@@ -279,6 +421,11 @@ static int appender_load(log4c_rc_t* this, sd_domnode_t* anode)
 					rollingfile_udata_set_logdir(rfup, newpath);
 				}
 				rollingfile_udata_set_files_prefix(rfup, (char *)logprefix->value);
+				rollingfile_udata_set_index(rfup,
+					(attrs[RC_ATTR_INDEXSIZE] ?
+					 parse_byte_size(attrs[RC_ATTR_INDEXSIZE]->value) : 0),
+					(attrs[RC_ATTR_INDEXINTERVAL] ?
+					 atol(attrs[RC_ATTR_INDEXINTERVAL]->value) : 0));
 
 				if (rollingpolicy_name){
 					/* recover a rollingpolicy instance with this name */
@@ -310,8 +457,9 @@ static int appender_load(log4c_rc_t* this, sd_domnode_t* anode)
 /******************************************************************************/
 static int layout_load(log4c_rc_t* this, sd_domnode_t* anode)
 {
-	sd_domnode_t*   name   = sd_domnode_attrs_get(anode, "name");
-	sd_domnode_t*   type   = sd_domnode_attrs_get(anode, "type");
+	sd_domnode_t*   attrs[RC_ATTR_MAX];
+	sd_domnode_t*   name   = rc_attrs_index(anode, attrs)[RC_ATTR_NAME];
+	sd_domnode_t*   type   = attrs[RC_ATTR_TYPE];
 	log4c_layout_t* layout = NULL;
 
 	if (!name) {
@@ -324,6 +472,10 @@ static int layout_load(log4c_rc_t* this, sd_domnode_t* anode)
 	if (type)
 		log4c_layout_set_type(layout, log4c_layout_type_get(type->value));
 
+	if (attrs[RC_ATTR_PATTERN] &&
+	    log4c_layout_pattern_set(layout, attrs[RC_ATTR_PATTERN]->value) == -1)
+		return -1;
+
 	return 0;
 }
 
@@ -331,8 +483,9 @@ static int layout_load(log4c_rc_t* this, sd_domnode_t* anode)
 /******************************************************************************/
 static int rollingpolicy_load(log4c_rc_t* this, sd_domnode_t* anode)
 {
-	sd_domnode_t*   name   = sd_domnode_attrs_get(anode, "name");
-	sd_domnode_t*   type   = sd_domnode_attrs_get(anode, "type");
+	sd_domnode_t*   attrs[RC_ATTR_MAX];
+	sd_domnode_t*   name   = rc_attrs_index(anode, attrs)[RC_ATTR_NAME];
+	sd_domnode_t*   type   = attrs[RC_ATTR_TYPE];
 	log4c_rollingpolicy_t* rpolicyp = NULL;
 	long a_maxsize;
 
@@ -350,8 +503,8 @@ static int rollingpolicy_load(log4c_rc_t* this, sd_domnode_t* anode)
 			log4c_rollingpolicy_type_get(type->value));
 
 		if (!strcasecmp(type->value, "sizewin")){
-			sd_domnode_t*   maxsize   = sd_domnode_attrs_get(anode, "maxsize");
-			sd_domnode_t*   maxnum  = sd_domnode_attrs_get(anode, "maxnum");
+			sd_domnode_t*   maxsize   = attrs[RC_ATTR_MAXSIZE];
+			sd_domnode_t*   maxnum  = attrs[RC_ATTR_MAXNUM];
 			rollingpolicy_sizewin_udata_t *sizewin_udatap = NULL;
 
 			sd_debug("type='sizewin', maxsize='%s', maxnum='%s', "
@@ -399,64 +552,602 @@ static int rollingpolicy_load(log4c_rc_t* this, sd_domnode_t* anode)
 #endif
 
 /******************************************************************************/
-extern int log4c_rc_load(log4c_rc_t* this, const char* a_filename)
-{    
-	sd_list_iter_t* i = NULL;
-	sd_domnode_t*   node = NULL;        
-	sd_domnode_t*   root_node = NULL;
-
-	sd_debug("parsing file '%s'\n", a_filename);
-
-	if (!this)
-		return -1;
-
-	root_node = sd_domnode_new(NULL, NULL);
+typedef int (*rc_element_load_t)(log4c_rc_t* this, sd_domnode_t* anode);
+
+static const struct {
+	const char*		name;
+	rc_element_load_t	load;
+} rc_elements[] = {
+	{ "category",		category_load },
+	{ "appender",		appender_load },
+#ifdef WITH_ROLLINGFILE
+	{ "rollingpolicy",	rollingpolicy_load },
+#endif
+	{ "layout",		layout_load },
+	{ "config",		config_load },
+};
 
-	if (sd_domnode_load(root_node, a_filename) == -1) {
-		sd_domnode_delete(root_node);
-		return -1;
-	}
+/******************************************************************************/
+static int rc_root_check(log4c_rc_t* this, const sd_domnode_t* root_node)
+{
+	sd_domnode_t* attrs[RC_ATTR_MAX];
+	sd_domnode_t* node = NULL;
 
 	/* Check configuration file root node */
-	if (strcmp(root_node->name, "log4c")) {
+	if (!root_node->name || strcmp(root_node->name, "log4c")) {
 		sd_error("invalid root name %s", root_node->name);
-		sd_domnode_delete(root_node);
 		return -1;
 	}
 
 	/* Check configuration file revision */
-	if ( (node = sd_domnode_attrs_get(root_node, "version")) != NULL)
+	if ( (node = rc_attrs_index(root_node, attrs)[RC_ATTR_VERSION]) != NULL)
 		if (strverscmp(log4c_version(), node->value) < 0) {
 			sd_error("version mismatch: library(%s) < config(%s)", log4c_version(), node->value);
-			sd_domnode_delete(root_node);
 			return -1;
 		}
 
-		/* backward compatibility. */
-		if ( (node = sd_domnode_attrs_get(root_node, "cleanup")) != NULL) {
-			sd_debug("attribute \"cleanup\" is deprecated");
-			this->config.nocleanup = !atoi(node->value);
+	/* backward compatibility. */
+	if ( (node = attrs[RC_ATTR_CLEANUP]) != NULL) {
+		sd_debug("attribute \"cleanup\" is deprecated");
+		this->config.nocleanup = !atoi(node->value);
+	}
+
+	return 0;
+}
+
+/******************************************************************************/
+static void rc_element_apply(log4c_rc_t* this, sd_domnode_t* node)
+{
+	size_t i;
+
+	if (!node->name || !node->attrs)
+		return;
+
+	for (i = 0; i < sizeof(rc_elements) / sizeof(rc_elements[0]); i++)
+		if (!strcmp(node->name, rc_elements[i].name)) {
+			rc_elements[i].load(this, node);
+			break;
+		}
+}
+
+/******************************************************************************/
+/*
+ * Binary image of a log4crc file, see log4c_rc_compile().
+ *
+ * The image is made of a header, the records of the elements, a table of
+ * string offsets and the string data. Records are sequences of 32 bit
+ * words:
+ *
+ *   node := name value nattrs (name value)* nchildren node*
+ *
+ * where names and values are indexes in the string table or
+ * RC_IMAGE_NOSTRING. The top level elements come in file order, followed
+ * by the root element without its children. Integers are stored in host
+ * byte order: images are not meant to be moved between hosts.
+ */
+#define RC_IMAGE_MAGIC		"L4CI"
+#define RC_IMAGE_VERSION	2
+#define RC_IMAGE_BYTEORDER	0x01020304
+#define RC_IMAGE_NOSTRING	0xffffffff
+#define RC_IMAGE_MAXDEPTH	64
+
+typedef struct {
+	char		magic[4];
+	XP_UINT32	version;
+	XP_UINT32	byteorder;
+	XP_UINT32	nelements;	/* number of top level elements */
+	XP_UINT32	root;		/* word offset of the root record */
+	XP_UINT32	nwords;		/* number of record words */
+	XP_UINT32	nstrings;	/* number of strings */
+	XP_UINT32	strsize;	/* size of the string data */
+	XP_INT64	src_mtime;	/* see rc_image_source_stat() */
+	XP_INT64	src_size;
+} rc_image_header_t;
+
+struct rc_image_writer {
+	sd_hash_t*	strings;	/* string => index + 1 */
+	char**		strtab;
+	size_t		nstrings;
+	size_t		maxstrings;
+	size_t		strsize;
+	XP_UINT32*	words;
+	size_t		nwords;
+	size_t		maxwords;
+	XP_UINT32	nelements;
+};
+
+/******************************************************************************/
+static void rc_image_put(struct rc_image_writer* w, XP_UINT32 a_word)
+{
+	if (w->nwords == w->maxwords) {
+		w->maxwords = w->maxwords ? 2 * w->maxwords : 1024;
+		w->words = sd_realloc(w->words, w->maxwords * sizeof(*w->words));
+	}
+	w->words[w->nwords++] = a_word;
+}
+
+/******************************************************************************/
+static void rc_image_put_string(struct rc_image_writer* w, const char* a_str)
+{
+	sd_hash_iter_t* i;
+
+	if (!a_str) {
+		rc_image_put(w, RC_IMAGE_NOSTRING);
+		return;
+	}
+
+	if ((i = sd_hash_lookup(w->strings, a_str)) == NULL) {
+		if (w->nstrings == w->maxstrings) {
+			w->maxstrings = w->maxstrings ? 2 * w->maxstrings : 256;
+			w->strtab = sd_realloc(w->strtab, 
+					       w->maxstrings * sizeof(*w->strtab));
 		}
+		w->strtab[w->nstrings] = sd_strdup(a_str);
+		w->strsize += strlen(a_str) + 1;
+		i = sd_hash_add(w->strings, w->strtab[w->nstrings], 
+				(void*) (w->nstrings + 1));
+		w->nstrings++;
+	}
 
-		/* load configuration elements */
-		for (i = sd_list_begin(root_node->children);
-			i != sd_list_end(root_node->children); 
-			i = sd_list_iter_next(i)) 
-		{
-			node = i->data;
+	rc_image_put(w, (XP_UINT32) ((size_t) i->data - 1));
+}
 
-			if (!strcmp(node->name, "category")) category_load(this, node);
-			if (!strcmp(node->name, "appender")) appender_load(this, node);
-#ifdef WITH_ROLLINGFILE
-			if (!strcmp(node->name, "rollingpolicy"))rollingpolicy_load(this, node);
+/******************************************************************************/
+static void rc_image_put_node(struct rc_image_writer* w, 
+			      const sd_domnode_t* anode, int a_children)
+{
+	sd_list_iter_t* i;
+	XP_UINT32 n = 0;
+	size_t nchildren;
+
+	rc_image_put_string(w, anode->name);
+	rc_image_put_string(w, anode->value);
+
+	rc_image_put(w, sd_list_get_nelem(anode->attrs));
+	for (i = sd_list_begin(anode->attrs); i != sd_list_end(anode->attrs);
+		i = sd_list_iter_next(i))
+	{
+		sd_domnode_t* attr = i->data;
+
+		rc_image_put_string(w, attr->name);
+		rc_image_put_string(w, attr->value);
+	}
+
+	/* comments are dropped: patch the count once the children are written */
+	nchildren = w->nwords;
+	rc_image_put(w, 0);
+
+	if (!a_children)
+		return;
+
+	for (i = sd_list_begin(anode->children); 
+		i != sd_list_end(anode->children);
+		i = sd_list_iter_next(i))
+	{
+		sd_domnode_t* child = i->data;
+
+		if (!child->name || !strcmp(child->name, "#comment"))
+			continue;
+		rc_image_put_node(w, child, 1);
+		n++;
+	}
+	w->words[nchildren] = n;
+}
+
+/******************************************************************************/
+/*
+ * The modification time, in nanoseconds where the system keeps them, and
+ * the size of a log4crc file: an image is stale when either changed.
+ */
+static int rc_image_source_stat(const char* a_filename, XP_INT64* a_mtime,
+				XP_INT64* a_size)
+{
+	struct stat st;
+
+	if (stat(a_filename, &st) != 0)
+		return -1;
+
+	*a_mtime = (XP_INT64) st.st_mtime * 1000000000;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+	*a_mtime += st.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+	*a_mtime += st.st_mtimespec.tv_nsec;
 #endif
-			if (!strcmp(node->name, "layout"))   layout_load(this, node);
-			if (!strcmp(node->name, "config"))   config_load(this, node);
-		}
+	*a_size = st.st_size;
+	return 0;
+}
+
+/******************************************************************************/
+static void rc_image_writer_init(struct rc_image_writer* w)
+{
+	memset(w, 0, sizeof(*w));
+	w->strings = sd_hash_new(256, NULL);
+}
 
-		sd_domnode_delete(root_node);
+/******************************************************************************/
+static void rc_image_writer_free(struct rc_image_writer* w)
+{
+	size_t i;
 
+	for (i = 0; i < w->nstrings; i++)
+		free(w->strtab[i]);
+	free(w->strtab);
+	free(w->words);
+	sd_hash_delete(w->strings);
+}
+
+/******************************************************************************/
+/* called by the parser for each element, see sd_domnode_load_stream() */
+static int rc_image_element(const sd_domnode_t* root_node, sd_domnode_t* node,
+			    void* data)
+{
+	struct rc_image_writer* w = data;
+
+	/* the root is checked once the whole file is read */
+	(void) root_node;
+
+	if (!node->name || !strcmp(node->name, "#comment"))
+		return 0;
+
+	rc_image_put_node(w, node, 1);
+	w->nelements++;
+	return 0;
+}
+
+/******************************************************************************/
+extern int log4c_rc_compile(const char* a_filename, const char* a_image)
+{
+	struct rc_image_writer w;
+	rc_image_header_t header;
+	sd_domnode_t* root_node = NULL;
+	XP_INT64 src_mtime, src_size;
+	FILE* fp = NULL;
+	size_t i;
+	int ret = -1;
+
+	if (!a_filename || !a_image)
+		return -1;
+
+	/* taken first, so that a concurrent change makes the image stale */
+	if (rc_image_source_stat(a_filename, &src_mtime, &src_size) != 0) {
+		sd_error("stat %s failed", a_filename);
+		return -1;
+	}
+
+	rc_image_writer_init(&w);
+	root_node = sd_domnode_new(NULL, NULL);
+
+	if (sd_domnode_load_stream(root_node, a_filename, rc_image_element, 
+				   &w) == -1)
+		goto out;
+
+	if (!root_node->name || strcmp(root_node->name, "log4c")) {
+		sd_error("invalid root name %s", root_node->name);
+		goto out;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RC_IMAGE_MAGIC, sizeof(header.magic));
+	header.version	 = RC_IMAGE_VERSION;
+	header.byteorder = RC_IMAGE_BYTEORDER;
+	header.nelements = w.nelements;
+	header.root	 = w.nwords;
+	rc_image_put_node(&w, root_node, 0);
+	header.nwords	 = w.nwords;
+	header.nstrings	 = w.nstrings;
+	header.strsize	 = w.strsize;
+	header.src_mtime = src_mtime;
+	header.src_size	 = src_size;
+
+	if ((fp = fopen(a_image, "wb")) == NULL) {
+		sd_error("can not open %s for writing", a_image);
+		goto out;
+	}
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+	    fwrite(w.words, sizeof(*w.words), w.nwords, fp) != w.nwords)
+		goto out;
+
+	for (i = 0, header.strsize = 0; i < w.nstrings; i++) {
+		XP_UINT32 offset = header.strsize;
+
+		if (fwrite(&offset, sizeof(offset), 1, fp) != 1)
+			goto out;
+		header.strsize += strlen(w.strtab[i]) + 1;
+	}
+
+	for (i = 0; i < w.nstrings; i++)
+		if (fwrite(w.strtab[i], strlen(w.strtab[i]) + 1, 1, fp) != 1)
+			goto out;
+
+	ret = 0;
+
+ out:
+	if (fp && fclose(fp) != 0)
+		ret = -1;
+	if (fp && ret == -1) {
+		sd_error("failed to write %s", a_image);
+		remove(a_image);
+	}
+
+	rc_image_writer_free(&w);
+	sd_domnode_delete(root_node);
+	return ret;
+}
+
+/******************************************************************************/
+/* the strings come from stroffs and strs, or from strtab when it is set */
+struct rc_image_reader {
+	const XP_UINT32*	words;
+	size_t			nwords;
+	size_t			pos;
+	char* const*		strtab;
+	const XP_UINT32*	stroffs;
+	XP_UINT32		nstrings;
+	const char*		strs;
+	XP_UINT32		strsize;
+	int			error;
+};
+
+/******************************************************************************/
+static XP_UINT32 rc_image_get(struct rc_image_reader* r)
+{
+	if (r->pos >= r->nwords) {
+		r->error = 1;
 		return 0;
+	}
+	return r->words[r->pos++];
+}
+
+/******************************************************************************/
+static const char* rc_image_get_string(struct rc_image_reader* r)
+{
+	XP_UINT32 id = rc_image_get(r);
+
+	if (id == RC_IMAGE_NOSTRING)
+		return NULL;
+
+	if (r->strtab) {
+		if (id >= r->nstrings) {
+			r->error = 1;
+			return NULL;
+		}
+		return r->strtab[id];
+	}
+
+	/* the string data is known to be NUL terminated */
+	if (id >= r->nstrings || r->stroffs[id] >= r->strsize) {
+		r->error = 1;
+		return NULL;
+	}
+	return r->strs + r->stroffs[id];
+}
+
+/******************************************************************************/
+static sd_domnode_t* rc_image_get_node(struct rc_image_reader* r, int a_depth)
+{
+	sd_domnode_t* node;
+	const char* name;
+	const char* value;
+	XP_UINT32 n;
+
+	name  = rc_image_get_string(r);
+	value = rc_image_get_string(r);
+	if (r->error || !name || a_depth > RC_IMAGE_MAXDEPTH) {
+		r->error = 1;
+		return NULL;
+	}
+
+	node = __sd_domnode_new(name, value, 1);
+
+	for (n = rc_image_get(r); n && !r->error; n--) {
+		name  = rc_image_get_string(r);
+		value = rc_image_get_string(r);
+		if (!r->error && name && value)
+			sd_list_append(node->attrs, 
+				       __sd_domnode_new(name, value, 0));
+	}
+
+	for (n = rc_image_get(r); n && !r->error; n--) {
+		sd_domnode_t* child = rc_image_get_node(r, a_depth + 1);
+
+		if (child)
+			sd_list_append(node->children, child);
+	}
+
+	if (r->error) {
+		sd_domnode_delete(node);
+		return NULL;
+	}
+	return node;
+}
+
+/******************************************************************************/
+/*
+ * Nothing is applied before the whole file is parsed, so that a malformed
+ * file leaves the configuration as it was. The elements are kept meanwhile
+ * in the compact form of the images rather than as a tree of the whole
+ * file, then rebuilt and applied one at a time.
+ */
+extern int log4c_rc_load(log4c_rc_t* this, const char* a_filename)
+{    
+	struct rc_image_writer w;
+	struct rc_image_reader r;
+	sd_domnode_t* root_node = NULL;
+	sd_domnode_t* node;
+	XP_UINT32 n;
+	int ret;
+
+	sd_debug("parsing file '%s'\n", a_filename);
+
+	if (!this)
+		return -1;
+
+	rc_attr_hash_init();
+
+	rc_image_writer_init(&w);
+	root_node = sd_domnode_new(NULL, NULL);
+
+	ret = sd_domnode_load_stream(root_node, a_filename, rc_image_element,
+				     &w);
+	if (ret != -1)
+		ret = rc_root_check(this, root_node);
+
+	if (ret != -1) {
+		memset(&r, 0, sizeof(r));
+		r.words	   = w.words;
+		r.nwords   = w.nwords;
+		r.strtab   = w.strtab;
+		r.nstrings = (XP_UINT32) w.nstrings;
+
+		for (n = 0; n < w.nelements; n++) {
+			if ((node = rc_image_get_node(&r, 1)) == NULL)
+				break;
+			rc_element_apply(this, node);
+			sd_domnode_delete(node);
+		}
+	}
+
+	sd_domnode_delete(root_node);
+	rc_image_writer_free(&w);
+	return ret;
+}
+
+/******************************************************************************/
+static void* rc_image_map(const char* a_image, size_t* a_size)
+{
+	void* addr = NULL;
+#ifndef _WIN32
+	struct stat st;
+	int fd;
+
+	if ((fd = open(a_image, O_RDONLY)) == -1)
+		return NULL;
+
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		*a_size = st.st_size;
+		addr = mmap(NULL, *a_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+			addr = NULL;
+	}
+	close(fd);
+#else
+	FILE* fp;
+	long size;
+
+	if ((fp = fopen(a_image, "rb")) == NULL)
+		return NULL;
+
+	if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0) {
+		rewind(fp);
+		addr = sd_malloc(size);
+		*a_size = size;
+		if (fread(addr, size, 1, fp) != 1) {
+			free(addr);
+			addr = NULL;
+		}
+	}
+	fclose(fp);
+#endif
+	return addr;
+}
+
+/******************************************************************************/
+static void rc_image_unmap(void* a_addr, size_t a_size)
+{
+#ifndef _WIN32
+	munmap(a_addr, a_size);
+#else
+	free(a_addr);
+#endif
+}
+
+/******************************************************************************/
+extern int log4c_rc_load_image(log4c_rc_t* this, const char* a_image,
+			       const char* a_filename)
+{
+	const rc_image_header_t* header;
+	struct rc_image_reader r;
+	sd_domnode_t* root_node = NULL;
+	sd_domnode_t** elements = NULL;
+	XP_UINT32 n = 0;
+	XP_INT64 src_mtime, src_size;
+	size_t size = 0;
+	void* addr;
+	int ret = -1;
+
+	if (!this || !a_image)
+		return -1;
+
+	sd_debug("loading image '%s'", a_image);
+
+	if ((addr = rc_image_map(a_image, &size)) == NULL)
+		return -1;
+
+	header = addr;
+	if (size < sizeof(*header) ||
+	    memcmp(header->magic, RC_IMAGE_MAGIC, sizeof(header->magic)) ||
+	    header->version != RC_IMAGE_VERSION ||
+	    header->byteorder != RC_IMAGE_BYTEORDER ||
+	    header->root > header->nwords ||
+	    header->nelements > header->nwords ||
+	    header->nwords > size / sizeof(XP_UINT32) ||
+	    header->nstrings > size / sizeof(XP_UINT32) ||
+	    size != sizeof(*header) + 
+	    (header->nwords + (size_t) header->nstrings) * sizeof(XP_UINT32) + 
+	    header->strsize ||
+	    (header->strsize && ((const char*) addr)[size - 1] != '\0')) {
+		sd_error("invalid image %s", a_image);
+		goto out;
+	}
+
+	if (a_filename &&
+	    (rc_image_source_stat(a_filename, &src_mtime, &src_size) != 0 ||
+	     src_mtime != header->src_mtime || src_size != header->src_size)) {
+		sd_debug("image %s is stale, %s has changed", a_image, a_filename);
+		goto out;
+	}
+
+	r.words	   = (const XP_UINT32*) (header + 1);
+	r.nwords   = header->nwords;
+	r.strtab   = NULL;
+	r.stroffs  = r.words + header->nwords;
+	r.nstrings = header->nstrings;
+	r.strs	   = (const char*) (r.stroffs + header->nstrings);
+	r.strsize  = header->strsize;
+	r.error	   = 0;
+
+	/* the root is checked before anything is applied */
+	r.pos = header->root;
+	if ((root_node = rc_image_get_node(&r, 0)) == NULL) {
+		sd_error("invalid image %s", a_image);
+		goto out;
+	}
+	if (rc_root_check(this, root_node) == -1)
+		goto out;
+
+	r.pos = 0;
+	r.nwords = header->root;
+	elements = sd_calloc(header->nelements + 1, sizeof(*elements));
+	for (n = 0; n < header->nelements; n++)
+		if ((elements[n] = rc_image_get_node(&r, 1)) == NULL) {
+			sd_error("invalid image %s", a_image);
+			goto out;
+		}
+
+	for (n = 0; n < header->nelements; n++)
+		rc_element_apply(this, elements[n]);
+	ret = 0;
+
+ out:
+	if (elements) {
+		while (n--)
+			sd_domnode_delete(elements[n]);
+		free(elements);
+	}
+	sd_domnode_delete(root_node);
+	rc_image_unmap(addr, size);
+	return ret;
 }
 
 /******************************************************************************/
@@ -30,6 +30,8 @@ __LOG4C_BEGIN_DECLS
  *        destructor or in log4c_fini()
  * @li @c bufsize maximum logging buffer size. 0 for no limits
  * @li @c debug activate log4c debugging
+ * @li @c clock the clock which timestamps the events, one of the
+ *        SD_CLOCK_* of sd/clock.h
  **/
 typedef struct 
 {
@@ -39,6 +41,7 @@ typedef struct
 	int bufsize;
 	int debug;
 	int reread;
+	int clock;
     } config;
 
 } log4c_rc_t;
@@ -60,6 +63,38 @@ LOG4C_API int		log4c_load(const char* a_filename);
  **/
 LOG4C_API int		log4c_rc_load(log4c_rc_t* a_rc, const char* a_filename);
 
+/**
+ * Compiles a log4crc file into a binary image which log4c_init() loads
+ * instead of the file, as long as the file is not modified. The image
+ * keeps the configuration elements as they are written in the file, not
+ * the objects they configure: loading it saves the XML parse, while the
+ * elements are still applied, and variables expanded, as from the file.
+ *
+ * @param a_filename name of the log4crc file
+ * @param a_image name of the image, by convention @a a_filename followed
+ * by LOG4C_RC_IMAGE_SUFFIX
+ * @returns 0 on success, -1 otherwise
+ **/
+LOG4C_API int		log4c_rc_compile(const char* a_filename, 
+					 const char* a_image);
+
+/**
+ * @internal
+ *
+ * Loads a binary image created by log4c_rc_compile().
+ *
+ * @param a_image name of the image
+ * @param a_filename name of the log4crc file it was compiled from
+ * @returns -1 if the image is invalid or @a a_filename has changed since
+ * it was compiled (modification time or size), in which case nothing was
+ * loaded from it.
+ **/
+LOG4C_API int		log4c_rc_load_image(log4c_rc_t* a_rc, 
+					    const char* a_image,
+					    const char* a_filename);
+
+#define LOG4C_RC_IMAGE_SUFFIX ".bin"
+
 /*
  * Rereads any log4crc files that have changed
  */
@@ -63,6 +63,7 @@ static int sizewin_get_last_index(rollingpolicy_sizewin_udata_t * swup);
 static char* sizewin_get_filename_by_index(rollingpolicy_sizewin_udata_t * swup,
 					   long i);
 static int sizewin_open_zero_file(char *filename, FILE **fpp );
+static void sizewin_rename_index(const char *from, const char *to);
 
 /*******************************************************************************
               Policy interface: init, is_triggering_event, rollover
@@ -128,6 +129,9 @@ static int sizewin_rollover(log4c_rollingpolicy_t *this, FILE ** current_fpp , i
        sd_error("open zero file failed");
      } else{
        swup->sw_flags &= !SW_LAST_FOPEN_FAILED;
+       if (swup->sw_rfudata)
+	 rollingfile_udata_set_current_filename(swup->sw_rfudata,
+						swup->sw_filenames[0]);
      }
      swup->sw_last_index = 0;
    } else {
@@ -159,6 +163,7 @@ static int sizewin_rollover(log4c_rollingpolicy_t *this, FILE ** current_fpp , i
 			  sd_error("unlink failed"); 
 			  rc = 1;
 		   } else {
+			 sizewin_rename_index(swup->sw_filenames[k], NULL);
 			 k = swup->sw_conf.swc_file_max_num_files-2;
 		   }
 		 } else {
@@ -180,6 +185,8 @@ static int sizewin_rollover(log4c_rollingpolicy_t *this, FILE ** current_fpp , i
 			   rc = 1;
 			   break;
 			 }
+			 sizewin_rename_index(swup->sw_filenames[i],
+					      swup->sw_filenames[i+1]);
 			 i--;
 		   }
 		   if ( !rc){
@@ -197,6 +204,9 @@ static int sizewin_rollover(log4c_rollingpolicy_t *this, FILE ** current_fpp , i
        rc = 1;
      } else{
        swup->sw_flags &= !SW_LAST_FOPEN_FAILED;
+       if (swup->sw_rfudata)
+	 rollingfile_udata_set_current_filename(swup->sw_rfudata,
+						swup->sw_filenames[0]);
        rc = 0;
      }
 
@@ -225,6 +235,7 @@ static int sizewin_init(log4c_rollingpolicy_t *this, rollingfile_udata_t *rfup){
   }
   
   /* initialize the filename array and last index */
+  swup->sw_rfudata = rfup;
   swup->sw_logdir = rollingfile_udata_get_logdir(rfup);
   swup->sw_files_prefix = rollingfile_udata_get_files_prefix(rfup);
 
@@ -428,3 +439,31 @@ const log4c_rollingpolicy_type_t log4c_rollingpolicy_type_sizewin = {
     sizewin_fini
 };
 
+/*******************************************************************************/
+
+/*
+ * Moves the index of a log file along with it, or removes it when 'to' is
+ * NULL. Log files without an index are the common case: nothing to do.
+ */
+static void sizewin_rename_index(const char *from, const char *to){
+  char *from_index;
+  char *to_index = NULL;
+
+  from_index = malloc(strlen(from) + sizeof(ROLLINGFILE_INDEX_SUFFIX));
+  if (to)
+    to_index = malloc(strlen(to) + sizeof(ROLLINGFILE_INDEX_SUFFIX));
+
+  if (from_index && (!to || to_index)) {
+    sprintf(from_index, "%s" ROLLINGFILE_INDEX_SUFFIX, from);
+    if (to) {
+      sprintf(to_index, "%s" ROLLINGFILE_INDEX_SUFFIX, to);
+      if (rename(from_index, to_index) && errno != ENOENT)
+	sd_error("rename of index '%s' failed", from_index);
+    } else if (unlink(from_index) && errno != ENOENT) {
+      sd_error("unlink of index '%s' failed", from_index);
+    }
+  }
+
+  free(from_index);
+  free(to_index);
+}
@@ -0,0 +1,411 @@
+static const char version[] = "$Id$";
+
+/*
+ * sigsafe.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/sigsafe.h>
+#include <log4c/priority.h>
+#include <log4c/thread.h>
+#include <log4c/rc.h>
+#include <sd/clock.h>
+#include <sd/malloc.h>
+#include <sd/sd_xplatform.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define SIGSAFE_PTHREADS
+#endif
+
+/*
+ * A slot holds the event of position p of the ring when p % SLOTS is its
+ * index. ss_state is 2 * lap while it is free for the event of lap
+ * p / SLOTS, and 2 * lap + 1 once that event is written: the slots are
+ * free for lap 0 when the library is loaded. A writer reserves a
+ * position by moving sigsafe_head past it, the thread which drains moves
+ * sigsafe_tail once it has copied the event.
+ */
+typedef struct {
+    XP_UINT64			ss_state;
+    const log4c_category_t*	ss_category;
+    int				ss_priority;
+    unsigned int		ss_len;
+    unsigned long		ss_thread;
+    unsigned long long		ss_realtime;
+    unsigned long long		ss_monotonic;
+    char			ss_msg[LOG4C_SIGSAFE_MESSAGE_MAX];
+} sigsafe_slot_t;
+
+static sigsafe_slot_t sigsafe_slots[LOG4C_SIGSAFE_SLOTS];
+static XP_UINT64 sigsafe_head = 0;
+static XP_UINT64 sigsafe_tail = 0;
+static XP_UINT64 sigsafe_drops = 0;
+
+#ifdef SIGSAFE_PTHREADS
+static pthread_mutex_t sigsafe_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#define SLOT_LAP(p)	((XP_UINT64) (p) / LOG4C_SIGSAFE_SLOTS)
+#define SLOT_OF(p)	(&sigsafe_slots[(p) % LOG4C_SIGSAFE_SLOTS])
+
+/* the text formatted so far, truncated to o_size - 1 */
+typedef struct {
+    char*	o_buf;
+    size_t	o_size;
+    size_t	o_len;
+} output_t;
+
+/*******************************************************************************/
+static void output_char(output_t* this, char a_char)
+{
+    if (this->o_len + 1 < this->o_size)
+	this->o_buf[this->o_len++] = a_char;
+}
+
+/*******************************************************************************/
+static void output_field(output_t* this, const char* a_prefix,
+			 const char* a_text, size_t a_len, int a_width,
+			 int a_left, int a_zero)
+{
+    size_t len = strlen(a_prefix) + a_len;
+    size_t pad = a_width > 0 && (size_t) a_width > len ? a_width - len : 0;
+
+    if (!a_left && !a_zero)
+	for (; pad; pad--)
+	    output_char(this, ' ');
+    while (*a_prefix)
+	output_char(this, *a_prefix++);
+    if (!a_left)
+	for (; pad; pad--)
+	    output_char(this, '0');
+    while (a_len--)
+	output_char(this, *a_text++);
+    for (; pad; pad--)
+	output_char(this, ' ');
+}
+
+/*******************************************************************************/
+/* the formatter of log4c_sigsafe_log(): no locale, no allocation. The
+   arguments after an unknown conversion can not be told apart, so the text
+   stops there */
+static size_t sigsafe_vformat(char* a_buffer, size_t a_size,
+			      const char* a_format, va_list a_args)
+{
+    output_t out = { a_buffer, a_size, 0 };
+    char digits[24];
+    const char* prefix;
+    const char* text;
+    unsigned long long value;
+    size_t len;
+    int left, zero, width, precision, longs, base, upper;
+
+    if (!a_size)
+	return 0;
+
+    while (*a_format) {
+	if (*a_format != '%') {
+	    output_char(&out, *a_format++);
+	    continue;
+	}
+
+	a_format++;
+	left = zero = width = longs = 0;
+	precision = -1;
+	for (; *a_format == '-' || *a_format == '0'; a_format++)
+	    *(*a_format == '-' ? &left : &zero) = 1;
+	if (*a_format == '*') {
+	    if ((width = va_arg(a_args, int)) < 0) {
+		left  = 1;
+		width = -width;
+	    }
+	    a_format++;
+	}
+	for (; *a_format >= '0' && *a_format <= '9'; a_format++)
+	    width = width * 10 + *a_format - '0';
+	if (*a_format == '.') {
+	    precision = 0;
+	    if (*++a_format == '*') {
+		if ((precision = va_arg(a_args, int)) < 0)
+		    precision = -1;
+		a_format++;
+	    }
+	    for (; *a_format >= '0' && *a_format <= '9'; a_format++)
+		precision = precision * 10 + *a_format - '0';
+	}
+	for (; *a_format == 'l' || *a_format == 'z' || *a_format == 'h';
+	     a_format++)
+	    longs += *a_format == 'l' ? 1 : *a_format == 'z' ? 3 : 0;
+
+	prefix = "";
+	base = 10;
+	upper = 0;
+	switch (*a_format) {
+	case 'd':
+	case 'i':
+	    {
+		long long n =
+		    longs >= 3 ? (long long) (ptrdiff_t) va_arg(a_args, size_t) :
+		    longs == 2 ? va_arg(a_args, long long) :
+		    longs == 1 ? va_arg(a_args, long) : va_arg(a_args, int);
+
+		if (n < 0) {
+		    prefix = "-";
+		    value = 0ULL - (unsigned long long) n;
+		}
+		else
+		    value = n;
+	    }
+	    break;
+	case 'u':
+	case 'x':
+	case 'X':
+	    value = longs >= 3 ? va_arg(a_args, size_t) :
+		longs == 2 ? va_arg(a_args, unsigned long long) :
+		longs == 1 ? va_arg(a_args, unsigned long) :
+		va_arg(a_args, unsigned int);
+	    base  = *a_format == 'u' ? 10 : 16;
+	    upper = *a_format == 'X';
+	    break;
+	case 'p':
+	    value  = (unsigned long long) (size_t) va_arg(a_args, void*);
+	    prefix = "0x";
+	    base   = 16;
+	    break;
+	case 'c':
+	    digits[0] = (char) va_arg(a_args, int);
+	    output_field(&out, "", digits, 1, width, left, 0);
+	    a_format++;
+	    continue;
+	case 's':
+	    if ((text = va_arg(a_args, const char*)) == NULL)
+		text = "(null)";
+	    for (len = 0; text[len] && (precision < 0 || len < (size_t) precision);
+		 len++)
+		;
+	    output_field(&out, "", text, len, width, left, 0);
+	    a_format++;
+	    continue;
+	case '%':
+	    output_char(&out, '%');
+	    a_format++;
+	    continue;
+	default:
+	    goto done;
+	}
+	a_format++;
+
+	len = sizeof(digits);
+	do {
+	    digits[--len] = (upper ? "0123456789ABCDEF" :
+			     "0123456789abcdef")[value % base];
+	    value /= base;
+	} while (value);
+	output_field(&out, prefix, digits + len, sizeof(digits) - len, width,
+		     left, zero);
+    }
+
+ done:
+    a_buffer[out.o_len] = '\0';
+    return out.o_len;
+}
+
+/*******************************************************************************/
+/* clock_gettime() is async-signal-safe, sd_clock_read() is not */
+static void sigsafe_now(unsigned long long* a_realtime,
+			unsigned long long* a_monotonic)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    *a_realtime = (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *a_monotonic = (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    /* stamped when drained */
+    *a_realtime  = 0;
+    *a_monotonic = 0;
+#endif
+}
+
+/*******************************************************************************/
+extern int log4c_sigsafe_log(const log4c_category_t* a_category,
+			     int a_priority, const char* a_format, ...)
+{
+    sigsafe_slot_t* slot;
+    XP_UINT64 position;
+    XP_INT64 diff;
+    va_list args;
+
+    if (!a_category || !a_format ||
+	log4c_category_get_chainedpriority(a_category) < a_priority)
+	return -1;
+
+    for (;;) {
+	position = SD_ATOMIC_LOAD(&sigsafe_head);
+	slot = SLOT_OF(position);
+	diff = (XP_INT64) (SD_ATOMIC_LOAD_ACQUIRE(&slot->ss_state) -
+			   2 * SLOT_LAP(position));
+	if (diff == 0) {
+	    if (SD_ATOMIC_CAS(&sigsafe_head, position, position + 1))
+		break;
+	}
+	else if (diff < 0) {
+	    /* the event of the previous lap is not drained */
+	    SD_ATOMIC_ADD(&sigsafe_drops, 1);
+	    return -1;
+	}
+    }
+
+    slot->ss_category = a_category;
+    slot->ss_priority = a_priority;
+    slot->ss_thread   = __log4c_thread_id();
+    sigsafe_now(&slot->ss_realtime, &slot->ss_monotonic);
+    va_start(args, a_format);
+    slot->ss_len = (unsigned int) sigsafe_vformat(slot->ss_msg,
+						  sizeof(slot->ss_msg),
+						  a_format, args);
+    va_end(args);
+
+    SD_ATOMIC_STORE_RELEASE(&slot->ss_state, 2 * SLOT_LAP(position) + 1);
+    return 0;
+}
+
+/*******************************************************************************/
+extern size_t log4c_sigsafe_format(char* a_buffer, size_t a_size,
+				   const char* a_format, ...)
+{
+    va_list args;
+    size_t len;
+
+    va_start(args, a_format);
+    len = sigsafe_vformat(a_buffer, a_size, a_format, args);
+    va_end(args);
+    return len;
+}
+
+/*******************************************************************************/
+static void sigsafe_dispatch(const sigsafe_slot_t* a_slot,
+			     XP_UINT64 a_position)
+{
+    const log4c_thread_t* self = log4c_thread_get();
+    log4c_logging_event_t evt;
+    log4c_thread_t thread;
+    char name[24];
+    sd_clock_time_t now;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_buffer.buf_maxsize = log4c_rc->config.bufsize;
+    evt.evt_buffer.buf_size = evt.evt_buffer.buf_maxsize ?
+	evt.evt_buffer.buf_maxsize : LOG4C_BUFFER_SIZE_DEFAULT;
+    evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
+
+    evt.evt_category	= log4c_category_get_name(a_slot->ss_category);
+    evt.evt_priority	= a_slot->ss_priority;
+    evt.evt_msg		= a_slot->ss_msg;
+    evt.evt_sequence	= a_position + 1;
+    evt.evt_thread	= self;
+
+    /* the name of another thread is not known, its id stands for it */
+    if (a_slot->ss_thread != self->th_id) {
+	log4c_sigsafe_format(name, sizeof(name), "%lu", a_slot->ss_thread);
+	thread.th_id   = a_slot->ss_thread;
+	thread.th_name = name;
+	evt.evt_thread = &thread;
+    }
+    if (a_slot->ss_realtime)
+	log4c_logging_event_set_time(&evt, a_slot->ss_realtime,
+				     a_slot->ss_monotonic);
+    else {
+	sd_clock_read(&now);
+	log4c_logging_event_set_time(&evt, now.ct_realtime, now.ct_monotonic);
+    }
+
+    __log4c_category_dispatch(a_slot->ss_category, &evt);
+
+    free(evt.evt_buffer.buf_data);
+}
+
+/*******************************************************************************/
+extern size_t log4c_sigsafe_drain(void)
+{
+    sigsafe_slot_t* slot;
+    sigsafe_slot_t event;
+    XP_UINT64 position;
+    size_t count = 0;
+
+#ifdef SIGSAFE_PTHREADS
+    pthread_mutex_lock(&sigsafe_mutex);
+#endif
+    for (;;) {
+	position = sigsafe_tail;
+	slot = SLOT_OF(position);
+	if (SD_ATOMIC_LOAD_ACQUIRE(&slot->ss_state) !=
+	    2 * SLOT_LAP(position) + 1)
+	    break;
+
+	/* the slot is given back before the appenders are called */
+	memcpy(&event, slot, sizeof(event));
+	SD_ATOMIC_STORE_RELEASE(&slot->ss_state, 2 * SLOT_LAP(position) + 2);
+	SD_ATOMIC_STORE_RELEASE(&sigsafe_tail, position + 1);
+
+	sigsafe_dispatch(&event, position);
+	count++;
+    }
+#ifdef SIGSAFE_PTHREADS
+    pthread_mutex_unlock(&sigsafe_mutex);
+#endif
+
+    return count;
+}
+
+/*******************************************************************************/
+extern unsigned long long log4c_sigsafe_get_drops(void)
+{
+    return SD_ATOMIC_LOAD(&sigsafe_drops);
+}
+
+/*******************************************************************************/
+extern void __log4c_sigsafe_bounds(unsigned long long* a_tail,
+				   unsigned long long* a_head)
+{
+    *a_tail = SD_ATOMIC_LOAD_ACQUIRE(&sigsafe_tail);
+    *a_head = SD_ATOMIC_LOAD_ACQUIRE(&sigsafe_head);
+}
+
+/*******************************************************************************/
+extern int __log4c_sigsafe_render(unsigned long long a_position,
+				  char* a_buffer, size_t a_size,
+				  unsigned long long* a_realtime,
+				  unsigned long long* a_monotonic)
+{
+    const sigsafe_slot_t* slot = SLOT_OF(a_position);
+    XP_UINT64 state = 2 * SLOT_LAP(a_position) + 1;
+    size_t len;
+
+    if (SD_ATOMIC_LOAD_ACQUIRE(&slot->ss_state) != state)
+	return -1;
+
+    len = log4c_sigsafe_format(a_buffer, a_size, "%-8s %s - %s\n",
+			       log4c_priority_to_string(slot->ss_priority),
+			       log4c_category_get_name(slot->ss_category),
+			       slot->ss_msg);
+    *a_realtime	 = slot->ss_realtime;
+    *a_monotonic = slot->ss_monotonic;
+
+    /* drained and written again meanwhile */
+    if (SD_ATOMIC_LOAD_ACQUIRE(&slot->ss_state) != state)
+	return -1;
+    return (int) len;
+}
@@ -0,0 +1,123 @@
+/* $Id$
+ *
+ * sigsafe.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_sigsafe_h
+#define log4c_sigsafe_h
+
+/**
+ * @file sigsafe.h
+ *
+ * @brief logging from signal handlers.
+ *
+ * log4c_category_log() allocates, formats with vsnprintf(), writes
+ * through stdio and takes locks: none of it may be done in a signal
+ * handler. log4c_sigsafe_log() only formats into a slot of a ring
+ * allocated with the library, reserved without a lock, so it can be
+ * called from a signal handler or by a thread which holds any lock.
+ *
+ * Its formatter knows @c %d, @c %i, @c %u, @c %x, @c %X, @c %c, @c %s,
+ * @c %p and @c %%, with the @c l, @c ll and @c z modifiers, the @c - and
+ * @c 0 flags, a width and a precision, given in the format or with @c *.
+ * The text stops at the first other conversion, whose argument could not
+ * be skipped.
+ *
+ * The events wait in the ring until log4c_sigsafe_drain() sends them to
+ * the appenders of their categories. The binlog background thread
+ * started by log4c_binlog_start() drains the ring as it goes, and
+ * log4c_fini() drains it too. A crash dump of the flight recorders
+ * holds the events still in the ring.
+ *
+ * @code
+ * static void on_sigchld(int a_signal)
+ * {
+ *     log4c_sigsafe_log(cat, LOG4C_PRIORITY_INFO, "child %d exited",
+ *                       (int) waitpid(-1, NULL, WNOHANG));
+ * }
+ * @endcode
+ **/
+
+#include <stddef.h>
+#include <log4c/defs.h>
+#include <log4c/category.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The number of events the ring holds. The events logged while it is
+ * full are dropped.
+ **/
+#define LOG4C_SIGSAFE_SLOTS		256
+
+/**
+ * The longest message, '\0' included. Longer messages are truncated.
+ **/
+#define LOG4C_SIGSAFE_MESSAGE_MAX	208
+
+/**
+ * Logs an event from a signal handler. The priority of the category is
+ * checked as by log4c_category_is_priority_enabled(), without the
+ * priority override of the thread nor the backtrace of the category.
+ * The event is timestamped when it is logged and keeps the id of the
+ * thread which logged it, named after its id unless it is the thread
+ * which drains it; it reaches the appenders without diagnostic contexts.
+ *
+ * @param a_category the category
+ * @param a_priority the priority of the event
+ * @param a_format the format, with the conversions described above
+ * @returns 0, or -1 if the event is not logged or the ring is full
+ **/
+LOG4C_API int log4c_sigsafe_log(const log4c_category_t* a_category,
+				int a_priority, const char* a_format, ...);
+
+/**
+ * Sends the events of the ring to the appenders of their categories, in
+ * the order they were logged. Must not be called from a signal handler.
+ *
+ * @returns the number of events sent
+ **/
+LOG4C_API size_t log4c_sigsafe_drain(void);
+
+/**
+ * @returns the number of events dropped because the ring was full
+ **/
+LOG4C_API unsigned long long log4c_sigsafe_get_drops(void);
+
+/**
+ * Formats like log4c_sigsafe_log(), into a buffer. Async-signal-safe.
+ *
+ * @param a_buffer the buffer
+ * @param a_size the size of the buffer
+ * @param a_format the format
+ * @returns the length of the text, '\0' excluded, truncated to fit
+ **/
+LOG4C_API size_t log4c_sigsafe_format(char* a_buffer, size_t a_size,
+				      const char* a_format, ...);
+
+/**
+ * @internal
+ * The positions of the oldest event of the ring and after the newest
+ * one. Async-signal-safe.
+ **/
+LOG4C_API void __log4c_sigsafe_bounds(unsigned long long* a_tail,
+				      unsigned long long* a_head);
+
+/**
+ * @internal
+ * Renders the event at a position of the ring as a line of the basic
+ * layout, without consuming it. Async-signal-safe.
+ *
+ * @returns the length of the line, or -1 if the slot does not hold that
+ * event
+ **/
+LOG4C_API int __log4c_sigsafe_render(unsigned long long a_position,
+				     char* a_buffer, size_t a_size,
+				     unsigned long long* a_realtime,
+				     unsigned long long* a_monotonic);
+
+__LOG4C_END_DECLS
+
+#endif
@@ -0,0 +1,624 @@
+static const char version[] = "$Id$";
+
+/*
+ * stats.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/stats.h>
+#include <log4c/appender.h>
+#include <log4c/category.h>
+#include <sd/factory.h>
+#include <sd/error.h>
+#include <sd/sd_xplatform.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include "lock.h"
+#define STATS_THREADS
+#endif
+
+/*
+ * The counters of a thread, in pages indexed by appender and category
+ * ids. Only the owning thread writes to a block; pages are published
+ * with a release store so that readers see them initialized.
+ *
+ * log4c_stats_reset() does not write to the blocks of other threads: it
+ * bumps the reset epoch, readers skip the blocks of an older epoch and
+ * each thread clears its own block when it next counts something.
+ */
+#define STATS_PAGE_SHIFT	10
+#define STATS_PAGE_SIZE		(1 << STATS_PAGE_SHIFT)
+#define STATS_NPAGES		1024
+#define STATS_MAXID		(STATS_PAGE_SIZE * STATS_NPAGES)
+
+typedef struct __log4c_stats_block {
+    struct __log4c_stats_block*	sb_next;
+    log4c_stats_t*		sb_appenders[STATS_NPAGES];
+    XP_UINT64*			sb_categories[STATS_NPAGES];
+    int				sb_dropped;
+    unsigned int		sb_epoch;
+} log4c_stats_block_t;
+
+/* single writer: a relaxed store is enough to keep readers untorn */
+#define STATS_ADD(counter, value) \
+    SD_ATOMIC_STORE(&(counter), (counter) + (value))
+
+static int stats_timing = 0;
+static int stats_lock_profiling = 0;
+
+/* counters of the threads which have exited */
+static log4c_stats_block_t stats_retired;
+
+/* incremented by each log4c_stats_reset() */
+static unsigned int stats_epoch = 0;
+
+#ifdef STATS_THREADS
+static log4c_stats_block_t* stats_blocks = NULL;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+#ifdef SD_TLS
+static SD_TLS log4c_stats_block_t* stats_self = NULL;
+#endif
+#define STATS_LOCK()	pthread_mutex_lock(&stats_mutex)
+#define STATS_UNLOCK()	pthread_mutex_unlock(&stats_mutex)
+
+/*
+ * Several locks, possibly held at the same time, share the counters of a
+ * site: they are updated with atomic additions.
+ */
+log4c_lock_site_t __log4c_lock_site_rollingfile = { "rollingfile" };
+log4c_lock_site_t __log4c_lock_site_file = { "file" };
+log4c_lock_site_t __log4c_lock_site_ansicolor = { "ansicolor" };
+
+static log4c_lock_site_t* const lock_sites[] = {
+    &__log4c_lock_site_rollingfile,
+    &__log4c_lock_site_file,
+    &__log4c_lock_site_ansicolor,
+};
+#define NLOCK_SITES ((int) (sizeof(lock_sites) / sizeof(lock_sites[0])))
+#else
+#define STATS_LOCK()
+#define STATS_UNLOCK()
+#endif
+
+/*******************************************************************************/
+static XP_UINT64 stats_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER count;
+    LARGE_INTEGER freq;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (XP_UINT64) (count.QuadPart * (1e9 / freq.QuadPart));
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (XP_UINT64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*******************************************************************************/
+static log4c_stats_t* block_appender(log4c_stats_block_t* this, int a_id)
+{
+    log4c_stats_t** page;
+
+    if (a_id < 0 || a_id >= STATS_MAXID)
+	return NULL;
+
+    page = &this->sb_appenders[a_id >> STATS_PAGE_SHIFT];
+    if (!*page) {
+	log4c_stats_t* p = calloc(STATS_PAGE_SIZE, sizeof(log4c_stats_t));
+
+	if (!p)
+	    return NULL;
+	SD_ATOMIC_STORE_RELEASE(page, p);
+    }
+    return &(*page)[a_id & (STATS_PAGE_SIZE - 1)];
+}
+
+/*******************************************************************************/
+static XP_UINT64* block_category(log4c_stats_block_t* this, int a_id)
+{
+    XP_UINT64** page;
+
+    if (a_id < 0 || a_id >= STATS_MAXID)
+	return NULL;
+
+    page = &this->sb_categories[a_id >> STATS_PAGE_SHIFT];
+    if (!*page) {
+	XP_UINT64* p = calloc(STATS_PAGE_SIZE, sizeof(XP_UINT64));
+
+	if (!p)
+	    return NULL;
+	SD_ATOMIC_STORE_RELEASE(page, p);
+    }
+    return &(*page)[a_id & (STATS_PAGE_SIZE - 1)];
+}
+
+/*******************************************************************************/
+static void block_sum_appender(const log4c_stats_block_t* this, int a_id,
+			       log4c_stats_t* a_stats)
+{
+    const log4c_stats_t* page;
+    const log4c_stats_t* s;
+
+    if ((page = SD_ATOMIC_LOAD_ACQUIRE(&this->sb_appenders[a_id >> STATS_PAGE_SHIFT])) == NULL)
+	return;
+
+    s = &page[a_id & (STATS_PAGE_SIZE - 1)];
+    a_stats->st_events	  += SD_ATOMIC_LOAD(&s->st_events);
+    a_stats->st_bytes	  += SD_ATOMIC_LOAD(&s->st_bytes);
+    a_stats->st_drops	  += SD_ATOMIC_LOAD(&s->st_drops);
+    a_stats->st_rollovers += SD_ATOMIC_LOAD(&s->st_rollovers);
+    a_stats->st_append_ns += SD_ATOMIC_LOAD(&s->st_append_ns);
+}
+
+/*******************************************************************************/
+static XP_UINT64 block_sum_category(const log4c_stats_block_t* this, int a_id)
+{
+    const XP_UINT64* page;
+
+    if ((page = SD_ATOMIC_LOAD_ACQUIRE(&this->sb_categories[a_id >> STATS_PAGE_SHIFT])) == NULL)
+	return 0;
+
+    return SD_ATOMIC_LOAD(&page[a_id & (STATS_PAGE_SIZE - 1)]);
+}
+
+/*******************************************************************************/
+/* atomic stores, for the readers summing the block meanwhile */
+static void block_clear(log4c_stats_block_t* this)
+{
+    int i, j;
+
+    for (i = 0; i < STATS_NPAGES; i++) {
+	for (j = 0; this->sb_appenders[i] && j < STATS_PAGE_SIZE; j++) {
+	    log4c_stats_t* s = &this->sb_appenders[i][j];
+
+	    SD_ATOMIC_STORE(&s->st_events, 0);
+	    SD_ATOMIC_STORE(&s->st_bytes, 0);
+	    SD_ATOMIC_STORE(&s->st_drops, 0);
+	    SD_ATOMIC_STORE(&s->st_rollovers, 0);
+	    SD_ATOMIC_STORE(&s->st_append_ns, 0);
+	}
+	for (j = 0; this->sb_categories[i] && j < STATS_PAGE_SIZE; j++)
+	    SD_ATOMIC_STORE(&this->sb_categories[i][j], 0);
+    }
+}
+
+#ifdef STATS_THREADS
+/*******************************************************************************/
+/* whether the counters of a block were reset since it last counted */
+static int block_is_stale(const log4c_stats_block_t* this)
+{
+    return SD_ATOMIC_LOAD_ACQUIRE(&this->sb_epoch) !=
+	SD_ATOMIC_LOAD(&stats_epoch);
+}
+
+/*******************************************************************************/
+/* folds the counters of an exiting thread into the retired ones */
+static void stats_thread_exit(void* a_block)
+{
+    log4c_stats_block_t* this = a_block;
+    log4c_stats_block_t** b;
+    int stale;
+    int i, j;
+
+    STATS_LOCK();
+    stale = block_is_stale(this);
+    for (b = &stats_blocks; *b; b = &(*b)->sb_next)
+	if (*b == this) {
+	    *b = this->sb_next;
+	    break;
+	}
+
+    for (i = 0; i < STATS_NPAGES; i++) {
+	for (j = 0; this->sb_appenders[i] && j < STATS_PAGE_SIZE; j++) {
+	    const log4c_stats_t* s = &this->sb_appenders[i][j];
+	    log4c_stats_t* r;
+
+	    if (stale || (!s->st_events && !s->st_rollovers))
+		continue;
+	    if ((r = block_appender(&stats_retired, (i << STATS_PAGE_SHIFT) + j)) == NULL)
+		continue;
+	    STATS_ADD(r->st_events, s->st_events);
+	    STATS_ADD(r->st_bytes, s->st_bytes);
+	    STATS_ADD(r->st_drops, s->st_drops);
+	    STATS_ADD(r->st_rollovers, s->st_rollovers);
+	    STATS_ADD(r->st_append_ns, s->st_append_ns);
+	}
+	for (j = 0; this->sb_categories[i] && j < STATS_PAGE_SIZE; j++) {
+	    XP_UINT64* r;
+
+	    if (stale || !this->sb_categories[i][j] ||
+		(r = block_category(&stats_retired, (i << STATS_PAGE_SHIFT) + j)) == NULL)
+		continue;
+	    STATS_ADD(*r, this->sb_categories[i][j]);
+	}
+	free(this->sb_appenders[i]);
+	free(this->sb_categories[i]);
+    }
+    STATS_UNLOCK();
+
+#ifdef SD_TLS
+    stats_self = NULL;
+#endif
+    free(this);
+}
+
+/*******************************************************************************/
+static void stats_key_create(void)
+{
+    pthread_key_create(&stats_key, stats_thread_exit);
+}
+#endif
+
+/*******************************************************************************/
+static log4c_stats_block_t* stats_block(void)
+{
+#ifdef STATS_THREADS
+    log4c_stats_block_t* this;
+
+#ifdef SD_TLS
+    if ((this = stats_self) != NULL)
+	goto found;
+#endif
+
+    pthread_once(&stats_once, stats_key_create);
+
+#ifndef SD_TLS
+    if ((this = pthread_getspecific(stats_key)) != NULL)
+	goto found;
+#endif
+
+    if ((this = calloc(1, sizeof(*this))) == NULL)
+	return NULL;
+    this->sb_epoch = SD_ATOMIC_LOAD(&stats_epoch);
+
+    pthread_setspecific(stats_key, this);
+#ifdef SD_TLS
+    stats_self = this;
+#endif
+
+    STATS_LOCK();
+    this->sb_next = stats_blocks;
+    stats_blocks  = this;
+    STATS_UNLOCK();
+    return this;
+
+ found:
+    if (block_is_stale(this)) {
+	unsigned int epoch = SD_ATOMIC_LOAD(&stats_epoch);
+
+	block_clear(this);
+	SD_ATOMIC_STORE_RELEASE(&this->sb_epoch, epoch);
+    }
+    return this;
+#else
+    return &stats_retired;
+#endif
+}
+
+/*******************************************************************************/
+extern unsigned long long __log4c_stats_start(void)
+{
+    return stats_timing ? stats_now() : 0;
+}
+
+/*******************************************************************************/
+extern void __log4c_stats_append(int a_id, const char* a_msg, int a_rc,
+				 unsigned long long a_start)
+{
+    log4c_stats_block_t* block;
+    log4c_stats_t* s;
+    int dropped;
+
+    if ((block = stats_block()) == NULL)
+	return;
+
+    dropped = block->sb_dropped || a_rc < 0 || !a_msg;
+    block->sb_dropped = 0;
+
+    if ((s = block_appender(block, a_id)) == NULL)
+	return;
+
+    STATS_ADD(s->st_events, 1);
+    if (dropped)
+	STATS_ADD(s->st_drops, 1);
+    else if (a_rc > 0)
+	STATS_ADD(s->st_bytes, a_rc);
+    if (a_start)
+	STATS_ADD(s->st_append_ns, stats_now() - a_start);
+}
+
+/*******************************************************************************/
+extern void __log4c_stats_drop(void)
+{
+    log4c_stats_block_t* block;
+
+    if ((block = stats_block()) != NULL)
+	block->sb_dropped = 1;
+}
+
+/*******************************************************************************/
+extern void __log4c_stats_rollover(int a_id)
+{
+    log4c_stats_block_t* block;
+    log4c_stats_t* s;
+
+    if ((block = stats_block()) != NULL &&
+	(s = block_appender(block, a_id)) != NULL)
+	STATS_ADD(s->st_rollovers, 1);
+}
+
+/*******************************************************************************/
+extern void __log4c_stats_category(int a_id)
+{
+    log4c_stats_block_t* block;
+    XP_UINT64* n;
+
+    if ((block = stats_block()) != NULL &&
+	(n = block_category(block, a_id)) != NULL)
+	STATS_ADD(*n, 1);
+}
+
+/*******************************************************************************/
+extern int log4c_stats_get_appender(const log4c_appender_t* a_appender,
+				    log4c_stats_t* a_stats)
+{
+    int id = log4c_appender_get_id(a_appender);
+#ifdef STATS_THREADS
+    const log4c_stats_block_t* b;
+#endif
+
+    if (!a_stats || id < 0)
+	return -1;
+
+    memset(a_stats, 0, sizeof(*a_stats));
+    if (id >= STATS_MAXID)
+	return 0;
+
+    STATS_LOCK();
+    block_sum_appender(&stats_retired, id, a_stats);
+#ifdef STATS_THREADS
+    for (b = stats_blocks; b; b = b->sb_next)
+	if (!block_is_stale(b))
+	    block_sum_appender(b, id, a_stats);
+#endif
+    STATS_UNLOCK();
+    return 0;
+}
+
+/*******************************************************************************/
+extern unsigned long long log4c_stats_get_category(const log4c_category_t* a_category)
+{
+    int id = log4c_category_get_id(a_category);
+    XP_UINT64 n;
+#ifdef STATS_THREADS
+    const log4c_stats_block_t* b;
+#endif
+
+    if (id < 0 || id >= STATS_MAXID)
+	return 0;
+
+    STATS_LOCK();
+    n = block_sum_category(&stats_retired, id);
+#ifdef STATS_THREADS
+    for (b = stats_blocks; b; b = b->sb_next)
+	if (!block_is_stale(b))
+	    n += block_sum_category(b, id);
+#endif
+    STATS_UNLOCK();
+    return n;
+}
+
+/*******************************************************************************/
+extern int log4c_stats_set_timing(int a_timing)
+{
+    int previous = stats_timing;
+
+    stats_timing = a_timing;
+    return previous;
+}
+
+/*******************************************************************************/
+extern int log4c_stats_get_timing(void)
+{
+    return stats_timing;
+}
+
+#ifdef STATS_THREADS
+/*******************************************************************************/
+extern int __log4c_lock(log4c_lock_site_t* a_site, pthread_mutex_t* a_mutex,
+			unsigned long long* a_acquired)
+{
+    log4c_lock_stats_t* s = &a_site->site_stats;
+    XP_UINT64 start;
+    XP_UINT64 wait;
+    int rc;
+
+    if (!stats_lock_profiling) {
+	*a_acquired = 0;
+	return pthread_mutex_lock(a_mutex);
+    }
+
+    if ((rc = pthread_mutex_trylock(a_mutex)) == 0) {
+	*a_acquired = stats_now();
+	SD_ATOMIC_ADD(&s->ls_acquisitions, 1);
+	return 0;
+    }
+
+    start = stats_now();
+    if ((rc = pthread_mutex_lock(a_mutex)) != 0) {
+	*a_acquired = 0;
+	return rc;
+    }
+    *a_acquired = stats_now();
+    wait = *a_acquired - start;
+
+    SD_ATOMIC_ADD(&s->ls_acquisitions, 1);
+    SD_ATOMIC_ADD(&s->ls_contended, 1);
+    SD_ATOMIC_ADD(&s->ls_wait_ns, wait);
+    /* may miss a longer wait of a lock of the same site at the same time */
+    if (wait > SD_ATOMIC_LOAD(&s->ls_max_wait_ns))
+	SD_ATOMIC_STORE(&s->ls_max_wait_ns, wait);
+    return 0;
+}
+
+/*******************************************************************************/
+extern int __log4c_unlock(log4c_lock_site_t* a_site, pthread_mutex_t* a_mutex,
+			  unsigned long long a_acquired)
+{
+    if (a_acquired)
+	SD_ATOMIC_ADD(&a_site->site_stats.ls_hold_ns, stats_now() - a_acquired);
+
+    return pthread_mutex_unlock(a_mutex);
+}
+#endif
+
+/*******************************************************************************/
+extern int log4c_stats_get_lock(const char* a_name, log4c_lock_stats_t* a_stats)
+{
+#ifdef STATS_THREADS
+    int i;
+
+    if (!a_name || !a_stats)
+	return -1;
+
+    for (i = 0; i < NLOCK_SITES; i++) {
+	const log4c_lock_stats_t* s = &lock_sites[i]->site_stats;
+
+	if (strcmp(lock_sites[i]->site_name, a_name))
+	    continue;
+
+	a_stats->ls_acquisitions = SD_ATOMIC_LOAD(&s->ls_acquisitions);
+	a_stats->ls_contended	 = SD_ATOMIC_LOAD(&s->ls_contended);
+	a_stats->ls_wait_ns	 = SD_ATOMIC_LOAD(&s->ls_wait_ns);
+	a_stats->ls_max_wait_ns	 = SD_ATOMIC_LOAD(&s->ls_max_wait_ns);
+	a_stats->ls_hold_ns	 = SD_ATOMIC_LOAD(&s->ls_hold_ns);
+	return 0;
+    }
+#endif
+    return -1;
+}
+
+/*******************************************************************************/
+extern int log4c_stats_set_lock_profiling(int a_profiling)
+{
+    int previous = stats_lock_profiling;
+
+    stats_lock_profiling = a_profiling;
+    return previous;
+}
+
+/*******************************************************************************/
+extern int log4c_stats_get_lock_profiling(void)
+{
+    return stats_lock_profiling;
+}
+
+/*******************************************************************************/
+extern void log4c_stats_reset(void)
+{
+#ifdef STATS_THREADS
+    int i;
+#endif
+
+    STATS_LOCK();
+    block_clear(&stats_retired);
+    SD_ATOMIC_STORE_RELEASE(&stats_epoch, stats_epoch + 1);
+#ifdef STATS_THREADS
+    for (i = 0; i < NLOCK_SITES; i++) {
+	log4c_lock_stats_t* s = &lock_sites[i]->site_stats;
+
+	SD_ATOMIC_STORE(&s->ls_acquisitions, 0);
+	SD_ATOMIC_STORE(&s->ls_contended, 0);
+	SD_ATOMIC_STORE(&s->ls_wait_ns, 0);
+	SD_ATOMIC_STORE(&s->ls_max_wait_ns, 0);
+	SD_ATOMIC_STORE(&s->ls_hold_ns, 0);
+    }
+#endif
+    STATS_UNLOCK();
+}
+
+/*******************************************************************************/
+extern int log4c_stats_dump(FILE* a_stream)
+{
+    log4c_appender_t* some[64];
+    log4c_appender_t** appenders = some;
+    log4c_stats_t stats;
+    int i, n;
+
+    if (!a_stream)
+	return -1;
+
+    n = sd_factory_list(log4c_appender_factory, (void**) some, 64);
+    if (n > 64) {
+	if ((appenders = malloc(n * sizeof(*appenders))) == NULL)
+	    return -1;
+	n = sd_factory_list(log4c_appender_factory, (void**) appenders, n);
+    }
+
+    for (i = 0; i < n; i++) {
+	log4c_stats_get_appender(appenders[i], &stats);
+	fprintf(a_stream, "appender '%s' events=%llu bytes=%llu drops=%llu "
+		"rollovers=%llu append_ns=%llu\n",
+		log4c_appender_get_name(appenders[i]),
+		stats.st_events, stats.st_bytes, stats.st_drops,
+		stats.st_rollovers, stats.st_append_ns);
+    }
+    if (appenders != some)
+	free(appenders);
+
+#ifdef STATS_THREADS
+    for (i = 0; i < NLOCK_SITES; i++) {
+	log4c_lock_stats_t lock;
+
+	log4c_stats_get_lock(lock_sites[i]->site_name, &lock);
+	fprintf(a_stream, "lock '%s' acquisitions=%llu contended=%llu "
+		"wait_ns=%llu max_wait_ns=%llu hold_ns=%llu\n",
+		lock_sites[i]->site_name, lock.ls_acquisitions,
+		lock.ls_contended, lock.ls_wait_ns, lock.ls_max_wait_ns,
+		lock.ls_hold_ns);
+    }
+#endif
+
+    n = log4c_category_get_count();
+    for (i = 0; i < n; i++) {
+	const log4c_category_t* cat = log4c_category_get_by_id(i);
+	unsigned long long nevents = log4c_stats_get_category(cat);
+
+	if (nevents)
+	    fprintf(a_stream, "category '%s' events=%llu\n",
+		    log4c_category_get_name(cat), nevents);
+    }
+
+    return ferror(a_stream) ? -1 : 0;
+}
+
+/*******************************************************************************/
+extern int log4c_stats_dump_file(const char* a_filename)
+{
+    FILE* fp;
+    int rc;
+
+    if (!a_filename || (fp = fopen(a_filename, "w")) == NULL) {
+	sd_error("can not open stats file '%s'", a_filename ? a_filename : "");
+	return -1;
+    }
+
+    rc = log4c_stats_dump(fp);
+    if (fclose(fp) != 0)
+	rc = -1;
+    return rc;
+}
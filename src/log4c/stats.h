@@ -0,0 +1,193 @@
+/* $Id$
+ *
+ * stats.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_stats_h
+#define log4c_stats_h
+
+/**
+ * @file stats.h
+ *
+ * @brief runtime counters of appenders and categories.
+ *
+ * Each thread counts the events it logs in its own counters, without
+ * locking. The counters of all threads are added up when they are read,
+ * including those of threads which have exited.
+ *
+ * The time spent appending is only measured when enabled with
+ * log4c_stats_set_timing(), since it reads the clock twice per event.
+ * Likewise the internal locks of the appenders are only profiled when
+ * enabled with log4c_stats_set_lock_profiling().
+ **/
+
+#include <stdio.h>
+#include <stddef.h>
+#include <log4c/defs.h>
+
+__LOG4C_BEGIN_DECLS
+
+struct __log4c_appender;
+struct __log4c_category;
+
+/**
+ * Counters of an appender.
+ *
+ * @li @c st_events the number of events given to the appender
+ * @li @c st_bytes the number of bytes written, as returned by the append
+ * function of the appender type
+ * @li @c st_drops the number of events which could not be written
+ * @li @c st_rollovers the number of rollovers of a rollingfile appender
+ * @li @c st_append_ns the time spent appending, in nanoseconds
+ **/
+typedef struct {
+    unsigned long long	st_events;
+    unsigned long long	st_bytes;
+    unsigned long long	st_drops;
+    unsigned long long	st_rollovers;
+    unsigned long long	st_append_ns;
+} log4c_stats_t;
+
+/**
+ * Counters of an internal lock, added up over all the locks of a site:
+ * the appender type which owns them.
+ *
+ * @li @c ls_acquisitions the number of times the lock was taken
+ * @li @c ls_contended the number of times it was held by another thread
+ * @li @c ls_wait_ns the time spent waiting for it, in nanoseconds
+ * @li @c ls_max_wait_ns the longest wait, in nanoseconds
+ * @li @c ls_hold_ns the time it was held, in nanoseconds
+ **/
+typedef struct {
+    unsigned long long	ls_acquisitions;
+    unsigned long long	ls_contended;
+    unsigned long long	ls_wait_ns;
+    unsigned long long	ls_max_wait_ns;
+    unsigned long long	ls_hold_ns;
+} log4c_lock_stats_t;
+
+/**
+ * Reads the counters of an appender.
+ *
+ * @param a_appender the appender
+ * @param a_stats the counters to fill in
+ * @returns 0 or -1 if a parameter is NULL
+ **/
+LOG4C_API int log4c_stats_get_appender(const struct __log4c_appender* a_appender,
+				       log4c_stats_t* a_stats);
+
+/**
+ * Returns the number of events logged to a category.
+ *
+ * @param a_category the category
+ **/
+LOG4C_API unsigned long long log4c_stats_get_category(
+    const struct __log4c_category* a_category);
+
+/**
+ * Enables or disables the measure of the time spent appending.
+ *
+ * @param a_timing 1 to enable, 0 to disable
+ * @returns the previous setting
+ **/
+LOG4C_API int log4c_stats_set_timing(int a_timing);
+
+/**
+ * @returns whether the time spent appending is measured
+ **/
+LOG4C_API int log4c_stats_get_timing(void);
+
+/**
+ * Reads the counters of a lock site.
+ *
+ * @param a_name the name of the site: "rollingfile", "file" or "ansicolor"
+ * @param a_stats the counters to fill in
+ * @returns 0 or -1 if there is no such site
+ **/
+LOG4C_API int log4c_stats_get_lock(const char* a_name, 
+				   log4c_lock_stats_t* a_stats);
+
+/**
+ * Enables or disables the profiling of internal locks. When disabled, a
+ * lock costs one more test.
+ *
+ * @param a_profiling 1 to enable, 0 to disable
+ * @returns the previous setting
+ **/
+LOG4C_API int log4c_stats_set_lock_profiling(int a_profiling);
+
+/**
+ * @returns whether the internal locks are profiled
+ **/
+LOG4C_API int log4c_stats_get_lock_profiling(void);
+
+/**
+ * Sets all counters back to zero. Events logged by other threads while
+ * resetting may or may not be counted.
+ **/
+LOG4C_API void log4c_stats_reset(void);
+
+/**
+ * Prints the counters of all appenders, of the lock sites and of the
+ * categories which logged events, one per line.
+ *
+ * @param a_stream the stream
+ * @returns 0 or -1 on error
+ **/
+LOG4C_API int log4c_stats_dump(FILE* a_stream);
+
+/**
+ * Same as log4c_stats_dump(), to a file which is overwritten.
+ *
+ * @param a_filename the name of the file
+ * @returns 0 or -1 on error
+ **/
+LOG4C_API int log4c_stats_dump_file(const char* a_filename);
+
+/**
+ * @internal
+ * Returns a start time for __log4c_stats_append(), 0 when timing is
+ * disabled.
+ **/
+LOG4C_API unsigned long long __log4c_stats_start(void);
+
+/**
+ * @internal
+ * Counts an event appended by an appender.
+ *
+ * @param a_id the appender id
+ * @param a_msg the rendered message, NULL if it was not appended
+ * @param a_rc the return code of the appender
+ * @param a_start the value returned by __log4c_stats_start()
+ **/
+LOG4C_API void __log4c_stats_append(int a_id, const char* a_msg, int a_rc,
+				    unsigned long long a_start);
+
+/**
+ * @internal
+ * Marks the event being appended by the current thread as dropped, for
+ * appenders which do not return an error when they drop an event.
+ **/
+LOG4C_API void __log4c_stats_drop(void);
+
+/**
+ * @internal
+ * Counts a rollover of an appender.
+ *
+ * @param a_id the appender id
+ **/
+LOG4C_API void __log4c_stats_rollover(int a_id);
+
+/**
+ * @internal
+ * Counts an event logged to a category.
+ *
+ * @param a_id the category id
+ **/
+LOG4C_API void __log4c_stats_category(int a_id);
+
+__LOG4C_END_DECLS
+
+#endif
@@ -0,0 +1,137 @@
+static const char version[] = "$Id$";
+
+/*
+ * thread.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/thread.h>
+#include <sd/sprintf.h>
+#include <sd/sd_xplatform.h>
+#include <sd/malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#endif
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+#include <pthread.h>
+#define THREAD_PTHREADS
+#endif
+
+/* ts_self.th_name is NULL until the thread is looked up */
+typedef struct {
+    log4c_thread_t	ts_self;
+    char		ts_name[LOG4C_THREAD_NAME_MAX];
+} thread_state_t;
+
+#ifdef SD_TLS
+static SD_TLS thread_state_t thread_state;
+#elif !defined(THREAD_PTHREADS)
+static thread_state_t thread_state;
+#endif
+
+#ifdef THREAD_PTHREADS
+static pthread_once_t thread_once = PTHREAD_ONCE_INIT;
+#ifndef SD_TLS
+static pthread_key_t thread_key;
+#endif
+
+static thread_state_t* thread_state_get(void);
+
+/*******************************************************************************/
+/* the thread which forked is another thread in the child */
+static void thread_atfork_child(void)
+{
+    thread_state_get()->ts_self.th_name = NULL;
+}
+
+/*******************************************************************************/
+static void thread_init(void)
+{
+    pthread_atfork(NULL, NULL, thread_atfork_child);
+#ifndef SD_TLS
+    pthread_key_create(&thread_key, free);
+#endif
+}
+#endif
+
+/*******************************************************************************/
+/* the state of the thread, allocated when it is first needed without TLS */
+static thread_state_t* thread_state_get(void)
+{
+#if defined(SD_TLS) || !defined(THREAD_PTHREADS)
+    return &thread_state;
+#else
+    thread_state_t* this;
+
+    pthread_once(&thread_once, thread_init);
+    if ((this = pthread_getspecific(thread_key)) == NULL) {
+	this = sd_calloc(1, sizeof(*this));
+	pthread_setspecific(thread_key, this);
+    }
+    return this;
+#endif
+}
+
+/*******************************************************************************/
+extern unsigned long __log4c_thread_id(void)
+{
+#if defined(__linux__) && defined(SYS_gettid)
+    return (unsigned long) syscall(SYS_gettid);
+#elif defined(_WIN32)
+    return (unsigned long) GetCurrentThreadId();
+#elif defined(THREAD_PTHREADS)
+    return (unsigned long) pthread_self();
+#else
+    return 0;
+#endif
+}
+
+/*******************************************************************************/
+static void thread_lookup(thread_state_t* this, const char* a_name)
+{
+#ifdef THREAD_PTHREADS
+    pthread_once(&thread_once, thread_init);
+#endif
+
+    this->ts_self.th_id = __log4c_thread_id();
+
+    this->ts_name[0] = '\0';
+    if (a_name)
+	sd_snprintf(this->ts_name, sizeof(this->ts_name), "%s", a_name);
+#if defined(__linux__) && defined(PR_GET_NAME)
+    /* 16 bytes at most */
+    else if (prctl(PR_GET_NAME, (unsigned long) this->ts_name, 0, 0, 0) == -1)
+	this->ts_name[0] = '\0';
+#endif
+
+    if (!this->ts_name[0])
+	sd_snprintf(this->ts_name, sizeof(this->ts_name), "%lu",
+		    this->ts_self.th_id);
+    this->ts_self.th_name = this->ts_name;
+}
+
+/*******************************************************************************/
+extern const log4c_thread_t* log4c_thread_get(void)
+{
+    thread_state_t* this = thread_state_get();
+
+    if (!this->ts_self.th_name)
+	thread_lookup(this, NULL);
+    return &this->ts_self;
+}
+
+/*******************************************************************************/
+extern void log4c_thread_set_name(const char* a_name)
+{
+    thread_lookup(thread_state_get(), a_name);
+}
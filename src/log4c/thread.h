@@ -0,0 +1,70 @@
+/* $Id$
+ *
+ * thread.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_thread_h
+#define log4c_thread_h
+
+/**
+ * @file thread.h
+ *
+ * @brief The identity of the logging threads.
+ *
+ * The id and the name of a thread are looked up the first time it logs
+ * an event which a layout or an appender wants them for, and kept in
+ * thread-local storage: later events only copy a pointer.
+ *
+ * The id is the one the system shows: the kernel thread id on Linux, the
+ * thread id on Windows, pthread_self() elsewhere. The name is the one
+ * the thread was given with pthread_setname_np() or prctl() on Linux,
+ * then the id in decimal; log4c_thread_set_name() replaces it.
+ **/
+
+#include <log4c/defs.h>
+
+__LOG4C_BEGIN_DECLS
+
+/**
+ * The longest thread name kept, '\0' included.
+ **/
+#define LOG4C_THREAD_NAME_MAX	32
+
+/**
+ * @brief the identity of a thread
+ *
+ * @li @c th_id the id of the thread
+ * @li @c th_name the name of the thread
+ **/
+typedef struct {
+    unsigned long	th_id;
+    const char*		th_name;
+} log4c_thread_t;
+
+/**
+ * @returns the identity of the calling thread, which stays valid until
+ * it exits
+ **/
+LOG4C_API const log4c_thread_t* log4c_thread_get(void);
+
+/**
+ * Names the calling thread in the events it logs from now on. The
+ * system name of the thread is left alone.
+ *
+ * @param a_name the name, cut to LOG4C_THREAD_NAME_MAX - 1 characters,
+ * or NULL to go back to the system name
+ **/
+LOG4C_API void log4c_thread_set_name(const char* a_name);
+
+/**
+ * @internal
+ * @returns the id of the calling thread, looked up again rather than kept.
+ * Async-signal-safe.
+ **/
+LOG4C_API unsigned long __log4c_thread_id(void);
+
+__LOG4C_END_DECLS
+
+#endif
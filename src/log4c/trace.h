@@ -0,0 +1,56 @@
+/* $Id$
+ *
+ * trace.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_trace_h
+#define log4c_trace_h
+
+/**
+ * @file trace.h
+ *
+ * @brief static tracepoints of the log4c provider.
+ *
+ * When configure finds sys/sdt.h, the probes below are compiled in as
+ * USDT probes which perf, bpftrace or systemtap can attach to at run
+ * time, e.g. usdt:liblog4c.so:log4c:appender_append_end. They cost a nop
+ * when nothing is attached. Otherwise they are compiled out.
+ *
+ * Probe arguments are evaluated even when nothing is attached, so only
+ * values already at hand are passed. Strings are passed as pointers and
+ * the byte count of an append is the return code of the appender, which
+ * is the number of bytes written for the stream, file and rollingfile
+ * appenders.
+ *
+ * @li @c vlog_entry (category, priority)
+ * @li @c vlog_return (category, priority, message)
+ * @li @c layout_format_start (layout, category)
+ * @li @c layout_format_end (layout, category, rendered message)
+ * @li @c appender_append_start (appender, category, rendered message)
+ * @li @c appender_append_end (appender, category, return code)
+ * @li @c rollover_start (appender, current file size)
+ * @li @c rollover_end (appender, return code)
+ * @li @c lock_wait (lock, appender)
+ * @li @c lock_acquired (lock, appender)
+ * @li @c lock_release (lock, appender)
+ * @li @c reread_start (file name)
+ * @li @c reread_end (file name, return code)
+ *
+ * The locks are named after the appender type: "rollingfile", "file"
+ * and "ansicolor".
+ **/
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define LOG4C_TRACE1(probe, a)		DTRACE_PROBE1(log4c, probe, a)
+#define LOG4C_TRACE2(probe, a, b)	DTRACE_PROBE2(log4c, probe, a, b)
+#define LOG4C_TRACE3(probe, a, b, c)	DTRACE_PROBE3(log4c, probe, a, b, c)
+#else
+#define LOG4C_TRACE1(probe, a)
+#define LOG4C_TRACE2(probe, a, b)
+#define LOG4C_TRACE3(probe, a, b, c)
+#endif
+
+#endif
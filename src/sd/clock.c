@@ -0,0 +1,189 @@
+static const char version[] = "$Id$";
+
+/*
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "clock.h"
+#include "sd_xplatform.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_REALTIME_COARSE) && \
+    defined(CLOCK_MONOTONIC_COARSE)
+#define CLOCK_COARSE
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && defined(SD_TLS)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define CLOCK_TSC
+#endif
+
+#define CLOCK_NSEC	1000000000ULL
+
+typedef void (*clock_read_t)(sd_clock_time_t*);
+
+static int clock_current = SD_CLOCK_REALTIME;
+
+#ifdef SD_TLS
+/* the last monotonic time read by the thread */
+static SD_TLS unsigned long long clock_last;
+#endif
+
+#ifdef HAVE_CLOCK_GETTIME
+/******************************************************************************/
+static unsigned long long clock_ns(clockid_t a_id)
+{
+    struct timespec ts;
+
+    clock_gettime(a_id, &ts);
+    return (unsigned long long) ts.tv_sec * CLOCK_NSEC + ts.tv_nsec;
+}
+#endif
+
+/******************************************************************************/
+static void clock_realtime(sd_clock_time_t* a_time)
+{
+#if defined(HAVE_CLOCK_GETTIME)
+    a_time->ct_realtime  = clock_ns(CLOCK_REALTIME);
+    a_time->ct_monotonic = clock_ns(CLOCK_MONOTONIC);
+#elif defined(_WIN32)
+    FILETIME ft;
+
+    /* in 100ns since 1601 */
+    SD_GETTIMEOFDAY(&ft, NULL);
+    a_time->ct_realtime = ((((unsigned long long) ft.dwHighDateTime << 32) |
+			    ft.dwLowDateTime) - 116444736000000000ULL) * 100;
+    a_time->ct_monotonic = a_time->ct_realtime;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    a_time->ct_realtime  = (unsigned long long) tv.tv_sec * CLOCK_NSEC +
+	tv.tv_usec * 1000ULL;
+    a_time->ct_monotonic = a_time->ct_realtime;
+#endif
+}
+
+#ifdef CLOCK_COARSE
+/******************************************************************************/
+static void clock_coarse(sd_clock_time_t* a_time)
+{
+    a_time->ct_realtime  = clock_ns(CLOCK_REALTIME_COARSE);
+    a_time->ct_monotonic = clock_ns(CLOCK_MONOTONIC_COARSE);
+}
+#endif
+
+#ifdef CLOCK_TSC
+
+/* nanoseconds between two calibrations of a thread */
+#define CLOCK_TSC_PERIOD	1000000000ULL
+/* the shortest interval a first rate is computed on */
+#define CLOCK_TSC_FIRST		10000000ULL
+
+/*
+ * The times a thread last read the clocks at, with the counter at that
+ * time, and the rate measured since the previous ones: 0 until the
+ * thread has measured one. The rate is measured on the monotonic clock,
+ * which NTP does not step.
+ */
+static SD_TLS unsigned long long tsc_anchor;
+static SD_TLS sd_clock_time_t	 tsc_anchor_time;
+static SD_TLS unsigned long long tsc_period;
+static SD_TLS double		 tsc_ns_per_tick;
+
+/******************************************************************************/
+static void clock_tsc(sd_clock_time_t* a_time)
+{
+    unsigned long long tsc = __rdtsc();
+    unsigned long long ticks = tsc - tsc_anchor;
+    unsigned long long elapsed;
+
+    if (tsc_ns_per_tick && ticks < tsc_period) {
+	elapsed = (unsigned long long) (ticks * tsc_ns_per_tick);
+	a_time->ct_realtime  = tsc_anchor_time.ct_realtime + elapsed;
+	a_time->ct_monotonic = tsc_anchor_time.ct_monotonic + elapsed;
+	return;
+    }
+
+    clock_realtime(a_time);
+    elapsed = a_time->ct_monotonic - tsc_anchor_time.ct_monotonic;
+
+    /* the first rate is measured on a short interval, the next ones on
+       the whole period */
+    if (tsc_anchor && ticks && (tsc_ns_per_tick || elapsed >= CLOCK_TSC_FIRST)) {
+	tsc_ns_per_tick = (double) elapsed / ticks;
+	tsc_period = (unsigned long long) (CLOCK_TSC_PERIOD / tsc_ns_per_tick);
+    } else if (tsc_anchor && !tsc_ns_per_tick)
+	return;
+
+    tsc_anchor	    = tsc;
+    tsc_anchor_time = *a_time;
+}
+
+/******************************************************************************/
+static int tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+	return 0;
+    return (edx & (1 << 8)) != 0;
+}
+#endif
+
+static clock_read_t clock_read = clock_realtime;
+
+/******************************************************************************/
+SD_API void sd_clock_read(sd_clock_time_t* a_time)
+{
+    clock_read(a_time);
+
+#ifdef SD_TLS
+    /* the counter extrapolates past the clock until the next calibration */
+    if (a_time->ct_monotonic < clock_last)
+	a_time->ct_monotonic = clock_last;
+    clock_last = a_time->ct_monotonic;
+#endif
+}
+
+/******************************************************************************/
+SD_API int sd_clock_use(int a_clock)
+{
+    switch (a_clock) {
+    case SD_CLOCK_REALTIME:
+	clock_read = clock_realtime;
+	break;
+#ifdef CLOCK_COARSE
+    case SD_CLOCK_COARSE:
+	clock_read = clock_coarse;
+	break;
+#endif
+#ifdef CLOCK_TSC
+    case SD_CLOCK_TSC:
+	if (!tsc_invariant())
+	    return -1;
+	clock_read = clock_tsc;
+	break;
+#endif
+    default:
+	return -1;
+    }
+
+    clock_current = a_clock;
+    return 0;
+}
+
+/******************************************************************************/
+SD_API int sd_clock_get(void)
+{
+    return clock_current;
+}
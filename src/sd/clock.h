@@ -0,0 +1,75 @@
+/* $Id$
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef __sd_clock_h
+#define __sd_clock_h
+
+/**
+ * @file clock.h
+ *
+ * @brief The clock which timestamps events
+ *
+ * sd_clock_read() reads the wall clock and a monotonic clock, in
+ * nanoseconds, from one of:
+ * @li @c SD_CLOCK_REALTIME clock_gettime() with CLOCK_REALTIME and
+ * CLOCK_MONOTONIC, the default.
+ * @li @c SD_CLOCK_COARSE the same with CLOCK_REALTIME_COARSE and
+ * CLOCK_MONOTONIC_COARSE, which cost a few nanoseconds but only move at
+ * the timer tick, every 1 to 10 milliseconds.
+ * @li @c SD_CLOCK_TSC the time stamp counter of the processor, scaled
+ * against the monotonic clock which each thread reads again once a
+ * second. Only with an invariant counter, which runs at a constant rate
+ * on all cores.
+ *
+ * The monotonic time never goes back within a thread, whatever the
+ * clock. Without clock_gettime() both times come from gettimeofday().
+ */
+
+#include "defs.h"
+
+__SD_BEGIN_DECLS
+
+/**
+ * The clocks of sd_clock_read().
+ */
+enum {
+    SD_CLOCK_REALTIME,
+    SD_CLOCK_COARSE,
+    SD_CLOCK_TSC
+};
+
+/**
+ * @li @c ct_realtime nanoseconds since the epoch
+ * @li @c ct_monotonic nanoseconds since an unspecified start, which
+ * NTP adjustments of the wall clock do not move
+ */
+typedef struct {
+    unsigned long long	ct_realtime;
+    unsigned long long	ct_monotonic;
+} sd_clock_time_t;
+
+/**
+ * Chooses the clock of sd_clock_read().
+ *
+ * @param a_clock SD_CLOCK_REALTIME, SD_CLOCK_COARSE or SD_CLOCK_TSC
+ * @returns 0 or -1 if the system or the processor does not have it
+ */
+SD_API int sd_clock_use(int a_clock);
+
+/**
+ * @returns the clock of sd_clock_read()
+ */
+SD_API int sd_clock_get(void);
+
+/**
+ * Reads the clock.
+ *
+ * @param a_time the wall clock and monotonic times
+ */
+SD_API void sd_clock_read(sd_clock_time_t* a_time);
+
+__SD_END_DECLS
+
+#endif
@@ -57,6 +57,10 @@ struct udata {
     size_t	  wptr;
     sd_stack_t*	  elements;
     sd_domnode_t* root;
+    XML_Parser	  parser;
+    sd_domnode_stream_func_t stream;
+    void*	  stream_data;
+    int		  stream_ret;
 };
 
 /******************************************************************************/
@@ -203,8 +207,22 @@ start_handler(struct udata* udata, const XML_Char* name, const XML_Char** atts)
 /******************************************************************************/
 static void end_handler(struct udata* udata, const XML_Char* name)
 {
+    sd_domnode_t* node;
+
     udata_pop_cdata(udata);
-    sd_stack_pop(udata->elements);
+    node = sd_stack_pop(udata->elements);
+
+    if (!udata->stream || sd_stack_get_nelem(udata->elements) != 1)
+	return;
+
+    /* hand the complete child of the root to the callback and forget it */
+    sd_list_del(udata->root->children, node);
+
+    if ((udata->stream_ret = udata->stream(udata->root, node,
+					   udata->stream_data)) != 0)
+	XML_StopParser(udata->parser, XML_FALSE);
+
+    sd_domnode_delete(node);
 }
 
 /******************************************************************************/
@@ -233,6 +251,13 @@ static void comment_handler(struct udata* udata, const XML_Char* s)
 
 /******************************************************************************/
 SD_API int sd_domnode_fread(sd_domnode_t* this, FILE* stream)
+{
+    return sd_domnode_fread_stream(this, stream, NULL, NULL);
+}
+
+/******************************************************************************/
+SD_API int sd_domnode_fread_stream(sd_domnode_t* this, FILE* stream,
+				   sd_domnode_stream_func_t func, void* data)
 {
     XML_Parser   p;
     struct udata* udata;
@@ -245,6 +270,9 @@ SD_API int sd_domnode_fread(sd_domnode_t* this, FILE* stream)
 	return -1;
 
     udata = udata_new();
+    udata->parser	= p;
+    udata->stream	= func;
+    udata->stream_data	= data;
 
     XML_SetStartElementHandler  (p, (XML_StartElementHandler)  start_handler);
     XML_SetEndElementHandler    (p, (XML_EndElementHandler)    end_handler);
@@ -268,11 +296,14 @@ SD_API int sd_domnode_fread(sd_domnode_t* this, FILE* stream)
 	}
 
 	if (!XML_ParseBuffer(p, n, (done = feof(stream)))) {
-	    sd_error("XML error: %s [%d:%d - %ld]\n",
-		     XML_ErrorString(XML_GetErrorCode(p)),
-		     XML_GetCurrentLineNumber(p),
-		     XML_GetCurrentColumnNumber(p),
-		     XML_GetCurrentByteIndex(p));
+	    if (udata->stream_ret)
+		sd_debug("XML parsing stopped by the stream callback");
+	    else
+		sd_error("XML error: %s [%d:%d - %ld]\n",
+			 XML_ErrorString(XML_GetErrorCode(p)),
+			 XML_GetCurrentLineNumber(p),
+			 XML_GetCurrentColumnNumber(p),
+			 XML_GetCurrentByteIndex(p));
 	    ret = -1;
 	    break;
 	}
@@ -426,6 +457,13 @@ SD_API int sd_domnode_fwrite(const sd_domnode_t* this, FILE* stream)
 
 /******************************************************************************/
 SD_API int sd_domnode_load(sd_domnode_t* this, const char* afilename)
+{
+    return sd_domnode_load_stream(this, afilename, NULL, NULL);
+}
+
+/******************************************************************************/
+SD_API int sd_domnode_load_stream(sd_domnode_t* this, const char* afilename,
+				  sd_domnode_stream_func_t func, void* data)
 {
     FILE* fp;
     int   ret = 0;
@@ -433,7 +471,7 @@ SD_API int sd_domnode_load(sd_domnode_t* this, const char* afilename)
     if ( (fp = fopen(afilename, "r")) == NULL)
 	return -1;
     
-    ret = sd_domnode_fread(this, fp);
+    ret = sd_domnode_fread_stream(this, fp, func, data);
 
     fclose(fp);
     return 0;
@@ -65,8 +65,9 @@
 
 static void domnode_attribute(struct __sd_domnode_xml_maker*, const char*,
 			       const char*);
+static int domnode_end(struct __sd_domnode_xml_maker*);
 
-#line 52 "../../../src/sd/domnode-xml-parser.y"
+#line 53 "../../../src/sd/domnode-xml-parser.y"
 #ifndef YYSTYPE
 typedef union { char *s; } yystype;
 # define YYSTYPE yystype
@@ -924,7 +925,7 @@ yyreduce:
   switch (yyn) {
 
 case 4:
-#line 71 "../../../src/sd/domnode-xml-parser.y"
+#line 72 "../../../src/sd/domnode-xml-parser.y"
 {
     sd_domnode_t* node = sd_stack_peek(a_maker->elements);
     
@@ -937,7 +938,7 @@ case 4:
 ;
     break;}
 case 5:
-#line 85 "../../../src/sd/domnode-xml-parser.y"
+#line 86 "../../../src/sd/domnode-xml-parser.y"
 {
     sd_domnode_t* parent = sd_stack_peek(a_maker->elements);
     sd_domnode_t* node = __sd_domnode_new(yyvsp[0].s, 0, 1);
@@ -968,17 +969,18 @@ case 5:
 ;
     break;}
 case 7:
-#line 119 "../../../src/sd/domnode-xml-parser.y"
+#line 120 "../../../src/sd/domnode-xml-parser.y"
 {
     sd_domnode_t* node = sd_stack_peek(a_maker->elements);
     assert(node != 0);
     
     sd_debug("END: simple node '%s'\n", node->name);
-    sd_stack_pop(a_maker->elements);
+    if (domnode_end(a_maker))
+	YYABORT;
 ;
     break;}
 case 8:
-#line 127 "../../../src/sd/domnode-xml-parser.y"
+#line 129 "../../../src/sd/domnode-xml-parser.y"
 {
     sd_domnode_t* node = sd_stack_peek(a_maker->elements);
     assert(node != 0);
@@ -993,11 +995,12 @@ case 8:
     /* $4 was obtain with strdup() */
     free(yyvsp[-1].s);
     
-    sd_stack_pop(a_maker->elements);
+    if (domnode_end(a_maker))
+	YYABORT;
 ;
     break;}
 case 9:
-#line 147 "../../../src/sd/domnode-xml-parser.y"
+#line 150 "../../../src/sd/domnode-xml-parser.y"
 {
     sd_domnode_t* node = sd_stack_peek(a_maker->elements);
     assert(node != 0);
@@ -1009,13 +1012,13 @@ case 9:
 ;
     break;}
 case 13:
-#line 163 "../../../src/sd/domnode-xml-parser.y"
+#line 166 "../../../src/sd/domnode-xml-parser.y"
 {
     yyval.s = yyvsp[0].s;
 ;
     break;}
 case 16:
-#line 175 "../../../src/sd/domnode-xml-parser.y"
+#line 178 "../../../src/sd/domnode-xml-parser.y"
 {
     domnode_attribute(a_maker, yyvsp[0].s, "");
     /* $1 was obtain with strdup() */
@@ -1023,7 +1026,7 @@ case 16:
 ;
     break;}
 case 17:
-#line 181 "../../../src/sd/domnode-xml-parser.y"
+#line 184 "../../../src/sd/domnode-xml-parser.y"
 {
     domnode_attribute(a_maker, yyvsp[-2].s, yyvsp[0].s);
     /* $1 was obtain with strdup() */
@@ -1265,7 +1268,7 @@ yyreturn:
 #endif
   return yyresult;
 }
-#line 190 "../../../src/sd/domnode-xml-parser.y"
+#line 193 "../../../src/sd/domnode-xml-parser.y"
 
 #undef a_maker
 
@@ -1281,3 +1284,25 @@ static void domnode_attribute(struct __sd_domnode_xml_maker* a_maker,
     
     sd_list_append(node->attrs, __sd_domnode_new(a_name, a_value, 0));
 }
+
+/******************************************************************************/
+/*
+ * Closes the current element. When streaming, the complete children of the
+ * document root are handed to the callback and deleted.
+ */
+static int domnode_end(struct __sd_domnode_xml_maker* a_maker)
+{
+    sd_domnode_t* node = sd_stack_pop(a_maker->elements);
+    int ret;
+
+    if (!a_maker->stream || sd_stack_get_nelem(a_maker->elements) != 1)
+	return 0;
+
+    /* the node was the last child appended to the root */
+    sd_list_iter_del(sd_list_rbegin(a_maker->root->children));
+
+    ret = a_maker->stream(a_maker->root, node, a_maker->stream_data);
+    sd_domnode_delete(node);
+
+    return ret;
+}
@@ -41,6 +41,7 @@
 
 static void domnode_attribute(struct __sd_domnode_xml_maker*, const char*,
 			       const char*);
+static int domnode_end(struct __sd_domnode_xml_maker*);
 %}
 
 %name-prefix="__sd_domnode_xml_"
@@ -121,7 +122,8 @@ empty_or_content
     assert(node != 0);
     
     sd_debug("END: simple node '%s'\n", node->name);
-    sd_stack_pop(a_maker->elements);
+    if (domnode_end(a_maker))
+	YYABORT;
 }
 | CLOSE content END name CLOSE
 {
@@ -138,7 +140,8 @@ empty_or_content
     /* $4 was obtain with strdup() */
     free($4);
     
-    sd_stack_pop(a_maker->elements);
+    if (domnode_end(a_maker))
+	YYABORT;
 }
 ;
 
@@ -202,3 +205,25 @@ static void domnode_attribute(struct __sd_domnode_xml_maker* a_maker,
     
     sd_list_append(node->attrs, __sd_domnode_new(a_name, a_value, 0));
 }
+
+/******************************************************************************/
+/*
+ * Closes the current element. When streaming, the complete children of the
+ * document root are handed to the callback and deleted.
+ */
+static int domnode_end(struct __sd_domnode_xml_maker* a_maker)
+{
+    sd_domnode_t* node = sd_stack_pop(a_maker->elements);
+    int ret;
+
+    if (!a_maker->stream || sd_stack_get_nelem(a_maker->elements) != 1)
+	return 0;
+
+    /* the node was the last child appended to the root */
+    sd_list_iter_del(sd_list_rbegin(a_maker->root->children));
+
+    ret = a_maker->stream(a_maker->root, node, a_maker->stream_data);
+    sd_domnode_delete(node);
+
+    return ret;
+}
@@ -98,7 +98,8 @@ SD_API int __sd_domnode_xml_fwrite(const sd_domnode_t* this, FILE* a_stream)
 }
 
 /******************************************************************************/
-static int xml_parse(sd_domnode_t** a_node, yyscan_t a_scanner)
+static int xml_parse(sd_domnode_t** a_node, yyscan_t a_scanner,
+		     sd_domnode_stream_func_t a_func, void* a_data)
 {
     int r;
     struct __sd_domnode_xml_maker maker;
@@ -106,8 +107,13 @@ static int xml_parse(sd_domnode_t** a_node, yyscan_t a_scanner)
     maker.scanner	= a_scanner;
     maker.elements	= sd_stack_new(0);
     maker.root		= 0;
+    maker.stream	= a_func;
+    maker.stream_data	= a_data;
     
-    if (! (r = __sd_domnode_xml_parse(&maker))) *a_node = maker.root;
+    if (! (r = __sd_domnode_xml_parse(&maker))) 
+	*a_node = maker.root;
+    else
+	sd_domnode_delete(maker.root);
     
     sd_stack_delete(maker.elements, 0);
     
@@ -116,6 +122,15 @@ static int xml_parse(sd_domnode_t** a_node, yyscan_t a_scanner)
 
 /******************************************************************************/
 SD_API int __sd_domnode_xml_fread(sd_domnode_t** a_node, FILE* a_stream)
+{
+    return __sd_domnode_xml_fread_stream(a_node, a_stream, 0, 0);
+}
+
+/******************************************************************************/
+SD_API int __sd_domnode_xml_fread_stream(sd_domnode_t** a_node,
+					 FILE* a_stream,
+					 sd_domnode_stream_func_t a_func,
+					 void* a_data)
 {
     int r;
     yyscan_t scanner;
@@ -123,7 +138,7 @@ SD_API int __sd_domnode_xml_fread(sd_domnode_t** a_node, FILE* a_stream)
     yylex_init(&scanner);
     yyset_in(a_stream, scanner);
     
-    r = xml_parse(a_node, scanner);
+    r = xml_parse(a_node, scanner, a_func, a_data);
     
     yylex_destroy(scanner);
     
@@ -140,7 +155,7 @@ SD_API int __sd_domnode_xml_read(sd_domnode_t** a_node, const char* a_buffer,
     yylex_init(&scanner);
     yy_switch_to_buffer(yy_scan_bytes(a_buffer, a_size, scanner), scanner);
     
-    r = xml_parse(a_node, scanner);
+    r = xml_parse(a_node, scanner, 0, 0);
     
     yylex_destroy(scanner);
     
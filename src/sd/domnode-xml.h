@@ -17,12 +17,18 @@
 #include "stack.h"
 
 struct __sd_domnode_xml_maker {
-    void*		scanner;
-    sd_stack_t*		elements;
-    sd_domnode_t*	root;
+    void*			scanner;
+    sd_stack_t*			elements;
+    sd_domnode_t*		root;
+    sd_domnode_stream_func_t	stream;
+    void*			stream_data;
 };
 
 SD_API int __sd_domnode_xml_fread(sd_domnode_t** a_node, FILE* a_stream);
+SD_API int __sd_domnode_xml_fread_stream(sd_domnode_t** a_node,
+					 FILE* a_stream,
+					 sd_domnode_stream_func_t a_func,
+					 void* a_data);
 SD_API int __sd_domnode_xml_fwrite(const sd_domnode_t* a_node, FILE* a_stream);
 
 SD_API int __sd_domnode_xml_read(sd_domnode_t** a_node, const char* a_buffer, size_t a_size);
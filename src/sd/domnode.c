@@ -89,12 +89,21 @@ static void domnode_update(sd_domnode_t* this, sd_domnode_t* a_node)
 
 /******************************************************************************/
 SD_API int sd_domnode_fread(sd_domnode_t* this, FILE* a_stream)
+{
+    return sd_domnode_fread_stream(this, a_stream, 0, 0);
+}
+
+/******************************************************************************/
+SD_API int sd_domnode_fread_stream(sd_domnode_t* this, FILE* a_stream,
+				   sd_domnode_stream_func_t a_func,
+				   void* a_data)
 {
     int ret;
     sd_domnode_t* node;
     
     /* TODO: generic format support */
-    if (! (ret = __sd_domnode_xml_fread(&node, a_stream)))
+    if (! (ret = __sd_domnode_xml_fread_stream(&node, a_stream, a_func,
+					       a_data)))
 	domnode_update(this, node);
     
     return ret ? -1 : 0;
@@ -131,6 +140,14 @@ SD_API int sd_domnode_fwrite(const sd_domnode_t* this, FILE* a_stream)
 
 /******************************************************************************/
 SD_API int sd_domnode_load(sd_domnode_t* this, const char* a_filename)
+{
+    return sd_domnode_load_stream(this, a_filename, 0, 0);
+}
+
+/******************************************************************************/
+SD_API int sd_domnode_load_stream(sd_domnode_t* this, const char* a_filename,
+				  sd_domnode_stream_func_t a_func,
+				  void* a_data)
 {
     FILE* fp;
     int   ret = 0;
@@ -138,7 +155,7 @@ SD_API int sd_domnode_load(sd_domnode_t* this, const char* a_filename)
     if ( (fp = fopen(a_filename, "r")) == 0)
 	return -1;
     
-    ret = sd_domnode_fread(this, fp);
+    ret = sd_domnode_fread_stream(this, fp, a_func, a_data);
 
     fclose(fp);
     return ret;
@@ -42,6 +42,26 @@ SD_API int		sd_domnode_fwrite(const sd_domnode_t* this,
 SD_API int		sd_domnode_load(sd_domnode_t* this,
 					const char* a_filename);
 
+/**
+ * Called by the streaming readers for each complete child element of the
+ * document root, in document order. @a a_root holds the name and the
+ * attributes of the document root but none of its children. @a a_node is
+ * deleted when the callback returns. A non zero return value stops the
+ * parsing.
+ */
+typedef int (*sd_domnode_stream_func_t)(const sd_domnode_t* a_root,
+					sd_domnode_t* a_node, void* a_data);
+
+SD_API int		sd_domnode_fread_stream(sd_domnode_t* this,
+						FILE* a_stream,
+						sd_domnode_stream_func_t a_func,
+						void* a_data);
+
+SD_API int		sd_domnode_load_stream(sd_domnode_t* this,
+					       const char* a_filename,
+					       sd_domnode_stream_func_t a_func,
+					       void* a_data);
+
 SD_API int		sd_domnode_store(const sd_domnode_t* this, 
 					 const char* a_filename);
 
@@ -0,0 +1,236 @@
+static const char version[] = "$Id$";
+
+/*
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "json.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <emmintrin.h>
+#include <immintrin.h>
+#define JSON_SSE2
+#define JSON_AVX2
+#endif
+
+typedef size_t (*escape_t)(char*, size_t, const char*, size_t*);
+
+/* 1 for the characters to escape */
+static const unsigned char json_special[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+};
+
+/******************************************************************************/
+/* writes the escape of a character, returns its length or 0 if it does not fit */
+static size_t escape_char(char* a_out, size_t a_room, unsigned char a_c)
+{
+    static const char hex[] = "0123456789abcdef";
+    char c = 0;
+
+    switch (a_c) {
+    case '"':  c = '"'; break;
+    case '\\': c = '\\'; break;
+    case '\b': c = 'b'; break;
+    case '\f': c = 'f'; break;
+    case '\n': c = 'n'; break;
+    case '\r': c = 'r'; break;
+    case '\t': c = 't'; break;
+    }
+
+    if (c) {
+	if (a_room < 2)
+	    return 0;
+	a_out[0] = '\\';
+	a_out[1] = c;
+	return 2;
+    }
+
+    if (a_room < 6)
+	return 0;
+    memcpy(a_out, "\\u00", 4);
+    a_out[4] = hex[a_c >> 4];
+    a_out[5] = hex[a_c & 0xf];
+    return 6;
+}
+
+/******************************************************************************/
+static size_t escape_scalar(char* a_out, size_t a_size, const char* a_in,
+			    size_t* a_len)
+{
+    const unsigned char* in = (const unsigned char*) a_in;
+    size_t len = *a_len;
+    size_t i, o = 0;
+
+    for (i = 0; i < len; i++) {
+	size_t n;
+
+	if (!json_special[in[i]]) {
+	    if (o == a_size)
+		break;
+	    a_out[o++] = (char) in[i];
+	    continue;
+	}
+	if ((n = escape_char(a_out + o, a_size - o, in[i])) == 0)
+	    break;
+	o += n;
+    }
+
+    *a_len = i;
+    return o;
+}
+
+#ifdef JSON_SSE2
+/******************************************************************************/
+/*
+ * Copies 16 bytes at a time while there is room for them. A block with a
+ * byte to escape is finished by the scalar loop from that byte on.
+ */
+static size_t escape_sse2(char* a_out, size_t a_size, const char* a_in,
+			  size_t* a_len)
+{
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctl    = _mm_set1_epi8(0x1f);
+    size_t len = *a_len;
+    size_t i = 0, o = 0, rest;
+
+    while (len - i >= 16 && a_size - o >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i*) (a_in + i));
+	__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+					      _mm_cmpeq_epi8(v, bslash)),
+				 _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+	unsigned int mask = (unsigned int) _mm_movemask_epi8(m);
+	size_t n;
+
+	_mm_storeu_si128((__m128i*) (a_out + o), v);
+	if (!mask) {
+	    i += 16;
+	    o += 16;
+	    continue;
+	}
+
+	/* the rest of the block, where escapes are likely to be close */
+	n  = __builtin_ctz(mask);
+	i += n;
+	o += n;
+	rest = 16 - n;
+	o += escape_scalar(a_out + o, a_size - o, a_in + i, &rest);
+	i += rest;
+	if (rest < 16 - n) {
+	    *a_len = i;
+	    return o;
+	}
+    }
+
+    rest = len - i;
+    o += escape_scalar(a_out + o, a_size - o, a_in + i, &rest);
+    *a_len = i + rest;
+    return o;
+}
+#endif
+
+#ifdef JSON_AVX2
+/******************************************************************************/
+/* the same, 32 bytes at a time */
+__attribute__((target("avx2")))
+static size_t escape_avx2(char* a_out, size_t a_size, const char* a_in,
+			  size_t* a_len)
+{
+    const __m256i quote  = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i ctl    = _mm256_set1_epi8(0x1f);
+    size_t len = *a_len;
+    size_t i = 0, o = 0, rest;
+
+    while (len - i >= 32 && a_size - o >= 32) {
+	__m256i v = _mm256_loadu_si256((const __m256i*) (a_in + i));
+	__m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+						    _mm256_cmpeq_epi8(v, bslash)),
+				    _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v));
+	unsigned int mask = (unsigned int) _mm256_movemask_epi8(m);
+	size_t n;
+
+	_mm256_storeu_si256((__m256i*) (a_out + o), v);
+	if (!mask) {
+	    i += 32;
+	    o += 32;
+	    continue;
+	}
+
+	/* the rest of the block, where escapes are likely to be close */
+	n  = __builtin_ctz(mask);
+	i += n;
+	o += n;
+	rest = 32 - n;
+	o += escape_scalar(a_out + o, a_size - o, a_in + i, &rest);
+	i += rest;
+	if (rest < 32 - n) {
+	    *a_len = i;
+	    return o;
+	}
+    }
+
+    rest = len - i;
+    o += escape_sse2(a_out + o, a_size - o, a_in + i, &rest);
+    *a_len = i + rest;
+    return o;
+}
+#endif
+
+static size_t escape_init(char* a_out, size_t a_size, const char* a_in,
+			  size_t* a_len);
+
+static escape_t json_escape = escape_init;
+
+/******************************************************************************/
+/* the first call picks the best implementation */
+static size_t escape_init(char* a_out, size_t a_size, const char* a_in,
+			  size_t* a_len)
+{
+    if (sd_json_escape_use(SD_JSON_AVX2) == -1 &&
+	sd_json_escape_use(SD_JSON_SSE2) == -1)
+	sd_json_escape_use(SD_JSON_SCALAR);
+
+    return json_escape(a_out, a_size, a_in, a_len);
+}
+
+/******************************************************************************/
+SD_API size_t sd_json_escape(char* a_out, size_t a_size, const char* a_in,
+			     size_t* a_len)
+{
+    return json_escape(a_out, a_size, a_in, a_len);
+}
+
+/******************************************************************************/
+SD_API int sd_json_escape_use(int a_impl)
+{
+    switch (a_impl) {
+    case SD_JSON_SCALAR:
+	json_escape = escape_scalar;
+	return 0;
+#ifdef JSON_SSE2
+    case SD_JSON_SSE2:
+	json_escape = escape_sse2;
+	return 0;
+#endif
+#ifdef JSON_AVX2
+    case SD_JSON_AVX2:
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("avx2"))
+	    return -1;
+	json_escape = escape_avx2;
+	return 0;
+#endif
+    }
+    return -1;
+}
@@ -0,0 +1,63 @@
+/* $Id$
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef __sd_json_h
+#define __sd_json_h
+
+/**
+ * @file json.h
+ *
+ * @brief Escaping of JSON strings
+ *
+ * sd_json_escape() escapes the characters which can not appear as they
+ * are in a JSON string: '"', '\\' and the control characters below 0x20.
+ * Other bytes, UTF-8 sequences included, are copied unchanged.
+ *
+ * Long strings are scanned 16 or 32 bytes at a time with SSE2 or AVX2
+ * when the processor has them, chosen on the first call.
+ */
+
+#include <stddef.h>
+#include "defs.h"
+
+__SD_BEGIN_DECLS
+
+/**
+ * The implementations of sd_json_escape().
+ */
+enum {
+    SD_JSON_SCALAR,
+    SD_JSON_SSE2,
+    SD_JSON_AVX2
+};
+
+/**
+ * Escapes a string for JSON, without the surrounding quotes. Stops
+ * before a character whose escape does not fit, so that the output is
+ * never cut in the middle of an escape sequence. The output is not
+ * terminated by a '\\0'.
+ *
+ * @param a_out the buffer to write to
+ * @param a_size the size of the buffer
+ * @param a_in the string to escape
+ * @param a_len the length of the string; set to the number of
+ * characters escaped, which is less when @a a_size is too small
+ * @returns the number of bytes written
+ */
+SD_API size_t sd_json_escape(char* a_out, size_t a_size, const char* a_in,
+			     size_t* a_len);
+
+/**
+ * Chooses the implementation of sd_json_escape(), for tests and
+ * benchmarks.
+ *
+ * @param a_impl SD_JSON_SCALAR, SD_JSON_SSE2 or SD_JSON_AVX2
+ * @returns 0 or -1 if the processor or the compiler does not support it
+ */
+SD_API int sd_json_escape_use(int a_impl);
+
+__SD_END_DECLS
+
+#endif
@@ -25,13 +25,16 @@
 #       include <stdint.h>
 #define  XP_UINT64 uint64_t
 #define  XP_INT64 int64_t
+#define  XP_UINT32 uint32_t
 #else
 #ifndef _WIN32
 #define  XP_UINT64 unsigned long long
 #define  XP_INT64 long long
+#define  XP_UINT32 unsigned int
 #else
 #define  XP_UINT64 DWORD64
 #define  XP_INT64 __int64
+#define  XP_UINT32 DWORD
 #endif
 #endif
 
@@ -128,6 +131,52 @@ int sd_stat_ctime(const char* path, time_t* time);
 #endif
 
 
+/*
+ * Thread local storage, when the compiler supports it. SD_TLS is left
+ * undefined otherwise, so that callers can fall back to thread keys.
+ */
+#if defined(_MSC_VER)
+#define SD_TLS __declspec(thread)
+#elif defined(__GNUC__)
+#define SD_TLS __thread
+#endif
+
+/*
+ * Atomic loads and stores, for data written by one thread and read by
+ * others: relaxed ones for counters, acquire/release ones to publish
+ * memory. SD_ATOMIC_CAS() is a full barrier, for data which several
+ * threads may publish at once. The fences order plain accesses, for data
+ * read while it may be overwritten and checked against a counter after.
+ */
+#if defined(__ATOMIC_RELAXED)
+#define SD_ATOMIC_LOAD(p)		__atomic_load_n(p, __ATOMIC_RELAXED)
+#define SD_ATOMIC_STORE(p, v)		__atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define SD_ATOMIC_LOAD_ACQUIRE(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define SD_ATOMIC_STORE_RELEASE(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define SD_ATOMIC_ADD(p, v)		__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define SD_ATOMIC_CAS(p, o, n)		__sync_bool_compare_and_swap(p, o, n)
+#define SD_ATOMIC_FENCE_ACQUIRE()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define SD_ATOMIC_FENCE_RELEASE()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#define SD_ATOMIC_LOAD(p)		(*(volatile __typeof__(*(p))*) (p))
+#define SD_ATOMIC_STORE(p, v)		(*(volatile __typeof__(*(p))*) (p) = (v))
+#define SD_ATOMIC_LOAD_ACQUIRE(p)	(__sync_synchronize(), SD_ATOMIC_LOAD(p))
+#define SD_ATOMIC_STORE_RELEASE(p, v)	do { __sync_synchronize(); SD_ATOMIC_STORE(p, v); } while (0)
+#define SD_ATOMIC_ADD(p, v)		__sync_fetch_and_add(p, v)
+#define SD_ATOMIC_CAS(p, o, n)		__sync_bool_compare_and_swap(p, o, n)
+#define SD_ATOMIC_FENCE_ACQUIRE()	__sync_synchronize()
+#define SD_ATOMIC_FENCE_RELEASE()	__sync_synchronize()
+#else
+#define SD_ATOMIC_LOAD(p)		(*(p))
+#define SD_ATOMIC_STORE(p, v)		(*(p) = (v))
+#define SD_ATOMIC_LOAD_ACQUIRE(p)	(*(p))
+#define SD_ATOMIC_STORE_RELEASE(p, v)	(*(p) = (v))
+#define SD_ATOMIC_ADD(p, v)		((*(p) += (v)) - (v))
+#define SD_ATOMIC_CAS(p, o, n)		(*(p) == (o) ? (*(p) = (n), 1) : 0)
+#define SD_ATOMIC_FENCE_ACQUIRE()	((void) 0)
+#define SD_ATOMIC_FENCE_RELEASE()	((void) 0)
+#endif
+
 #ifdef __HP_cc
 #define inline __inline
 #endif 
@@ -6,10 +6,20 @@ static const char version[] = "$Id$";
  * See the COPYING file for the terms of usage and distribution.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
 #include "sprintf.h"
 #include "malloc.h"
 #include "sd_xplatform.h"
@@ -33,7 +43,8 @@ SD_API char* sd_sprintf(const char* a_fmt, ...)
 }
 
 /******************************************************************************/
-SD_API char* sd_vsprintf(const char* a_fmt, va_list a_args)
+static char* vsprintf_alloc(const sd_format_t* a_parsed, const char* a_fmt,
+			    va_list a_args)
 {
     int		size	= 1024;
     char*	buffer  = (char*)sd_calloc(size, sizeof(char));
@@ -44,7 +55,8 @@ SD_API char* sd_vsprintf(const char* a_fmt, va_list a_args)
 	   iterations. */
 	va_list ap_local;
 	va_copy(ap_local, a_args);
-	n = vsnprintf(buffer, size, a_fmt, ap_local);
+	n = a_parsed ? sd_format_vsnprintf(a_parsed, buffer, size, ap_local) :
+	    sd_vsnprintf(buffer, size, a_fmt, ap_local);
 	va_end(ap_local);
 	
 	/* If that worked, return */
@@ -63,6 +75,962 @@ SD_API char* sd_vsprintf(const char* a_fmt, va_list a_args)
     return 0;
 }
 
+/******************************************************************************/
+SD_API char* sd_vsprintf(const char* a_fmt, va_list a_args)
+{
+    return vsprintf_alloc(NULL, a_fmt, a_args);
+}
+
+/******************************************************************************/
+/*
+ * sd_vsnprintf() formats integers, characters, strings and doubles
+ * itself. It hands the formats with other conversions whole to
+ * vsnprintf(): pointers, whose output depends on the C library, long
+ * doubles and %a, positional arguments, wide characters, the "'" flag or
+ * extensions of the C library. Calling snprintf() for each of them
+ * instead costs more than it saves on the rest of the message.
+ *
+ * The %f, %e and %g conversions are correctly rounded, half to even on
+ * the exact binary value as the C library does: the digits are estimated
+ * with one floating point operation, then checked with exact integer
+ * arithmetic. Values whose digits do not fit in 53 bits, infinities, NaNs
+ * and locales with another decimal point go to snprintf() alone.
+ */
+
+#define SPEC_MINUS	0x01
+#define SPEC_PLUS	0x02
+#define SPEC_SPACE	0x04
+#define SPEC_HASH	0x08
+#define SPEC_ZERO	0x10
+#define SPEC_WIDTH_ARG	0x20
+#define SPEC_PREC_ARG	0x40
+
+enum {
+    LEN_NONE = 0,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_Z,
+    LEN_J,
+    LEN_T
+};
+
+typedef struct {
+    char*	o_buf;
+    size_t	o_size;		/* room for characters, the '\0' excluded */
+    size_t	o_len;		/* characters output, written or not */
+} output_t;
+
+/*
+ * A conversion and the text before it. The last spec of a parsed format
+ * has no conversion, only the text after the last one.
+ */
+typedef struct {
+    const char*	sp_literal;
+    size_t	sp_literal_len;
+    int		sp_flags;
+    int		sp_width;
+    int		sp_prec;	/* -1 when there is none */
+    int		sp_length;
+    int		sp_conv;	/* 0 for the text at the end */
+} format_spec_t;
+
+struct __sd_format {
+    const char*		f_string;
+    size_t		f_length;	/* of the text, when it has no conversion */
+    int			f_vsnprintf;	/* left to vsnprintf() */
+    int			f_nspecs;
+    format_spec_t	f_specs[1];
+};
+
+static const char digits_lower[] = "0123456789abcdef";
+static const char digits_upper[] = "0123456789ABCDEF";
+
+/* the powers of ten which are exact doubles */
+static const double float_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define FLOAT_POW10_MAX		22
+#define FLOAT_DIGITS_MAX	15	/* significant digits below 2^53 */
+#define FLOAT_EXACT_MAX		9007199254740992.0
+
+/* a number of at most BIG_LIMBS * 32 bits, the low limb first */
+#define BIG_LIMBS		12
+
+typedef struct {
+    unsigned int	b_limbs[BIG_LIMBS];
+    int			b_n;
+} big_t;
+
+static const char digits_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/******************************************************************************/
+/* the runs are short: copying bytes beats calling memcpy() or memset() */
+static void output_chars(output_t* this, const char* a_chars, size_t a_len)
+{
+    if (this->o_len < this->o_size) {
+	size_t room = this->o_size - this->o_len;
+	size_t n = a_len < room ? a_len : room;
+	char* to = this->o_buf + this->o_len;
+
+	if (n > 16)
+	    memcpy(to, a_chars, n);
+	else
+	    while (n--)
+		*to++ = *a_chars++;
+    }
+    this->o_len += a_len;
+}
+
+/******************************************************************************/
+static void output_fill(output_t* this, int a_char, size_t a_len)
+{
+    if (this->o_len < this->o_size) {
+	size_t room = this->o_size - this->o_len;
+	size_t n = a_len < room ? a_len : room;
+	char* to = this->o_buf + this->o_len;
+
+	if (n > 16)
+	    memset(to, a_char, n);
+	else
+	    while (n--)
+		*to++ = (char) a_char;
+    }
+    this->o_len += a_len;
+}
+
+/******************************************************************************/
+/* writes the digits of a_value before a_end, two at a time */
+static char* format_decimal(char* a_end, unsigned long long a_value)
+{
+    unsigned int v;
+
+    while (a_value > 0xffffffffUL) {
+	unsigned int i = (unsigned int) (a_value % 100) * 2;
+
+	a_value /= 100;
+	a_end -= 2;
+	a_end[0] = digits_pairs[i];
+	a_end[1] = digits_pairs[i + 1];
+    }
+
+    for (v = (unsigned int) a_value; v >= 100; v /= 100) {
+	unsigned int i = (v % 100) * 2;
+
+	a_end -= 2;
+	a_end[0] = digits_pairs[i];
+	a_end[1] = digits_pairs[i + 1];
+    }
+
+    if (v >= 10) {
+	a_end -= 2;
+	a_end[0] = digits_pairs[v * 2];
+	a_end[1] = digits_pairs[v * 2 + 1];
+    } else
+	*--a_end = (char) ('0' + v);
+
+    return a_end;
+}
+
+/******************************************************************************/
+static void format_integer(output_t* this, unsigned long long a_value,
+			   int a_negative, int a_conv, int a_flags,
+			   int a_width, int a_prec)
+{
+    char digits[32];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    char prefix[2];
+    size_t nprefix = 0;
+    size_t ndigits;
+    size_t nzeros = 0;
+    size_t len;
+    int zero = !a_value;
+
+    if (!zero || a_prec != 0) {
+	switch (a_conv) {
+	case 'x':
+	case 'X': {
+	    const char* table = a_conv == 'x' ? digits_lower : digits_upper;
+
+	    do {
+		*--start = table[a_value & 0xf];
+	    } while (a_value >>= 4);
+	    break;
+	}
+	case 'o':
+	    do {
+		*--start = (char) ('0' + (a_value & 0x7));
+	    } while (a_value >>= 3);
+	    break;
+	default:
+	    start = format_decimal(end, a_value);
+	    break;
+	}
+    }
+    ndigits = end - start;
+
+    if (a_conv == 'd' || a_conv == 'i') {
+	if (a_negative)
+	    prefix[nprefix++] = '-';
+	else if (a_flags & SPEC_PLUS)
+	    prefix[nprefix++] = '+';
+	else if (a_flags & SPEC_SPACE)
+	    prefix[nprefix++] = ' ';
+    } else if (a_flags & SPEC_HASH) {
+	if (a_conv == 'o') {
+	    if (!ndigits || *start != '0')
+		nzeros = 1;
+	} else if (a_conv != 'u' && !zero) {
+	    prefix[nprefix++] = '0';
+	    prefix[nprefix++] = (char) a_conv;
+	}
+    }
+
+    if (a_prec > 0 && (size_t) a_prec > ndigits + nzeros)
+	nzeros = a_prec - ndigits;
+
+    len = nprefix + nzeros + ndigits;
+    if (a_width > 0 && (size_t) a_width > len) {
+	size_t npad = a_width - len;
+
+	if (a_flags & SPEC_MINUS) {
+	    output_chars(this, prefix, nprefix);
+	    output_fill(this, '0', nzeros);
+	    output_chars(this, start, ndigits);
+	    output_fill(this, ' ', npad);
+	    return;
+	}
+	if ((a_flags & SPEC_ZERO) && a_prec < 0)
+	    nzeros += npad;
+	else
+	    output_fill(this, ' ', npad);
+    }
+
+    output_chars(this, prefix, nprefix);
+    output_fill(this, '0', nzeros);
+    output_chars(this, start, ndigits);
+}
+
+/******************************************************************************/
+static void format_string(output_t* this, const char* a_string, size_t a_len,
+			  int a_flags, int a_width)
+{
+    size_t npad = a_width > 0 && (size_t) a_width > a_len ? a_width - a_len : 0;
+
+    if (npad && !(a_flags & SPEC_MINUS))
+	output_fill(this, ' ', npad);
+    output_chars(this, a_string, a_len);
+    if (npad && (a_flags & SPEC_MINUS))
+	output_fill(this, ' ', npad);
+}
+
+/******************************************************************************/
+static void big_set(big_t* this, unsigned long long a_value)
+{
+    this->b_n = 0;
+    for (; a_value; a_value >>= 32)
+	this->b_limbs[this->b_n++] = (unsigned int) a_value;
+}
+
+/******************************************************************************/
+static void big_mul(big_t* this, unsigned int a_factor)
+{
+    unsigned long long carry = 0;
+    int i;
+
+    for (i = 0; i < this->b_n; i++) {
+	carry += (unsigned long long) this->b_limbs[i] * a_factor;
+	this->b_limbs[i] = (unsigned int) carry;
+	carry >>= 32;
+    }
+    if (carry)
+	this->b_limbs[this->b_n++] = (unsigned int) carry;
+}
+
+/******************************************************************************/
+static void big_mul_pow10(big_t* this, int a_exp)
+{
+    for (; a_exp >= 9; a_exp -= 9)
+	big_mul(this, 1000000000U);
+    if (a_exp)
+	big_mul(this, (unsigned int) float_pow10[a_exp]);
+}
+
+/******************************************************************************/
+static void big_shl(big_t* this, int a_bits)
+{
+    int words = a_bits / 32;
+    int bits = a_bits % 32;
+    int i;
+
+    if (!this->b_n || !a_bits)
+	return;
+
+    if (bits) {
+	unsigned int carry = 0;
+
+	for (i = 0; i < this->b_n; i++) {
+	    unsigned int limb = this->b_limbs[i];
+
+	    this->b_limbs[i] = (limb << bits) | carry;
+	    carry = limb >> (32 - bits);
+	}
+	if (carry)
+	    this->b_limbs[this->b_n++] = carry;
+    }
+
+    if (words) {
+	for (i = this->b_n - 1; i >= 0; i--)
+	    this->b_limbs[i + words] = this->b_limbs[i];
+	for (i = 0; i < words; i++)
+	    this->b_limbs[i] = 0;
+	this->b_n += words;
+    }
+}
+
+/******************************************************************************/
+static int big_cmp(const big_t* a_a, const big_t* a_b)
+{
+    int i;
+
+    if (a_a->b_n != a_b->b_n)
+	return a_a->b_n < a_b->b_n ? -1 : 1;
+    for (i = a_a->b_n - 1; i >= 0; i--)
+	if (a_a->b_limbs[i] != a_b->b_limbs[i])
+	    return a_a->b_limbs[i] < a_b->b_limbs[i] ? -1 : 1;
+    return 0;
+}
+
+/******************************************************************************/
+/*
+ * Compares 2 * a_mant * 2^a_exp * 10^a_scale with a_twice, a candidate
+ * doubled so that halves are integers. Both sides are scaled by the
+ * negative powers to stay integers: they fit in BIG_LIMBS since the
+ * callers keep a_twice below 2^54 and a_scale within FLOAT_POW10_MAX.
+ */
+static int float_cmp(unsigned long long a_mant, int a_exp, int a_scale,
+		     unsigned long long a_twice)
+{
+    big_t value, candidate;
+
+    /* the value is below 2^128 when a_exp < 0: far below a_twice */
+    if (a_exp < -200)
+	return a_twice ? -1 : 1;
+
+    big_set(&value, 2 * a_mant);
+    big_set(&candidate, a_twice);
+    if (a_exp > 0)
+	big_shl(&value, a_exp);
+    else
+	big_shl(&candidate, -a_exp);
+    if (a_scale > 0)
+	big_mul_pow10(&value, a_scale);
+    else
+	big_mul_pow10(&candidate, -a_scale);
+
+    return big_cmp(&value, &candidate);
+}
+
+/******************************************************************************/
+/*
+ * The nearest integer to a_mant * 2^a_exp * 10^a_scale, ties to even, in
+ * a_n. Returns -1 when it does not fit in 53 bits or the power of ten is
+ * not exact.
+ */
+static int float_round(double a_value, unsigned long long a_mant, int a_exp,
+		       int a_scale, unsigned long long* a_n)
+{
+    double estimate;
+    unsigned long long n;
+    int cmp;
+
+    if (a_scale > FLOAT_POW10_MAX || a_scale < -FLOAT_POW10_MAX)
+	return -1;
+
+    estimate = a_scale >= 0 ? a_value * float_pow10[a_scale] :
+	a_value / float_pow10[-a_scale];
+    if (!(estimate < FLOAT_EXACT_MAX))
+	return -1;
+
+    /* the estimate is off by one at most */
+    n = (unsigned long long) estimate;
+    if (n && float_cmp(a_mant, a_exp, a_scale, 2 * n) < 0)
+	n--;
+    else if (float_cmp(a_mant, a_exp, a_scale, 2 * n + 2) >= 0)
+	n++;
+
+    cmp = float_cmp(a_mant, a_exp, a_scale, 2 * n + 1);
+    if (cmp > 0 || (cmp == 0 && (n & 1)))
+	n++;
+
+    *a_n = n;
+    return 0;
+}
+
+/******************************************************************************/
+/* the digits of a_n, at least a_min of them */
+static size_t float_digits(char* a_buf, unsigned long long a_n, int a_min)
+{
+    char digits[24];
+    char* start = format_decimal(digits + sizeof(digits), a_n);
+    size_t len = digits + sizeof(digits) - start;
+    size_t zeros = a_min > 0 && (size_t) a_min > len ? a_min - len : 0;
+
+    memset(a_buf, '0', zeros);
+    memcpy(a_buf + zeros, start, len);
+    return zeros + len;
+}
+
+/******************************************************************************/
+/*
+ * Formats a double for %f, %e and %g. Returns -1 when it is left to
+ * snprintf().
+ */
+static int format_float(output_t* this, double a_value, int a_conv,
+			int a_flags, int a_width, int a_prec)
+{
+    char body[64];
+    char digits[32];
+    char* b = body;
+    const char* point = localeconv()->decimal_point;
+    unsigned long long bits, mant, n = 0;
+    int conv = a_conv | 0x20;
+    int upper = a_conv != conv;
+    int negative, exp, x = 0;
+    int nfrac, nint;
+    size_t ndigits, len;
+
+#if DBL_MANT_DIG != 53 || DBL_MAX_EXP != 1024
+    return -1;
+#endif
+    if (point[0] != '.' || point[1])
+	return -1;
+
+    memcpy(&bits, &a_value, sizeof(bits));
+    negative = (int) (bits >> 63);
+    exp	     = (int) (bits >> 52) & 0x7ff;
+    mant     = bits & ((1ULL << 52) - 1);
+    if (exp == 0x7ff)
+	return -1;
+    if (exp) {
+	mant |= 1ULL << 52;
+	exp -= 1075;
+    } else
+	exp = -1074;
+    if (negative)
+	a_value = -a_value;
+
+    if (a_prec < 0)
+	a_prec = 6;
+
+    if (conv == 'f') {
+	if (a_prec > FLOAT_POW10_MAX ||
+	    (mant && float_round(a_value, mant, exp, a_prec, &n) == -1))
+	    return -1;
+	nfrac = a_prec;
+    } else {
+	/* the significant digits, and the exponent of the first one */
+	int ndig = conv == 'g' ? (a_prec ? a_prec : 1) : a_prec + 1;
+	int msb = 63;
+
+	if (ndig > FLOAT_DIGITS_MAX)
+	    return -1;
+
+	if (mant) {
+	    while (!(mant >> msb))
+		msb--;
+	    /* floor(log10(value)), or one less */
+	    x = (int) ((msb + exp) * 0.30102999566398119521 +
+		       (msb + exp < 0 ? -1.0 : 0.0));
+	    if (float_round(a_value, mant, exp, ndig - 1 - x, &n) == -1)
+		return -1;
+	    if (n >= (unsigned long long) float_pow10[ndig]) {
+		x++;
+		if (float_round(a_value, mant, exp, ndig - 1 - x, &n) == -1)
+		    return -1;
+	    }
+	    /* rounded up to the next power of ten */
+	    if (n >= (unsigned long long) float_pow10[ndig]) {
+		n /= 10;
+		x++;
+	    }
+	}
+
+	if (conv == 'g' && x < ndig && x >= -4) {
+	    conv  = 'f';
+	    nfrac = ndig - 1 - x;
+	} else {
+	    conv  = 'e';
+	    nfrac = ndig - 1;
+	}
+    }
+
+    ndigits = float_digits(digits, n, nfrac + 1);
+    nint    = conv == 'e' ? 1 : (int) ndigits - nfrac;
+
+    /* %g drops the trailing zeros, and the point when nothing follows it */
+    if (a_conv == 'g' || a_conv == 'G') {
+	if (!(a_flags & SPEC_HASH))
+	    while (nfrac && digits[nint + nfrac - 1] == '0')
+		nfrac--;
+    }
+
+    if (negative)
+	*b++ = '-';
+    else if (a_flags & SPEC_PLUS)
+	*b++ = '+';
+    else if (a_flags & SPEC_SPACE)
+	*b++ = ' ';
+
+    memcpy(b, digits, nint);
+    b += nint;
+    if (nfrac || (a_flags & SPEC_HASH))
+	*b++ = '.';
+    memcpy(b, digits + nint, nfrac);
+    b += nfrac;
+
+    if (conv == 'e') {
+	*b++ = upper ? 'E' : 'e';
+	*b++ = x < 0 ? '-' : '+';
+	b += float_digits(b, (unsigned long long) (x < 0 ? -x : x), 2);
+    }
+    len = b - body;
+
+    if (a_width > 0 && (size_t) a_width > len) {
+	size_t npad = a_width - len;
+	size_t nsign = body[0] == '-' || body[0] == '+' || body[0] == ' ';
+
+	if (a_flags & SPEC_MINUS) {
+	    output_chars(this, body, len);
+	    output_fill(this, ' ', npad);
+	    return 0;
+	}
+	if (a_flags & SPEC_ZERO) {
+	    output_chars(this, body, nsign);
+	    output_fill(this, '0', npad);
+	    output_chars(this, body + nsign, len - nsign);
+	    return 0;
+	}
+	output_fill(this, ' ', npad);
+    }
+    output_chars(this, body, len);
+    return 0;
+}
+
+/******************************************************************************/
+/* a double format_float() does not take, formatted by snprintf() alone */
+static void format_float_libc(output_t* this, double a_value, int a_conv,
+			      int a_flags, int a_width, int a_prec)
+{
+    char fmt[16];
+    char buffer[128];
+    char* f = fmt;
+    char* text = buffer;
+    int n;
+
+    *f++ = '%';
+    if (a_flags & SPEC_MINUS) *f++ = '-';
+    if (a_flags & SPEC_PLUS)  *f++ = '+';
+    if (a_flags & SPEC_SPACE) *f++ = ' ';
+    if (a_flags & SPEC_HASH)  *f++ = '#';
+    if (a_flags & SPEC_ZERO)  *f++ = '0';
+    *f++ = '*';
+    *f++ = '.';
+    *f++ = '*';
+    *f++ = (char) a_conv;
+    *f   = '\0';
+
+    if ((n = snprintf(buffer, sizeof(buffer), fmt, a_width, a_prec,
+		      a_value)) < 0)
+	return;
+    if ((size_t) n >= sizeof(buffer)) {
+	text = sd_malloc(n + 1);
+	snprintf(text, n + 1, fmt, a_width, a_prec, a_value);
+    }
+    output_chars(this, text, n);
+    if (text != buffer)
+	free(text);
+}
+
+/******************************************************************************/
+/*
+ * Parses the conversion following a '%' into a_spec. Returns what follows
+ * it, or NULL if it is to be left to vsnprintf().
+ */
+static const char* parse_spec(const char* a_fmt, format_spec_t* a_spec)
+{
+    const char* p = a_fmt;
+
+    a_spec->sp_flags  = 0;
+    a_spec->sp_width  = 0;
+    a_spec->sp_prec   = -1;
+    a_spec->sp_length = LEN_NONE;
+
+    for (;; p++) {
+	switch (*p) {
+	case '-': a_spec->sp_flags |= SPEC_MINUS; continue;
+	case '+': a_spec->sp_flags |= SPEC_PLUS;  continue;
+	case ' ': a_spec->sp_flags |= SPEC_SPACE; continue;
+	case '#': a_spec->sp_flags |= SPEC_HASH;  continue;
+	case '0': a_spec->sp_flags |= SPEC_ZERO;  continue;
+	}
+	break;
+    }
+
+    if (*p == '*') {
+	a_spec->sp_flags |= SPEC_WIDTH_ARG;
+	if (*++p >= '0' && *p <= '9')
+	    return NULL;
+    } else {
+	while (*p >= '0' && *p <= '9')
+	    a_spec->sp_width = a_spec->sp_width * 10 + (*p++ - '0');
+	if (*p == '$')
+	    return NULL;
+    }
+
+    if (*p == '.') {
+	a_spec->sp_prec = 0;
+	if (*++p == '*') {
+	    a_spec->sp_flags |= SPEC_PREC_ARG;
+	    if (*++p >= '0' && *p <= '9')
+		return NULL;
+	} else
+	    while (*p >= '0' && *p <= '9')
+		a_spec->sp_prec = a_spec->sp_prec * 10 + (*p++ - '0');
+    }
+
+    switch (*p) {
+    case 'h':
+	if (*++p == 'h') { a_spec->sp_length = LEN_HH; p++; }
+	else a_spec->sp_length = LEN_H;
+	break;
+    case 'l':
+	if (*++p == 'l') { a_spec->sp_length = LEN_LL; p++; }
+	else a_spec->sp_length = LEN_L;
+	break;
+    case 'z': a_spec->sp_length = LEN_Z; p++; break;
+#ifdef HAVE_STDINT_H
+    case 'j': a_spec->sp_length = LEN_J; p++; break;
+#endif
+    case 't': a_spec->sp_length = LEN_T; p++; break;
+    }
+
+    switch (a_spec->sp_conv = *p++) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+    case 'n':
+    case '%':
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+	return p;
+    case 'c':
+    case 's':
+	return a_spec->sp_length == LEN_NONE ? p : NULL;
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+static void format_spec(output_t* this, const format_spec_t* a_spec,
+			va_list* a_args)
+{
+    unsigned long long value;
+    int flags = a_spec->sp_flags;
+    int width = a_spec->sp_width;
+    int prec = a_spec->sp_prec;
+
+    if (flags & SPEC_WIDTH_ARG) {
+	if ((width = va_arg(*a_args, int)) < 0) {
+	    flags |= SPEC_MINUS;
+	    width = -width;
+	}
+    }
+    if ((flags & SPEC_PREC_ARG) && (prec = va_arg(*a_args, int)) < 0)
+	prec = -1;
+
+    switch (a_spec->sp_conv) {
+    case 'd':
+    case 'i': {
+	long long v;
+
+	switch (a_spec->sp_length) {
+	case LEN_HH:	v = (signed char) va_arg(*a_args, int); break;
+	case LEN_H:	v = (short) va_arg(*a_args, int); break;
+	case LEN_L:	v = va_arg(*a_args, long); break;
+	case LEN_LL:	v = va_arg(*a_args, long long); break;
+	case LEN_Z:	v = va_arg(*a_args, ptrdiff_t); break;
+	case LEN_T:	v = va_arg(*a_args, ptrdiff_t); break;
+#ifdef HAVE_STDINT_H
+	case LEN_J:	v = va_arg(*a_args, intmax_t); break;
+#endif
+	default:	v = va_arg(*a_args, int); break;
+	}
+	value = v < 0 ? 0ULL - (unsigned long long) v : (unsigned long long) v;
+	format_integer(this, value, v < 0, a_spec->sp_conv, flags, width, prec);
+	break;
+    }
+
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+	switch (a_spec->sp_length) {
+	case LEN_HH:	value = (unsigned char) va_arg(*a_args, unsigned int); break;
+	case LEN_H:	value = (unsigned short) va_arg(*a_args, unsigned int); break;
+	case LEN_L:	value = va_arg(*a_args, unsigned long); break;
+	case LEN_LL:	value = va_arg(*a_args, unsigned long long); break;
+	case LEN_Z:	value = va_arg(*a_args, size_t); break;
+	case LEN_T:	value = (size_t) va_arg(*a_args, ptrdiff_t); break;
+#ifdef HAVE_STDINT_H
+	case LEN_J:	value = va_arg(*a_args, uintmax_t); break;
+#endif
+	default:	value = va_arg(*a_args, unsigned int); break;
+	}
+	format_integer(this, value, 0, a_spec->sp_conv, flags, width, prec);
+	break;
+
+    case 'c': {
+	char c = (char) va_arg(*a_args, int);
+
+	format_string(this, &c, 1, flags, width);
+	break;
+    }
+
+    case 's': {
+	const char* s = va_arg(*a_args, const char*);
+	size_t len;
+
+	if (s == NULL)
+	    s = prec < 0 || prec >= 6 ? "(null)" : "";
+	if (prec < 0)
+	    len = strlen(s);
+	else {
+	    const char* nul = memchr(s, '\0', prec);
+
+	    len = nul ? (size_t) (nul - s) : (size_t) prec;
+	}
+	format_string(this, s, len, flags, width);
+	break;
+    }
+
+    case 'n': {
+	void* n = va_arg(*a_args, void*);
+
+	switch (a_spec->sp_length) {
+	case LEN_HH:	*(signed char*) n = (signed char) this->o_len; break;
+	case LEN_H:	*(short*) n = (short) this->o_len; break;
+	case LEN_L:	*(long*) n = (long) this->o_len; break;
+	case LEN_LL:	*(long long*) n = (long long) this->o_len; break;
+	case LEN_Z:	*(size_t*) n = this->o_len; break;
+	case LEN_T:	*(ptrdiff_t*) n = (ptrdiff_t) this->o_len; break;
+#ifdef HAVE_STDINT_H
+	case LEN_J:	*(intmax_t*) n = (intmax_t) this->o_len; break;
+#endif
+	default:	*(int*) n = (int) this->o_len; break;
+	}
+	break;
+    }
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G': {
+	double v = va_arg(*a_args, double);
+
+	if (format_float(this, v, a_spec->sp_conv, flags, width, prec) == -1)
+	    format_float_libc(this, v, a_spec->sp_conv, flags, width, prec);
+	break;
+    }
+
+    case '%':
+	output_chars(this, "%", 1);
+	break;
+    }
+}
+
+/******************************************************************************/
+static int output_end(output_t* this)
+{
+    if (this->o_buf)
+	this->o_buf[this->o_len < this->o_size ? this->o_len : this->o_size] = '\0';
+
+    return this->o_len > INT_MAX ? -1 : (int) this->o_len;
+}
+
+/******************************************************************************/
+static void output_init(output_t* this, char* a_buf, size_t a_size)
+{
+    this->o_buf  = a_size ? a_buf : NULL;
+    this->o_size = a_size ? a_size - 1 : 0;
+    this->o_len  = 0;
+}
+
+/******************************************************************************/
+SD_API int sd_vsnprintf(char* a_buf, size_t a_size, const char* a_fmt,
+			va_list a_args)
+{
+    output_t out;
+    format_spec_t spec;
+    const char* p = a_fmt;
+    va_list ap;
+    int n;
+
+    output_init(&out, a_buf, a_size);
+
+    /* kept whole for the formats handed to vsnprintf() */
+    va_copy(ap, a_args);
+
+    for (;;) {
+	const char* percent = p;
+
+	while (*percent && *percent != '%')
+	    percent++;
+	output_chars(&out, p, percent - p);
+	if (!*percent)
+	    break;
+
+	if ((p = parse_spec(percent + 1, &spec)) == NULL) {
+	    va_end(ap);
+	    va_copy(ap, a_args);
+	    n = vsnprintf(a_buf, a_size, a_fmt, ap);
+	    va_end(ap);
+	    return n;
+	}
+	format_spec(&out, &spec, &ap);
+    }
+
+    va_end(ap);
+    return output_end(&out);
+}
+
+/******************************************************************************/
+SD_API sd_format_t* sd_format_new(const char* a_fmt)
+{
+    sd_format_t* this;
+    const char* p;
+    int nspecs = 1;
+
+    for (p = a_fmt; (p = strchr(p, '%')) != NULL; p++)
+	nspecs++;
+
+    this = sd_malloc(sizeof(*this) + (nspecs - 1) * sizeof(format_spec_t));
+    this->f_string    = a_fmt;
+    this->f_length    = 0;
+    this->f_vsnprintf = 0;
+    this->f_nspecs    = 0;
+
+    for (p = a_fmt; ; ) {
+	format_spec_t* spec = &this->f_specs[this->f_nspecs++];
+	const char* percent = p;
+
+	while (*percent && *percent != '%')
+	    percent++;
+	spec->sp_literal     = p;
+	spec->sp_literal_len = percent - p;
+	spec->sp_conv	     = 0;
+	if (!*percent)
+	    break;
+
+	if ((p = parse_spec(percent + 1, spec)) == NULL) {
+	    this->f_vsnprintf = 1;
+	    break;
+	}
+    }
+
+    if (this->f_nspecs == 1 && !this->f_vsnprintf)
+	this->f_length = this->f_specs[0].sp_literal_len;
+
+    return this;
+}
+
+/******************************************************************************/
+SD_API void sd_format_delete(sd_format_t* this)
+{
+    free(this);
+}
+
+/******************************************************************************/
+SD_API const char* sd_format_get_string(const sd_format_t* this)
+{
+    return this ? this->f_string : NULL;
+}
+
+/******************************************************************************/
+SD_API int sd_format_is_literal(const sd_format_t* this)
+{
+    return this && this->f_nspecs == 1 && !this->f_vsnprintf;
+}
+
+/******************************************************************************/
+SD_API size_t sd_format_get_length(const sd_format_t* this)
+{
+    return this ? this->f_length : 0;
+}
+
+/******************************************************************************/
+SD_API int sd_format_vsnprintf(const sd_format_t* this, char* a_buf,
+			       size_t a_size, va_list a_args)
+{
+    output_t out;
+    const format_spec_t* spec;
+    va_list ap;
+
+    if (this->f_vsnprintf)
+	return vsnprintf(a_buf, a_size, this->f_string, a_args);
+
+    output_init(&out, a_buf, a_size);
+    va_copy(ap, a_args);
+
+    for (spec = this->f_specs; ; spec++) {
+	output_chars(&out, spec->sp_literal, spec->sp_literal_len);
+	if (!spec->sp_conv)
+	    break;
+	format_spec(&out, spec, &ap);
+    }
+
+    va_end(ap);
+    return output_end(&out);
+}
+
+/******************************************************************************/
+SD_API char* sd_format_vsprintf(const sd_format_t* this, va_list a_args)
+{
+    return vsprintf_alloc(this, this->f_string, a_args);
+}
+
+/******************************************************************************/
+SD_API int sd_snprintf(char* a_buf, size_t a_size, const char* a_fmt, ...)
+{
+    va_list	args;
+    int		n;
+
+    va_start(args, a_fmt);
+    n = sd_vsnprintf(a_buf, a_size, a_fmt, args);
+    va_end(args);
+
+    return n;
+}
+
 #if defined(__osf__)
 #	ifndef snprintf
 #		include "sprintf.osf.c"
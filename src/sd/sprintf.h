@@ -49,6 +49,66 @@ SD_API char* sd_sprintf(const char* a_fmt, ...);
  */
 SD_API char* sd_vsprintf(const char* a_fmt, va_list a_arg);
 
+/**
+ * Same as vsnprintf(3), faster on integer, string and double conversions,
+ * which it formats itself. Doubles are correctly rounded like the C
+ * library does. Formats with long double, hexadecimal floating point or
+ * pointer conversions, positional arguments, wide characters or
+ * extensions of the C library are left to vsnprintf(3).
+ *
+ * @returns the length of the whole output, which was truncated if it is
+ * not less than \a size, or -1 on error.
+ */
+SD_API int sd_vsnprintf(char* str, size_t size, const char* fmt, va_list arg);
+
+/**
+ * Same as snprintf(3), see sd_vsnprintf().
+ */
+SD_API int sd_snprintf(char* str, size_t size, const char* fmt, ...);
+
+/**
+ * A format parsed once, to be formatted many times without scanning it
+ * again. It refers to the format string, which must outlive it.
+ */
+typedef struct __sd_format sd_format_t;
+
+/**
+ * Parses a format.
+ */
+SD_API sd_format_t* sd_format_new(const char* fmt);
+
+/**
+ * Destructor for sd_format_t.
+ */
+SD_API void sd_format_delete(sd_format_t* fmt);
+
+/**
+ * Returns the format string which was parsed.
+ */
+SD_API const char* sd_format_get_string(const sd_format_t* fmt);
+
+/**
+ * Returns true if the format has no conversion: the output is the format
+ * string itself.
+ */
+SD_API int sd_format_is_literal(const sd_format_t* fmt);
+
+/**
+ * Returns the length of the format string when it has no conversion.
+ */
+SD_API size_t sd_format_get_length(const sd_format_t* fmt);
+
+/**
+ * Same as sd_vsnprintf() with a parsed format.
+ */
+SD_API int sd_format_vsnprintf(const sd_format_t* fmt, char* str, size_t size,
+			       va_list arg);
+
+/**
+ * Same as sd_vsprintf() with a parsed format.
+ */
+SD_API char* sd_format_vsprintf(const sd_format_t* fmt, va_list arg);
+
 #if defined(__osf__)
 SD_API int snprintf(char* str, size_t size, const char* fmt, ...);
 SD_API int vsnprintf(char* str, size_t size, const char* fmt, va_list arg);
@@ -0,0 +1,72 @@
+static const char version[] = "$Id$";
+
+/*
+ * log4c-compile.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/rc.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USAGE "Usage: log4c-compile [-h] [-o <image>] <log4crc>...\n\n" \
+"Compiles log4crc files into binary images which log4c_init() loads\n" \
+"instead of parsing the files. An image is ignored as soon as the file\n" \
+"it was compiled from is modified.\n\n" \
+"By default the image of a file is written next to it, with the\n" \
+LOG4C_RC_IMAGE_SUFFIX " suffix, which is where log4c_init() looks for it.\n\n" \
+"-o  name of the image, when compiling a single file\n" \
+"-h  display this help message\n"
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    const char* output = NULL;
+    char* image;
+    int ret = 0;
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "ho:")) != -1) {
+	switch(c) {
+	case 'o':
+	    output = optarg;
+	    break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    if (SD_OPTIND >= argc || (output && SD_OPTIND + 1 < argc)) {
+	fprintf(stderr, USAGE);
+	return 1;
+    }
+
+    for (; SD_OPTIND < argc; SD_OPTIND++) {
+	const char* rcfile = argv[SD_OPTIND];
+
+	if (output)
+	    image = strdup(output);
+	else {
+	    image = malloc(strlen(rcfile) + sizeof(LOG4C_RC_IMAGE_SUFFIX));
+	    sprintf(image, "%s" LOG4C_RC_IMAGE_SUFFIX, rcfile);
+	}
+
+	if (log4c_rc_compile(rcfile, image) == -1) {
+	    fprintf(stderr, "log4c-compile: failed to compile %s\n", rcfile);
+	    ret = 1;
+	}
+
+	free(image);
+    }
+
+    return ret;
+}
@@ -0,0 +1,686 @@
+static const char version[] = "$Id$";
+
+/*
+ * log4c-decode.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "parse_time.h"
+#include <log4c/init.h>
+#include <log4c/rc.h>
+#include <log4c/layout.h>
+#include <log4c/layout_type_pattern.h>
+#include <log4c/priority.h>
+#include <log4c/binlog.h>
+#include <sd/malloc.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#define USAGE "Usage: log4c-decode [-h] [-l <layout>] [-P <pattern>] [-s <time>]\n" \
+"                   [-e <time>] [-c <category>] [-p <priority>] [-j <threads>]\n" \
+"                   <segment>...\n\n" \
+"Decodes the segment files written by log4c_binlog_start() and prints\n" \
+"the events through a layout, in the order they were written. Segments\n" \
+"are sorted by their number, so prefix.* can be given in any order.\n\n" \
+"Events are filtered on their record header, without rendering the\n" \
+"messages of the events which do not match. Segments are decoded by\n" \
+"several threads; the layout is applied in order by the main thread.\n\n" \
+"Times are seconds since the epoch, possibly with a fraction, or local\n" \
+"times as YYYY-MM-DD HH:MM:SS.\n\n" \
+"-l  layout: basic, dated, basic_r, dated_r, null, ISO8601, json, pattern..., basic\n" \
+"    default\n" \
+"-P  a pattern for the pattern layout, implies -l pattern\n" \
+"-s  skip the events before this time\n" \
+"-e  skip the events from this time on\n" \
+"-c  only the events of this category and of its descendants\n" \
+"-p  only the events of this priority or higher\n" \
+"-j  number of decoding threads, 4 by default\n" \
+"-h  display this help message\n"
+
+/* the contexts of a thread: cx_nmdc fields of sg_mdc from cx_mdc */
+typedef struct {
+    size_t			cx_mdc;
+    size_t			cx_nmdc;
+    const char*			cx_ndc;
+} context_t;
+
+/* ev_context is the index of the contexts of the event, plus one, or 0 */
+typedef struct {
+    const log4c_binlog_record_t* ev_rec;
+    const char*			ev_category;
+    log4c_thread_t		ev_thread;
+    size_t			ev_context;
+    size_t			ev_msg;
+} event_t;
+
+typedef struct {
+    const char*		sg_name;
+    long		sg_number;
+    char*		sg_data;
+    size_t		sg_size;
+    int			sg_mapped;
+    event_t*		sg_events;
+    size_t		sg_nevents;
+    size_t		sg_maxevents;
+    char*		sg_text;
+    size_t		sg_textlen;
+    size_t		sg_textsize;
+    context_t*		sg_contexts;
+    size_t		sg_ncontexts;
+    size_t		sg_maxcontexts;
+    log4c_field_t*	sg_mdc;
+    size_t		sg_nmdc;
+    size_t		sg_maxmdc;
+    int			sg_status;
+} segment_t;
+
+/* decoding state of a segment: its formats, categories and threads by id */
+typedef struct {
+    log4c_binlog_format_t**	dc_formats;
+    size_t			dc_nformats;
+    const char**		dc_categories;
+    signed char*		dc_match;
+    size_t			dc_ncategories;
+    log4c_thread_t*		dc_threads;
+    size_t			dc_nthreads;
+    size_t*			dc_contexts;
+    size_t			dc_ncontexts;
+} decoder_t;
+
+static segment_t*	segments = NULL;
+static size_t		nsegments = 0;
+
+static XP_INT64		opt_start = -1;
+static XP_INT64		opt_end = -1;
+static const char*	opt_category = NULL;
+static int		opt_priority = LOG4C_PRIORITY_UNKNOWN;
+static int		opt_threads = 4;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t	mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	cond = PTHREAD_COND_INITIALIZER;
+static size_t		next_decode = 0;
+static size_t		next_output = 0;
+#endif
+
+/******************************************************************************/
+/* the number after the last dot of a segment name */
+static long segment_number(const char* a_name)
+{
+    const char* dot = strrchr(a_name, '.');
+
+    return dot ? strtol(dot + 1, NULL, 10) : 0;
+}
+
+/******************************************************************************/
+static int segment_compare(const void* a_a, const void* a_b)
+{
+    const segment_t* a = a_a;
+    const segment_t* b = a_b;
+    size_t alen = strrchr(a->sg_name, '.') ?
+	(size_t) (strrchr(a->sg_name, '.') - a->sg_name) : strlen(a->sg_name);
+    size_t blen = strrchr(b->sg_name, '.') ?
+	(size_t) (strrchr(b->sg_name, '.') - b->sg_name) : strlen(b->sg_name);
+    int c;
+
+    if ((c = strncmp(a->sg_name, b->sg_name, alen < blen ? alen : blen)) != 0)
+	return c;
+    if (alen != blen)
+	return alen < blen ? -1 : 1;
+    return (a->sg_number > b->sg_number) - (a->sg_number < b->sg_number);
+}
+
+/******************************************************************************/
+static int segment_load(segment_t* this)
+{
+    struct stat st;
+    int fd;
+
+    if ((fd = open(this->sg_name, O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+	fprintf(stderr, "log4c-decode: can not open %s\n", this->sg_name);
+	if (fd != -1)
+	    close(fd);
+	return -1;
+    }
+
+    this->sg_size = st.st_size;
+#ifdef HAVE_MMAP
+    if (this->sg_size &&
+	(this->sg_data = mmap(NULL, this->sg_size, PROT_READ, MAP_PRIVATE,
+			      fd, 0)) != MAP_FAILED) {
+	this->sg_mapped = 1;
+	close(fd);
+	return 0;
+    }
+#endif
+    this->sg_data = sd_malloc(this->sg_size + 1);
+    if (read(fd, this->sg_data, this->sg_size) != (ssize_t) this->sg_size) {
+	fprintf(stderr, "log4c-decode: can not read %s\n", this->sg_name);
+	close(fd);
+	return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+/******************************************************************************/
+static void segment_free(segment_t* this)
+{
+#ifdef HAVE_MMAP
+    if (this->sg_mapped)
+	munmap(this->sg_data, this->sg_size);
+    else
+#endif
+	free(this->sg_data);
+    free(this->sg_events);
+    free(this->sg_text);
+    free(this->sg_contexts);
+    free(this->sg_mdc);
+    this->sg_data     = NULL;
+    this->sg_events   = NULL;
+    this->sg_text     = NULL;
+    this->sg_contexts = NULL;
+    this->sg_mdc      = NULL;
+}
+
+/******************************************************************************/
+static void decoder_grow(void** a_array, size_t* a_n, size_t a_id, size_t a_size)
+{
+    size_t n = *a_n ? *a_n : 64;
+
+    while (n <= a_id)
+	n *= 2;
+    *a_array = sd_realloc(*a_array, n * a_size);
+    memset((char*) *a_array + *a_n * a_size, 0, (n - *a_n) * a_size);
+    *a_n = n;
+}
+
+/******************************************************************************/
+static int category_match(const char* a_name)
+{
+    size_t len;
+
+    if (!opt_category || !strcmp(opt_category, "root"))
+	return 1;
+
+    len = strlen(opt_category);
+    return !strncmp(a_name, opt_category, len) &&
+	(a_name[len] == '\0' || a_name[len] == '.');
+}
+
+/******************************************************************************/
+static int event_add(segment_t* this, decoder_t* a_dc,
+		     const log4c_binlog_record_t* a_rec)
+{
+    const log4c_binlog_format_t* fmt = NULL;
+    const char* message = NULL;
+    const void* fields;
+    size_t fieldsize;
+    event_t* ev;
+    int n;
+
+    if (a_rec->rec_category >= a_dc->dc_ncategories ||
+	!a_dc->dc_categories[a_rec->rec_category])
+	return -1;
+
+    /* the fields are decoded again when the event is printed */
+    if (a_rec->rec_type == LOG4C_BINLOG_KV) {
+	if (log4c_binlog_kv_split(a_rec + 1, a_rec->rec_size - sizeof(*a_rec),
+				  &message, &fields, &fieldsize) == -1 ||
+	    log4c_field_decode(fields, fieldsize, NULL, 0) < 0)
+	    return -1;
+    }
+    else if (a_rec->rec_format >= a_dc->dc_nformats ||
+	     (fmt = a_dc->dc_formats[a_rec->rec_format]) == NULL)
+	return -1;
+
+    if (this->sg_textsize - this->sg_textlen < 256) {
+	this->sg_textsize = this->sg_textsize ? 2 * this->sg_textsize : 65536;
+	this->sg_text = sd_realloc(this->sg_text, this->sg_textsize);
+    }
+
+    for (;;) {
+	size_t room = this->sg_textsize - this->sg_textlen;
+
+	if (message) {
+	    n = (int) strlen(message);
+	    if ((size_t) n < room) {
+		memcpy(this->sg_text + this->sg_textlen, message, n + 1);
+		break;
+	    }
+	}
+	else if ((n = log4c_binlog_format_render(fmt, a_rec + 1,
+						 a_rec->rec_size - sizeof(*a_rec),
+						 this->sg_text + this->sg_textlen,
+						 room)) < 0)
+	    return -1;
+	else if ((size_t) n < room)
+	    break;
+	this->sg_textsize = 2 * this->sg_textsize + n;
+	this->sg_text = sd_realloc(this->sg_text, this->sg_textsize);
+    }
+
+    if (this->sg_nevents == this->sg_maxevents) {
+	this->sg_maxevents = this->sg_maxevents ? 2 * this->sg_maxevents : 1024;
+	this->sg_events = sd_realloc(this->sg_events,
+				     this->sg_maxevents * sizeof(event_t));
+    }
+
+    ev = &this->sg_events[this->sg_nevents++];
+    ev->ev_rec	    = a_rec;
+    ev->ev_category = a_dc->dc_categories[a_rec->rec_category];
+    if (a_rec->rec_thread < a_dc->dc_nthreads &&
+	a_dc->dc_threads[a_rec->rec_thread].th_name)
+	ev->ev_thread = a_dc->dc_threads[a_rec->rec_thread];
+    else {
+	/* a thread the segment does not define */
+	ev->ev_thread.th_id   = a_rec->rec_thread;
+	ev->ev_thread.th_name = "?";
+    }
+    ev->ev_context = a_rec->rec_thread < a_dc->dc_ncontexts ?
+	a_dc->dc_contexts[a_rec->rec_thread] : 0;
+    ev->ev_msg	    = this->sg_textlen;
+    this->sg_textlen += n + 1;
+    return 0;
+}
+
+/******************************************************************************/
+static int context_add(segment_t* this, decoder_t* a_dc,
+		       const log4c_binlog_record_t* a_rec)
+{
+    context_t* cx;
+    const char* ndc;
+    const void* mdc;
+    size_t mdcsize;
+    int n;
+
+    if (log4c_binlog_kv_split(a_rec + 1, a_rec->rec_size - sizeof(*a_rec),
+			      &ndc, &mdc, &mdcsize) == -1 ||
+	(n = log4c_field_decode(mdc, mdcsize, NULL, 0)) < 0)
+	return -1;
+
+    if (this->sg_maxmdc - this->sg_nmdc < (size_t) n) {
+	this->sg_maxmdc = 2 * this->sg_maxmdc + n;
+	this->sg_mdc = sd_realloc(this->sg_mdc,
+				  this->sg_maxmdc * sizeof(*this->sg_mdc));
+    }
+    if (this->sg_ncontexts == this->sg_maxcontexts) {
+	this->sg_maxcontexts = this->sg_maxcontexts ? 2 * this->sg_maxcontexts : 16;
+	this->sg_contexts = sd_realloc(this->sg_contexts,
+				       this->sg_maxcontexts * sizeof(*cx));
+    }
+
+    cx = &this->sg_contexts[this->sg_ncontexts++];
+    cx->cx_mdc  = this->sg_nmdc;
+    cx->cx_nmdc = log4c_field_decode(mdc, mdcsize, this->sg_mdc + this->sg_nmdc, n);
+    cx->cx_ndc  = *ndc ? ndc : NULL;
+    this->sg_nmdc += n;
+
+    if (a_rec->rec_thread >= a_dc->dc_ncontexts)
+	decoder_grow((void**) &a_dc->dc_contexts, &a_dc->dc_ncontexts,
+		     a_rec->rec_thread, sizeof(*a_dc->dc_contexts));
+    a_dc->dc_contexts[a_rec->rec_thread] = this->sg_ncontexts;
+    return 0;
+}
+
+/******************************************************************************/
+static int segment_decode(segment_t* this)
+{
+    const log4c_binlog_header_t* hdr;
+    decoder_t dc;
+    size_t offset;
+    size_t i;
+    int ret = 0;
+
+    if (segment_load(this) == -1)
+	return -1;
+
+    hdr = (const log4c_binlog_header_t*) this->sg_data;
+    if (this->sg_size < sizeof(*hdr) ||
+	memcmp(hdr->hdr_magic, LOG4C_BINLOG_MAGIC, sizeof(hdr->hdr_magic)) ||
+	hdr->hdr_version != LOG4C_BINLOG_VERSION) {
+	fprintf(stderr, "log4c-decode: %s is not a segment\n", this->sg_name);
+	return -1;
+    }
+    if (hdr->hdr_byteorder != LOG4C_BINLOG_BYTEORDER) {
+	fprintf(stderr, "log4c-decode: %s was written with another byte order\n",
+		this->sg_name);
+	return -1;
+    }
+
+    memset(&dc, 0, sizeof(dc));
+
+    for (offset = sizeof(*hdr); offset < this->sg_size; ) {
+	const log4c_binlog_record_t* rec =
+	    (const log4c_binlog_record_t*) (this->sg_data + offset);
+	const char* string = (const char*) (rec + 1);
+	XP_INT64 usec;
+
+	if (this->sg_size - offset < sizeof(*rec) ||
+	    rec->rec_size < sizeof(*rec) || rec->rec_size % 8 ||
+	    rec->rec_size > this->sg_size - offset) {
+	    /* the writer stopped in the middle of a record */
+	    fprintf(stderr, "log4c-decode: %s: truncated at offset %lu\n",
+		    this->sg_name, (unsigned long) offset);
+	    break;
+	}
+	offset += rec->rec_size;
+
+	switch (rec->rec_type) {
+	case LOG4C_BINLOG_FORMAT:
+	    if (!memchr(string, '\0', rec->rec_size - sizeof(*rec)))
+		break;
+	    if (rec->rec_format >= dc.dc_nformats)
+		decoder_grow((void**) &dc.dc_formats, &dc.dc_nformats,
+			     rec->rec_format, sizeof(*dc.dc_formats));
+	    log4c_binlog_format_delete(dc.dc_formats[rec->rec_format]);
+	    dc.dc_formats[rec->rec_format] = log4c_binlog_format_new(string);
+	    break;
+
+	case LOG4C_BINLOG_CATEGORY: {
+	    size_t n = dc.dc_ncategories;
+
+	    if (!memchr(string, '\0', rec->rec_size - sizeof(*rec)))
+		break;
+	    if (rec->rec_category >= dc.dc_ncategories) {
+		decoder_grow((void**) &dc.dc_categories, &n,
+			     rec->rec_category, sizeof(*dc.dc_categories));
+		decoder_grow((void**) &dc.dc_match, &dc.dc_ncategories,
+			     rec->rec_category, sizeof(*dc.dc_match));
+	    }
+	    dc.dc_categories[rec->rec_category] = string;
+	    dc.dc_match[rec->rec_category] = category_match(string);
+	    break;
+	}
+
+	case LOG4C_BINLOG_THREAD:
+	    if (!memchr(string, '\0', rec->rec_size - sizeof(*rec)))
+		break;
+	    if (rec->rec_thread >= dc.dc_nthreads)
+		decoder_grow((void**) &dc.dc_threads, &dc.dc_nthreads,
+			     rec->rec_thread, sizeof(*dc.dc_threads));
+	    dc.dc_threads[rec->rec_thread].th_id   = (unsigned long) rec->rec_sequence;
+	    dc.dc_threads[rec->rec_thread].th_name = string;
+	    break;
+
+	case LOG4C_BINLOG_CONTEXT:
+	    if (context_add(this, &dc, rec) == -1) {
+		fprintf(stderr, "log4c-decode: %s: bad context at offset %lu\n",
+			this->sg_name, (unsigned long) (offset - rec->rec_size));
+		ret = -1;
+	    }
+	    break;
+
+	case LOG4C_BINLOG_EVENT:
+	case LOG4C_BINLOG_KV:
+	    usec = (XP_INT64) (rec->rec_realtime / 1000);
+	    if ((opt_start != -1 && usec < opt_start) ||
+		(opt_end != -1 && usec >= opt_end) ||
+		rec->rec_priority > opt_priority ||
+		(rec->rec_category < dc.dc_ncategories &&
+		 !dc.dc_match[rec->rec_category]))
+		break;
+
+	    if (event_add(this, &dc, rec) == -1) {
+		fprintf(stderr, "log4c-decode: %s: bad event at offset %lu\n",
+			this->sg_name, (unsigned long) (offset - rec->rec_size));
+		ret = -1;
+	    }
+	    break;
+
+	default:
+	    break;
+	}
+    }
+
+    for (i = 0; i < dc.dc_nformats; i++)
+	log4c_binlog_format_delete(dc.dc_formats[i]);
+    free(dc.dc_formats);
+    free(dc.dc_categories);
+    free(dc.dc_match);
+    free(dc.dc_threads);
+    free(dc.dc_contexts);
+    return ret;
+}
+
+/******************************************************************************/
+static void segment_output(segment_t* this, log4c_layout_t* a_layout,
+			   log4c_logging_event_t* a_event)
+{
+    static log4c_field_t* fields = NULL;
+    static size_t maxfields = 0;
+    size_t i;
+
+    for (i = 0; i < this->sg_nevents; i++) {
+	const event_t* ev = &this->sg_events[i];
+	const char* rendered;
+	const char* message;
+	const void* data;
+	size_t size;
+	int n = 0;
+
+	if (ev->ev_rec->rec_type == LOG4C_BINLOG_KV &&
+	    log4c_binlog_kv_split(ev->ev_rec + 1,
+				  ev->ev_rec->rec_size - sizeof(*ev->ev_rec),
+				  &message, &data, &size) == 0 &&
+	    (n = log4c_field_decode(data, size, NULL, 0)) > 0) {
+	    if ((size_t) n > maxfields) {
+		maxfields = n;
+		fields = sd_realloc(fields, maxfields * sizeof(*fields));
+	    }
+	    log4c_field_decode(data, size, fields, n);
+	}
+	a_event->evt_fields  = n > 0 ? fields : NULL;
+	a_event->evt_nfields = n > 0 ? n : 0;
+
+	a_event->evt_category		= ev->ev_category;
+	a_event->evt_priority		= ev->ev_rec->rec_priority;
+	a_event->evt_msg		= this->sg_text + ev->ev_msg;
+	a_event->evt_sequence		= ev->ev_rec->rec_sequence;
+	a_event->evt_thread		= &ev->ev_thread;
+	if (ev->ev_context) {
+	    const context_t* cx = &this->sg_contexts[ev->ev_context - 1];
+
+	    a_event->evt_mdc  = cx->cx_nmdc ? this->sg_mdc + cx->cx_mdc : NULL;
+	    a_event->evt_nmdc = cx->cx_nmdc;
+	    a_event->evt_ndc  = cx->cx_ndc;
+	}
+	else {
+	    a_event->evt_mdc  = NULL;
+	    a_event->evt_nmdc = 0;
+	    a_event->evt_ndc  = NULL;
+	}
+	log4c_logging_event_set_time(a_event, ev->ev_rec->rec_realtime,
+				     ev->ev_rec->rec_monotonic);
+
+	if ((rendered = log4c_layout_format(a_layout, a_event)) == NULL)
+	    rendered = a_event->evt_msg;
+	fputs(rendered, stdout);
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+/******************************************************************************/
+/*
+ * Decodes the next segment, staying at most two segments per thread ahead
+ * of the output so that memory use stays bounded.
+ */
+static void* decode_thread(void* a_arg)
+{
+    size_t window = 2 * opt_threads;
+    size_t i;
+    int status;
+
+    (void) a_arg;
+
+    for (;;) {
+	pthread_mutex_lock(&mutex);
+	while (next_decode < nsegments && next_decode >= next_output + window)
+	    pthread_cond_wait(&cond, &mutex);
+	if (next_decode >= nsegments) {
+	    pthread_mutex_unlock(&mutex);
+	    break;
+	}
+	i = next_decode++;
+	pthread_mutex_unlock(&mutex);
+
+	status = segment_decode(&segments[i]) == -1 ? -1 : 1;
+
+	pthread_mutex_lock(&mutex);
+	segments[i].sg_status = status;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+    }
+
+    return NULL;
+}
+#endif
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    const char* layout_name = "basic";
+    const char* pattern = NULL;
+    const log4c_layout_type_t* layout_type;
+    log4c_layout_t* layout;
+    log4c_logging_event_t evt;
+#ifdef HAVE_PTHREAD_H
+    pthread_t* threads;
+#endif
+    size_t i;
+    int ret = 0;
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "hl:P:s:e:c:p:j:")) != -1) {
+	switch(c) {
+	case 'l':
+	    layout_name = optarg;
+	    break;
+	case 'P':
+	    pattern	= optarg;
+	    layout_name = "pattern";
+	    break;
+	case 's':
+	case 'e':
+	    if (parse_time(optarg) == -1) {
+		fprintf(stderr, "log4c-decode: bad time '%s'\n", optarg);
+		return 1;
+	    }
+	    *(c == 's' ? &opt_start : &opt_end) = parse_time(optarg);
+	    break;
+	case 'c':
+	    opt_category = optarg;
+	    break;
+	case 'p':
+	    if ((opt_priority = log4c_priority_to_int(optarg)) ==
+		LOG4C_PRIORITY_UNKNOWN) {
+		fprintf(stderr, "log4c-decode: unknown priority '%s'\n", optarg);
+		fprintf(stderr, USAGE);
+		return 1;
+	    }
+	    break;
+	case 'j':
+	    if ((opt_threads = atoi(optarg)) < 1)
+		opt_threads = 1;
+	    break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    if (SD_OPTIND >= argc) {
+	fprintf(stderr, USAGE);
+	return 1;
+    }
+
+    log4c_init();
+
+    if ((layout_type = log4c_layout_type_get(layout_name)) == NULL) {
+	fprintf(stderr, "log4c-decode: unknown layout '%s'\n", layout_name);
+	log4c_fini();
+	return 1;
+    }
+    layout = log4c_layout_get("log4c-decode");
+    log4c_layout_set_type(layout, layout_type);
+    if (pattern && log4c_layout_pattern_set(layout, pattern) == -1) {
+	fprintf(stderr, "log4c-decode: bad pattern '%s'\n", pattern);
+	log4c_fini();
+	return 1;
+    }
+
+    nsegments = argc - SD_OPTIND;
+    segments  = sd_calloc(nsegments, sizeof(*segments));
+    for (i = 0; i < nsegments; i++) {
+	segments[i].sg_name   = argv[SD_OPTIND + i];
+	segments[i].sg_number = segment_number(segments[i].sg_name);
+    }
+    qsort(segments, nsegments, sizeof(*segments), segment_compare);
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_buffer.buf_maxsize = log4c_rc->config.bufsize;
+    evt.evt_buffer.buf_size = evt.evt_buffer.buf_maxsize ?
+	evt.evt_buffer.buf_maxsize : LOG4C_BUFFER_SIZE_DEFAULT;
+    evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
+
+#ifdef HAVE_PTHREAD_H
+    threads = sd_calloc(opt_threads, sizeof(*threads));
+    for (c = 0; c < opt_threads; c++)
+	pthread_create(&threads[c], NULL, decode_thread, NULL);
+
+    for (i = 0; i < nsegments; i++) {
+	pthread_mutex_lock(&mutex);
+	while (!segments[i].sg_status)
+	    pthread_cond_wait(&cond, &mutex);
+	pthread_mutex_unlock(&mutex);
+
+	if (segments[i].sg_status == -1)
+	    ret = 1;
+	segment_output(&segments[i], layout, &evt);
+	segment_free(&segments[i]);
+
+	pthread_mutex_lock(&mutex);
+	next_output++;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+    }
+
+    for (c = 0; c < opt_threads; c++)
+	pthread_join(threads[c], NULL);
+    free(threads);
+#else
+    for (i = 0; i < nsegments; i++) {
+	if (segment_decode(&segments[i]) == -1)
+	    ret = 1;
+	segment_output(&segments[i], layout, &evt);
+	segment_free(&segments[i]);
+    }
+#endif
+
+    fflush(stdout);
+    free(evt.evt_buffer.buf_data);
+    free(segments);
+    log4c_fini();
+    return ret;
+}
@@ -0,0 +1,236 @@
+static const char version[] = "$Id$";
+
+/*
+ * log4c-flight.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/appender_type_flightrecorder.h>
+#include <sd/malloc.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USAGE "Usage: log4c-flight [-h] [-t] <dump>...\n\n" \
+"Prints the lines kept by the flight recorder appenders in the files\n" \
+"written by log4c_flightrecorder_dump(), merging the rings of the\n" \
+"threads and the dumps by time.\n\n" \
+"-t  prefix each line with the name or the id of its thread\n" \
+"-h  display this help message\n"
+
+typedef struct {
+    log4c_flightrecorder_record_t	ln_rec;
+    const char*				ln_text;
+    const char*				ln_thread;
+} line_t;
+
+static line_t*	lines = NULL;
+static size_t	nlines = 0;
+static size_t	maxlines = 0;
+
+/******************************************************************************/
+static char* dump_load(const char* a_name, size_t* a_size)
+{
+    FILE* fp;
+    char* data;
+    long size;
+
+    if ((fp = fopen(a_name, "rb")) == NULL ||
+	fseek(fp, 0, SEEK_END) == -1 || (size = ftell(fp)) == -1 ||
+	fseek(fp, 0, SEEK_SET) == -1) {
+	fprintf(stderr, "log4c-flight: can not open %s\n", a_name);
+	if (fp)
+	    fclose(fp);
+	return NULL;
+    }
+
+    data = sd_malloc(size + 1);
+    if (fread(data, 1, size, fp) != (size_t) size) {
+	fprintf(stderr, "log4c-flight: can not read %s\n", a_name);
+	fclose(fp);
+	free(data);
+	return NULL;
+    }
+    fclose(fp);
+    *a_size = size;
+    return data;
+}
+
+/******************************************************************************/
+/* whether a record fits in the rest of the ring and is well formed; a
+   padding record may be cut to its size and length at the end of a ring */
+static int record_check(const log4c_flightrecorder_record_t* a_rec,
+			size_t a_left)
+{
+    if (a_rec->fr_size % 8 || a_rec->fr_size > a_left)
+	return 0;
+    if (a_rec->fr_len == LOG4C_FLIGHTRECORDER_PADDING)
+	return a_rec->fr_size >= 8;
+    return a_rec->fr_size >= sizeof(*a_rec) &&
+	a_rec->fr_size == ((sizeof(*a_rec) + a_rec->fr_len + 7) & ~(size_t) 7);
+}
+
+/******************************************************************************/
+/* the records of a ring, without the padding and the torn ones: past a torn
+   record, the ring is searched for the next well formed one */
+static void ring_parse(const char* a_name, const char* a_data, size_t a_size,
+		       const char* a_thread)
+{
+    log4c_flightrecorder_record_t rec;
+    size_t offset = 0;
+    size_t skipped = 0;
+
+    while (offset + 8 <= a_size) {
+	memset(&rec, 0, sizeof(rec));
+	memcpy(&rec, a_data + offset,
+	       a_size - offset < sizeof(rec) ? a_size - offset : sizeof(rec));
+	if (!record_check(&rec, a_size - offset)) {
+	    offset  += 8;
+	    skipped += 8;
+	    continue;
+	}
+
+	if (rec.fr_len != LOG4C_FLIGHTRECORDER_PADDING) {
+	    if (nlines == maxlines) {
+		maxlines = maxlines ? 2 * maxlines : 1024;
+		lines = sd_realloc(lines, maxlines * sizeof(*lines));
+	    }
+	    lines[nlines].ln_rec    = rec;
+	    lines[nlines].ln_text   = a_data + offset + sizeof(rec);
+	    lines[nlines].ln_thread = a_thread;
+	    nlines++;
+	}
+	offset += rec.fr_size;
+    }
+
+    if (skipped)
+	fprintf(stderr, "log4c-flight: %s: %lu torn bytes of thread %s skipped\n",
+		a_name, (unsigned long) skipped, a_thread);
+}
+
+/******************************************************************************/
+static int dump_parse(const char* a_name, char* a_data, size_t a_size)
+{
+    log4c_flightrecorder_header_t hdr;
+    log4c_flightrecorder_ring_t* ring;
+    size_t offset = sizeof(hdr);
+    unsigned int i;
+
+    if (a_size < sizeof(hdr))
+	goto bad;
+    memcpy(&hdr, a_data, sizeof(hdr));
+    if (memcmp(hdr.hdr_magic, LOG4C_FLIGHTRECORDER_MAGIC,
+	       sizeof(hdr.hdr_magic)) ||
+	hdr.hdr_version != LOG4C_FLIGHTRECORDER_VERSION)
+	goto bad;
+    if (hdr.hdr_byteorder != LOG4C_FLIGHTRECORDER_BYTEORDER) {
+	fprintf(stderr, "log4c-flight: %s was written with another byte order\n",
+		a_name);
+	return -1;
+    }
+
+    for (i = 0; i < hdr.hdr_nrings; i++) {
+	if (offset + sizeof(*ring) > a_size)
+	    goto truncated;
+	ring = (log4c_flightrecorder_ring_t*) (a_data + offset);
+	offset += sizeof(*ring);
+	if (ring->ring_size > a_size - offset)
+	    goto truncated;
+
+	/* the name is not terminated when it fills the field */
+	ring->ring_name[sizeof(ring->ring_name) - 1] = '\0';
+	if (!ring->ring_name[0])
+	    sprintf(ring->ring_name, "%llu", ring->ring_thread);
+	if (ring->ring_cuts)
+	    fprintf(stderr, "log4c-flight: %s: %llu lines of thread %s cut\n",
+		    a_name, ring->ring_cuts, ring->ring_name);
+
+	ring_parse(a_name, a_data + offset, (size_t) ring->ring_size,
+		   ring->ring_name);
+	offset += (size_t) ring->ring_size;
+    }
+    return 0;
+
+ bad:
+    fprintf(stderr, "log4c-flight: %s is not a flight recorder dump\n", a_name);
+    return -1;
+
+ truncated:
+    fprintf(stderr, "log4c-flight: %s: truncated at offset %lu\n", a_name,
+	    (unsigned long) offset);
+    return -1;
+}
+
+/******************************************************************************/
+static int line_compare(const void* a_a, const void* a_b)
+{
+    const log4c_flightrecorder_record_t* a = &((const line_t*) a_a)->ln_rec;
+    const log4c_flightrecorder_record_t* b = &((const line_t*) a_b)->ln_rec;
+
+    if (a->fr_monotonic != b->fr_monotonic)
+	return a->fr_monotonic < b->fr_monotonic ? -1 : 1;
+    if (a->fr_realtime != b->fr_realtime)
+	return a->fr_realtime < b->fr_realtime ? -1 : 1;
+    if (a->fr_sequence != b->fr_sequence)
+	return a->fr_sequence < b->fr_sequence ? -1 : 1;
+    return 0;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    char** dumps;
+    size_t ndumps;
+    size_t size;
+    size_t i;
+    int opt_thread = 0;
+    int ret = 0;
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "ht")) != -1) {
+	switch(c) {
+	case 't':
+	    opt_thread = 1;
+	    break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    if (SD_OPTIND >= argc) {
+	fprintf(stderr, USAGE);
+	return 1;
+    }
+
+    ndumps = argc - SD_OPTIND;
+    dumps  = sd_calloc(ndumps, sizeof(*dumps));
+    for (i = 0; i < ndumps; i++) {
+	if ((dumps[i] = dump_load(argv[SD_OPTIND + i], &size)) == NULL ||
+	    dump_parse(argv[SD_OPTIND + i], dumps[i], size) == -1)
+	    ret = 1;
+    }
+
+    /* the sequence orders the lines a thread logged at the same time */
+    qsort(lines, nlines, sizeof(*lines), line_compare);
+
+    for (i = 0; i < nlines; i++) {
+	if (opt_thread)
+	    printf("[%s] ", lines[i].ln_thread);
+	fwrite(lines[i].ln_text, 1, lines[i].ln_rec.fr_len, stdout);
+    }
+
+    fflush(stdout);
+    for (i = 0; i < ndumps; i++)
+	free(dumps[i]);
+    free(dumps);
+    free(lines);
+    return ret;
+}
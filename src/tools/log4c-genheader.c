@@ -0,0 +1,260 @@
+static const char version[] = "$Id$";
+
+/*
+ * log4c-genheader.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/priority.h>
+#include <sd/domnode.h>
+#include <sd/hash.h>
+#include <sd/malloc.h>
+#include <sd/sd_xplatform.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USAGE "Usage: log4c-genheader [-h] [-o <header>] [-p <prefix>] <log4crc>...\n\n" \
+"Generates a C header describing the categories of log4crc files, read\n" \
+"in order like log4c_init() does. For each category it defines:\n\n" \
+"  PREFIX_PRIORITY_<id>  the chained priority, usable in #if\n" \
+"  prefix_<id>           a log4c_static_category_t descriptor\n\n" \
+"where <id> is the category name with dots and other characters which\n" \
+"can not appear in a C identifier replaced by '_'.\n\n" \
+"-o  name of the header, instead of the standard output\n" \
+"-p  prefix of the generated names, log4c_static by default\n" \
+"-h  display this help message\n"
+
+typedef struct {
+    char*	name;
+    char*	id;
+    int		priority;
+} category_t;
+
+static category_t*	categories = NULL;
+static size_t		ncategories = 0;
+static size_t		maxcategories = 0;
+static sd_hash_t*	names = NULL;
+
+/******************************************************************************/
+static char* category_id(const char* a_name)
+{
+    char* id = sd_strdup(a_name);
+    char* p;
+
+    for (p = id; *p; p++)
+	if (!isalnum((unsigned char) *p))
+	    *p = '_';
+    return id;
+}
+
+/******************************************************************************/
+static category_t* category_get(const char* a_name)
+{
+    sd_hash_iter_t* i;
+    category_t* cat;
+
+    if ((i = sd_hash_lookup(names, a_name)) != NULL)
+	return &categories[(size_t) i->data - 1];
+
+    if (ncategories == maxcategories) {
+	maxcategories = maxcategories ? 2 * maxcategories : 256;
+	categories = sd_realloc(categories, maxcategories * sizeof(*categories));
+    }
+
+    cat		  = &categories[ncategories++];
+    cat->name	  = sd_strdup(a_name);
+    cat->id	  = category_id(a_name);
+    cat->priority = LOG4C_PRIORITY_NOTSET;
+    sd_hash_add(names, cat->name, (void*) ncategories);
+    return cat;
+}
+
+/******************************************************************************/
+static int load(const char* a_filename)
+{
+    sd_domnode_t* root_node = sd_domnode_new(NULL, NULL);
+    sd_list_iter_t* i;
+
+    if (sd_domnode_load(root_node, a_filename) == -1 ||
+	!root_node->name || strcmp(root_node->name, "log4c")) {
+	fprintf(stderr, "log4c-genheader: can not load %s\n", a_filename);
+	sd_domnode_delete(root_node);
+	return -1;
+    }
+
+    for (i = sd_list_begin(root_node->children);
+	 i != sd_list_end(root_node->children);
+	 i = sd_list_iter_next(i))
+    {
+	sd_domnode_t* node = i->data;
+	sd_domnode_t* name;
+	sd_domnode_t* priority;
+
+	if (strcmp(node->name, "category") ||
+	    (name = sd_domnode_attrs_get(node, "name")) == NULL ||
+	    !*name->value)
+	    continue;
+
+	if ((priority = sd_domnode_attrs_get(node, "priority")) != NULL)
+	    category_get(name->value)->priority =
+		log4c_priority_to_int(priority->value);
+	else
+	    category_get(name->value);
+    }
+
+    sd_domnode_delete(root_node);
+    return 0;
+}
+
+/******************************************************************************/
+/*
+ * Same as log4c_category_get_chainedpriority(): the first priority set
+ * going up the dotted name, then the root category.
+ */
+static int chained_priority(const category_t* a_cat)
+{
+    const category_t* root = category_get("root");
+    sd_hash_iter_t* i;
+    char* name = sd_strdup(a_cat->name);
+    char* dot;
+    int priority = a_cat->priority;
+
+    while (priority == LOG4C_PRIORITY_NOTSET &&
+	   (dot = strrchr(name, '.')) != NULL) {
+	*dot = '\0';
+	if ((i = sd_hash_lookup(names, name)) != NULL)
+	    priority = categories[(size_t) i->data - 1].priority;
+    }
+    free(name);
+
+    return (priority == LOG4C_PRIORITY_NOTSET ? root->priority : priority);
+}
+
+/******************************************************************************/
+static void print_string(FILE* a_fp, const char* a_str)
+{
+    fputc('"', a_fp);
+    for (; *a_str; a_str++) {
+	if (*a_str == '"' || *a_str == '\\')
+	    fputc('\\', a_fp);
+	fputc(*a_str, a_fp);
+    }
+    fputc('"', a_fp);
+}
+
+/******************************************************************************/
+static int generate(FILE* a_fp, const char* a_prefix, int argc, char* argv[])
+{
+    char* upper = sd_strdup(a_prefix);
+    sd_hash_t* ids = sd_hash_new(256, NULL);
+    sd_hash_iter_t* id;
+    size_t i;
+
+    for (i = 0; upper[i]; i++)
+	upper[i] = toupper((unsigned char) upper[i]);
+
+    /* identifiers of different names can collide */
+    for (i = 0; i < ncategories; i++) {
+	if ((id = sd_hash_lookup(ids, categories[i].id)) != NULL) {
+	    fprintf(stderr, "log4c-genheader: categories '%s' and '%s' "
+		    "have the same identifier '%s'\n", 
+		    (const char*) id->data, categories[i].name, 
+		    categories[i].id);
+	    sd_hash_delete(ids);
+	    free(upper);
+	    return -1;
+	}
+	sd_hash_add(ids, categories[i].id, categories[i].name);
+    }
+    sd_hash_delete(ids);
+
+    fprintf(a_fp, "/*\n * Generated by log4c-genheader from");
+    for (i = 0; i < (size_t) argc; i++)
+	fprintf(a_fp, " %s", argv[i]);
+    fprintf(a_fp, ".\n * Do not edit.\n */\n\n");
+
+    fprintf(a_fp, "#ifndef __%s_h\n#define __%s_h\n\n", a_prefix, a_prefix);
+    fprintf(a_fp, "#include <log4c/category.h>\n\n");
+    fprintf(a_fp, "#ifndef __LOG4C_STATIC_UNUSED\n"
+	    "#if defined(__GNUC__)\n"
+	    "#define __LOG4C_STATIC_UNUSED __attribute__((unused))\n"
+	    "#else\n"
+	    "#define __LOG4C_STATIC_UNUSED\n"
+	    "#endif\n"
+	    "#endif\n\n");
+
+    for (i = 0; i < ncategories; i++) {
+	int priority = chained_priority(&categories[i]);
+
+	fprintf(a_fp, "#define %s_PRIORITY_%s %d /* %s */\n", upper, 
+		categories[i].id, priority, log4c_priority_to_string(priority));
+	fprintf(a_fp, "static const log4c_static_category_t %s_%s "
+		"__LOG4C_STATIC_UNUSED =\n    { ", a_prefix, categories[i].id);
+	print_string(a_fp, categories[i].name);
+	fprintf(a_fp, ", %s_PRIORITY_%s };\n\n", upper, categories[i].id);
+    }
+
+    fprintf(a_fp, "#endif\n");
+    free(upper);
+    return 0;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    const char* output = NULL;
+    const char* prefix = "log4c_static";
+    FILE* fp = stdout;
+    int ret = 0;
+    int first;
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "ho:p:")) != -1) {
+	switch(c) {
+	case 'o':
+	    output = optarg;
+	    break;
+	case 'p':
+	    prefix = optarg;
+	    break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    if (SD_OPTIND >= argc) {
+	fprintf(stderr, USAGE);
+	return 1;
+    }
+
+    names = sd_hash_new(256, NULL);
+    category_get("root");
+
+    for (first = SD_OPTIND; SD_OPTIND < argc; SD_OPTIND++)
+	if (load(argv[SD_OPTIND]) == -1)
+	    return 1;
+
+    if (output && (fp = fopen(output, "w")) == NULL) {
+	fprintf(stderr, "log4c-genheader: can not open %s\n", output);
+	return 1;
+    }
+
+    if (generate(fp, prefix, argc - first, argv + first) == -1)
+	ret = 1;
+
+    if (output && fclose(fp) != 0)
+	ret = 1;
+    if (output && ret)
+	remove(output);
+
+    return ret;
+}
@@ -0,0 +1,186 @@
+static const char version[] = "$Id$";
+
+/*
+ * log4c-seek.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "parse_time.h"
+#include <log4c/appender_type_rollingfile.h>
+#include <sd/malloc.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define USAGE "Usage: log4c-seek [-h] [-s <time>] [-e <time>] <logfile>...\n\n" \
+"Prints the part of the files of a rollingfile appender logged between\n" \
+"two times, using the indexes written next to them when the appender\n" \
+"has an indexsize or indexinterval. The files are ordered by the time of\n" \
+"their first event, so prefix*.txt can be given in any order. Files\n" \
+"without an index are skipped.\n\n" \
+"The output starts at the last index entry before the start time and\n" \
+"ends at the first index entry from the end time on, so it can hold a\n" \
+"few events around the range, depending on the density of the index.\n\n" \
+"Times are seconds since the epoch, possibly with a fraction, or local\n" \
+"times as YYYY-MM-DD HH:MM:SS.\n\n" \
+"-s  start time, the beginning of the files by default\n" \
+"-e  end time, the end of the files by default\n" \
+"-h  display this help message\n"
+
+typedef struct {
+    const char*			lf_name;
+    rollingfile_index_entry_t*	lf_entries;
+    size_t			lf_nentries;
+} logfile_t;
+
+#define ENTRY_TIME(e) ((e)->rie_sec * 1000000 + (e)->rie_usec)
+
+/******************************************************************************/
+static int logfile_compare(const void* a_a, const void* a_b)
+{
+    XP_INT64 a = ENTRY_TIME(((const logfile_t*) a_a)->lf_entries);
+    XP_INT64 b = ENTRY_TIME(((const logfile_t*) a_b)->lf_entries);
+
+    return (a > b) - (a < b);
+}
+
+/******************************************************************************/
+/* offset of the first entry at or after a_time, -1 if there is none */
+static XP_INT64 logfile_offset(const logfile_t* this, XP_INT64 a_time)
+{
+    size_t lo = 0, hi = this->lf_nentries;
+
+    while (lo < hi) {
+	size_t mid = lo + (hi - lo) / 2;
+
+	if (ENTRY_TIME(&this->lf_entries[mid]) < a_time)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo < this->lf_nentries ? this->lf_entries[lo].rie_offset : -1;
+}
+
+/******************************************************************************/
+/* copies the bytes of a file from a_from up to a_to, or the end if -1 */
+static int logfile_copy(const logfile_t* this, XP_INT64 a_from, XP_INT64 a_to)
+{
+    char buffer[65536];
+    FILE* fp;
+    size_t n;
+
+    if ((fp = fopen(this->lf_name, "rb")) == NULL ||
+	fseek(fp, (long) a_from, SEEK_SET) == -1) {
+	fprintf(stderr, "log4c-seek: can not read %s\n", this->lf_name);
+	if (fp)
+	    fclose(fp);
+	return -1;
+    }
+
+    while (a_to == -1 || a_from < a_to) {
+	size_t want = sizeof(buffer);
+
+	if (a_to != -1 && (XP_INT64) want > a_to - a_from)
+	    want = (size_t) (a_to - a_from);
+	if ((n = fread(buffer, 1, want, fp)) == 0)
+	    break;
+	fwrite(buffer, 1, n, stdout);
+	a_from += n;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    XP_INT64 start = -1;
+    XP_INT64 end = -1;
+    logfile_t* files;
+    size_t nfiles = 0;
+    size_t i;
+    int ret = 0;
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "hs:e:")) != -1) {
+	switch(c) {
+	case 's':
+	case 'e':
+	    if (parse_time(optarg) == -1) {
+		fprintf(stderr, "log4c-seek: bad time '%s'\n", optarg);
+		return 1;
+	    }
+	    *(c == 's' ? &start : &end) = parse_time(optarg);
+	    break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    if (SD_OPTIND >= argc) {
+	fprintf(stderr, USAGE);
+	return 1;
+    }
+
+    files = sd_calloc(argc - SD_OPTIND, sizeof(*files));
+    for (; SD_OPTIND < argc; SD_OPTIND++) {
+	logfile_t* lf = &files[nfiles];
+
+	lf->lf_name = argv[SD_OPTIND];
+	if (rollingfile_index_read(lf->lf_name, &lf->lf_entries,
+				   &lf->lf_nentries) == -1) {
+	    fprintf(stderr, "log4c-seek: %s has no index, skipped\n", lf->lf_name);
+	    ret = 1;
+	    continue;
+	}
+	if (!lf->lf_nentries) {
+	    free(lf->lf_entries);
+	    continue;
+	}
+	nfiles++;
+    }
+
+    qsort(files, nfiles, sizeof(*files), logfile_compare);
+
+    /* a file holds the events from its first entry to the next file's */
+    for (i = 0; i < nfiles; i++) {
+	XP_INT64 from = 0;
+	XP_INT64 to = -1;
+
+	if (end != -1 && ENTRY_TIME(files[i].lf_entries) >= end)
+	    break;
+	if (start != -1 && i + 1 < nfiles &&
+	    ENTRY_TIME(files[i + 1].lf_entries) <= start)
+	    continue;
+
+	if (start != -1) {
+	    struct timeval tv;
+
+	    tv.tv_sec  = (time_t) (start / 1000000);
+	    tv.tv_usec = (long) (start % 1000000);
+	    if ((from = rollingfile_index_find(files[i].lf_name, &tv)) == -1)
+		from = 0;
+	}
+	if (end != -1)
+	    to = logfile_offset(&files[i], end);
+
+	if (logfile_copy(&files[i], from, to) == -1)
+	    ret = 1;
+    }
+
+    for (i = 0; i < nfiles; i++)
+	free(files[i].lf_entries);
+    free(files);
+    fflush(stdout);
+    return ret;
+}
@@ -0,0 +1,40 @@
+static const char version[] = "$Id$";
+
+/*
+ * parse_time.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "parse_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************/
+extern XP_INT64 parse_time(const char* a_arg)
+{
+    struct tm tm;
+    char* end;
+    double seconds;
+
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(a_arg, "%d-%d-%d%*c%d:%d:%d", &tm.tm_year, &tm.tm_mon,
+	       &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 6) {
+	tm.tm_year -= 1900;
+	tm.tm_mon  -= 1;
+	tm.tm_isdst = -1;
+	return (XP_INT64) mktime(&tm) * 1000000;
+    }
+
+    seconds = strtod(a_arg, &end);
+    if (end == a_arg || *end || seconds < 0)
+	return -1;
+
+    return (XP_INT64) (seconds * 1e6 + 0.5);
+}
@@ -0,0 +1,23 @@
+/* $Id$
+ *
+ * parse_time.h
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#ifndef log4c_tools_parse_time_h
+#define log4c_tools_parse_time_h
+
+#include <sd/sd_xplatform.h>
+
+/**
+ * Parses a time given to the -s and -e options of the tools.
+ *
+ * @param a_arg seconds since the epoch, possibly with a fraction, or a
+ * local time as YYYY-MM-DD HH:MM:SS
+ * @returns the time in microseconds since the epoch, or -1 if @a a_arg
+ * is not a time
+ **/
+extern XP_INT64 parse_time(const char* a_arg);
+
+#endif
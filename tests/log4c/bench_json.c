@@ -0,0 +1,158 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/init.h>
+#include <log4c/layout.h>
+#include <log4c/priority.h>
+#include <sd/json.h>
+#include <sd/malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include <sd/sd_xplatform.h>
+
+#define USAGE "Usage: bench_json [-h] [<megabytes>]\n\n" \
+"This program measures the throughput of sd_json_escape(), which the\n" \
+"json layout uses, with each of its implementations, on strings of\n" \
+"several lengths with no character to escape and with one in 100 and\n" \
+"one in 10. It then times the json layout against basic_r on a\n" \
+"message of 100 bytes and one of 4KB.\n\n" \
+"Each case escapes 256MB by default.\n\n" \
+"-h  display this help message\n"
+
+/******************************************************************************/
+static XP_UINT64 my_utime(void)
+{
+    struct timeval tv;
+
+    SD_GETTIMEOFDAY(&tv, NULL);
+    return (XP_UINT64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/******************************************************************************/
+static void make_string(char* a_string, size_t a_len, int a_every)
+{
+    size_t i;
+
+    for (i = 0; i < a_len; i++)
+	a_string[i] = 'a' + i % 26;
+    if (a_every)
+	for (i = a_every / 2; i < a_len; i += a_every)
+	    a_string[i] = (i / a_every) % 2 ? '"' : '\n';
+    a_string[a_len] = '\0';
+}
+
+/******************************************************************************/
+static void bench_escape(size_t a_total)
+{
+    static const char* names[] = { "scalar", "sse2", "avx2" };
+    static const size_t lengths[] = { 64, 1024, 65536 };
+    static const int everys[] = { 0, 100, 10 };
+    char* in = sd_malloc(65536 + 1);
+    char* out = sd_malloc(6 * 65536);
+    size_t l;
+    int e, impl;
+
+    printf("%-8s %-8s", "length", "escapes");
+    for (impl = SD_JSON_SCALAR; impl <= SD_JSON_AVX2; impl++)
+	printf(" %10s", names[impl]);
+    printf("\n");
+
+    for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+	for (e = 0; e < (int) (sizeof(everys) / sizeof(everys[0])); e++) {
+	    size_t ncalls = a_total / lengths[l];
+
+	    make_string(in, lengths[l], everys[e]);
+	    printf("%-8lu 1/%-6d", (unsigned long) lengths[l], everys[e]);
+
+	    for (impl = SD_JSON_SCALAR; impl <= SD_JSON_AVX2; impl++) {
+		XP_UINT64 start, elapsed;
+		size_t i;
+
+		if (sd_json_escape_use(impl) == -1) {
+		    printf(" %10s", "-");
+		    continue;
+		}
+
+		start = my_utime();
+		for (i = 0; i < ncalls; i++) {
+		    size_t len = lengths[l];
+
+		    sd_json_escape(out, 6 * 65536, in, &len);
+		}
+		elapsed = my_utime() - start;
+		printf(" %6.2f GB/s", elapsed ?
+		       (double) ncalls * lengths[l] / elapsed / 1000.0 : 0.0);
+	    }
+	    printf("\n");
+	}
+    }
+
+    if (sd_json_escape_use(SD_JSON_AVX2) == -1)
+	sd_json_escape_use(SD_JSON_SSE2);
+    free(in);
+    free(out);
+}
+
+/******************************************************************************/
+static void bench_layout(const char* a_layout, size_t a_len, long a_ncalls)
+{
+    log4c_layout_t* layout = log4c_layout_get(a_layout);
+    log4c_logging_event_t evt;
+    char* msg = sd_malloc(a_len + 1);
+    XP_UINT64 start;
+    long i;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get(a_layout));
+    make_string(msg, a_len, 100);
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_category = "bench.json";
+    evt.evt_priority = LOG4C_PRIORITY_INFO;
+    evt.evt_msg = msg;
+    evt.evt_buffer.buf_size = 2 * a_len + 512;
+    evt.evt_buffer.buf_maxsize = evt.evt_buffer.buf_size;
+    evt.evt_buffer.buf_data = sd_malloc(evt.evt_buffer.buf_size);
+    SD_GETTIMEOFDAY(&evt.evt_timestamp, NULL);
+
+    start = my_utime();
+    for (i = 0; i < a_ncalls; i++)
+	log4c_layout_format(layout, &evt);
+    printf("%-8s %5lu bytes %8.1f ns\n", a_layout, (unsigned long) a_len,
+	   (my_utime() - start) * 1000.0 / a_ncalls);
+
+    free(evt.evt_buffer.buf_data);
+    free(msg);
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    size_t total = 256;
+
+    if (argc > 1) {
+	if (!strcmp(argv[1], "-h") || atol(argv[1]) <= 0) {
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+	total = atol(argv[1]);
+    }
+
+    log4c_init();
+
+    bench_escape(total * 1024 * 1024);
+    printf("\n");
+    bench_layout("basic_r", 100, 1000000);
+    bench_layout("json", 100, 1000000);
+    bench_layout("basic_r", 4096, 100000);
+    bench_layout("json", 4096, 100000);
+
+    log4c_fini();
+    return 0;
+}
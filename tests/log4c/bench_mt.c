@@ -0,0 +1,538 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/defs.h>
+#include <log4c/category.h>
+#include <log4c/init.h>
+#include <log4c/rc.h>
+#include <log4c/stats.h>
+#include <log4c/binlog.h>
+#include <sd/sd_xplatform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+/******************************************************************************/
+#define NUM_THREADS	4
+#define NUM_MSGS	10000
+#define MSG_SIZE	128
+#define WORK_DIR	"bench_mt.d"
+#define MMAP_SIZE	(1024 * 1024)
+
+#define USAGE "Usage: bench_mt [-h] [-j] [-L] [-B] [-t <threads>] [-n <msgs>] [-s <size>]\n" \
+"                [-a <appender,...>] [-l <layout,...>] [-d <dir>]\n\n" \
+"This program runs threads logging concurrently through every pair of\n" \
+"appender and layout, timing each logging call. For each pair it\n" \
+"reports the throughput and the 50th, 99th and 99.9th percentiles and\n" \
+"the maximum of the call latency, in nanoseconds.\n\n" \
+"The results are written to stdout as CSV, or JSON with -j, so that they\n" \
+"can be compared between releases. With -L the internal locks of the\n" \
+"appenders are profiled, and the lock columns give the number of\n" \
+"contended acquisitions and the wait and hold times, in nanoseconds.\n" \
+"With -B the threads log with LOG4C_BINLOG(): the latency is the cost\n" \
+"of queuing the message, which a background thread formats and appends.\n\n" \
+"Appenders: stream stream2 file rollingfile mmap socket, and syslog and\n" \
+"ansicolor when asked for with -a. The mmap appender is not thread safe\n" \
+"and always runs with a single thread. The socket appender sends to a\n" \
+"local receiver.\n" \
+"Layouts: basic dated basic_r dated_r null ISO8601 json pattern.\n\n" \
+"-t  number of threads, 4 by default\n" \
+"-n  number of messages per thread, 10000 by default\n" \
+"-s  message size, 128 by default\n" \
+"-a  comma separated list of appenders\n" \
+"-l  comma separated list of layouts\n" \
+"-d  directory of the log files, "WORK_DIR" by default\n" \
+"-j  JSON output\n" \
+"-L  profile the internal locks of the appenders\n" \
+"-B  defer the formatting of the messages\n" \
+"-h  display this help message\n"
+
+static const char* all_appenders[] = {
+    "stream", "stream2", "file",
+#ifdef WITH_ROLLINGFILE
+    "rollingfile",
+#endif
+    "mmap", "socket", "syslog", "ansicolor"
+};
+static const int nall_appenders = sizeof(all_appenders) / sizeof(all_appenders[0]);
+
+static const char* all_layouts[] = {
+    "basic", "dated", "basic_r", "dated_r", "null", "ISO8601", "json", "pattern"
+};
+static const int nall_layouts = sizeof(all_layouts) / sizeof(all_layouts[0]);
+
+static int		g_num_threads = NUM_THREADS;
+static long		g_num_msgs = NUM_MSGS;
+static long		g_msgsize = MSG_SIZE;
+static const char*	g_dir = WORK_DIR;
+static int		g_json = 0;
+static int		g_locks = 0;
+static int		g_binlog = 0;
+static const char*	g_appenders = "stream,stream2,file,rollingfile,mmap,socket";
+static const char*	g_layouts = "basic,dated,basic_r,dated_r,null,ISO8601,json,pattern";
+static char*		g_buffer = NULL;
+
+/******************************************************************************/
+/*
+ * HDR style histogram: values below HIST_SUB have their own bucket, larger
+ * values share buckets of HIST_SUB / 2 per power of two, which keeps the
+ * relative error under 2 / HIST_SUB.
+ */
+#define HIST_SUB_BITS	7
+#define HIST_SUB	(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS	((64 - HIST_SUB_BITS + 2) * (HIST_SUB / 2))
+
+typedef XP_UINT64 nsec_t;
+
+typedef struct {
+    XP_UINT64	counts[HIST_BUCKETS];
+    XP_UINT64	total;
+    nsec_t	max;
+} histogram_t;
+
+/******************************************************************************/
+static int hist_shift(nsec_t a_value)
+{
+    int shift = 0;
+
+    while ((a_value >> shift) >= HIST_SUB)
+	shift++;
+    return shift;
+}
+
+/******************************************************************************/
+static void hist_record(histogram_t* this, nsec_t a_value)
+{
+    int shift = hist_shift(a_value);
+
+    this->counts[shift * (HIST_SUB / 2) + (a_value >> shift)]++;
+    this->total++;
+    if (a_value > this->max)
+	this->max = a_value;
+}
+
+/******************************************************************************/
+static void hist_merge(histogram_t* this, const histogram_t* a_other)
+{
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+	this->counts[i] += a_other->counts[i];
+    this->total += a_other->total;
+    if (a_other->max > this->max)
+	this->max = a_other->max;
+}
+
+/******************************************************************************/
+/* highest value equivalent to the bucket holding the given percentile */
+static nsec_t hist_percentile(const histogram_t* this, double a_percentile)
+{
+    XP_UINT64 rank = (XP_UINT64) (a_percentile / 100.0 * this->total + 0.5);
+    XP_UINT64 seen = 0;
+    int i;
+
+    if (rank < 1)
+	rank = 1;
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+	if ((seen += this->counts[i]) >= rank) {
+	    int shift = i < HIST_SUB ? 0 : (i - HIST_SUB / 2) / (HIST_SUB / 2);
+	    nsec_t low = (nsec_t) (i - shift * (HIST_SUB / 2)) << shift;
+	    nsec_t high = low + ((nsec_t) 1 << shift) - 1;
+
+	    return high < this->max ? high : this->max;
+	}
+    }
+    return this->max;
+}
+
+/******************************************************************************/
+static nsec_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (nsec_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/******************************************************************************/
+/* local receiver for the socket appender */
+static int		g_udp_fd = -1;
+static int		g_udp_port = 0;
+static volatile int	g_udp_stop = 0;
+static pthread_t	g_udp_thread;
+
+static void* udp_drain(void* arg)
+{
+    char buf[65536];
+
+    while (!g_udp_stop)
+	recv(g_udp_fd, buf, sizeof(buf), 0);
+    return NULL;
+}
+
+static int udp_start(void)
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { 0, 100000 };
+    socklen_t len = sizeof(addr);
+
+    if ((g_udp_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1)
+	return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family	 = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (bind(g_udp_fd, (struct sockaddr*) &addr, sizeof(addr)) == -1 ||
+	getsockname(g_udp_fd, (struct sockaddr*) &addr, &len) == -1)
+	return -1;
+
+    setsockopt(g_udp_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    g_udp_port = ntohs(addr.sin_port);
+    return pthread_create(&g_udp_thread, NULL, udp_drain, NULL);
+}
+
+static void udp_stop(void)
+{
+    if (g_udp_fd == -1)
+	return;
+    g_udp_stop = 1;
+    pthread_join(g_udp_thread, NULL);
+    close(g_udp_fd);
+}
+
+/******************************************************************************/
+static int in_list(const char* a_list, const char* a_name)
+{
+    size_t len = strlen(a_name);
+    const char* p = a_list;
+
+    while ((p = strstr(p, a_name)) != NULL) {
+	if ((p == a_list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+	    return 1;
+	p += len;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/*
+ * Writes a log4crc with an appender and a category per pair of appender
+ * and layout: category bench.<appender>.<layout>.
+ */
+static int generate_rc(const char* a_filename)
+{
+    FILE* fp;
+    int a, l;
+
+    if ((fp = fopen(a_filename, "w")) == NULL)
+	return -1;
+
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+	    "<!DOCTYPE log4c SYSTEM \"\">\n\n<log4c>\n\n"
+	    "\t<config>\n\t\t<bufsize>0</bufsize>\n"
+	    "\t\t<nocleanup>0</nocleanup>\n\t\t<reread>0</reread>\n"
+	    "\t</config>\n\n");
+
+    for (l = 0; l < nall_layouts; l++)
+	fprintf(fp, "\t<layout name=\"%s\" type=\"%s\"/>\n",
+		all_layouts[l], all_layouts[l]);
+
+    for (a = 0; a < nall_appenders; a++) {
+	const char* app = all_appenders[a];
+
+	if (!in_list(g_appenders, app))
+	    continue;
+
+	for (l = 0; l < nall_layouts; l++) {
+	    const char* lay = all_layouts[l];
+
+	    if (!in_list(g_layouts, lay))
+		continue;
+
+	    fprintf(fp, "\t<category name=\"bench.%s.%s\" priority=\"debug\" "
+		    "additivity=\"false\" appender=\"", app, lay);
+
+	    /* these appenders are named after the file they write to */
+	    if (!strcmp(app, "stream") || !strcmp(app, "stream2") ||
+		!strcmp(app, "mmap"))
+		fprintf(fp, "%s/%s.%s.log", g_dir, app, lay);
+	    else
+		fprintf(fp, "%s.%s", app, lay);
+	    fprintf(fp, "\"/>\n");
+
+	    if (!strcmp(app, "stream") || !strcmp(app, "stream2"))
+		fprintf(fp, "\t<appender name=\"%s/%s.%s.log\" type=\"%s\" "
+			"layout=\"%s\"/>\n", g_dir, app, lay, app, lay);
+	    else if (!strcmp(app, "mmap")) {
+		char path[1024];
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/%s.%s.log", g_dir, app, lay);
+		if ((fd = open(path, O_RDWR | O_CREAT, 0644)) == -1 ||
+		    ftruncate(fd, MMAP_SIZE) == -1)
+		    fprintf(stderr, "can not create %s: %s\n", path,
+			    strerror(errno));
+		if (fd != -1)
+		    close(fd);
+		fprintf(fp, "\t<appender name=\"%s\" type=\"mmap\" "
+			"layout=\"%s\"/>\n", path, lay);
+	    }
+	    else if (!strcmp(app, "file"))
+		fprintf(fp, "\t<appender name=\"file.%s\" type=\"file\" "
+			"layout=\"%s\" path=\"%s/file.%s.log\"/>\n",
+			lay, lay, g_dir, lay);
+	    else if (!strcmp(app, "rollingfile"))
+		fprintf(fp, "\t<rollingpolicy name=\"sizewin.%s\" "
+			"type=\"sizewin\" maxsize=\"10MB\" maxnum=\"3\"/>\n"
+			"\t<appender name=\"rollingfile.%s\" "
+			"type=\"rollingfile\" layout=\"%s\" logdir=\"%s\" "
+			"prefix=\"rollingfile.%s\" "
+			"rollingpolicy=\"sizewin.%s\"/>\n",
+			lay, lay, lay, g_dir, lay, lay);
+	    else if (!strcmp(app, "socket"))
+		fprintf(fp, "\t<appender name=\"socket.%s\" type=\"socket\" "
+			"layout=\"%s\" dest=\"127.0.0.1\" destport=\"%d\"/>\n",
+			lay, lay, g_udp_port);
+	    else if (!strcmp(app, "ansicolor"))
+		fprintf(fp, "\t<appender name=\"ansicolor.%s\" "
+			"type=\"ansicolor\" layout=\"%s\" stream=\"stderr\"/>\n",
+			lay, lay);
+	    else
+		fprintf(fp, "\t<appender name=\"%s.%s\" type=\"%s\" "
+			"layout=\"%s\"/>\n", app, lay, app, lay);
+	}
+    }
+
+    fprintf(fp, "\n</log4c>\n");
+    return fclose(fp);
+}
+
+/******************************************************************************/
+typedef struct {
+    log4c_category_t*	cat;
+    pthread_barrier_t*	barrier;
+    histogram_t		hist;
+} producer_t;
+
+static void* producer(void* arg)
+{
+    producer_t* this = arg;
+    nsec_t start;
+    long i;
+
+    pthread_barrier_wait(this->barrier);
+
+    for (i = 0; i < g_num_msgs; i++) {
+	start = now_ns();
+	if (g_binlog)
+	    LOG4C_BINLOG(this->cat, LOG4C_PRIORITY_ERROR, "%s", g_buffer);
+	else
+	    log4c_category_log(this->cat, LOG4C_PRIORITY_ERROR, "%s", g_buffer);
+	hist_record(&this->hist, now_ns() - start);
+    }
+    return NULL;
+}
+
+/******************************************************************************/
+/* the pairs run one at a time, so all sites can be added up */
+static void lock_totals(log4c_lock_stats_t* a_total)
+{
+    static const char* sites[] = { "rollingfile", "file", "ansicolor" };
+    log4c_lock_stats_t lock;
+    size_t i;
+
+    memset(a_total, 0, sizeof(*a_total));
+    for (i = 0; i < sizeof(sites) / sizeof(sites[0]); i++) {
+	if (log4c_stats_get_lock(sites[i], &lock) == -1)
+	    continue;
+	a_total->ls_contended += lock.ls_contended;
+	a_total->ls_wait_ns   += lock.ls_wait_ns;
+	a_total->ls_hold_ns   += lock.ls_hold_ns;
+	if (lock.ls_max_wait_ns > a_total->ls_max_wait_ns)
+	    a_total->ls_max_wait_ns = lock.ls_max_wait_ns;
+    }
+}
+
+/******************************************************************************/
+static void run(const char* a_appender, const char* a_layout, int* a_first)
+{
+    char name[128];
+    int nthreads = strcmp(a_appender, "mmap") ? g_num_threads : 1;
+    producer_t* producers = calloc(nthreads, sizeof(*producers));
+    histogram_t* hist = calloc(1, sizeof(*hist));
+    pthread_t* threads = calloc(nthreads, sizeof(*threads));
+    pthread_barrier_t barrier;
+    log4c_lock_stats_t locks;
+    nsec_t start, stop;
+    double seconds;
+    int i;
+
+    snprintf(name, sizeof(name), "bench.%s.%s", a_appender, a_layout);
+    pthread_barrier_init(&barrier, NULL, nthreads + 1);
+    log4c_stats_reset();
+
+    for (i = 0; i < nthreads; i++) {
+	producers[i].cat     = log4c_category_get(name);
+	producers[i].barrier = &barrier;
+	pthread_create(&threads[i], NULL, producer, &producers[i]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    start = now_ns();
+    for (i = 0; i < nthreads; i++) {
+	pthread_join(threads[i], NULL);
+	hist_merge(hist, &producers[i].hist);
+    }
+    stop = now_ns();
+    seconds = (stop - start) / 1e9;
+    if (g_binlog)
+	log4c_binlog_flush();
+    lock_totals(&locks);
+
+    if (g_json)
+	printf("%s\n  { \"appender\": \"%s\", \"layout\": \"%s\", "
+	       "\"threads\": %d, \"events\": %llu, \"seconds\": %.6f, "
+	       "\"events_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+	       "\"p999_ns\": %llu, \"max_ns\": %llu, \"lock_contended\": %llu, "
+	       "\"lock_wait_ns\": %llu, \"lock_max_wait_ns\": %llu, "
+	       "\"lock_hold_ns\": %llu }",
+	       *a_first ? "" : ",", a_appender, a_layout, nthreads,
+	       (unsigned long long) hist->total, seconds, hist->total / seconds,
+	       (unsigned long long) hist_percentile(hist, 50),
+	       (unsigned long long) hist_percentile(hist, 99),
+	       (unsigned long long) hist_percentile(hist, 99.9),
+	       (unsigned long long) hist->max, locks.ls_contended,
+	       locks.ls_wait_ns, locks.ls_max_wait_ns, locks.ls_hold_ns);
+    else
+	printf("%s,%s,%d,%llu,%.6f,%.0f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+	       a_appender, a_layout, nthreads,
+	       (unsigned long long) hist->total, seconds, hist->total / seconds,
+	       (unsigned long long) hist_percentile(hist, 50),
+	       (unsigned long long) hist_percentile(hist, 99),
+	       (unsigned long long) hist_percentile(hist, 99.9),
+	       (unsigned long long) hist->max, locks.ls_contended,
+	       locks.ls_wait_ns, locks.ls_max_wait_ns, locks.ls_hold_ns);
+    fflush(stdout);
+    *a_first = 0;
+
+    pthread_barrier_destroy(&barrier);
+    free(threads);
+    free(hist);
+    free(producers);
+}
+
+/******************************************************************************/
+static void getopts(int argc, char **argv)
+{
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "hjLBt:n:s:a:l:d:")) != -1) {
+	switch(c) {
+	case 'j': g_json = 1; break;
+	case 'L': g_locks = 1; break;
+	case 'B': g_binlog = 1; break;
+	case 't': g_num_threads = atoi(optarg); break;
+	case 'n': g_num_msgs = atol(optarg); break;
+	case 's': g_msgsize = atol(optarg); break;
+	case 'a': g_appenders = optarg; break;
+	case 'l': g_layouts = optarg; break;
+	case 'd': g_dir = optarg; break;
+	case 'h':
+	default:
+	    fprintf(stderr, USAGE);
+	    exit(1);
+	}
+    }
+
+    if (g_num_threads < 1)
+	g_num_threads = 1;
+    if (g_msgsize < 1)
+	g_msgsize = 1;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    char rcfile[1024];
+    int first = 1;
+    int a, l;
+
+    getopts(argc, argv);
+
+    g_buffer = malloc(g_msgsize);
+    memset(g_buffer, 'X', g_msgsize);
+    g_buffer[g_msgsize - 1] = '\0';
+
+    if (mkdir(g_dir, 0755) == -1 && errno != EEXIST) {
+	fprintf(stderr, "can not create %s: %s\n", g_dir, strerror(errno));
+	return 1;
+    }
+
+    if (in_list(g_appenders, "socket") && udp_start() == -1) {
+	fprintf(stderr, "can not start the socket receiver: %s\n",
+		strerror(errno));
+	return 1;
+    }
+
+    snprintf(rcfile, sizeof(rcfile), "%s/log4crc", g_dir);
+    if (generate_rc(rcfile) == -1) {
+	fprintf(stderr, "can not write %s\n", rcfile);
+	return 1;
+    }
+
+    log4c_init();
+    log4c_stats_set_lock_profiling(g_locks);
+    if (log4c_load(rcfile) == -1) {
+	fprintf(stderr, "can not load %s\n", rcfile);
+	return 1;
+    }
+
+    if (g_binlog && log4c_binlog_start(NULL, 0, 0) == -1) {
+	fprintf(stderr, "can not start the binlog thread\n");
+	return 1;
+    }
+
+    fprintf(stderr, "  %d thread(s) writing %ld message(s) of length %ld\n",
+	    g_num_threads, g_num_msgs, g_msgsize);
+
+    if (g_json)
+	printf("[");
+    else
+	printf("appender,layout,threads,events,seconds,events_per_sec,"
+	       "p50_ns,p99_ns,p999_ns,max_ns,lock_contended,lock_wait_ns,"
+	       "lock_max_wait_ns,lock_hold_ns\n");
+
+    for (a = 0; a < nall_appenders; a++)
+	for (l = 0; l < nall_layouts; l++)
+	    if (in_list(g_appenders, all_appenders[a]) &&
+		in_list(g_layouts, all_layouts[l]))
+		run(all_appenders[a], all_layouts[l], &first);
+
+    if (g_json)
+	printf("\n]\n");
+
+    if (g_binlog) {
+	log4c_binlog_stop();
+	fprintf(stderr, "  %llu message(s) dropped by the binlog buffers\n",
+		log4c_binlog_get_drops());
+    }
+
+    udp_stop();
+    free(g_buffer);
+    return log4c_fini();
+}
@@ -0,0 +1,199 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <log4c/defs.h>
+#include <log4c/category.h>
+#include <log4c/init.h>
+#include <log4c/rc.h>
+#include <log4c/version.h>
+#include <sd/domnode.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <sd/sd_xplatform.h>
+
+/******************************************************************************/
+
+typedef XP_UINT64 usec_t;
+static usec_t my_utime(void)
+{
+#ifdef _WIN32
+ FILETIME tv;
+ ULARGE_INTEGER   li;
+#else
+    struct timeval tv;
+#endif
+
+    SD_GETTIMEOFDAY(&tv, NULL);
+
+#ifdef _WIN32
+	memcpy(&li, &tv, sizeof(FILETIME));
+	li.QuadPart /= 10;                /* In microseconds */
+	return li.QuadPart;
+#else
+    return (usec_t) (tv.tv_sec * 1000000 + tv.tv_usec);
+#endif
+}
+
+/******************************************************************************/
+#define NUM_CATEGORIES	20000
+#define NUM_LOADS	5
+#define RC_FILE		"bench_rc.log4crc"
+
+#ifdef _WIN32
+#define display_time(name,start,stop,elapsed, avg) \
+fprintf(stderr,"%s: (start %I64u stop %I64u) elapsed %I64u us - average %I64u us\n\n", \
+	name, start, stop, elapsed, avg)
+#else
+#define display_time(name,start,stop,elapsed, avg) \
+fprintf(stderr,"%s: (start %llu stop %llu) elapsed %llu us - average %llu us\n\n", \
+	name,start, stop, elapsed, avg)
+#endif
+
+#define USAGE  "Usage: bench_rc [-h] [-k] [<num categories> [<num loads>]]\n\n" \
+"This program generates a log4crc file with the given number of\n" \
+"categories, spread over a few appenders and layouts, and times loading\n" \
+"it. The first load creates the categories, the following ones behave\n" \
+"like a reread of the file.\n\n" \
+"The time taken to only parse the file into a DOM tree is given for\n" \
+"comparison.\n\n" \
+"The defaults are 20000 categories and 5 loads.\n\n" \
+"-k  keep the generated file ("RC_FILE")\n" \
+"-h  display this help message\n"
+
+/******************************************************************************/
+static long g_num_categories = NUM_CATEGORIES;
+static long g_num_loads = NUM_LOADS;
+static int g_keep = 0;
+
+/******************************************************************************/
+static void getopts(int argc, char **argv)
+{
+    int c;
+
+    while ((c = SD_GETOPT(argc, argv, "hk")) != -1) {
+	switch(c) {
+	case 'k':
+	    g_keep = 1;
+	    break;
+	case 'h':
+	    fprintf(stderr, USAGE);
+	    exit(1);
+	    break;
+	}
+    }
+
+    if ( SD_OPTIND < argc ){
+	g_num_categories = atol(argv[SD_OPTIND]);
+	if ( SD_OPTIND+1 < argc ){
+	    g_num_loads =  atol(argv[SD_OPTIND+1]);
+	}
+    }
+    if (g_num_loads < 1)
+	g_num_loads = 1;
+
+    fprintf(stderr, "  Loading %ld time(s) a file of %ld categories\n\n",
+	    g_num_loads, g_num_categories);
+}
+
+/******************************************************************************/
+static int generate(const char* a_filename, long a_ncats)
+{
+    static const char* priorities[] = { "error", "warn", "notice", "info",
+					"debug" };
+    FILE* fp;
+    long i;
+
+    if ((fp = fopen(a_filename, "w")) == NULL)
+	return -1;
+
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+	    "<!DOCTYPE log4c SYSTEM \"\">\n\n"
+	    "<log4c version=\"%s\">\n\n"
+	    "\t<config>\n"
+	    "\t\t<bufsize>0</bufsize>\n"
+	    "\t\t<debug level=\"0\"/>\n"
+	    "\t\t<nocleanup>0</nocleanup>\n"
+	    "\t\t<reread>0</reread>\n"
+	    "\t</config>\n\n", log4c_version());
+
+    for (i = 0; i < 8; i++)
+	fprintf(fp, "\t<appender name=\"bench.app%ld\" type=\"stream\" "
+		"layout=\"%s\"/>\n", i, i % 2 ? "basic" : "dated");
+
+    fprintf(fp, "\t<layout name=\"basic\" type=\"basic\"/>\n"
+	    "\t<layout name=\"dated\" type=\"dated\"/>\n\n"
+	    "\t<category name=\"root\" priority=\"notice\"/>\n");
+
+    /* a few levels of hierarchy, like service.module.component */
+    for (i = 0; i < a_ncats; i++) {
+	fprintf(fp, "\t<category name=\"svc%ld.mod%ld.comp%ld\" "
+		"priority=\"%s\"", i / 1000, (i / 50) % 20, i % 50,
+		priorities[i % 5]);
+	if (i % 7 == 0)
+	    fprintf(fp, " appender=\"bench.app%ld\"", i % 8);
+	if (i % 13 == 0)
+	    fprintf(fp, " additivity=\"false\"");
+	fprintf(fp, "/>\n");
+    }
+
+    fprintf(fp, "\n</log4c>\n");
+    return fclose(fp);
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    sd_domnode_t* node;
+    usec_t start;
+    usec_t stop;
+    long i;
+
+    getopts(argc, argv);
+
+    log4c_init();
+
+    if (generate(RC_FILE, g_num_categories) == -1) {
+	fprintf(stderr, "failed to generate %s\n", RC_FILE);
+	return 1;
+    }
+
+    start = my_utime();
+    node = sd_domnode_new(NULL, NULL);
+    sd_domnode_load(node, RC_FILE);
+    sd_domnode_delete(node);
+    stop = my_utime();
+    display_time("DOM tree parse only", start, stop, (stop-start), (stop-start));
+
+    start = my_utime();
+    if (log4c_load(RC_FILE) == -1)
+	fprintf(stderr, "failed to load %s\n", RC_FILE);
+    stop = my_utime();
+    display_time("first load", start, stop, (stop-start), (stop-start));
+
+    if (g_num_loads > 1) {
+	start = my_utime();
+	for (i = 1; i < g_num_loads; i++)
+	    log4c_load(RC_FILE);
+	stop = my_utime();
+	display_time("reload", start, stop, (stop-start),
+		     (stop-start)/(g_num_loads - 1));
+    }
+
+    fprintf(stderr, "  %d categories\n", log4c_category_get_count());
+
+    if (!g_keep)
+	unlink(RC_FILE);
+
+    return log4c_fini();
+}
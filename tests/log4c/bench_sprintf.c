@@ -0,0 +1,104 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sd/sprintf.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include <sd/sd_xplatform.h>
+
+#define USAGE "Usage: bench_sprintf [-h] [<num calls>]\n\n" \
+"This program times snprintf(), sd_snprintf(), which formats the log4c\n" \
+"messages, and sd_format_vsnprintf(), which formats those of the\n" \
+"LOG4C_LOG() call sites, on a few formats typical of log messages.\n\n" \
+"The default number of calls is 1000000.\n\n" \
+"-h  display this help message\n"
+
+/******************************************************************************/
+static XP_UINT64 my_utime(void)
+{
+    struct timeval tv;
+
+    SD_GETTIMEOFDAY(&tv, NULL);
+    return (XP_UINT64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/******************************************************************************/
+/* keeps the compiler from turning the calls into something else */
+static int (*volatile libc_snprintf)(char*, size_t, const char*, ...) = snprintf;
+
+/******************************************************************************/
+#define TIME_IT(name, ncalls, call) \
+    do { \
+	XP_UINT64 start = my_utime(); \
+	long i; \
+	for (i = 0; i < ncalls; i++) \
+	    call; \
+	elapsed[name] = my_utime() - start; \
+    } while (0)
+
+#define BENCH(label, ncalls, fmt, ...) \
+    do { \
+	XP_UINT64 elapsed[3]; \
+	sd_format_t* parsed = sd_format_new(fmt); \
+	TIME_IT(0, ncalls, libc_snprintf(buffer, sizeof(buffer), fmt, __VA_ARGS__)); \
+	TIME_IT(1, ncalls, sd_snprintf(buffer, sizeof(buffer), fmt, __VA_ARGS__)); \
+	TIME_IT(2, ncalls, parsed_snprintf(parsed, buffer, sizeof(buffer), __VA_ARGS__)); \
+	printf("%-8s snprintf %6.1f ns  sd_snprintf %6.1f ns (%.2fx)  parsed %6.1f ns (%.2fx)\n", \
+	       label, elapsed[0] * 1000.0 / ncalls, \
+	       elapsed[1] * 1000.0 / ncalls, SPEEDUP(elapsed[0], elapsed[1]), \
+	       elapsed[2] * 1000.0 / ncalls, SPEEDUP(elapsed[0], elapsed[2])); \
+	sd_format_delete(parsed); \
+    } while (0)
+
+#define SPEEDUP(a, b) ((b) ? (double) (a) / (b) : 0.0)
+
+/******************************************************************************/
+/* the arguments follow the format, as in the log4c call sites */
+static int parsed_snprintf(const sd_format_t* a_parsed, char* a_buf,
+			   size_t a_size, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, a_size);
+    n = sd_format_vsnprintf(a_parsed, a_buf, a_size, args);
+    va_end(args);
+
+    return n;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    static volatile int vi = 123456;
+    static volatile long long vll = -9876543210LL;
+    static volatile double vd = 3.14159;
+    char buffer[256];
+    long ncalls = 1000000;
+
+    if (argc > 1) {
+	if (!strcmp(argv[1], "-h") || (ncalls = atol(argv[1])) <= 0) {
+	    fprintf(stderr, USAGE);
+	    return 1;
+	}
+    }
+
+    BENCH("text", ncalls, "connection accepted from the client", 0);
+    BENCH("int", ncalls, "request %d took %d us, status %d", vi, vi / 7, 200);
+    BENCH("int64", ncalls, "offset %lld size %llu", vll, (unsigned long long) vll);
+    BENCH("hex", ncalls, "handle 0x%08x flags %#x", vi, vi >> 4);
+    BENCH("string", ncalls, "user %s from %-16s:%5d", "alice", "192.168.0.1", vi);
+    BENCH("dated", ncalls, "%04d%02d%02d %02d:%02d:%02d.%03ld %-8s %s- %s\n",
+	  2024, 1, 2, 3, 4, 5, 678L, "INFO", "app.db", "message");
+    BENCH("float", ncalls, "load %.2f ratio %g", vd, vd / 3);
+
+    return 0;
+}
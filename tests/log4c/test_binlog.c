@@ -0,0 +1,463 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_binlog.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/appender.h>
+#include <log4c/category.h>
+#include <log4c/init.h>
+#include <log4c/layout.h>
+#include <log4c/layout_type_pattern.h>
+#include <log4c/binlog.h>
+#include <log4c/context.h>
+#include <sd/test.h>
+#include <sd/sd_xplatform.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEGMENT_PREFIX "test_binlog.seg"
+
+static log4c_category_t* cat = NULL;
+
+/*******************************************************************************/
+static int test_append(log4c_appender_t* this,
+		       const log4c_logging_event_t* a_event)
+{
+    FILE* fp = log4c_appender_get_udata(this);
+
+    return fprintf(fp, "[%s] %s", log4c_appender_get_name(this),
+		   a_event->evt_rendered_msg);
+}
+
+/*******************************************************************************/
+static const log4c_appender_type_t log4c_appender_type_test = {
+  "test",
+  NULL,
+  test_append,
+  NULL,
+};
+
+/******************************************************************************/
+static void log_messages(void)
+{
+    /* not terminated: the precision bounds it */
+    static const char unterminated[4] = { 'a', 'b', 'c', 'd' };
+    int i;
+
+    for (i = 0; i < 3; i++)
+	LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d of %s", i, "test");
+
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_WARN,
+		 "%c|%5d|%-5u|%lx|%lld|%zu|%08.3f|%e|%*d|%.*s|%s|%%",
+		 'x', -42, 42U, 0xbeefUL, -1234567890123LL, (size_t) 7,
+		 3.14159, 1e-10, 6, 12, 3, "truncated", (const char*) NULL);
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_INFO, "%Lf", (long double) 2.5);
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_INFO, "%.4s|%.*s|%.8s", unterminated,
+		 2, unterminated, "short");
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_DEBUG, "below the priority %d", 0);
+}
+
+/******************************************************************************/
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char* formats[] = {
+	"plain", "%d %s %f", "%5.*f", "%%", "%hhd %zu %Lg",
+	"%n", "%1$s", "%ls", "%lc", "%y", "%",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+	log4c_binlog_format_t* fmt = log4c_binlog_format_new(formats[i]);
+
+	fprintf(sd_test_out(a_test), "'%s' %s\n", formats[i],
+		fmt ? "deferred" : "immediate");
+	log4c_binlog_format_delete(fmt);
+    }
+
+    return log4c_binlog_register("%d") == log4c_binlog_register("%d") &&
+	log4c_binlog_register("%n") == -1;
+}
+
+/******************************************************************************/
+static int test1(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_appender_t* appender = log4c_appender_get("test_binlog");
+
+    log4c_appender_set_type(appender, &log4c_appender_type_test);
+    log4c_appender_set_udata(appender, sd_test_out(a_test));
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(cat, 0);
+
+    /* not started: formatted right away */
+    log_messages();
+
+    if (log4c_binlog_start(NULL, 0, 0) == -1)
+	return 0;
+
+    log_messages();
+    log4c_binlog_flush();
+
+    /* can not be deferred */
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "%2$s %1$s", "world", "hello");
+
+    return log4c_binlog_stop() == 0 && log4c_binlog_get_drops() == 0;
+}
+
+/******************************************************************************/
+/* decodes the segment files */
+static int test2(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_binlog_format_t* formats[64];
+    char* categories[64];
+    const log4c_thread_t* self = log4c_thread_get();
+    unsigned int segment;
+    int nevents = 0;
+    int nthreads = 0;
+    int i;
+
+    if (log4c_binlog_start(SEGMENT_PREFIX, 256, 0) == -1)
+	return 0;
+    log_messages();
+    log4c_binlog_stop();
+
+    for (segment = 0; ; segment++) {
+	log4c_binlog_header_t hdr;
+	log4c_binlog_record_t rec;
+	char name[64];
+	char* data;
+	char msg[256];
+	FILE* fp;
+
+	sprintf(name, "%s.%u", SEGMENT_PREFIX, segment);
+	if ((fp = fopen(name, "rb")) == NULL)
+	    break;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.hdr_magic, LOG4C_BINLOG_MAGIC, 4) ||
+	    hdr.hdr_segment != segment)
+	    return 0;
+
+	memset(formats, 0, sizeof(formats));
+	memset(categories, 0, sizeof(categories));
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+	    size_t size = rec.rec_size - sizeof(rec);
+
+	    data = malloc(size + 1);
+	    if (fread(data, 1, size, fp) != size)
+		return 0;
+
+	    switch (rec.rec_type) {
+	    case LOG4C_BINLOG_FORMAT:
+		formats[rec.rec_format % 64] = log4c_binlog_format_new(data);
+		break;
+	    case LOG4C_BINLOG_CATEGORY:
+		categories[rec.rec_category % 64] = strdup(data);
+		break;
+	    case LOG4C_BINLOG_THREAD:
+		/* each segment defines the thread */
+		if (rec.rec_sequence == self->th_id && !strcmp(data, self->th_name))
+		    nthreads++;
+		break;
+	    case LOG4C_BINLOG_EVENT:
+		if (log4c_binlog_format_render(formats[rec.rec_format % 64],
+					       data, size, msg, sizeof(msg)) < 0)
+		    return 0;
+		fprintf(sd_test_out(a_test), "segment %u [%s] %s %s\n", segment,
+			categories[rec.rec_category % 64],
+			log4c_priority_to_string(rec.rec_priority), msg);
+		nevents++;
+		break;
+	    }
+	    free(data);
+	}
+	fclose(fp);
+	remove(name);
+
+	for (i = 0; i < 64; i++) {
+	    log4c_binlog_format_delete(formats[i]);
+	    free(categories[i]);
+	}
+    }
+
+    return segment > 1 && nevents == 6 && nthreads == (int) segment;
+}
+
+/******************************************************************************/
+/* key/value fields, sent to the appenders then written to a segment */
+static int test3(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_field_t fields[3];
+    log4c_binlog_record_t rec;
+    log4c_binlog_header_t hdr;
+    char data[256];
+    int nevents = 0;
+    FILE* fp;
+
+    log4c_layout_set_type(log4c_layout_get("test_binlog"),
+			  log4c_layout_type_get("basic"));
+    log4c_appender_set_layout(log4c_appender_get("test_binlog"),
+			      log4c_layout_get("test_binlog"));
+
+    fields[0] = log4c_field_string("user", "bob");
+    fields[1] = log4c_field_int("latency", 12);
+    fields[2] = log4c_field_double("load", 0.5);
+
+    log4c_category_binlog_kv(cat, LOG4C_PRIORITY_ERROR, "not started", fields, 3);
+
+    if (log4c_binlog_start(NULL, 0, 0) == -1)
+	return 0;
+    log4c_category_binlog_kv(cat, LOG4C_PRIORITY_ERROR, "deferred", fields, 3);
+    log4c_category_binlog_kv(cat, LOG4C_PRIORITY_DEBUG, "not enabled", fields, 3);
+    log4c_binlog_stop();
+
+    if (log4c_binlog_start(SEGMENT_PREFIX, 0, 0) == -1)
+	return 0;
+    log4c_category_binlog_kv(cat, LOG4C_PRIORITY_WARN, "written", fields, 2);
+    log4c_binlog_stop();
+
+    if ((fp = fopen(SEGMENT_PREFIX ".0", "rb")) == NULL ||
+	fread(&hdr, sizeof(hdr), 1, fp) != 1)
+	return 0;
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+	size_t size = rec.rec_size - sizeof(rec);
+	log4c_field_t decoded[3];
+	const char* message;
+	const void* encoded;
+	size_t encoded_size;
+	char text[128];
+	int n;
+
+	if (size > sizeof(data) || fread(data, 1, size, fp) != size)
+	    return 0;
+	if (rec.rec_type != LOG4C_BINLOG_KV)
+	    continue;
+
+	if (log4c_binlog_kv_split(data, size, &message, &encoded,
+				  &encoded_size) == -1 ||
+	    (n = log4c_field_decode(encoded, encoded_size, decoded, 3)) != 2)
+	    return 0;
+	log4c_field_render(decoded, n, text, sizeof(text));
+	fprintf(sd_test_out(a_test), "segment %s %s%s\n",
+		log4c_priority_to_string(rec.rec_priority), message, text);
+	nevents++;
+    }
+    fclose(fp);
+    remove(SEGMENT_PREFIX ".0");
+
+    return nevents == 1;
+}
+
+/******************************************************************************/
+/* counts the records of a type in a segment, then removes it */
+static int segment_count(const char* a_name, unsigned int a_type)
+{
+    log4c_binlog_record_t rec;
+    log4c_binlog_header_t hdr;
+    char data[256];
+    int n = 0;
+    FILE* fp;
+
+    if ((fp = fopen(a_name, "rb")) == NULL ||
+	fread(&hdr, sizeof(hdr), 1, fp) != 1)
+	return -1;
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+	size_t size = rec.rec_size - sizeof(rec);
+
+	if (size > sizeof(data) || fread(data, 1, size, fp) != size)
+	    return -1;
+	if (rec.rec_type == a_type)
+	    n++;
+    }
+    fclose(fp);
+    remove(a_name);
+    return n;
+}
+
+/******************************************************************************/
+/* the contexts go with the deferred events, and are only written when
+   they change or in a new segment */
+static int test4(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_layout_t* layout = log4c_layout_get("test_binlog");
+    int ok = 1;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("pattern"));
+    log4c_layout_pattern_set(layout, "%p [%x]%X %m%n");
+
+    if (log4c_binlog_start(NULL, 0, 0) == -1)
+	return 0;
+    log4c_mdc_put("request", "r-1");
+    log4c_ndc_push("checkout");
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 1);
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 2);
+    log4c_mdc_put("request", "r-2");
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 3);
+    log4c_ndc_pop();
+    log4c_mdc_clear();
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 4);
+    log4c_binlog_stop();
+
+    log4c_mdc_put("request", "r-3");
+    if (log4c_binlog_start(SEGMENT_PREFIX, 0, 0) == -1)
+	return 0;
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 5);
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 6);
+    log4c_binlog_stop();
+    if (segment_count(SEGMENT_PREFIX ".0", LOG4C_BINLOG_CONTEXT) != 1)
+	ok = 0;
+
+    /* unchanged, but a new segment */
+    if (log4c_binlog_start(SEGMENT_PREFIX, 0, 0) == -1)
+	return 0;
+    LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "message %d", 7);
+    log4c_binlog_stop();
+    if (segment_count(SEGMENT_PREFIX ".0", LOG4C_BINLOG_CONTEXT) != 1)
+	ok = 0;
+
+    log4c_mdc_clear();
+    return ok && log4c_binlog_get_drops() == 0;
+}
+
+/******************************************************************************/
+static int logging = 1;
+
+static void* log_forever(void* a_arg)
+{
+    log4c_category_t* busy = a_arg;
+
+    while (SD_ATOMIC_LOAD_ACQUIRE(&logging))
+	LOG4C_BINLOG(busy, LOG4C_PRIORITY_ERROR, "busy %d", 0);
+    return NULL;
+}
+
+/* a flush returns while another thread keeps logging */
+static int test5(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* busy = log4c_category_get("binlog.busy");
+    pthread_t thread;
+    int i, ok = 1;
+
+    /* the events go nowhere */
+    log4c_category_set_additivity(busy, 0);
+    log4c_category_set_priority(busy, LOG4C_PRIORITY_ERROR);
+
+    if (log4c_binlog_start(NULL, 0, 0) == -1)
+	return 0;
+    if (pthread_create(&thread, NULL, log_forever, busy)) {
+	log4c_binlog_stop();
+	return 0;
+    }
+
+    for (i = 0; i < 10 && ok; i++) {
+	LOG4C_BINLOG(cat, LOG4C_PRIORITY_ERROR, "flushed %d", i);
+	ok = log4c_binlog_flush() == 0;
+    }
+
+    SD_ATOMIC_STORE_RELEASE(&logging, 0);
+    pthread_join(thread, NULL);
+    return log4c_binlog_stop() == 0 && ok;
+}
+
+/******************************************************************************/
+/* log4c-decode filters the events of the segments and keeps their order */
+static int test6(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char* names[] = {
+	"binlog.db", "binlog.db.pool", "binlog.dbx", "binlog", "binlog.net",
+    };
+    static const int priorities[] = {
+	LOG4C_PRIORITY_ERROR, LOG4C_PRIORITY_DEBUG, LOG4C_PRIORITY_INFO,
+	LOG4C_PRIORITY_NOTICE, LOG4C_PRIORITY_TRACE,
+    };
+    log4c_category_t* cats[5];
+    char command[4096];
+    char expected[4096];
+    char output[4096];
+    size_t len = 0, n;
+    unsigned int nsegments;
+    FILE* fp;
+    int i, ok = 1;
+
+    for (i = 0; i < 5; i++) {
+	cats[i] = log4c_category_get(names[i]);
+	log4c_category_set_priority(cats[i], LOG4C_PRIORITY_TRACE);
+    }
+
+    /* small segments, so that the events are spread over several */
+    if (log4c_binlog_start(SEGMENT_PREFIX, 256, 0) == -1)
+	return 0;
+    for (i = 0; i < 40; i++) {
+	log4c_category_t* c = cats[i % 5];
+	int priority = priorities[i / 5 % 5];
+
+	LOG4C_BINLOG(c, priority, "event %d of %s", i, names[i % 5]);
+	if (i % 5 < 2 && priority <= LOG4C_PRIORITY_INFO)
+	    len += sprintf(expected + len, "%s %s event %d of %s\n",
+			   names[i % 5], log4c_priority_to_string(priority), i,
+			   names[i % 5]);
+    }
+    log4c_binlog_stop();
+
+    /* the segments are given last first */
+    for (nsegments = 0; ; nsegments++) {
+	sprintf(command, "%s.%u", SEGMENT_PREFIX, nsegments);
+	if ((fp = fopen(command, "rb")) == NULL)
+	    break;
+	fclose(fp);
+    }
+    n = sprintf(command, "%s/log4c-decode -j 3 -P '%%c %%p %%m%%n' "
+		"-c binlog.db -p info", TOOLSDIR);
+    for (i = (int) nsegments - 1; i >= 0; i--)
+	n += sprintf(command + n, " %s.%d", SEGMENT_PREFIX, i);
+
+    if ((fp = popen(command, "r")) == NULL)
+	ok = 0;
+    else {
+	n = fread(output, 1, sizeof(output) - 1, fp);
+	output[n] = '\0';
+	if (pclose(fp) != 0 || strcmp(output, expected))
+	    ok = 0;
+	fprintf(sd_test_out(a_test), "%s", output);
+    }
+
+    for (i = 0; i < (int) nsegments; i++) {
+	sprintf(command, "%s.%d", SEGMENT_PREFIX, i);
+	remove(command);
+    }
+    return ok && nsegments > 1;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    int ret;
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    log4c_init();
+
+    cat = log4c_category_get("binlog");
+
+    sd_test_add(t, test0);
+    sd_test_add(t, test1);
+    sd_test_add(t, test2);
+    sd_test_add(t, test3);
+    sd_test_add(t, test4);
+    sd_test_add(t, test5);
+    sd_test_add(t, test6);
+
+    ret = sd_test_run(t, argc, argv);
+
+    sd_test_delete(t);
+
+    log4c_fini();
+    return ! ret;
+}
@@ -23,11 +23,18 @@ static const char version[] = "$Id$";
 #include <log4c/layout.h>
 #include <log4c/category.h>
 #include <log4c/init.h>
+#include <log4c/stats.h>
+#include <log4c/backtrace.h>
+#include <log4c/appender_type_flightrecorder.h>
+#include <log4c/sigsafe.h>
 #include <sd/test.h>
 #include <sd/factory.h>
+#include <sd/clock.h>
 #include <sd/sd_xplatform.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <signal.h>
 
 static log4c_category_t* root = NULL;
 static log4c_category_t* sub1 = NULL;
@@ -195,6 +202,749 @@ static int test5(sd_test_t* a_test, int argc, char* argv[])
     return 1;
 }
 
+/******************************************************************************/
+static int test6(sd_test_t* a_test, int argc, char* argv[])
+{   
+    int i;
+    char name[32];
+    log4c_category_t* cat;
+    static const char* names[] = { "tenant.42.io", "root.io", "io.", "" };
+
+    /* enough siblings for the parent to index its children */
+    for (i = 0; i < 100; i++) {
+	snprintf(name, sizeof(name), "tenant.%d.io", i);
+	cat = log4c_category_get(name);
+
+	if (cat != log4c_category_get(name) ||
+	    strcmp(log4c_category_get_name(cat), name))
+	    return 0;
+    }
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+	log4c_category_print(log4c_category_get(names[i]), sd_test_out(a_test));
+	fprintf(sd_test_out(a_test), "\n");
+    }
+    return 1;
+}
+
+/******************************************************************************/
+static int test7(sd_test_t* a_test, int argc, char* argv[])
+{   
+    int i, n = log4c_category_get_count();
+    log4c_category_t* leaf = log4c_category_get("sub1.sub2.leaf");
+
+    for (i = 0; i < n; i++)
+	if (log4c_category_get_id(log4c_category_get_by_id(i)) != i)
+	    return 0;
+
+    if (log4c_category_get_by_id(n + 1) || log4c_category_get_by_id(-1))
+	return 0;
+
+    /* settings made above an existing subtree reach its leaves */
+    log4c_category_set_priority(sun1sub2, LOG4C_PRIORITY_WARN);
+    log4c_category_set_additivity(sub1, 0);
+
+    foo(leaf, error);
+    foo(leaf, info);
+
+    log4c_category_set_priority(sun1sub2, LOG4C_PRIORITY_NOTSET);
+    log4c_category_set_additivity(sub1, 1);
+
+    foo(leaf, info);
+    return 1;
+}
+
+/******************************************************************************/
+static int test8(sd_test_t* a_test, int argc, char* argv[])
+{   
+    log4c_stats_t stats;
+    int i;
+
+    log4c_stats_reset();
+    log4c_stats_set_timing(1);
+
+    for (i = 0; i < 3; i++)
+	foo(sub1, error);
+    foo(sun1sub2, debug);
+
+    log4c_stats_set_timing(0);
+
+    if (log4c_stats_get_appender(log4c_appender_get("appender1"), &stats))
+	return 0;
+
+    fprintf(sd_test_out(a_test), "\nappender1 events=%llu bytes=%llu drops=%llu\n",
+	    stats.st_events, stats.st_bytes, stats.st_drops);
+    fprintf(sd_test_out(a_test), "sub1 events=%llu sub1.sub2 events=%llu\n",
+	    log4c_stats_get_category(sub1), log4c_stats_get_category(sun1sub2));
+    if (stats.st_append_ns == 0)
+	return 0;
+
+    /* the counters of this thread read as reset before it counts again */
+    log4c_stats_reset();
+    if (log4c_stats_get_appender(log4c_appender_get("appender1"), &stats) ||
+	stats.st_events || log4c_stats_get_category(sub1))
+	return 0;
+
+    foo(sub1, error);
+    log4c_stats_get_appender(log4c_appender_get("appender1"), &stats);
+    return stats.st_events == 1 && log4c_stats_get_category(sub1) == 1;
+}
+
+/******************************************************************************/
+static const char* site_msg = NULL;
+static int site_line = 0;
+
+static int site_append(log4c_appender_t* this,
+		       const log4c_logging_event_t* a_event)
+{
+    site_msg  = a_event->evt_msg;
+    site_line = a_event->evt_loc->loc_line;
+
+    return fprintf(log4c_appender_get_udata(this), "[%s] %s\n",
+		   log4c_appender_get_name(this), a_event->evt_msg);
+}
+
+static const log4c_appender_type_t log4c_appender_type_site = {
+  "site",
+  NULL,
+  site_append,
+  NULL,
+};
+
+/******************************************************************************/
+static int test9(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char literal[] = "a message with no conversion";
+    log4c_category_t* cat = log4c_category_get("site");
+    log4c_appender_t* appender = log4c_appender_get("site");
+    int line, i;
+
+    log4c_appender_set_type(appender, &log4c_appender_type_site);
+    log4c_appender_set_udata(appender, sd_test_out(a_test));
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(cat, 0);
+
+    for (i = 0; i < 3; i++)
+	LOG4C_LOG(cat, LOG4C_PRIORITY_ERROR, "call %d of %s, %-4x|%5.1f", i,
+		  "a site", i * 255, 1.5);
+
+    /* the message is the format itself */
+    LOG4C_LOG(cat, LOG4C_PRIORITY_ERROR, literal); line = __LINE__;
+    if (site_msg != literal || site_line != line)
+	return 0;
+
+    /* a site given another format than its first */
+    for (i = 0; i < 2; i++)
+	LOG4C_LOG(cat, LOG4C_PRIORITY_ERROR, i ? "second %d" : "first %d%%", i);
+
+    LOG4C_LOG(cat, LOG4C_PRIORITY_DEBUG, "not enabled %d", i);
+    return 1;
+}
+
+/******************************************************************************/
+static int test10(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("kv");
+    log4c_appender_t* appender = log4c_appender_get("kv");
+    log4c_layout_t* layout = log4c_layout_get("kv");
+    log4c_field_t fields[7];
+    log4c_field_t decoded[7];
+    XP_UINT64 encoded[64];
+    char text[16];
+    size_t size;
+    int n, ok = 1;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("basic_r"));
+    log4c_appender_set_type(appender, &log4c_appender_type_test);
+    log4c_appender_set_udata(appender, sd_test_out(a_test));
+    log4c_appender_set_layout(appender, layout);
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(cat, 0);
+
+    fields[0] = log4c_field_string("user", "alice");
+    fields[1] = log4c_field_uint("req", 18446744073709551615ULL);
+    fields[2] = log4c_field_int("latency", -42);
+    fields[3] = log4c_field_double("ratio", 0.25);
+    fields[4] = log4c_field_bool("cached", 1);
+    fields[5] = log4c_field_string("path", "a \"b\"\n\\");
+    fields[6] = log4c_field_string("none", NULL);
+
+    log4c_category_log_kv(cat, LOG4C_PRIORITY_ERROR, "request done", fields, 7);
+    log4c_category_log_kv(cat, LOG4C_PRIORITY_ERROR, "no field", NULL, 0);
+    log4c_category_log_kv(cat, LOG4C_PRIORITY_DEBUG, "not enabled", fields, 7);
+
+    /* truncated like snprintf() */
+    n = log4c_field_render(fields, 3, text, sizeof(text));
+    fprintf(sd_test_out(a_test), "%d '%s'\n", n, text);
+    if (n != 48 || strlen(text) != sizeof(text) - 1)
+	ok = 0;
+
+    size = log4c_field_encode(fields, 7, encoded);
+    if (size != log4c_field_encoded_size(fields, 7) ||
+	log4c_field_decode(encoded, size, NULL, 0) != 7 ||
+	log4c_field_decode(encoded, size, decoded, 7) != 7 ||
+	log4c_field_decode(encoded, size - 8, NULL, 0) != -1)
+	return 0;
+    for (n = 0; n < 7; n++) {
+	char a[64], b[64];
+
+	log4c_field_render(&fields[n], 1, a, sizeof(a));
+	log4c_field_render(&decoded[n], 1, b, sizeof(b));
+	if (strcmp(a, b))
+	    ok = 0;
+    }
+
+    return ok;
+}
+
+/******************************************************************************/
+static struct timeval clock_tv;
+static log4c_logging_event_t clock_events[2];
+
+static int clock_append(log4c_appender_t* this,
+			const log4c_logging_event_t* a_event)
+{
+    clock_tv = a_event->evt_timestamp;
+    clock_events[0] = clock_events[1];
+    clock_events[1] = *a_event;
+    return 0;
+}
+
+static const log4c_appender_type_t log4c_appender_type_clock = {
+  "clock",
+  NULL,
+  clock_append,
+  NULL,
+  NULL,
+  LOG4C_NEEDS_NONE,
+};
+
+/******************************************************************************/
+static long clock_diff(const struct timeval* a, const struct timeval* b)
+{
+    return (a->tv_sec - b->tv_sec) * 1000000L + (a->tv_usec - b->tv_usec);
+}
+
+/******************************************************************************/
+/* the clock is only read when a layout or an appender needs the time */
+static int test11(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char* names[] = { "realtime", "coarse", "tsc" };
+    log4c_category_t* cat = log4c_category_get("clock");
+    log4c_appender_t* appender = log4c_appender_get("clock");
+    log4c_layout_t* layout = log4c_layout_get("clock");
+    struct timeval start, now, tv;
+    sd_clock_time_t reading;
+    int clock, ok = 1;
+
+    log4c_appender_set_type(appender, &log4c_appender_type_clock);
+    log4c_appender_set_layout(appender, layout);
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(cat, 0);
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("basic_r"));
+    log4c_category_error(cat, "no time");
+    fprintf(sd_test_out(a_test), "basic_r: %s\n",
+	    clock_tv.tv_sec ? "time" : "no time");
+    if (clock_tv.tv_sec)
+	ok = 0;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("dated_r"));
+    log4c_category_error(cat, "time");
+    fprintf(sd_test_out(a_test), "dated_r: %s\n",
+	    clock_tv.tv_sec ? "time" : "no time");
+    if (!clock_tv.tv_sec)
+	ok = 0;
+
+    /* the events of a thread follow each other */
+    log4c_category_error(cat, "time");
+    if (clock_events[1].evt_sequence != clock_events[0].evt_sequence + 1 ||
+	clock_events[1].evt_monotonic_ns < clock_events[0].evt_monotonic_ns ||
+	clock_events[1].evt_realtime_ns / 1000 !=
+	(unsigned long long) clock_tv.tv_sec * 1000000 + clock_tv.tv_usec ||
+	log4c_logging_event_compare(&clock_events[0], &clock_events[1]) >= 0 ||
+	log4c_logging_event_compare(&clock_events[1], &clock_events[0]) <= 0 ||
+	log4c_logging_event_compare(&clock_events[1], &clock_events[1]) != 0)
+	ok = 0;
+
+    /* a layout type which does not say is given the time */
+    memset(&clock_tv, 0, sizeof(clock_tv));
+    log4c_layout_set_type(layout, &log4c_layout_type_test);
+    log4c_category_error(cat, "time");
+    fprintf(sd_test_out(a_test), "test: %s\n",
+	    clock_tv.tv_sec ? "time" : "no time");
+    if (!clock_tv.tv_sec)
+	ok = 0;
+
+    /* each clock stays close to gettimeofday(), its monotonic time never
+       goes back */
+    for (clock = SD_CLOCK_REALTIME; clock <= SD_CLOCK_TSC; clock++) {
+	unsigned long long last = 0;
+	long worst = 0;
+
+	if (sd_clock_use(clock) == -1)
+	    continue;
+
+	SD_GETTIMEOFDAY(&start, NULL);
+	do {
+	    long diff;
+
+	    SD_GETTIMEOFDAY(&now, NULL);
+	    sd_clock_read(&reading);
+	    tv.tv_sec  = (time_t) (reading.ct_realtime / 1000000000);
+	    tv.tv_usec = (long) (reading.ct_realtime % 1000000000 / 1000);
+	    diff = clock_diff(&tv, &now);
+	    if (diff < 0)
+		diff = -diff;
+	    if (diff > worst)
+		worst = diff;
+	    if (reading.ct_monotonic < last)
+		worst = 1000000;
+	    last = reading.ct_monotonic;
+	} while (clock_diff(&now, &start) < 50000);
+
+	if (worst > 20000) {
+	    fprintf(sd_test_out(a_test), "%s: %ld us off\n", names[clock], worst);
+	    ok = 0;
+	}
+    }
+    sd_clock_use(SD_CLOCK_REALTIME);
+
+    return ok;
+}
+
+/******************************************************************************/
+/* the thread is only looked up when a layout or an appender needs it */
+static int test12(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("clock");
+    log4c_layout_t* layout = log4c_layout_get("clock");
+    const log4c_thread_t* self = log4c_thread_get();
+    unsigned long id = self->th_id;
+    int ok = 1;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("basic_r"));
+    log4c_category_error(cat, "no thread");
+    if (clock_events[1].evt_thread)
+	ok = 0;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("pattern"));
+    log4c_category_error(cat, "thread");
+    if (clock_events[1].evt_thread != self || log4c_thread_get() != self)
+	ok = 0;
+
+    log4c_thread_set_name("a name longer than the longest name kept");
+    log4c_category_error(cat, "thread");
+    fprintf(sd_test_out(a_test), "thread: %s\n",
+	    clock_events[1].evt_thread->th_name);
+    if (self->th_id != id)
+	ok = 0;
+
+    log4c_thread_set_name("main");
+    fprintf(sd_test_out(a_test), "thread: %s\n", self->th_name);
+
+    return ok;
+}
+
+/******************************************************************************/
+static void context_print(sd_test_t* a_test, const log4c_logging_event_t* a_event)
+{
+    size_t i;
+
+    fprintf(sd_test_out(a_test), "context: [%s]", a_event->evt_ndc);
+    for (i = 0; i < a_event->evt_nmdc; i++)
+	fprintf(sd_test_out(a_test), " %s=%s", a_event->evt_mdc[i].f_key,
+		a_event->evt_mdc[i].f_value.v_string);
+    fprintf(sd_test_out(a_test), "\n");
+}
+
+/******************************************************************************/
+/* the contexts of the thread, referenced by the events which need them */
+static int test13(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("clock");
+    log4c_layout_t* layout = log4c_layout_get("clock");
+    char key[8];
+    int i, ok = 1;
+
+    if (log4c_mdc_put("request", "r-1") == -1 ||
+	log4c_mdc_put("user", "alice") == -1 ||
+	log4c_mdc_put("request", "r-2") == -1 ||
+	strcmp(log4c_mdc_get("request"), "r-2") ||
+	log4c_mdc_get("none") ||
+	log4c_ndc_push("checkout") == -1 ||
+	log4c_ndc_push("payment") == -1 ||
+	log4c_ndc_get_depth() != 2)
+	ok = 0;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("basic_r"));
+    log4c_category_error(cat, "no context");
+    if (clock_events[1].evt_mdc || clock_events[1].evt_ndc)
+	ok = 0;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("pattern"));
+    log4c_category_error(cat, "context");
+    context_print(a_test, &clock_events[1]);
+    if (clock_events[1].evt_nmdc != 2 ||
+	strcmp(clock_events[1].evt_ndc, "checkout payment"))
+	ok = 0;
+
+    log4c_ndc_pop();
+    log4c_mdc_remove("request");
+    log4c_category_error(cat, "context");
+    context_print(a_test, &clock_events[1]);
+
+    /* full contexts refuse more */
+    for (i = 0; i < LOG4C_MDC_MAX; i++) {
+	sprintf(key, "k%d", i);
+	if ((log4c_mdc_put(key, "v") == -1) != (i == LOG4C_MDC_MAX - 1))
+	    ok = 0;
+    }
+    while (log4c_ndc_push("x") == 0)
+	;
+    if (log4c_ndc_get_depth() != LOG4C_NDC_MAX)
+	ok = 0;
+
+    log4c_mdc_clear();
+    log4c_ndc_clear();
+    log4c_category_error(cat, "no context");
+    if (clock_events[1].evt_mdc || clock_events[1].evt_ndc ||
+	log4c_ndc_get())
+	ok = 0;
+
+    return ok;
+}
+
+/******************************************************************************/
+/* the priority override of the thread, carried by the MDC */
+static int test14(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("clock");
+    int ok = 1;
+
+    clock_events[1].evt_msg = NULL;
+    log4c_category_debug(cat, "not logged");
+    if (clock_events[1].evt_msg || __log4c_category_overrides)
+	ok = 0;
+
+    if (log4c_category_set_thread_priority(LOG4C_PRIORITY_DEBUG) == -1 ||
+	log4c_category_get_thread_priority() != LOG4C_PRIORITY_DEBUG ||
+	!log4c_category_is_debug_enabled(cat) ||
+	log4c_category_is_trace_enabled(cat) ||
+	__log4c_category_overrides != 1)
+	ok = 0;
+    log4c_category_debug(cat, "overridden");
+    if (!clock_events[1].evt_msg)
+	ok = 0;
+    context_print(a_test, &clock_events[1]);
+
+    /* the worker of a request takes the override with the MDC */
+    log4c_mdc_put(LOG4C_MDC_PRIORITY, "trace");
+    if (log4c_category_get_thread_priority() != LOG4C_PRIORITY_TRACE ||
+	!log4c_category_is_trace_enabled(cat) ||
+	__log4c_category_overrides != 1)
+	ok = 0;
+
+    log4c_mdc_remove(LOG4C_MDC_PRIORITY);
+    if (log4c_category_is_debug_enabled(cat) || __log4c_category_overrides)
+	ok = 0;
+
+    log4c_mdc_put(LOG4C_MDC_PRIORITY, "none");
+    if (log4c_category_get_thread_priority() != LOG4C_PRIORITY_NOTSET)
+	ok = 0;
+
+    log4c_category_set_thread_priority(LOG4C_PRIORITY_DEBUG);
+    log4c_mdc_clear();
+    clock_events[1].evt_msg = NULL;
+    log4c_category_debug(cat, "not logged");
+    if (clock_events[1].evt_msg || __log4c_category_overrides)
+	ok = 0;
+
+    return ok;
+}
+
+/******************************************************************************/
+static FILE* backtrace_out = NULL;
+static unsigned long backtrace_thread = 0;
+
+static int backtrace_append(log4c_appender_t* this,
+			    const log4c_logging_event_t* a_event)
+{
+    backtrace_thread = a_event->evt_thread ? a_event->evt_thread->th_id : 0;
+    fprintf(backtrace_out, "%s %s [%s]%s%s\n",
+	    log4c_priority_to_string(a_event->evt_priority), a_event->evt_msg,
+	    a_event->evt_ndc ? a_event->evt_ndc : "",
+	    a_event->evt_nfields ? " fields" : "",
+	    a_event->evt_loc ? "" : " no location");
+    return 0;
+}
+
+static const log4c_appender_type_t log4c_appender_type_backtrace = {
+  "backtrace",
+  NULL,
+  backtrace_append,
+  NULL,
+  NULL,
+  LOG4C_NEEDS_CONTEXT,
+};
+
+/******************************************************************************/
+/* the events a category does not log, kept until an error */
+static int test15(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("backtrace");
+    log4c_category_t* child = log4c_category_get("backtrace.child");
+    log4c_appender_t* appender = log4c_appender_get("backtrace");
+    log4c_field_t field = log4c_field_int("n", 3);
+    int i, ok = 1;
+
+    backtrace_out = sd_test_out(a_test);
+    log4c_appender_set_type(appender, &log4c_appender_type_backtrace);
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(cat, 0);
+
+    if (log4c_category_set_backtrace(cat, LOG4C_PRIORITY_DEBUG) !=
+	LOG4C_PRIORITY_NOTSET ||
+	__log4c_category_overrides != 1 ||
+	!log4c_category_is_debug_enabled(child) ||
+	log4c_category_is_trace_enabled(child) ||
+	log4c_category_get_backtrace(child) != LOG4C_PRIORITY_NOTSET)
+	ok = 0;
+
+    log4c_category_debug(cat, "kept");
+    log4c_ndc_push("request");
+    log4c_category_debug(child, "kept %d", 2);
+    log4c_category_log_kv(cat, LOG4C_PRIORITY_DEBUG, "kept", &field, 1);
+    log4c_category_log(cat, LOG4C_PRIORITY_TRACE, "dropped");
+    log4c_category_info(cat, "logged");
+    if (log4c_backtrace_get_count() != 3)
+	ok = 0;
+
+    log4c_category_error(cat, "failed");
+    if (log4c_backtrace_get_count() != 0)
+	ok = 0;
+
+    /* the oldest events make room */
+    for (i = 0; i < 10000; i++)
+	log4c_category_debug(cat, "kept %d", i);
+    fprintf(sd_test_out(a_test), "kept: %s\n",
+	    log4c_backtrace_get_count() < 10000 ? "some" : "all");
+    log4c_backtrace_clear();
+    log4c_category_error(cat, "failed");
+
+    log4c_category_debug(cat, "kept");
+    if (log4c_backtrace_set_trigger(LOG4C_PRIORITY_WARN) != LOG4C_PRIORITY_ERROR)
+	ok = 0;
+    log4c_category_warn(cat, "warned");
+    log4c_backtrace_set_trigger(LOG4C_PRIORITY_ERROR);
+    log4c_ndc_pop();
+
+    log4c_category_set_backtrace(cat, LOG4C_PRIORITY_NOTSET);
+    log4c_category_debug(cat, "dropped");
+    if (log4c_backtrace_get_count() || __log4c_category_overrides ||
+	log4c_category_is_debug_enabled(child))
+	ok = 0;
+
+    return ok;
+}
+
+/******************************************************************************/
+/* the last lines of a thread, dumped from its ring */
+static int test16(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* cat = log4c_category_get("flight");
+    log4c_appender_t* appender = log4c_appender_get("flight");
+    log4c_flightrecorder_header_t hdr;
+    log4c_flightrecorder_ring_t ring;
+    log4c_flightrecorder_record_t rec;
+    unsigned long long sequence = 0;
+    size_t offset, nrecs = 0;
+    char* data;
+    FILE* fp = tmpfile();
+    int i, ok = 1;
+
+    log4c_appender_set_type(appender, &log4c_appender_type_flightrecorder);
+    log4c_flightrecorder_set_size(appender, 4096);
+    log4c_category_set_appender(cat, appender);
+    log4c_category_set_priority(cat, LOG4C_PRIORITY_DEBUG);
+    log4c_category_set_additivity(cat, 0);
+
+    if (log4c_flightrecorder_dump(appender, fileno(fp)) != -1)
+	ok = 0;
+
+    /* the oldest lines make room */
+    for (i = 0; i < 200; i++)
+	log4c_category_debug(cat, "line %d", i);
+
+    if (log4c_flightrecorder_dump(appender, fileno(fp)) == -1)
+	return 0;
+    rewind(fp);
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	memcmp(hdr.hdr_magic, LOG4C_FLIGHTRECORDER_MAGIC, 4) ||
+	hdr.hdr_nrings != 1 ||
+	fread(&ring, sizeof(ring), 1, fp) != 1 ||
+	ring.ring_size > 4096 || ring.ring_cuts) {
+	fclose(fp);
+	return 0;
+    }
+
+    data = malloc(ring.ring_size);
+    if (fread(data, 1, ring.ring_size, fp) != ring.ring_size)
+	ok = 0;
+    fclose(fp);
+
+    for (offset = 0; ok && offset < ring.ring_size; offset += rec.fr_size) {
+	memcpy(&rec, data + offset, sizeof(rec));
+	if (rec.fr_size < 8 || rec.fr_size % 8)
+	    ok = 0;
+	else if (rec.fr_len != LOG4C_FLIGHTRECORDER_PADDING) {
+	    if (nrecs++ && rec.fr_sequence != sequence + 1)
+		ok = 0;
+	    sequence = rec.fr_sequence;
+	    if (offset + rec.fr_size == ring.ring_size)
+		fwrite(data + offset + sizeof(rec), 1, rec.fr_len,
+		       sd_test_out(a_test));
+	}
+    }
+    fprintf(sd_test_out(a_test), "kept: %s\n",
+	    nrecs > 0 && nrecs < 200 ? "some" : "all");
+    free(data);
+
+    /* a closed recorder is not dumped, and keeps its rings when reopened */
+    log4c_appender_close(appender);
+    if (log4c_flightrecorder_dump(appender, fileno(stdout)) != -1)
+	ok = 0;
+    log4c_category_debug(cat, "reopened");
+    fp = tmpfile();
+    if (log4c_flightrecorder_dump(appender, fileno(fp)) == -1)
+	ok = 0;
+    rewind(fp);
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.hdr_nrings != 1 ||
+	fread(&ring, sizeof(ring), 1, fp) != 1 || ring.ring_size < 4096 - 512)
+	ok = 0;
+    fclose(fp);
+
+    return ok;
+}
+
+/******************************************************************************/
+static log4c_category_t* sigsafe_cat = NULL;
+
+static void sigsafe_handler(int a_signal)
+{
+    log4c_sigsafe_log(sigsafe_cat, LOG4C_PRIORITY_WARN, "signal %d in %s",
+		      a_signal, "handler");
+}
+
+/* events logged from a signal handler, sent to the appenders later */
+static int test17(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_appender_t* appender = log4c_appender_get("backtrace");
+    char buffer[64], expected[64];
+    int i, ok = 1;
+
+    sigsafe_cat = log4c_category_get("sigsafe");
+    backtrace_out = sd_test_out(a_test);
+    log4c_category_set_appender(sigsafe_cat, appender);
+    log4c_category_set_priority(sigsafe_cat, LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(sigsafe_cat, 0);
+
+    log4c_sigsafe_format(buffer, sizeof(buffer),
+			 "%d|%5u|%-4x|%04X|%lld|%zu|%c|%.3s|%%|%q", -42, 7U,
+			 0xabU, 0x1fU, -1234567890123LL, (size_t) 99, 'z',
+			 "string");
+    snprintf(expected, sizeof(expected),
+	     "%d|%5u|%-4x|%04X|%lld|%zu|%c|%.3s|%%|", -42, 7U, 0xabU,
+	     0x1fU, -1234567890123LL, (size_t) 99, 'z', "string");
+    if (strcmp(buffer, expected))
+	ok = 0;
+
+    /* the widths given as arguments, and the end at an unknown conversion */
+    log4c_sigsafe_format(buffer, sizeof(buffer), "%*d|%-*u|%*s|%.*s|%f|%d",
+			 5, 42, 4, 7U, -6, "ab", 2, "string", 1.5, 3);
+    if (strcmp(buffer, "   42|7   |ab    |st|"))
+	ok = 0;
+    if (log4c_sigsafe_format(buffer, 8, "%s", "truncated") != 7 ||
+	strcmp(buffer, "truncat"))
+	ok = 0;
+
+#ifdef SIGUSR1
+    signal(SIGUSR1, sigsafe_handler);
+    raise(SIGUSR1);
+    signal(SIGUSR1, SIG_DFL);
+#else
+    sigsafe_handler(10);
+#endif
+    if (log4c_sigsafe_log(sigsafe_cat, LOG4C_PRIORITY_DEBUG, "dropped") != -1)
+	ok = 0;
+    log4c_sigsafe_log(sigsafe_cat, LOG4C_PRIORITY_INFO, "pointer %p",
+		      (void*) 0);
+
+    if (log4c_sigsafe_drain() != 2 || log4c_sigsafe_drain() != 0 ||
+	backtrace_thread != log4c_thread_get()->th_id)
+	ok = 0;
+
+    /* the events logged while the ring is full are dropped */
+    for (i = 0; i < LOG4C_SIGSAFE_SLOTS + 10; i++)
+	log4c_sigsafe_log(sigsafe_cat, LOG4C_PRIORITY_INFO, "event %d", i);
+    if (log4c_sigsafe_get_drops() != 10)
+	ok = 0;
+    backtrace_out = tmpfile();
+    if (log4c_sigsafe_drain() != LOG4C_SIGSAFE_SLOTS)
+	ok = 0;
+    fclose(backtrace_out);
+
+    return ok;
+}
+
+/******************************************************************************/
+/* a category made behind the factory's back stays out of the trie */
+static int test18(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_category_t* direct;
+    log4c_category_t* cat;
+    int ok = 1;
+
+    log4c_category_set_priority(log4c_category_get("direct"),
+				LOG4C_PRIORITY_ERROR);
+    direct = log4c_category_new("direct.child");
+    if (!direct || log4c_category_get_chainedpriority(direct) !=
+	LOG4C_PRIORITY_ERROR)
+	ok = 0;
+
+    /* it follows the changes of its parent, and of root through it */
+    log4c_category_set_priority(log4c_category_get("direct"),
+				LOG4C_PRIORITY_DEBUG);
+    if (log4c_category_get_chainedpriority(direct) != LOG4C_PRIORITY_DEBUG ||
+	!log4c_category_is_priority_enabled(direct, LOG4C_PRIORITY_DEBUG))
+	ok = 0;
+    log4c_category_set_appender(log4c_category_get("direct"),
+				log4c_appender_get("backtrace"));
+    backtrace_out = sd_test_out(a_test);
+    log4c_category_debug(direct, "reaches the appender of its parent");
+    log4c_category_set_priority(log4c_category_get("direct"),
+				LOG4C_PRIORITY_NOTSET);
+    if (log4c_category_get_chainedpriority(direct) !=
+	log4c_category_get_chainedpriority(log4c_category_get("root")))
+	ok = 0;
+    log4c_category_set_priority(log4c_category_get("direct"),
+				LOG4C_PRIORITY_ERROR);
+    log4c_category_delete(direct);
+
+    cat = log4c_category_get("direct.child");
+    if (!cat || strcmp(log4c_category_get_name(cat), "direct.child") ||
+	log4c_category_get_chainedpriority(cat) != LOG4C_PRIORITY_ERROR ||
+	log4c_category_get("direct.child") != cat)
+	ok = 0;
+
+    return ok;
+}
+
 /******************************************************************************/
 int main(int argc, char* argv[])
 {    
@@ -222,6 +972,19 @@ int main(int argc, char* argv[])
     sd_test_add(t, test3);
     sd_test_add(t, test4);
     sd_test_add(t, test5);
+    sd_test_add(t, test6);
+    sd_test_add(t, test7);
+    sd_test_add(t, test8);
+    sd_test_add(t, test9);
+    sd_test_add(t, test10);
+    sd_test_add(t, test11);
+    sd_test_add(t, test12);
+    sd_test_add(t, test13);
+    sd_test_add(t, test14);
+    sd_test_add(t, test15);
+    sd_test_add(t, test16);
+    sd_test_add(t, test17);
+    sd_test_add(t, test18);
 
     ret = sd_test_run(t, argc, argv);
 
@@ -0,0 +1,123 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_genheader.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/category.h>
+#include <log4c/priority.h>
+#include <log4c/rc.h>
+#include <sd/test.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* generated from test_genheader.rc by log4c-genheader, see Makefile.am */
+#include "test_genheader.h"
+
+#define COLLISION_RC	"test_genheader.tmp.rc"
+#define COLLISION_H	"test_genheader.tmp.h"
+
+/* the chained priorities are constants of the preprocessor */
+#if TEST_GENHEADER_PRIORITY_app_db_pool != TEST_GENHEADER_PRIORITY_app
+#error "app.db.pool does not inherit the priority of app"
+#endif
+
+#define DESCRIPTOR(id) \
+    { &test_genheader_##id, TEST_GENHEADER_PRIORITY_##id }
+
+static const struct {
+    const log4c_static_category_t*	descriptor;
+    int					priority;
+} descriptors[] = {
+    DESCRIPTOR(root),
+    DESCRIPTOR(app),
+    DESCRIPTOR(app_db),
+    DESCRIPTOR(app_db_query),
+    DESCRIPTOR(app_db_pool),
+    DESCRIPTOR(app_net_http),
+    DESCRIPTOR(other_sub),
+    DESCRIPTOR(other_x),
+};
+
+/******************************************************************************/
+/* the priorities of the header are those log4c_load() gives the categories */
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    size_t i;
+    int ok = 1;
+
+    if (log4c_load(SRCDIR "/test_genheader.rc") == -1)
+	return 0;
+
+    for (i = 0; i < sizeof(descriptors) / sizeof(descriptors[0]); i++) {
+	const log4c_static_category_t* desc = descriptors[i].descriptor;
+	int priority = log4c_category_get_chainedpriority(
+	    log4c_category_get(desc->name));
+
+	fprintf(sd_test_out(a_test), "%-14s %-7s %s\n", desc->name,
+		log4c_priority_to_string(desc->priority),
+		log4c_priority_to_string(priority));
+	if (desc->priority != descriptors[i].priority ||
+	    desc->priority != priority)
+	    ok = 0;
+    }
+    return ok;
+}
+
+/******************************************************************************/
+/* names which only differ by characters replaced in identifiers collide */
+static int test1(sd_test_t* a_test, int argc, char* argv[])
+{
+    char command[512];
+    char message[256];
+    FILE* fp;
+    size_t n;
+    int ok = 1;
+
+    if ((fp = fopen(COLLISION_RC, "w")) == NULL)
+	return 0;
+    fprintf(fp, "<log4c>\n"
+	    "\t<category name=\"a.b\" priority=\"info\"/>\n"
+	    "\t<category name=\"a_b\" priority=\"debug\"/>\n"
+	    "</log4c>\n");
+    fclose(fp);
+
+    sprintf(command, "%s/log4c-genheader -o %s %s 2>&1", TOOLSDIR,
+	    COLLISION_H, COLLISION_RC);
+    if ((fp = popen(command, "r")) == NULL) {
+	remove(COLLISION_RC);
+	return 0;
+    }
+    n = fread(message, 1, sizeof(message) - 1, fp);
+    message[n] = '\0';
+    if (pclose(fp) == 0)
+	ok = 0;
+    fprintf(sd_test_out(a_test), "%s", message);
+
+    if (!strstr(message, "'a.b' and 'a_b' have the same identifier 'a_b'"))
+	ok = 0;
+
+    /* no header is left behind */
+    if ((fp = fopen(COLLISION_H, "r")) != NULL) {
+	fclose(fp);
+	ok = 0;
+    }
+
+    remove(COLLISION_RC);
+    remove(COLLISION_H);
+    return ok;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    sd_test_add(t, test0);
+    sd_test_add(t, test1);
+
+    return ! sd_test_run(t, argc, argv);
+}
@@ -0,0 +1,171 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_json.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/layout.h>
+#include <log4c/init.h>
+#include <log4c/priority.h>
+#include <sd/json.h>
+#include <sd/test.h>
+#include <sd/malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+/* compares the implementations of sd_json_escape() with the scalar one */
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char* names[] = { "scalar", "sse2", "avx2" };
+    char in[300];
+    char expected[2000], got[2000];
+    int impl, i, nerrors = 0;
+
+    for (impl = SD_JSON_SSE2; impl <= SD_JSON_AVX2; impl++) {
+	if (sd_json_escape_use(impl) == -1)
+	    continue;
+	srand(1);
+
+	for (i = 0; i < 20000; i++) {
+	    size_t len = rand() % sizeof(in);
+	    size_t size = rand() % 2 ? sizeof(got) : rand() % (2 * len + 8);
+	    size_t len1 = len, len2 = len;
+	    size_t n1, n2, j;
+	    int density = 1 + rand() % 64;
+
+	    for (j = 0; j < len; j++)
+		in[j] = rand() % density ? 'a' + rand() % 26 :
+		    "\"\\\n\t\x01\x1f\x7f\x80 "[rand() % 9];
+
+	    sd_json_escape_use(SD_JSON_SCALAR);
+	    n1 = sd_json_escape(expected, size, in, &len1);
+	    sd_json_escape_use(impl);
+	    n2 = sd_json_escape(got, size, in, &len2);
+
+	    if (n1 != n2 || len1 != len2 || memcmp(expected, got, n1)) {
+		if (nerrors++ < 10)
+		    fprintf(sd_test_out(a_test), "%s: length %d size %d: %d/%d != %d/%d\n",
+			    names[impl], (int) len, (int) size, (int) n2,
+			    (int) len2, (int) n1, (int) len1);
+	    }
+	}
+    }
+
+    /* the default one */
+    if (sd_json_escape_use(SD_JSON_AVX2) == -1)
+	sd_json_escape_use(SD_JSON_SSE2);
+
+    {
+	const char s[] = "tab\there \"quoted\" back\\slash \x01 new\nline \xc3\xa9";
+	size_t len = sizeof(s) - 1;
+	size_t n = sd_json_escape(got, sizeof(got), s, &len);
+
+	fprintf(sd_test_out(a_test), "%.*s\n", (int) n, got);
+	if (len != sizeof(s) - 1)
+	    nerrors++;
+
+	/* never cut in an escape sequence */
+	len = sizeof(s) - 1;
+	n = sd_json_escape(got, 4, s, &len);
+	if (n != 3 || len != 3)
+	    nerrors++;
+	len = sizeof(s) - 1;
+	n = sd_json_escape(got, 5, s, &len);
+	if (n != 5 || len != 4)
+	    nerrors++;
+    }
+
+    return nerrors == 0;
+}
+
+/******************************************************************************/
+static void format(sd_test_t* a_test, const log4c_layout_t* a_layout,
+		   log4c_logging_event_t* a_event, size_t a_maxsize)
+{
+    a_event->evt_buffer.buf_maxsize = a_maxsize;
+    a_event->evt_buffer.buf_size = a_maxsize ? a_maxsize : 16;
+    a_event->evt_buffer.buf_data = sd_malloc(a_event->evt_buffer.buf_size);
+
+    fputs(log4c_layout_format(a_layout, a_event), sd_test_out(a_test));
+
+    free(a_event->evt_buffer.buf_data);
+}
+
+/******************************************************************************/
+static int test1(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_layout_t* layout = log4c_layout_get("json");
+    log4c_location_info_t loc = { "file.c", 42, "function", NULL };
+    log4c_thread_t thread = { 4242, "worker \"1\"" };
+    log4c_logging_event_t evt;
+    log4c_field_t fields[6];
+    log4c_field_t mdc[1];
+    char long_message[3000];
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("json"));
+
+    memset(&evt, 0, sizeof(evt));
+    evt.evt_category = "app.db";
+    evt.evt_priority = LOG4C_PRIORITY_ERROR;
+    evt.evt_msg = "a \"message\"\twith\nescapes";
+    evt.evt_timestamp.tv_sec = 1700000000;
+    evt.evt_timestamp.tv_usec = 42;
+
+    /* a buffer which grows */
+    format(a_test, layout, &evt, 0);
+
+    fields[0] = log4c_field_string("user", "al\"ice");
+    fields[1] = log4c_field_int("latency", -42);
+    fields[2] = log4c_field_uint("req", 18446744073709551615ULL);
+    fields[3] = log4c_field_double("ratio", 0.25);
+    fields[4] = log4c_field_bool("cached", 0);
+    fields[5] = log4c_field_string("none", NULL);
+    evt.evt_fields = fields;
+    evt.evt_nfields = 6;
+    evt.evt_loc = &loc;
+    evt.evt_thread = &thread;
+    mdc[0] = log4c_field_string("request", "r-17");
+    evt.evt_mdc = mdc;
+    evt.evt_nmdc = 1;
+    evt.evt_ndc = "checkout";
+    evt.evt_priority = LOG4C_PRIORITY_WARN;
+    evt.evt_timestamp.tv_usec = 999999;
+    format(a_test, layout, &evt, 0);
+
+    /* limited buffers: the message is cut, then the fields are dropped */
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    evt.evt_msg = long_message;
+    format(a_test, layout, &evt, 256);
+    format(a_test, layout, &evt, 160);
+
+    evt.evt_fields = NULL;
+    evt.evt_nfields = 0;
+    evt.evt_loc = NULL;
+    format(a_test, layout, &evt, 0);
+
+    return 1;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    int ret;
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    log4c_init();
+
+    sd_test_add(t, test0);
+    sd_test_add(t, test1);
+
+    ret = sd_test_run(t, argc, argv);
+
+    sd_test_delete(t);
+
+    log4c_fini();
+    return ! ret;
+}
@@ -0,0 +1,129 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_logger.cpp
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/appender.h>
+#include <log4c/category.h>
+#include <log4c/init.h>
+#include <log4c/logger.hpp>
+#include <sd/test.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+static std::string last;
+static int last_line = 0;
+
+/******************************************************************************/
+static int test_append(log4c_appender_t* a_appender,
+		       const log4c_logging_event_t* a_event)
+{
+    FILE* fp = static_cast<FILE*>(log4c_appender_get_udata(a_appender));
+
+    last = a_event->evt_msg;
+    last_line = a_event->evt_loc->loc_line;
+    return std::fprintf(fp, "[%s] %s\n", a_event->evt_category,
+			a_event->evt_msg);
+}
+
+/******************************************************************************/
+static const log4c_appender_type_t log4c_appender_type_test = {
+    "test",
+    NULL,
+    test_append,
+    NULL,
+};
+
+/******************************************************************************/
+#define CHECK(a_expected, ...) \
+    do { \
+	log.error(__VA_ARGS__); \
+	if (last != (a_expected)) { \
+	    std::fprintf(sd_test_out(a_test), "'%s' != '%s'\n", last.c_str(), \
+			 std::string(a_expected).c_str()); \
+	    ok = 0; \
+	} \
+    } while (0)
+
+/******************************************************************************/
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c::logger log("logger");
+    log4c_appender_t* appender = log4c_appender_get("test_logger");
+    std::string s("a string");
+    std::string_view sv = std::string_view("a view of a string").substr(2, 4);
+    const char* null = NULL;
+    long long big = -9223372036854775807LL - 1;
+    int line;
+    int ok = 1;
+
+    log4c_appender_set_type(appender, &log4c_appender_type_test);
+    log4c_appender_set_udata(appender, sd_test_out(a_test));
+    log4c_category_set_appender(log.category(), appender);
+    log4c_category_set_priority(log.category(), LOG4C_PRIORITY_INFO);
+    log4c_category_set_additivity(log.category(), 0);
+
+    CHECK("no argument, 100%", LOG4C_FMT("no argument, 100%%"));
+    CHECK("42 -7 7 0", LOG4C_FMT("%d %i %u %d"), 42, -7, 7U, false);
+    CHECK("-9223372036854775808 18446744073709551615",
+	  LOG4C_FMT("%d %u"), big, 18446744073709551615ULL);
+    CHECK("4294967295 -1 255", LOG4C_FMT("%u %d %hhu"), -1, 4294967295U, 255);
+    CHECK("[   42|42   |00042|+42|0x2a|052|FF]",
+	  LOG4C_FMT("[%5d|%-5d|%05d|%+d|%#x|%#o|%X]"), 42, 42, 42, 42, 42, 42, 255);
+    CHECK("[    7|7    |007]", LOG4C_FMT("[%*d|%-*d|%.*d]"), 5, 7, 5, 7, 3, 7);
+    CHECK("x 3.14 1.000000e-10 2.5", LOG4C_FMT("%c %.2f %e %Lg"), 'x', 3.14159,
+	  1e-10, (long double) 2.5);
+    CHECK("a string|view|a literal|(null)", LOG4C_FMT("%s|%s|%s|%s"), s, sv,
+	  "a literal", null);
+    CHECK("[  view|vi   |a st]", LOG4C_FMT("[%6s|%-5.2s|%.*s]"), sv, sv, 4, s);
+    CHECK("[  a s]", LOG4C_FMT("[%*.*s]"), 5, 3, s);
+    CHECK("(nil) (nil)", LOG4C_FMT("%p %p"), (void*) 0, nullptr);
+
+    /* a message longer than the buffer on the stack */
+    std::string long_string(2000, 'x');
+    CHECK(long_string + "|end", LOG4C_FMT("%s|%s"), long_string, "end");
+
+    log.error(LOG4C_FMT("at a line")); line = __LINE__;
+    if (last_line != line)
+	ok = 0;
+
+    log.debug(LOG4C_FMT("not enabled %d"), 0);
+    if (last.compare(0, 11, "not enabled") == 0)
+	ok = 0;
+
+#ifdef TEST_LOGGER_COMPILE_ERRORS
+    /* each of these lines fails to compile */
+    log.error(LOG4C_FMT("%d"));
+    log.error(LOG4C_FMT("%d"), 1, 2);
+    log.error(LOG4C_FMT("%d"), "one");
+    log.error(LOG4C_FMT("%s"), 1);
+    log.error(LOG4C_FMT("%f"), 1);
+    log.error(LOG4C_FMT("%n"), &line);
+    log.error(LOG4C_FMT("%1$d"), 1);
+#endif
+
+    return ok;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    int ret;
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    log4c_init();
+
+    sd_test_add(t, test0);
+
+    ret = sd_test_run(t, argc, argv);
+
+    sd_test_delete(t);
+
+    log4c_fini();
+    return ! ret;
+}
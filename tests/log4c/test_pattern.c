@@ -0,0 +1,151 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_pattern.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <log4c/layout.h>
+#include <log4c/layout_type_pattern.h>
+#include <log4c/init.h>
+#include <log4c/priority.h>
+#include <sd/test.h>
+#include <sd/malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+static void format(sd_test_t* a_test, const log4c_layout_t* a_layout,
+		   log4c_logging_event_t* a_event, size_t a_maxsize)
+{
+    a_event->evt_buffer.buf_maxsize = a_maxsize;
+    a_event->evt_buffer.buf_size = a_maxsize ? a_maxsize : 16;
+    a_event->evt_buffer.buf_data = sd_malloc(a_event->evt_buffer.buf_size);
+
+    fprintf(sd_test_out(a_test), "[%s]\n", log4c_layout_format(a_layout, a_event));
+
+    free(a_event->evt_buffer.buf_data);
+}
+
+/******************************************************************************/
+static void event_init(log4c_logging_event_t* a_event)
+{
+    memset(a_event, 0, sizeof(*a_event));
+    a_event->evt_category = "app.db";
+    a_event->evt_priority = LOG4C_PRIORITY_WARN;
+    a_event->evt_msg	  = "a message";
+    a_event->evt_sequence = 42;
+    log4c_logging_event_set_time(a_event, 1700000000123456789ULL, 987654321ULL);
+}
+
+/******************************************************************************/
+/* the conversions */
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char* patterns[] = {
+	NULL,
+	"%d %T %o %q",
+	"%d{%H:%M:%S}.%.3N|%.6N|%N|%.N|%12.3N|",
+	"[%10p][%-10p][%.2c][%-8.3c]%%%n",
+	"%F:%L %M |%m|%K",
+	"[%t][%i]",
+	"no conversion",
+	"",
+    };
+    log4c_layout_t* layout = log4c_layout_get("pattern");
+    log4c_location_info_t loc = { "file.c", 42, "function", NULL };
+    log4c_logging_event_t evt;
+    log4c_thread_t thread = { 4242, "worker-1" };
+    log4c_field_t fields[2];
+    log4c_field_t mdc[2];
+    size_t i;
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("pattern"));
+    event_init(&evt);
+
+    for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+	if (patterns[i] && log4c_layout_pattern_set(layout, patterns[i]) == -1)
+	    return 0;
+	format(a_test, layout, &evt, 0);
+    }
+
+    fields[0] = log4c_field_string("user", "alice");
+    fields[1] = log4c_field_int("rows", 12);
+    evt.evt_fields  = fields;
+    evt.evt_nfields = 2;
+    evt.evt_loc	    = &loc;
+    log4c_layout_pattern_set(layout, "%F:%L %M |%m|%K");
+    format(a_test, layout, &evt, 0);
+
+    evt.evt_thread = &thread;
+    log4c_layout_pattern_set(layout, "[%-10t][%i] %m");
+    format(a_test, layout, &evt, 0);
+
+    log4c_layout_pattern_set(layout, "[%X{request}][%X{none}][%x]%X");
+    format(a_test, layout, &evt, 0);
+    mdc[0] = log4c_field_string("request", "r-17");
+    mdc[1] = log4c_field_string("user", "bob smith");
+    evt.evt_mdc  = mdc;
+    evt.evt_nmdc = 2;
+    evt.evt_ndc	 = "checkout payment";
+    format(a_test, layout, &evt, 0);
+
+    return 1;
+}
+
+/******************************************************************************/
+/* long lines grow the buffer or are cut, bad patterns are refused */
+static int test1(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_layout_t* layout = log4c_layout_get("pattern");
+    log4c_logging_event_t evt;
+    char message[200];
+
+    log4c_layout_set_type(layout, log4c_layout_type_get("pattern"));
+    log4c_layout_pattern_set(layout, "%p %m%n");
+    event_init(&evt);
+
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+    evt.evt_msg = message;
+    format(a_test, layout, &evt, 0);
+    format(a_test, layout, &evt, 32);
+
+    /* the cut line keeps the end of line of the pattern */
+    log4c_layout_pattern_set(layout, "%d{%H:%M:%S} %-8p %c - %m%n");
+    format(a_test, layout, &evt, 40);
+    log4c_layout_pattern_set(layout, "%p %m");
+    format(a_test, layout, &evt, 40);
+    log4c_layout_pattern_set(layout, "%p %m%n");
+
+    if (log4c_layout_pattern_set(layout, "%p %y") != -1 ||
+	log4c_layout_pattern_set(layout, "%d{%H") != -1 ||
+	log4c_layout_pattern_set(layout, "trailing %") != -1)
+	return 0;
+
+    /* the layout keeps its pattern */
+    evt.evt_msg = "kept";
+    format(a_test, layout, &evt, 0);
+    return 1;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    int ret;
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    log4c_init();
+
+    sd_test_add(t, test0);
+    sd_test_add(t, test1);
+
+    ret = sd_test_run(t, argc, argv);
+
+    sd_test_delete(t);
+
+    log4c_fini();
+    return ! ret;
+}
@@ -15,6 +15,7 @@ static const char version[] = "$Id$";
 #include <log4c/appender.h>
 #include <sd/factory.h>
 #include <stdio.h>
+#include <log4c/priority.h>
 
 /******************************************************************************/
 static void log4c_print(FILE* a_fp)
@@ -62,6 +63,94 @@ static int test2(sd_test_t* a_test, int argc, char* argv[])
     return 1;
 }
 
+/******************************************************************************/
+static int rc_write(const char* a_filename, const char* a_category,
+		    const char* a_priority)
+{
+    FILE* fp;
+
+    if ((fp = fopen(a_filename, "w")) == NULL)
+	return -1;
+    fprintf(fp, "<log4c>\n"
+	    "\t<category name=\"%s\" priority=\"%s\"/>\n"
+	    "</log4c>\n", a_category, a_priority);
+    fclose(fp);
+    return 0;
+}
+
+/******************************************************************************/
+/* an image applies the configuration it was compiled from */
+static int test3(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_rc_t rc;
+    int ok = 1;
+
+    if (rc_write("test_rc.image", "image", "notice") == -1)
+	return 0;
+
+    if (log4c_rc_compile("test_rc.image", "test_rc.image.bin") == -1 ||
+	log4c_rc_load_image(&rc, "test_rc.image.bin", "test_rc.image") == -1 ||
+	log4c_category_get_priority(log4c_category_get("image")) !=
+	LOG4C_PRIORITY_NOTICE)
+	ok = 0;
+    remove("test_rc.image.bin");
+    remove("test_rc.image");
+
+    return ok;
+}
+
+/******************************************************************************/
+/* a malformed file applies nothing */
+static int test4(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_rc_t rc;
+    FILE* fp;
+    int ok = 1;
+
+    if ((fp = fopen("test_rc.bad", "w")) == NULL)
+	return 0;
+    fprintf(fp, "<log4c>\n"
+	    "\t<category name=\"malformed\" priority=\"debug\"/>\n"
+	    "\t<category name=\"malformed.child\" priority=\n");
+    fclose(fp);
+
+    if (log4c_rc_load(&rc, "test_rc.bad") != -1 ||
+	log4c_category_get_priority(log4c_category_get("malformed")) !=
+	LOG4C_PRIORITY_NOTSET)
+	ok = 0;
+    remove("test_rc.bad");
+
+    return ok;
+}
+
+/******************************************************************************/
+/* a stale image is refused and the file is loaded instead */
+static int test5(sd_test_t* a_test, int argc, char* argv[])
+{
+    log4c_rc_t rc;
+    int ok = 1;
+
+    if (rc_write("test_rc.stale", "stale", "debug") == -1 ||
+	log4c_rc_compile("test_rc.stale", "test_rc.stale.bin") == -1)
+	return 0;
+
+    /* rewritten within the same second, but not with the same size */
+    if (rc_write("test_rc.stale", "stale", "error") == -1 ||
+	log4c_rc_load_image(&rc, "test_rc.stale.bin", "test_rc.stale") != -1 ||
+	log4c_category_get_priority(log4c_category_get("stale")) !=
+	LOG4C_PRIORITY_NOTSET)
+	ok = 0;
+
+    if (ok && (log4c_rc_load(&rc, "test_rc.stale") == -1 ||
+	       log4c_category_get_priority(log4c_category_get("stale")) !=
+	       LOG4C_PRIORITY_ERROR))
+	ok = 0;
+    remove("test_rc.stale.bin");
+    remove("test_rc.stale");
+
+    return ok;
+}
+
 /******************************************************************************/
 int main(int argc, char* argv[])
 {    
@@ -70,6 +159,9 @@ int main(int argc, char* argv[])
     sd_test_add(t, test0);
     sd_test_add(t, test1);
     sd_test_add(t, test2);
+    sd_test_add(t, test3);
+    sd_test_add(t, test4);
+    sd_test_add(t, test5);
 
     return ! sd_test_run(t, argc, argv);
 }
@@ -17,6 +17,9 @@
 #endif
  
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <log4c.h>
 #include <log4c/appender_type_rollingfile.h>
 #include <log4c/rollingpolicy.h>
@@ -103,6 +106,12 @@ static void init_log4c_with_rollingfile_appender(){
   rollingfile_udata_set_logdir(rfup, param_log_dir);
   rollingfile_udata_set_files_prefix(rfup, param_log_prefix);
 
+  /*
+   * Keep an index next to each file, with an entry every 512 bytes or
+   * every second, which log4c-seek uses to find a time range
+  */
+  rollingfile_udata_set_index(rfup, 512, 1);
+
   /*
    * Get a new rollingpolicy
    * type defaults to "sizewin" but set the type explicitly here
@@ -173,11 +182,141 @@ static int test0(int argc, char* argv[])
   return 1;
 }
 
+/******************************************************************************/
+/*
+ * Writes events to a file indexed at each event, then looks up the time
+ * of one of them in the index, directly and through log4c-seek.
+ */
+#define INDEX_LOGFILE "test_rf_index"
+#define INDEX_NEVENTS 50
+
+static int test1(int argc, char* argv[])
+{
+  log4c_category_t* cat;
+  log4c_appender_t* appender;
+  rollingfile_udata_t* rfup;
+  rollingfile_index_entry_t* entries = NULL;
+  size_t nentries = 0, i, j;
+  long starts[INDEX_NEVENTS];
+  struct timeval tv;
+  long expected;
+  char command[256];
+  char* data;
+  char* output;
+  long size;
+  size_t n;
+  FILE* fp;
+  int ok = 1;
+
+  remove(INDEX_LOGFILE);
+  remove(INDEX_LOGFILE ROLLINGFILE_INDEX_SUFFIX);
+  log4c_init();
+
+  rfup = rollingfile_make_udata();
+  rollingfile_udata_set_logdir(rfup, ".");
+  rollingfile_udata_set_files_prefix(rfup, INDEX_LOGFILE);
+  rollingfile_udata_set_index(rfup, 1, 0);
+
+  appender = log4c_appender_get("test_rf_index");
+  log4c_appender_set_type(appender, &log4c_appender_type_rollingfile);
+  log4c_appender_set_layout(appender, log4c_layout_get("basic"));
+  log4c_appender_set_udata(appender, rfup);
+
+  cat = log4c_category_get("test_rf_index");
+  log4c_category_set_appender(cat, appender);
+  log4c_category_set_priority(cat, LOG4C_PRIORITY_DEBUG);
+  log4c_category_set_additivity(cat, 0);
+
+  /* a few milliseconds apart, so that the index times differ */
+  for (i = 0; i < INDEX_NEVENTS; i++) {
+    log4c_category_error(cat, "event %d", (int) i);
+    usleep(1000);
+  }
+
+  /* the line of each event */
+  if ((fp = fopen(INDEX_LOGFILE, "rb")) == NULL ||
+      fseek(fp, 0, SEEK_END) || (size = ftell(fp)) <= 0 ||
+      fseek(fp, 0, SEEK_SET))
+    return 0;
+  data = malloc(size + 1);
+  if (fread(data, 1, size, fp) != (size_t) size)
+    ok = 0;
+  fclose(fp);
+  data[size] = '\0';
+  for (i = 0, j = 0; i < INDEX_NEVENTS; i++) {
+    starts[i] = (long) j;
+    while (j < (size_t) size && data[j++] != '\n')
+      ;
+  }
+
+  /* an entry at each event, at the start of its line */
+  if (rollingfile_index_read(INDEX_LOGFILE, &entries, &nentries) == -1 ||
+      nentries != INDEX_NEVENTS) {
+    printf("index: %lu entries\n", (unsigned long) nentries);
+    ok = 0;
+  }
+  for (i = 0; ok && i < nentries; i++)
+    if (entries[i].rie_offset != starts[i] ||
+	(i && (entries[i].rie_sec < entries[i - 1].rie_sec ||
+	       (entries[i].rie_sec == entries[i - 1].rie_sec &&
+		entries[i].rie_usec < entries[i - 1].rie_usec)))) {
+      printf("index: bad entry %lu\n", (unsigned long) i);
+      ok = 0;
+    }
+
+  if (ok) {
+    /* the entry before the first one at or after the time */
+    i = nentries / 2;
+    tv.tv_sec  = (time_t) entries[i].rie_sec;
+    tv.tv_usec = entries[i].rie_usec;
+    for (j = 0; j < nentries && (entries[j].rie_sec < tv.tv_sec ||
+				 (entries[j].rie_sec == tv.tv_sec &&
+				  entries[j].rie_usec < (unsigned int) tv.tv_usec)); j++)
+      ;
+    expected = j ? (long) entries[j - 1].rie_offset : 0;
+
+    if (rollingfile_index_find(INDEX_LOGFILE, &tv) != expected) {
+      printf("index: offset %ld instead of %ld\n",
+	     rollingfile_index_find(INDEX_LOGFILE, &tv), expected);
+      ok = 0;
+    }
+
+    /* log4c-seek prints the file from there on */
+    sprintf(command, "%s/log4c-seek -s %lld.%06u %s", TOOLSDIR,
+	    (long long) tv.tv_sec, (unsigned int) tv.tv_usec, INDEX_LOGFILE);
+    output = malloc(size + 1);
+    if ((fp = popen(command, "r")) == NULL)
+      ok = 0;
+    else {
+      n = fread(output, 1, size, fp);
+      if (pclose(fp) != 0 || n != (size_t) (size - expected) ||
+	  memcmp(output, data + expected, n)) {
+	printf("log4c-seek: %lu bytes, %ld expected\n", (unsigned long) n,
+	       size - expected);
+	ok = 0;
+      }
+    }
+    free(output);
+  }
+
+  free(entries);
+  free(data);
+  log4c_category_set_appender(cat, NULL);
+  log4c_appender_close(appender);
+  remove(INDEX_LOGFILE);
+  remove(INDEX_LOGFILE ROLLINGFILE_INDEX_SUFFIX);
+
+  printf("index test %s\n", ok ? "passed" : "failed");
+  return ok;
+}
+
 /******************************************************************************/
 int main(int argc, char* argv[])
 {    
-   
+  int ok;
+
+  ok = test1(argc, argv);
   test0(argc,argv);
 
-    return(0);
+  return(ok ? 0 : 1);
 }
@@ -0,0 +1,267 @@
+static const char version[] = "$Id$";
+
+/*
+ * test_sprintf.c
+ *
+ * See the COPYING file for the terms of usage and distribution.
+ */
+
+#include <sd/sprintf.h>
+#include <sd/test.h>
+#include <sd/sd_xplatform.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int nchecks = 0;
+static int nerrors = 0;
+
+/******************************************************************************/
+/*
+ * compares sd_vsnprintf() and sd_format_vsnprintf() with vsnprintf(),
+ * whole and truncated
+ */
+static void check(sd_test_t* a_test, const char* a_fmt, ...)
+{
+    static const size_t sizes[] = { 512, 0, 1, 2, 7, 16 };
+    sd_format_t* parsed = sd_format_new(a_fmt);
+    char expected[512];
+    char got[512];
+    size_t i;
+    int j;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+	va_list ap;
+	int n, m;
+
+	memset(expected, '#', sizeof(expected));
+	va_start(ap, a_fmt);
+	n = vsnprintf(expected, sizes[i], a_fmt, ap);
+	va_end(ap);
+
+	for (j = 0; j < 2; j++) {
+	    memset(got, '#', sizeof(got));
+	    va_start(ap, a_fmt);
+	    m = j ? sd_format_vsnprintf(parsed, got, sizes[i], ap) :
+		sd_vsnprintf(got, sizes[i], a_fmt, ap);
+	    va_end(ap);
+
+	    nchecks++;
+	    if (n != m || memcmp(expected, got, sizeof(got))) {
+		nerrors++;
+		fprintf(sd_test_out(a_test), "%s '%s' size %d: '%.*s' (%d) != '%.*s' (%d)\n",
+			j ? "parsed" : "direct", a_fmt, (int) sizes[i],
+			(int) sizes[i], got, m, (int) sizes[i], expected, n);
+	    }
+	}
+    }
+
+    sd_format_delete(parsed);
+}
+
+/******************************************************************************/
+static int test0(sd_test_t* a_test, int argc, char* argv[])
+{
+    int n1 = 0, n2 = 0;
+
+    nchecks = nerrors = 0;
+
+    check(a_test, "");
+    check(a_test, "plain text");
+    check(a_test, "100%% %5% %-5%|");
+    check(a_test, "%d %d %d %d", 0, 1, -1, 42);
+    check(a_test, "%d %d", 2147483647, -2147483647 - 1);
+    check(a_test, "%i|%5d|%-5d|%05d|%+d|% d|%+ d", 7, 7, 7, -7, 7, 7, 7);
+    check(a_test, "%.0d|%5.0d|%.3d|%8.3d|%-8.3d|%08.3d", 0, 0, 7, -7, 7, 7);
+    check(a_test, "%u %o %x %X", 4294967295U, 8U, 0xdeadbeefU, 0xdeadbeefU);
+    check(a_test, "%#o|%#o|%#.0o|%#5o|%#.3o", 8U, 0U, 0U, 8U, 8U);
+    check(a_test, "%#x|%#x|%#X|%#08x|%#-8x|%#.4x", 255U, 0U, 255U, 255U, 255U, 255U);
+    check(a_test, "%+u|% u|%#u", 5U, 5U, 5U);
+    check(a_test, "%hhd %hhu %hd %hu", 300, 300, 70000, 70000);
+    check(a_test, "%ld %lu %lx", -123456789L, 123456789UL, 0xabcdefUL);
+    check(a_test, "%lld %llu %llx %llo", -9223372036854775807LL - 1,
+	  18446744073709551615ULL, 0x0123456789abcdefULL, 01234567012345670ULL);
+    check(a_test, "%lld %lld %lld", 4294967295LL, 4294967296LL, 99999999999LL);
+    check(a_test, "%zu %zd %zx", (size_t) 12345, (ptrdiff_t) -12345, (size_t) 255);
+    check(a_test, "%td %tx", (ptrdiff_t) -7, (ptrdiff_t) 255);
+    check(a_test, "%*d|%-*d|%*d|%.*d|%.*d", 6, 1, 6, 2, -6, 3, 4, 5, -1, 6);
+    check(a_test, "%c|%3c|%-3c|%03c", 'a', 'b', 'c', 'd');
+    check(a_test, "%s|%10s|%-10s|%.2s|%10.2s|%010s", "abc", "abc", "abc",
+	  "abc", "abc", "abc");
+    check(a_test, "%s|%.3s|%.6s|%8s", (char*) NULL, (char*) NULL,
+	  (char*) NULL, (char*) NULL);
+    check(a_test, "%.*s|%.*s", 3, "abcdef", -1, "abcdef");
+    check(a_test, "%f %e %g %a", 3.14159, 1e-10, 1e20, 0.5);
+    check(a_test, "%8.3f|%-8.3f|%08.3f|%+.2e|% G|%#g|%.0f", 3.14159, 3.14159,
+	  -3.14159, 12345.678, 0.0001, 1.0, 2.5);
+    check(a_test, "%*.*f|%Lf|%Lg", 10, 2, 1.0 / 3, (long double) 2.5,
+	  (long double) 1e100);
+    check(a_test, "%p %p %10p", (void*) 0, (void*) &nchecks, (void*) &nerrors);
+    check(a_test, "%s=%d%n %s=%d%n", "a", 1, &n1, "b", 2, &n2);
+    check(a_test, "%2$s %1$s", "world", "hello");
+    check(a_test, "%'d", 1234567);
+    check(a_test, "%ls", L"wide");
+
+    n1 = n2 = 0;
+    {
+	char buf[16];
+
+	sd_snprintf(buf, sizeof(buf), "%s%n%d%n", "abc", &n1, 12345, &n2);
+	check(a_test, "%d %d", n1, n2);
+    }
+
+    fprintf(sd_test_out(a_test), "%d checks, %d errors\n", nchecks, nerrors);
+    return nerrors == 0 && n1 == 3 && n2 == 8;
+}
+
+/******************************************************************************/
+static double pow10_of(int a_exp)
+{
+    double p = 1;
+
+    for (; a_exp > 0; a_exp--)
+	p *= 10;
+    for (; a_exp < 0; a_exp++)
+	p /= 10;
+    return p;
+}
+
+/******************************************************************************/
+/* random integer conversions */
+static int test1(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char flags[] = "-+ #0";
+    static const char* lengths[] = { "", "hh", "h", "l", "ll" };
+    static const char convs[] = "diuoxX";
+    int i;
+
+    nchecks = nerrors = 0;
+    srand(1);
+
+    for (i = 0; i < 10000; i++) {
+	char fmt[32];
+	char* p = fmt;
+	const char* length = lengths[rand() % 5];
+	long long value = ((long long) rand() << 33) ^ ((long long) rand() << 16) ^
+	    rand();
+	int j;
+
+	*p++ = '|';
+	*p++ = '%';
+	for (j = 0; j < 5; j++)
+	    if (rand() % 4 == 0)
+		*p++ = flags[j];
+	if (rand() % 2)
+	    p += sprintf(p, "%d", rand() % 30);
+	if (rand() % 2)
+	    p += sprintf(p, ".%d", rand() % 25);
+	p += sprintf(p, "%s%c|", length, convs[rand() % 6]);
+
+	value >>= rand() % 64;
+	if (rand() % 2)
+	    value = -value;
+	if (rand() % 16 == 0)
+	    value = 0;
+
+	if (!strcmp(length, "ll"))
+	    check(a_test, fmt, value);
+	else if (!strcmp(length, "l"))
+	    check(a_test, fmt, (long) value);
+	else
+	    check(a_test, fmt, (int) value);
+    }
+
+    fprintf(sd_test_out(a_test), "%d checks, %d errors\n", nchecks, nerrors);
+    return nerrors == 0;
+}
+
+/******************************************************************************/
+/* random floating point conversions, ties and values out of the fast path */
+static int test2(sd_test_t* a_test, int argc, char* argv[])
+{
+    static const char flags[] = "-+ #0";
+    static const char convs[] = "feEgGF";
+    static const double specials[] = {
+	0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.375, 1e15 + 0.5, 9.9999995,
+	0.000099999995, 1e-300, 5e-324, 1.7976931348623157e308,
+	1e22, 1e23, 123456789012345678.0,
+    };
+    double inf = 1e308 * 10;
+    char buffer[32];
+    int i;
+
+    nchecks = nerrors = 0;
+    srand(2);
+
+    check(a_test, "%f|%e|%g|%G|%F", inf, -inf, inf - inf, inf, -inf);
+    check(a_test, "%.30f|%.20e|%.16g|%#.0e|%#.0f|%.0g", 0.1, 0.1, 0.1, 5.0,
+	  5.0, 0.0);
+    check(a_test, "%g|%.3e|%f|%G", 999999.5, 999999.5, 999999.5, -999999.5);
+
+    /* glibc drops the zeros "#" keeps when the rounding carries into a
+       new digit, and prints "1.e+06" */
+    nchecks++;
+    if (sd_snprintf(buffer, sizeof(buffer), "%#g", 999999.5) != 11 ||
+	strcmp(buffer, "1.00000e+06")) {
+	nerrors++;
+	fprintf(sd_test_out(a_test), "'%%#g' of 999999.5: '%s'\n", buffer);
+    }
+
+    for (i = 0; i < 20000; i++) {
+	char fmt[32];
+	char* p = fmt;
+	double value;
+	int j;
+
+	*p++ = '|';
+	*p++ = '%';
+	for (j = 0; j < 5; j++)
+	    if (rand() % 6 == 0)
+		*p++ = flags[j];
+	if (rand() % 3 == 0)
+	    p += sprintf(p, "%d", rand() % 30);
+	if (rand() % 2)
+	    p += sprintf(p, ".%d", rand() % 18);
+	p += sprintf(p, "%c|", convs[rand() % 6]);
+
+	switch (rand() % 4) {
+	case 0:
+	    value = specials[rand() % (sizeof(specials) / sizeof(specials[0]))];
+	    break;
+	case 1:
+	    /* ties at some precision */
+	    value = (rand() % 100000) / (double) (1 << (rand() % 12));
+	    break;
+	default:
+	    value = ((double) rand() / RAND_MAX + rand() % 10) *
+		pow10_of(rand() % 60 - 30);
+	    break;
+	}
+	if (rand() % 2)
+	    value = -value;
+
+	check(a_test, fmt, value);
+    }
+
+    fprintf(sd_test_out(a_test), "%d checks, %d errors\n", nchecks, nerrors);
+    return nerrors == 0;
+}
+
+/******************************************************************************/
+int main(int argc, char* argv[])
+{
+    int ret;
+    sd_test_t* t = sd_test_new(argc, argv);
+
+    sd_test_add(t, test0);
+    sd_test_add(t, test1);
+    sd_test_add(t, test2);
+
+    ret = sd_test_run(t, argc, argv);
+
+    sd_test_delete(t);
+
+    return ! ret;
+}